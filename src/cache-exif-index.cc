@@ -0,0 +1,709 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cache-exif-index.h"
+
+#include <sys/mman.h>
+
+#include <clocale>
+#include <cstring>
+
+#include "cache.h"
+#include "debug.h"
+#include "exif.h"
+#include "filedata.h"
+#include "intl.h"
+#include "metadata.h"
+#include "options.h"
+#include "secure-save.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Binary metadata index file format:
+ *-------------------------------------------------------------------
+ *
+ * One index per source folder, holding the values of the metadata keys
+ * read most often (#exif_index_fields) for every file in that folder, so
+ * sorting, the sidebar, the OSD and searches do not parse the files again:
+ *
+ * ExifIndexHeader
+ * ExifIndexRecord[count]  fixed size, in no particular order
+ * data[data_size]         file names and values, referenced by records
+ *
+ * The values of a record are, for each field in order, a guint32 count
+ * followed by count NUL terminated strings. A record is valid while the
+ * size and modification time of the file and of its sidecars are unchanged.
+ * Formatted values depend on the locale, an index written with another
+ * locale is ignored.
+ *
+ * The file is mapped read only, changes are kept in memory. The indexes
+ * of the #EXIF_INDEX_OPEN_MAX most recently used folders are kept open,
+ * and are written shortly after they change and when they are closed.
+ *
+ * All functions are thread safe.
+ */
+
+namespace
+{
+
+struct ExifIndexField
+{
+	const gchar *key;
+	MetadataFormat format;
+};
+
+constexpr ExifIndexField exif_index_fields[] = {
+	{"Exif.Photo.DateTimeOriginal",	METADATA_PLAIN},
+	{"Exif.Photo.DateTimeDigitized",	METADATA_PLAIN},
+	{ORIENTATION_KEY,		METADATA_PLAIN},
+	{RATING_KEY,			METADATA_PLAIN},
+	{KEYWORD_KEY,			METADATA_PLAIN},
+	{"Exif.Image.Make",		METADATA_PLAIN},
+	{"Exif.Image.Model",		METADATA_PLAIN},
+	{"Exif.Photo.LensModel",	METADATA_PLAIN},
+	{"Xmp.exif.GPSLatitude",	METADATA_PLAIN},
+	{"Xmp.exif.GPSLongitude",	METADATA_PLAIN},
+	{"Xmp.exif.GPSImgDirection",	METADATA_PLAIN},
+	{"formatted.Camera",		METADATA_FORMATTED},
+	{"formatted.DateTime",		METADATA_FORMATTED},
+	{"formatted.DateTimeDigitized",	METADATA_FORMATTED},
+	{"formatted.ShutterSpeed",	METADATA_FORMATTED},
+	{"formatted.Aperture",		METADATA_FORMATTED},
+	{"formatted.ExposureBias",	METADATA_FORMATTED},
+	{"formatted.ISOSpeedRating",	METADATA_FORMATTED},
+	{"formatted.FocalLength",	METADATA_FORMATTED},
+	{"formatted.FocalLength35mmFilm",	METADATA_FORMATTED},
+	{"formatted.Flash",		METADATA_FORMATTED},
+	{"formatted.GPSPosition",	METADATA_FORMATTED},
+	{"formatted.GPSAltitude",	METADATA_FORMATTED},
+};
+
+constexpr guint32 EXIF_INDEX_FIELD_COUNT = sizeof(exif_index_fields) / sizeof(exif_index_fields[0]);
+
+constexpr gchar exif_index_magic[8] = {'G', 'Q', 'E', 'X', 'I', 'D', 'X', '\0'};
+constexpr guint32 exif_index_version = 2;
+
+constexpr guint EXIF_INDEX_OPEN_MAX = 16; /**< folder indexes kept in memory */
+constexpr guint EXIF_INDEX_SAVE_DELAY = 5; /**< seconds from a change to saving */
+
+struct ExifIndexHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 record_size;
+	guint32 field_count;
+	guint32 locale_hash;
+	guint32 count;
+	guint32 data_size;
+};
+
+struct ExifIndexRecord
+{
+	gint64 size;
+	gint64 date;
+	gint64 sidecar_date;
+	guint32 name_offset;
+	guint32 name_length;
+	guint32 values_offset;
+	guint32 values_length;
+};
+
+struct ExifIndexEntry
+{
+	gint64 size;
+	gint64 date;
+	gint64 sidecar_date;
+	const guchar *values; /**< in the mapped index or in owned */
+	guint32 values_length;
+	guchar *owned;
+};
+
+/**
+ * @brief The contents of an index to be written, copied from an #ExifIndex
+ */
+struct ExifIndexSave
+{
+	gchar *dir;
+	GArray *records; /**< #ExifIndexRecord */
+	GByteArray *data;
+};
+
+struct ExifIndex
+{
+	gchar *dir;
+
+	guchar *map_data;
+	gsize map_len;
+
+	GHashTable *entries; /**< file name -> #ExifIndexEntry */
+
+	gboolean dirty;
+};
+
+GMutex exif_index_mutex;
+GHashTable *exif_index_folders; /**< folder -> #ExifIndex, guarded by exif_index_mutex */
+GQueue exif_index_lru = G_QUEUE_INIT; /**< #ExifIndex, most recently used first */
+guint exif_index_save_id; /**< event source id */
+GList *exif_index_saves; /**< #ExifIndexSave to be written once exif_index_mutex is released */
+
+gint exif_index_field_find(const gchar *key, MetadataFormat format)
+{
+	for (guint32 i = 0; i < EXIF_INDEX_FIELD_COUNT; i++)
+		{
+		if (exif_index_fields[i].format == format && strcmp(exif_index_fields[i].key, key) == 0) return i;
+		}
+
+	return -1;
+}
+
+guint32 exif_index_locale_hash()
+{
+	static const guint32 hash = g_str_hash(setlocale(LC_ALL, nullptr));
+
+	return hash;
+}
+
+gboolean exif_index_entry_valid(const ExifIndexEntry *entry, const ExifIndexFile &file)
+{
+	return entry->size == file.size &&
+	       entry->date == file.date &&
+	       entry->sidecar_date == file.sidecar_date;
+}
+
+void exif_index_entry_free(gpointer data)
+{
+	auto entry = static_cast<ExifIndexEntry *>(data);
+
+	g_free(entry->owned);
+	g_free(entry);
+}
+
+/**
+ * @returns The values of \a field, or FALSE if \a values is malformed
+ */
+gboolean exif_index_values_get(const guchar *values, gsize len, gint field, GList **list)
+{
+	gsize pos = 0;
+
+	*list = nullptr;
+
+	for (gint i = 0; i <= field; i++)
+		{
+		guint32 count;
+
+		if (len - pos < sizeof(count)) return FALSE;
+		memcpy(&count, values + pos, sizeof(count));
+		pos += sizeof(count);
+
+		for (guint32 n = 0; n < count; n++)
+			{
+			auto str = reinterpret_cast<const gchar *>(values + pos);
+			auto end = static_cast<const gchar *>(memchr(str, '\0', len - pos));
+
+			if (!end)
+				{
+				g_list_free_full(*list, g_free);
+				*list = nullptr;
+				return FALSE;
+				}
+
+			if (i == field) *list = g_list_prepend(*list, g_strdup(str));
+			pos += end - str + 1;
+			}
+		}
+
+	*list = g_list_reverse(*list);
+
+	return TRUE;
+}
+
+void exif_index_map(ExifIndex *ei)
+{
+	g_autofree gchar *path = cache_exif_index_location(ei->dir, FALSE);
+	if (!path) return;
+
+	g_autofree gchar *pathl = path_from_utf8(path);
+	gsize map_len = 0;
+	guchar *map_data = map_file(pathl, map_len);
+	if (!map_data) return;
+
+	const auto *header = reinterpret_cast<const ExifIndexHeader *>(map_data);
+
+	if (map_len < sizeof(ExifIndexHeader) ||
+	    memcmp(header->magic, exif_index_magic, sizeof(exif_index_magic)) != 0 ||
+	    header->version != exif_index_version ||
+	    header->record_size != sizeof(ExifIndexRecord) ||
+	    header->field_count != EXIF_INDEX_FIELD_COUNT ||
+	    header->locale_hash != exif_index_locale_hash() ||
+	    sizeof(ExifIndexHeader) + static_cast<guint64>(header->count) * sizeof(ExifIndexRecord) + header->data_size != map_len)
+		{
+		DEBUG_1("exif index %s is invalid or outdated, ignoring", path);
+		munmap(map_data, map_len);
+		return;
+		}
+
+	ei->map_data = map_data;
+	ei->map_len = map_len;
+
+	const auto *records = reinterpret_cast<const ExifIndexRecord *>(map_data + sizeof(ExifIndexHeader));
+	const auto *data = reinterpret_cast<const guchar *>(records + header->count);
+
+	for (guint32 i = 0; i < header->count; i++)
+		{
+		const ExifIndexRecord *rec = records + i;
+
+		if (static_cast<guint64>(rec->name_offset) + rec->name_length >= header->data_size ||
+		    data[rec->name_offset + rec->name_length] != '\0' ||
+		    static_cast<guint64>(rec->values_offset) + rec->values_length > header->data_size)
+			{
+			continue;
+			}
+
+		auto entry = g_new0(ExifIndexEntry, 1);
+		entry->size = rec->size;
+		entry->date = rec->date;
+		entry->sidecar_date = rec->sidecar_date;
+		entry->values = data + rec->values_offset;
+		entry->values_length = rec->values_length;
+
+		g_hash_table_insert(ei->entries, g_strdup(reinterpret_cast<const gchar *>(data + rec->name_offset)), entry);
+		}
+
+	DEBUG_1("exif index %s: %u records", path, header->count);
+}
+
+/**
+ * @brief Copies the records of a changed index to be written
+ *
+ * Must be called with exif_index_mutex held. The file is written by
+ * exif_index_save_pending() once the mutex is released, so the checks
+ * for deleted files do not block the other threads.
+ */
+void exif_index_save(ExifIndex *ei)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	if (!ei->dirty) return;
+
+	ei->dirty = FALSE;
+
+	if (!options->thumbnails.enable_caching) return;
+
+	auto save = g_new0(ExifIndexSave, 1);
+	save->dir = g_strdup(ei->dir);
+	save->records = g_array_sized_new(FALSE, FALSE, sizeof(ExifIndexRecord), g_hash_table_size(ei->entries));
+	save->data = g_byte_array_new();
+
+	g_hash_table_iter_init(&iter, ei->entries);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+		auto name = static_cast<const gchar *>(key);
+		auto entry = static_cast<const ExifIndexEntry *>(value);
+
+		ExifIndexRecord rec{};
+		rec.size = entry->size;
+		rec.date = entry->date;
+		rec.sidecar_date = entry->sidecar_date;
+		rec.name_offset = save->data->len;
+		rec.name_length = strlen(name);
+		g_byte_array_append(save->data, reinterpret_cast<const guint8 *>(name), rec.name_length + 1);
+		rec.values_offset = save->data->len;
+		rec.values_length = entry->values_length;
+		g_byte_array_append(save->data, entry->values, entry->values_length);
+
+		g_array_append_val(save->records, rec);
+		}
+
+	exif_index_saves = g_list_prepend(exif_index_saves, save);
+}
+
+void exif_index_save_free(ExifIndexSave *save)
+{
+	g_byte_array_free(save->data, TRUE);
+	g_array_free(save->records, TRUE);
+	g_free(save->dir);
+	g_free(save);
+}
+
+gboolean exif_index_save_write(ExifIndexSave *save)
+{
+	g_autofree gchar *path = cache_exif_index_location(save->dir, TRUE);
+	if (!path) return FALSE;
+
+	/* drop the files that no longer exist */
+	guint32 count = 0;
+	for (guint i = 0; i < save->records->len; i++)
+		{
+		const ExifIndexRecord &rec = g_array_index(save->records, ExifIndexRecord, i);
+		g_autofree gchar *source = g_build_filename(save->dir, reinterpret_cast<const gchar *>(save->data->data + rec.name_offset), NULL);
+
+		if (isfile(source)) g_array_index(save->records, ExifIndexRecord, count++) = rec;
+		}
+	g_array_set_size(save->records, count);
+
+	ExifIndexHeader header{};
+	memcpy(header.magic, exif_index_magic, sizeof(exif_index_magic));
+	header.version = exif_index_version;
+	header.record_size = sizeof(ExifIndexRecord);
+	header.field_count = EXIF_INDEX_FIELD_COUNT;
+	header.locale_hash = exif_index_locale_hash();
+	header.count = save->records->len;
+	header.data_size = save->data->len;
+
+	g_autofree gchar *pathl = path_from_utf8(path);
+	SecureSaveInfo *ssi = secure_open(pathl);
+	gboolean ret = FALSE;
+
+	if (!ssi)
+		{
+		log_printf("Unable to save exif index: %s\n", path);
+		}
+	else
+		{
+		secure_fwrite(&header, sizeof(header), 1, ssi);
+		if (save->records->len > 0) secure_fwrite(save->records->data, sizeof(ExifIndexRecord), save->records->len, ssi);
+		if (save->data->len > 0) secure_fwrite(save->data->data, 1, save->data->len, ssi);
+
+		if (secure_close(ssi))
+			{
+			log_printf(_("error saving exif index: %s\nerror: %s\n"), path,
+				    secsave_strerror(secsave_errno));
+			}
+		else
+			{
+			ret = TRUE;
+			}
+		}
+
+	DEBUG_1("exif index %s: saved %u records", path, save->records->len);
+
+	return ret;
+}
+
+/**
+ * @brief Writes the indexes copied by exif_index_save()
+ *
+ * Must be called without exif_index_mutex held.
+ */
+void exif_index_save_pending()
+{
+	g_mutex_lock(&exif_index_mutex);
+	GList *saves = g_list_reverse(exif_index_saves);
+	exif_index_saves = nullptr;
+	g_mutex_unlock(&exif_index_mutex);
+
+	for (GList *work = saves; work; work = work->next)
+		{
+		auto save = static_cast<ExifIndexSave *>(work->data);
+
+		exif_index_save_write(save);
+		exif_index_save_free(save);
+		}
+
+	g_list_free(saves);
+}
+
+void exif_index_free(ExifIndex *ei)
+{
+	exif_index_save(ei);
+
+	g_hash_table_destroy(ei->entries);
+	if (ei->map_data) munmap(ei->map_data, ei->map_len);
+	g_free(ei->dir);
+	g_free(ei);
+}
+
+/**
+ * @brief The index of a folder, opened if needed
+ *
+ * Must be called with exif_index_mutex held.
+ */
+ExifIndex *exif_index_get(const gchar *dir)
+{
+	if (!exif_index_folders) exif_index_folders = g_hash_table_new(g_str_hash, g_str_equal);
+
+	auto ei = static_cast<ExifIndex *>(g_hash_table_lookup(exif_index_folders, dir));
+	if (ei)
+		{
+		if (g_queue_peek_head(&exif_index_lru) != ei)
+			{
+			g_queue_remove(&exif_index_lru, ei);
+			g_queue_push_head(&exif_index_lru, ei);
+			}
+		return ei;
+		}
+
+	ei = g_new0(ExifIndex, 1);
+	ei->dir = g_strdup(dir);
+	ei->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, exif_index_entry_free);
+
+	exif_index_map(ei);
+
+	g_hash_table_insert(exif_index_folders, ei->dir, ei);
+	g_queue_push_head(&exif_index_lru, ei);
+
+	if (g_queue_get_length(&exif_index_lru) > EXIF_INDEX_OPEN_MAX)
+		{
+		auto old = static_cast<ExifIndex *>(g_queue_pop_tail(&exif_index_lru));
+
+		g_hash_table_remove(exif_index_folders, old->dir);
+		exif_index_free(old);
+		}
+
+	return ei;
+}
+
+ExifIndexEntry *exif_index_find(const ExifIndexFile &file, gboolean open)
+{
+	g_autofree gchar *dir = remove_level_from_path(file.path);
+	ExifIndex *ei;
+
+	if (open)
+		{
+		ei = exif_index_get(dir);
+		}
+	else
+		{
+		ei = exif_index_folders ? static_cast<ExifIndex *>(g_hash_table_lookup(exif_index_folders, dir)) : nullptr;
+		if (!ei) return nullptr;
+		}
+
+	return static_cast<ExifIndexEntry *>(g_hash_table_lookup(ei->entries, filename_from_path(file.path)));
+}
+
+gboolean exif_index_save_cb(gpointer)
+{
+	g_mutex_lock(&exif_index_mutex);
+	exif_index_save_id = 0;
+	g_mutex_unlock(&exif_index_mutex);
+
+	exif_index_flush();
+
+	return G_SOURCE_REMOVE;
+}
+
+void exif_index_changed(ExifIndex *ei)
+{
+	ei->dirty = TRUE;
+
+	if (!exif_index_save_id)
+		{
+		exif_index_save_id = g_timeout_add_seconds(EXIF_INDEX_SAVE_DELAY, exif_index_save_cb, nullptr);
+		}
+}
+
+} // namespace
+
+/**
+ * @brief Copies the state of \a fd the index records are checked against
+ *
+ * Done on the main thread, so worker threads never read the FileData.
+ * Free with exif_index_file_clear().
+ */
+void exif_index_file_init(ExifIndexFile &file, const FileData *fd)
+{
+	file.path = g_strdup(fd->path);
+	file.size = fd->size;
+	file.date = fd->date;
+	file.modified_xmp = fd->modified_xmp != nullptr;
+
+	/* written sidecars change the metadata without touching the file */
+	file.sidecar_date = 0;
+	for (GList *work = fd->sidecar_files; work; work = work->next)
+		{
+		file.sidecar_date = MAX(file.sidecar_date, static_cast<gint64>(static_cast<FileData *>(work->data)->date));
+		}
+}
+
+void exif_index_file_clear(ExifIndexFile &file)
+{
+	g_free(file.path);
+	file.path = nullptr;
+}
+
+/**
+ * @brief Looks up the value of a metadata key in the index
+ * @param values Set to the values, as exif_get_metadata() would return them
+ * @returns FALSE if \a key is not indexed or the file has no up to date record
+ */
+gboolean exif_index_lookup_file(const ExifIndexFile &file, const gchar *key, MetadataFormat format, GList **values)
+{
+	gint field;
+	gboolean ret = FALSE;
+
+	if (!file.path || !key) return FALSE;
+
+	/* the metadata read from the file include the unsaved changes */
+	if (file.modified_xmp) return FALSE;
+
+	field = exif_index_field_find(key, format);
+	if (field < 0) return FALSE;
+
+	g_mutex_lock(&exif_index_mutex);
+
+	ExifIndexEntry *entry = exif_index_find(file, TRUE);
+	if (entry && exif_index_entry_valid(entry, file))
+		{
+		ret = exif_index_values_get(entry->values, entry->values_length, field, values);
+		}
+
+	g_mutex_unlock(&exif_index_mutex);
+
+	/* of an index closed to open this one */
+	exif_index_save_pending();
+
+	return ret;
+}
+
+gboolean exif_index_lookup(FileData *fd, const gchar *key, MetadataFormat format, GList **values)
+{
+	if (!fd) return FALSE;
+
+	ExifIndexFile file;
+	exif_index_file_init(file, fd);
+	gboolean ret = exif_index_lookup_file(file, key, format, values);
+	exif_index_file_clear(file);
+
+	return ret;
+}
+
+/**
+ * @brief Records the indexed values of a file, if it has no up to date record
+ * @param exif The metadata of the file, as returned by exif_read()
+ */
+void exif_index_update_file(const ExifIndexFile &file, ExifData *exif)
+{
+	if (!file.path || !exif || file.modified_xmp) return;
+
+	g_mutex_lock(&exif_index_mutex);
+	ExifIndexEntry *entry = exif_index_find(file, TRUE);
+	gboolean valid = (entry && exif_index_entry_valid(entry, file));
+	g_mutex_unlock(&exif_index_mutex);
+
+	if (valid) return;
+
+	GByteArray *values = g_byte_array_new();
+
+	for (const auto &field : exif_index_fields)
+		{
+		GList *list = exif_get_metadata(exif, field.key, field.format);
+		guint32 count = 0;
+		guint count_pos = values->len;
+
+		g_byte_array_append(values, reinterpret_cast<const guint8 *>(&count), sizeof(count));
+
+		for (GList *work = list; work; work = work->next)
+			{
+			auto str = static_cast<const gchar *>(work->data);
+			if (!str) continue;
+
+			g_byte_array_append(values, reinterpret_cast<const guint8 *>(str), strlen(str) + 1);
+			count++;
+			}
+
+		memcpy(values->data + count_pos, &count, sizeof(count));
+		g_list_free_full(list, g_free);
+		}
+
+	auto new_entry = g_new0(ExifIndexEntry, 1);
+	new_entry->size = file.size;
+	new_entry->date = file.date;
+	new_entry->sidecar_date = file.sidecar_date;
+	new_entry->values_length = values->len;
+	new_entry->owned = g_byte_array_free(values, FALSE);
+	new_entry->values = new_entry->owned;
+
+	g_autofree gchar *dir = remove_level_from_path(file.path);
+
+	g_mutex_lock(&exif_index_mutex);
+	ExifIndex *ei = exif_index_get(dir);
+	g_hash_table_replace(ei->entries, g_strdup(filename_from_path(file.path)), new_entry);
+	exif_index_changed(ei);
+	g_mutex_unlock(&exif_index_mutex);
+
+	exif_index_save_pending();
+}
+
+void exif_index_update(FileData *fd, ExifData *exif)
+{
+	if (!fd) return;
+
+	ExifIndexFile file;
+	exif_index_file_init(file, fd);
+	exif_index_update_file(file, exif);
+	exif_index_file_clear(file);
+}
+
+/**
+ * @brief Drops the record of a file whose metadata were written
+ */
+void exif_index_forget(FileData *fd)
+{
+	if (!fd) return;
+
+	g_autofree gchar *dir = remove_level_from_path(fd->path);
+
+	g_mutex_lock(&exif_index_mutex);
+
+	ExifIndex *ei = exif_index_folders ? static_cast<ExifIndex *>(g_hash_table_lookup(exif_index_folders, dir)) : nullptr;
+	if (ei && g_hash_table_remove(ei->entries, fd->name)) exif_index_changed(ei);
+
+	g_mutex_unlock(&exif_index_mutex);
+}
+
+/**
+ * @brief Saves all changed indexes
+ */
+void exif_index_flush()
+{
+	g_mutex_lock(&exif_index_mutex);
+
+	for (GList *work = exif_index_lru.head; work; work = work->next)
+		{
+		exif_index_save(static_cast<ExifIndex *>(work->data));
+		}
+
+	g_mutex_unlock(&exif_index_mutex);
+
+	exif_index_save_pending();
+}
+
+/**
+ * @brief Saves and closes all indexes, they are read again on next use
+ */
+void exif_index_close()
+{
+	g_mutex_lock(&exif_index_mutex);
+
+	while (!g_queue_is_empty(&exif_index_lru))
+		{
+		auto ei = static_cast<ExifIndex *>(g_queue_pop_head(&exif_index_lru));
+
+		g_hash_table_remove(exif_index_folders, ei->dir);
+		exif_index_free(ei);
+		}
+
+	g_mutex_unlock(&exif_index_mutex);
+
+	exif_index_save_pending();
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CACHE_EXIF_INDEX_H
+#define CACHE_EXIF_INDEX_H
+
+#include <glib.h>
+
+#include "typedefs.h"
+
+struct ExifData;
+class FileData;
+
+/**
+ * @brief The state of a file its index record is checked against
+ */
+struct ExifIndexFile
+{
+	gchar *path;
+	gint64 size;
+	gint64 date;
+	gint64 sidecar_date;
+	gboolean modified_xmp;
+};
+
+void exif_index_file_init(ExifIndexFile &file, const FileData *fd);
+void exif_index_file_clear(ExifIndexFile &file);
+
+gboolean exif_index_lookup_file(const ExifIndexFile &file, const gchar *key, MetadataFormat format, GList **values);
+void exif_index_update_file(const ExifIndexFile &file, ExifData *exif);
+
+gboolean exif_index_lookup(FileData *fd, const gchar *key, MetadataFormat format, GList **values);
+void exif_index_update(FileData *fd, ExifData *exif);
+void exif_index_forget(FileData *fd);
+void exif_index_flush();
+void exif_index_close();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -61,6 +61,7 @@ static gboolean cache_loader_phase1_process(CacheLoader *cl)
 		if (!cl->il && !cl->error)
 			{
 			cl->il = image_loader_new(cl->fd);
+			image_loader_set_job_class(cl->il, IMAGE_LOADER_JOB_BACKGROUND);
 			g_signal_connect(G_OBJECT(cl->il), "error", (GCallback)cache_loader_phase1_error_cb, cl);
 			g_signal_connect(G_OBJECT(cl->il), "done", (GCallback)cache_loader_phase1_done_cb, cl);
 			if (image_loader_start(cl->il))
@@ -281,15 +281,30 @@ static gboolean cache_maintain_home_cb(gpointer data)
 			while (work)
 				{
 				auto fd_list = static_cast<FileData *>(work->data);
-				gchar *path_buf = g_strdup(fd_list->path);
+				gchar *path_buf;
+				gboolean orphan;
 
-				gchar *dot = strrchr(path_buf, '.');
-
-				if (dot) *dot = '\0';
-				if ((!cm->metadata && cm->clear) ||
-				    (strlen(path_buf) > base_length && !isfile(path_buf + base_length)) )
+				if (!cm->metadata && (strcmp(fd_list->name, GQ_CACHE_SIM_INDEX) == 0 ||
+				                      strcmp(fd_list->name, GQ_CACHE_EXIF_INDEX) == 0))
 					{
+					/* the indexes belong to the folder, not to a file */
+					g_autofree gchar *dir_buf = remove_level_from_path(fd_list->path);
+					orphan = (strlen(dir_buf) > base_length && !isdir(dir_buf + base_length));
+					path_buf = g_strdup(fd_list->path);
+					}
+				else
+					{
+					path_buf = g_strdup(fd_list->path);
+
+					gchar *dot = strrchr(path_buf, '.');
+
+					if (dot) *dot = '\0';
+					orphan = (strlen(path_buf) > base_length && !isfile(path_buf + base_length));
 					if (dot) *dot = '.';
+					}
+
+				if ((!cm->metadata && cm->clear) || orphan)
+					{
 					if (!unlink_file(path_buf)) log_printf("failed to delete:%s\n", path_buf);
 					}
 				else
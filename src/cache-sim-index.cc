@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cache-sim-index.h"
+
+#include <sys/mman.h>
+
+#include <cstring>
+
+#include "cache.h"
+#include "debug.h"
+#include "filedata.h"
+#include "intl.h"
+#include "secure-save.h"
+#include "similar.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Binary similarity index file format:
+ *-------------------------------------------------------------------
+ *
+ * One index per source folder, holding the data of the per-file .sim
+ * cache files for every image in that folder:
+ *
+ * SimIndexHeader
+ * SimIndexRecord[count]  fixed size, in no particular order
+ * names[names_size]      NUL terminated file names, referenced by records
+ *
+ * A record is valid while the size and modification time of its source
+ * file are unchanged. Similarity data is stored as three 1024 byte
+ * planes (red, green, blue) so it can be copied straight into
+ * #ImageSimilarityData.
+ *
+ * The file is mapped read only. Changes are kept in memory and the
+ * whole index is rewritten by sim_index_save().
+ */
+
+namespace
+{
+
+constexpr gchar sim_index_magic[8] = {'G', 'Q', 'S', 'I', 'M', 'I', 'D', 'X'};
+constexpr guint32 sim_index_version = 1;
+
+enum SimIndexFlags : guint32 {
+	SIM_INDEX_DIMENSIONS = 1 << 0,
+	SIM_INDEX_MD5SUM     = 1 << 1,
+	SIM_INDEX_SIMILARITY = 1 << 2
+};
+
+struct SimIndexHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 record_size;
+	guint32 count;
+	guint32 names_size;
+};
+
+struct SimIndexRecord
+{
+	gint64 size;
+	gint64 date;
+	guint32 name_offset;
+	guint32 name_length;
+	gint32 width;
+	gint32 height;
+	guint32 flags;
+	guint32 reserved;
+	guint8 md5sum[16];
+	guint8 sim[3 * 1024];
+};
+
+gboolean sim_index_record_valid(const SimIndexRecord *rec, FileData *fd)
+{
+	return rec->size == fd->size && rec->date == static_cast<gint64>(fd->date);
+}
+
+} // namespace
+
+struct SimIndex
+{
+	gchar *dir;
+
+	guchar *map_data;
+	gsize map_len;
+
+	GHashTable *records; /**< file name -> #SimIndexRecord in map_data */
+	GHashTable *updates; /**< file name -> #SimIndexRecord added or changed since the index was mapped */
+
+	gboolean dirty;
+};
+
+static void sim_index_map(SimIndex *si)
+{
+	g_autofree gchar *path = cache_sim_index_location(si->dir, FALSE);
+	if (!path) return;
+
+	g_autofree gchar *pathl = path_from_utf8(path);
+	gsize map_len = 0;
+	guchar *map_data = map_file(pathl, map_len);
+	if (!map_data) return;
+
+	const auto *header = reinterpret_cast<const SimIndexHeader *>(map_data);
+
+	if (map_len < sizeof(SimIndexHeader) ||
+	    memcmp(header->magic, sim_index_magic, sizeof(sim_index_magic)) != 0 ||
+	    header->version != sim_index_version ||
+	    header->record_size != sizeof(SimIndexRecord) ||
+	    sizeof(SimIndexHeader) + static_cast<guint64>(header->count) * sizeof(SimIndexRecord) + header->names_size != map_len)
+		{
+		DEBUG_1("sim index %s is invalid, ignoring", path);
+		munmap(map_data, map_len);
+		return;
+		}
+
+	si->map_data = map_data;
+	si->map_len = map_len;
+
+	const auto *records = reinterpret_cast<const SimIndexRecord *>(map_data + sizeof(SimIndexHeader));
+	const auto *names = reinterpret_cast<const gchar *>(records + header->count);
+
+	for (guint32 i = 0; i < header->count; i++)
+		{
+		const SimIndexRecord *rec = records + i;
+
+		if (static_cast<guint64>(rec->name_offset) + rec->name_length >= header->names_size ||
+		    names[rec->name_offset + rec->name_length] != '\0')
+			{
+			continue;
+			}
+
+		g_hash_table_insert(si->records, const_cast<gchar *>(names + rec->name_offset), const_cast<SimIndexRecord *>(rec));
+		}
+
+	DEBUG_1("sim index %s: %u records", path, header->count);
+}
+
+/**
+ * @brief Opens the similarity index of a folder
+ * @param dir Source folder
+ * @returns A new #SimIndex, empty if the folder has no index yet
+ */
+SimIndex *sim_index_open(const gchar *dir)
+{
+	SimIndex *si;
+
+	if (!dir) return nullptr;
+
+	si = g_new0(SimIndex, 1);
+	si->dir = g_strdup(dir);
+	si->records = g_hash_table_new(g_str_hash, g_str_equal);
+	si->updates = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	sim_index_map(si);
+
+	return si;
+}
+
+/**
+ * @brief Saves pending changes and frees the index
+ */
+void sim_index_free(SimIndex *si)
+{
+	if (!si) return;
+
+	sim_index_save(si);
+
+	g_hash_table_destroy(si->updates);
+	g_hash_table_destroy(si->records);
+	if (si->map_data) munmap(si->map_data, si->map_len);
+	g_free(si->dir);
+	g_free(si);
+}
+
+static const SimIndexRecord *sim_index_find(SimIndex *si, const gchar *name)
+{
+	auto rec = static_cast<const SimIndexRecord *>(g_hash_table_lookup(si->updates, name));
+	if (rec) return rec;
+
+	return static_cast<const SimIndexRecord *>(g_hash_table_lookup(si->records, name));
+}
+
+static void sim_index_append(GArray *records, GString *names, const gchar *name, const SimIndexRecord *rec)
+{
+	SimIndexRecord out = *rec;
+
+	out.name_offset = names->len;
+	out.name_length = strlen(name);
+	g_string_append_len(names, name, out.name_length + 1);
+
+	g_array_append_val(records, out);
+}
+
+/**
+ * @brief Rewrites the index file if anything changed
+ * @returns FALSE if the index could not be written
+ *
+ * Records of files that no longer exist are dropped.
+ */
+gboolean sim_index_save(SimIndex *si)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	if (!si || !si->dirty) return TRUE;
+
+	g_autofree gchar *path = cache_sim_index_location(si->dir, TRUE);
+	if (!path) return FALSE;
+
+	GArray *records = g_array_sized_new(FALSE, FALSE, sizeof(SimIndexRecord),
+					    g_hash_table_size(si->records) + g_hash_table_size(si->updates));
+	GString *names = g_string_new(nullptr);
+
+	g_hash_table_iter_init(&iter, si->records);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+		auto name = static_cast<const gchar *>(key);
+
+		if (g_hash_table_contains(si->updates, name)) continue;
+
+		g_autofree gchar *source = g_build_filename(si->dir, name, NULL);
+		if (!isfile(source)) continue;
+
+		sim_index_append(records, names, name, static_cast<const SimIndexRecord *>(value));
+		}
+
+	g_hash_table_iter_init(&iter, si->updates);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+		sim_index_append(records, names, static_cast<const gchar *>(key), static_cast<const SimIndexRecord *>(value));
+		}
+
+	SimIndexHeader header{};
+	memcpy(header.magic, sim_index_magic, sizeof(sim_index_magic));
+	header.version = sim_index_version;
+	header.record_size = sizeof(SimIndexRecord);
+	header.count = records->len;
+	header.names_size = names->len;
+
+	g_autofree gchar *pathl = path_from_utf8(path);
+	SecureSaveInfo *ssi = secure_open(pathl);
+	gboolean ret = FALSE;
+
+	if (!ssi)
+		{
+		log_printf("Unable to save sim index: %s\n", path);
+		}
+	else
+		{
+		secure_fwrite(&header, sizeof(header), 1, ssi);
+		if (records->len > 0) secure_fwrite(records->data, sizeof(SimIndexRecord), records->len, ssi);
+		if (names->len > 0) secure_fwrite(names->str, 1, names->len, ssi);
+
+		if (secure_close(ssi))
+			{
+			log_printf(_("error saving sim index: %s\nerror: %s\n"), path,
+				    secsave_strerror(secsave_errno));
+			}
+		else
+			{
+			si->dirty = FALSE;
+			ret = TRUE;
+			}
+		}
+
+	DEBUG_1("sim index %s: saved %u records", path, records->len);
+
+	g_string_free(names, TRUE);
+	g_array_free(records, TRUE);
+
+	return ret;
+}
+
+/**
+ * @brief Looks up the cached data of a file
+ * @returns A new #CacheData (without path) or NULL if there is no up to date record
+ */
+CacheData *sim_index_lookup(SimIndex *si, FileData *fd)
+{
+	if (!si || !fd) return nullptr;
+
+	const SimIndexRecord *rec = sim_index_find(si, fd->name);
+	if (!rec || !sim_index_record_valid(rec, fd)) return nullptr;
+
+	CacheData *cd = cache_sim_data_new();
+
+	if (rec->flags & SIM_INDEX_DIMENSIONS)
+		{
+		cache_sim_data_set_dimensions(cd, rec->width, rec->height);
+		}
+	if (rec->flags & SIM_INDEX_MD5SUM)
+		{
+		cache_sim_data_set_md5sum(cd, rec->md5sum);
+		}
+	if (rec->flags & SIM_INDEX_SIMILARITY)
+		{
+		cd->sim = image_sim_new();
+		memcpy(cd->sim->avg_r, rec->sim, 1024);
+		memcpy(cd->sim->avg_g, rec->sim + 1024, 1024);
+		memcpy(cd->sim->avg_b, rec->sim + 2048, 1024);
+		cd->sim->filled = TRUE;
+		cd->similarity = TRUE;
+		}
+
+	return cd;
+}
+
+/**
+ * @brief Records the data of a file
+ *
+ * Fields not set in \a cd are kept from an existing up to date record.
+ */
+void sim_index_update(SimIndex *si, FileData *fd, const CacheData *cd)
+{
+	if (!si || !fd || !cd) return;
+
+	auto rec = g_new0(SimIndexRecord, 1);
+
+	const SimIndexRecord *old = sim_index_find(si, fd->name);
+	if (old && sim_index_record_valid(old, fd)) *rec = *old;
+
+	rec->size = fd->size;
+	rec->date = fd->date;
+
+	if (cd->dimensions)
+		{
+		rec->width = cd->width;
+		rec->height = cd->height;
+		rec->flags |= SIM_INDEX_DIMENSIONS;
+		}
+	if (cd->have_md5sum)
+		{
+		memcpy(rec->md5sum, cd->md5sum, sizeof(rec->md5sum));
+		rec->flags |= SIM_INDEX_MD5SUM;
+		}
+	if (cd->similarity && cache_sim_data_filled(cd->sim))
+		{
+		memcpy(rec->sim, cd->sim->avg_r, 1024);
+		memcpy(rec->sim + 1024, cd->sim->avg_g, 1024);
+		memcpy(rec->sim + 2048, cd->sim->avg_b, 1024);
+		rec->flags |= SIM_INDEX_SIMILARITY;
+		}
+
+	if (old && memcmp(old, rec, sizeof(SimIndexRecord)) == 0)
+		{
+		g_free(rec);
+		return;
+		}
+
+	g_hash_table_replace(si->updates, g_strdup(fd->name), rec);
+	si->dirty = TRUE;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CACHE_SIM_INDEX_H
+#define CACHE_SIM_INDEX_H
+
+#include <glib.h>
+
+struct CacheData;
+class FileData;
+struct SimIndex;
+
+SimIndex *sim_index_open(const gchar *dir);
+void sim_index_free(SimIndex *si);
+
+gboolean sim_index_save(SimIndex *si);
+
+CacheData *sim_index_lookup(SimIndex *si, FileData *fd);
+void sim_index_update(SimIndex *si, FileData *fd, const CacheData *cd);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
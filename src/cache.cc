@@ -21,6 +21,7 @@
 
 #include "cache.h"
 
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <utime.h>
@@ -49,6 +50,21 @@
  * Cache data file format:
  *-------------------------------------------------------------------
  *
+ * A single fixed size #SimCacheFile record, in host byte order:
+ *
+ * magic "GQSIMBIN", version, record size, flags of the fields present \n
+ * width, height \n
+ * date (time_t, or -1 if no embedded date) \n
+ * md5sum (16 byte digest) \n
+ * similarity grid, as three 1024 byte planes (red, green, blue) of 32 x 32
+ *
+ * The whole file is read and validated with one pread(). Fields whose flag
+ * is not set are zero, except the date which is -1.
+ *
+ *-------------------------------------------------------------------
+ * Old text format, still read:
+ *-------------------------------------------------------------------
+ *
  * SIMcache \n
  * #comment \n
  * Dimensions=[<width> x <height>] \n
@@ -61,11 +77,37 @@
  * All data lines should end with a new line char. \n
  * Format is very strict, data must begin with the char immediately following '='. \n
  * Currently SimilarityGrid is always assumed to be 32 x 32 RGB. \n
+ *
+ * A text file is rewritten in the binary format when it is loaded.
  */
 
 namespace
 {
 
+constexpr gchar sim_cache_magic[8] = {'G', 'Q', 'S', 'I', 'M', 'B', 'I', 'N'};
+constexpr guint32 sim_cache_version = 1;
+
+enum SimCacheFlags : guint32 {
+	SIM_CACHE_DIMENSIONS = 1 << 0,
+	SIM_CACHE_DATE       = 1 << 1,
+	SIM_CACHE_MD5SUM     = 1 << 2,
+	SIM_CACHE_SIMILARITY = 1 << 3
+};
+
+struct SimCacheFile
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 size;
+	guint32 flags;
+	gint32 width;
+	gint32 height;
+	guint32 reserved;
+	gint64 date;
+	guint8 md5sum[16];
+	guint8 sim[3 * 1024];
+};
+
 struct CachePathParts
 {
 	CachePathParts(CacheType cache_type)
@@ -187,67 +229,43 @@ void cache_sim_data_free(CacheData *cd)
  *-------------------------------------------------------------------
  */
 
-static gboolean cache_sim_write_dimensions(SecureSaveInfo *ssi, CacheData *cd)
-{
-	if (!cd || !cd->dimensions) return FALSE;
-
-	secure_fprintf(ssi, "Dimensions=[%d x %d]\n", cd->width, cd->height);
-
-	return TRUE;
-}
-
-static gboolean cache_sim_write_date(SecureSaveInfo *ssi, CacheData *cd)
+static void cache_sim_write_file(SecureSaveInfo *ssi, CacheData *cd)
 {
-	if (!cd || !cd->have_date) return FALSE;
-
-	secure_fprintf(ssi, "Date=[%ld]\n", cd->date);
-
-	return TRUE;
-}
-
-static gboolean cache_sim_write_md5sum(SecureSaveInfo *ssi, CacheData *cd)
-{
-	gchar *text;
-
-	if (!cd || !cd->have_md5sum) return FALSE;
+	SimCacheFile file{};
 
-	text = md5_digest_to_text(cd->md5sum);
-	secure_fprintf(ssi, "MD5sum=[%s]\n", text);
-	g_free(text);
+	memcpy(file.magic, sim_cache_magic, sizeof(sim_cache_magic));
+	file.version = sim_cache_version;
+	file.size = sizeof(SimCacheFile);
+	file.date = -1;
 
-	return TRUE;
-}
-
-static gboolean cache_sim_write_similarity(SecureSaveInfo *ssi, CacheData *cd)
-{
-	guint x;
-	guint y;
-	guint8 buf[3 * 32];
-
-	if (!cd || !cd->similarity || !cd->sim || !cd->sim->filled) return FALSE;
-
-	secure_fprintf(ssi, "SimilarityGrid[32 x 32]=");
-	for (y = 0; y < 32; y++)
+	if (cd->dimensions)
 		{
-		guint s = y * 32;
-		guint8 *avg_r = &cd->sim->avg_r[s];
-		guint8 *avg_g = &cd->sim->avg_g[s];
-		guint8 *avg_b = &cd->sim->avg_b[s];
-		guint n = 0;
+		file.flags |= SIM_CACHE_DIMENSIONS;
+		file.width = cd->width;
+		file.height = cd->height;
+		}
 
-		for (x = 0; x < 32; x++)
-			{
-			buf[n++] = avg_r[x];
-			buf[n++] = avg_g[x];
-			buf[n++] = avg_b[x];
-			}
+	if (cd->have_date)
+		{
+		file.flags |= SIM_CACHE_DATE;
+		file.date = cd->date;
+		}
 
-		secure_fwrite(buf, sizeof(buf), 1, ssi);
+	if (cd->have_md5sum)
+		{
+		file.flags |= SIM_CACHE_MD5SUM;
+		memcpy(file.md5sum, cd->md5sum, sizeof(file.md5sum));
 		}
 
-	secure_fputc(ssi, '\n');
+	if (cd->similarity && cd->sim && cd->sim->filled)
+		{
+		file.flags |= SIM_CACHE_SIMILARITY;
+		memcpy(file.sim, cd->sim->avg_r, 1024);
+		memcpy(file.sim + 1024, cd->sim->avg_g, 1024);
+		memcpy(file.sim + 2048, cd->sim->avg_b, 1024);
+		}
 
-	return TRUE;
+	secure_fwrite(&file, sizeof(file), 1, ssi);
 }
 
 gboolean cache_sim_data_save(CacheData *cd)
@@ -267,11 +285,7 @@ gboolean cache_sim_data_save(CacheData *cd)
 		return FALSE;
 		}
 
-	secure_fprintf(ssi, "SIMcache\n#%s %s\n", PACKAGE, VERSION);
-	cache_sim_write_dimensions(ssi, cd);
-	cache_sim_write_date(ssi, cd);
-	cache_sim_write_md5sum(ssi, cd);
-	cache_sim_write_similarity(ssi, cd);
+	cache_sim_write_file(ssi, cd);
 
 	if (secure_close(ssi))
 		{
@@ -501,24 +515,52 @@ static gboolean cache_sim_read_similarity(FILE *f, gchar *buf, gint s, CacheData
 	return FALSE;
 }
 
-CacheData *cache_sim_data_load(const gchar *path)
+static gboolean cache_sim_read_file(const SimCacheFile &file, gssize len, CacheData *cd)
 {
-	FILE *f;
-	CacheData *cd = nullptr;
-	gchar buf[32];
-	gint success = CACHE_LOAD_LINE_NOISE;
-	gchar *pathl;
+	if (len != sizeof(SimCacheFile) ||
+	    file.version != sim_cache_version ||
+	    file.size != sizeof(SimCacheFile))
+		{
+		return FALSE;
+		}
 
-	if (!path) return nullptr;
+	if (file.flags & SIM_CACHE_DIMENSIONS)
+		{
+		cd->width = file.width;
+		cd->height = file.height;
+		cd->dimensions = TRUE;
+		}
 
-	pathl = path_from_utf8(path);
-	f = fopen(pathl, "r");
-	g_free(pathl);
+	if (file.flags & SIM_CACHE_DATE)
+		{
+		cd->date = file.date;
+		cd->have_date = TRUE;
+		}
 
-	if (!f) return nullptr;
+	if (file.flags & SIM_CACHE_MD5SUM)
+		{
+		memcpy(cd->md5sum, file.md5sum, sizeof(cd->md5sum));
+		cd->have_md5sum = TRUE;
+		}
 
-	cd = cache_sim_data_new();
-	cd->path = g_strdup(path);
+	if (file.flags & SIM_CACHE_SIMILARITY)
+		{
+		if (!cd->sim) cd->sim = image_sim_new();
+
+		memcpy(cd->sim->avg_r, file.sim, 1024);
+		memcpy(cd->sim->avg_g, file.sim + 1024, 1024);
+		memcpy(cd->sim->avg_b, file.sim + 2048, 1024);
+		cd->sim->filled = TRUE;
+		cd->similarity = TRUE;
+		}
+
+	return TRUE;
+}
+
+static void cache_sim_read_text(FILE *f, CacheData *cd)
+{
+	gchar buf[32];
+	gint success = CACHE_LOAD_LINE_NOISE;
 
 	if (fread(&buf, sizeof(gchar), 9, f) != 9 ||
 	    strncmp(buf, "SIMcache", 8) != 0)
@@ -559,8 +601,75 @@ CacheData *cache_sim_data_load(const gchar *path)
 				}
 			}
 		}
+}
+
+/**
+ * @brief Replaces a text format cache file with the binary format
+ *
+ * The modification time is kept, as it ties the cache file to its source.
+ */
+static void cache_sim_upgrade(CacheData *cd, time_t mtime)
+{
+	if (!access_file(cd->path, W_OK)) return;
+
+	DEBUG_1("upgrading sim cache file %s", cd->path);
+
+	if (cache_sim_data_save(cd))
+		{
+		filetime_set(cd->path, mtime);
+		}
+}
+
+CacheData *cache_sim_data_load(const gchar *path)
+{
+	CacheData *cd = nullptr;
+	SimCacheFile file;
+	struct stat st;
+	gssize len;
+	gint fd;
+
+	if (!path) return nullptr;
+
+	g_autofree gchar *pathl = path_from_utf8(path);
+	fd = open(pathl, O_RDONLY);
+
+	if (fd == -1) return nullptr;
+
+	cd = cache_sim_data_new();
+	cd->path = g_strdup(path);
+
+	len = pread(fd, &file, sizeof(file), 0);
+
+	if (len >= static_cast<gssize>(sizeof(sim_cache_magic)) &&
+	    memcmp(file.magic, sim_cache_magic, sizeof(sim_cache_magic)) == 0)
+		{
+		if (!cache_sim_read_file(file, len, cd))
+			{
+			DEBUG_1("%s is not a valid cache file", cd->path);
+			}
+		close(fd);
+		}
+	else
+		{
+		FILE *f = fdopen(fd, "r");
 
-	fclose(f);
+		if (f)
+			{
+			cache_sim_read_text(f, cd);
+
+			if (fstat(fd, &st) != 0) st.st_mtime = 0;
+			fclose(f);
+
+			if ((cd->dimensions || cd->have_date || cd->have_md5sum || cd->similarity) && st.st_mtime)
+				{
+				cache_sim_upgrade(cd, st.st_mtime);
+				}
+			}
+		else
+			{
+			close(fd);
+			}
+		}
 
 	if (!cd->dimensions &&
 	    !cd->have_date &&
@@ -647,6 +756,47 @@ gchar *cache_get_location(CacheType cache_type, const gchar *source)
 	return cache_get_location(cache_type, source, TRUE, nullptr);
 }
 
+static gchar *cache_folder_index_location(const gchar *dir, const gchar *name, gboolean create)
+{
+	if (!dir) return nullptr;
+
+	mode_t mode = 0755;
+	g_autofree gchar *source = g_build_filename(dir, name, NULL);
+	g_autofree gchar *base = cache_get_location(CACHE_TYPE_SIM, source, FALSE, &mode);
+
+	if (create && !recursive_mkdir_if_not_exists(base, mode))
+		{
+		log_printf("Failed to create cache dir %s\n", base);
+		return nullptr;
+		}
+
+	return g_build_filename(base, name, NULL);
+}
+
+/**
+ * @brief Location of the binary similarity index covering the files of a folder
+ * @param dir Source folder
+ * @param create Create the cache folder if it does not exist
+ * @returns Path of the index file, or NULL if the folder could not be created
+ *
+ * The index lives beside the per-file .sim files of \a dir.
+ */
+gchar *cache_sim_index_location(const gchar *dir, gboolean create)
+{
+	return cache_folder_index_location(dir, GQ_CACHE_SIM_INDEX, create);
+}
+
+/**
+ * @brief Location of the index of frequently used metadata of the files of a folder
+ *
+ * See cache_sim_index_location(). The index holds data extracted from the
+ * files only, so it is kept with the thumbnails, not with the metadata.
+ */
+gchar *cache_exif_index_location(const gchar *dir, gboolean create)
+{
+	return cache_folder_index_location(dir, GQ_CACHE_EXIF_INDEX, create);
+}
+
 gchar *cache_find_location(CacheType type, const gchar *source)
 {
 	gchar *path;
@@ -39,6 +39,9 @@ struct ImageSimilarityData;
 #define GQ_CACHE_EXT_METADATA   ".meta"
 #define GQ_CACHE_EXT_XMP_METADATA   ".gq.xmp"
 
+#define GQ_CACHE_SIM_INDEX      "simindex.bin"
+#define GQ_CACHE_EXIF_INDEX     "exifindex.bin"
+
 
 enum CacheType {
 	CACHE_TYPE_THUMB,
@@ -78,6 +81,8 @@ gint cache_sim_data_filled(ImageSimilarityData *sd);
 
 gchar *cache_create_location(CacheType cache_type, const gchar *source);
 gchar *cache_get_location(CacheType cache_type, const gchar *source);
+gchar *cache_sim_index_location(const gchar *dir, gboolean create);
+gchar *cache_exif_index_location(const gchar *dir, gboolean create);
 gchar *cache_find_location(CacheType type, const gchar *source);
 
 const gchar *get_thumbnails_cache_dir();
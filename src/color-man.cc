@@ -315,8 +315,8 @@ void color_man_correct_region(ColorMan *cm, GdkPixbuf *pixbuf, gint x, gint y, g
 	rs = gdk_pixbuf_get_rowstride(pixbuf);
 
 	/** @FIXME: x,y expected to be = 0. Maybe this is not the right place for scaling */
-	w = w * scale_factor();
-	h = h * scale_factor();
+	w = w * cm->scale_factor;
+	h = h * cm->scale_factor;
 
 	w = MIN(w, pixbuf_width - x);
 	h = MIN(h, pixbuf_height - y);
@@ -347,6 +347,7 @@ static ColorMan *color_man_new_real(ImageWindow *imd, GdkPixbuf *pixbuf,
 	cm = g_new0(ColorMan, 1);
 	cm->imd = imd;
 	cm->pixbuf = pixbuf;
+	cm->scale_factor = scale_factor();
 	if (cm->pixbuf) g_object_ref(cm->pixbuf);
 
 	has_alpha = pixbuf ? gdk_pixbuf_get_has_alpha(pixbuf) : FALSE;
@@ -48,6 +48,7 @@ struct ColorMan {
 	GdkPixbuf *pixbuf;
 	gint incremental_sync;
 	gint row;
+	gint scale_factor; /* kept up to date by image.cc, so that tiles can be corrected off the main thread */
 
 	gpointer profile;
 
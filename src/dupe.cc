@@ -28,11 +28,13 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #include <gdk/gdk.h>
 #include <gio/gio.h>
 #include <glib-object.h>
 
+#include "cache-sim-index.h"
 #include "cache.h"
 #include "collect-table.h"
 #include "collect.h"
@@ -53,6 +55,7 @@
 #include "misc.h"
 #include "options.h"
 #include "print.h"
+#include "similar-index.h"
 #include "similar.h"
 #include "thumb.h"
 #include "typedefs.h"
@@ -139,8 +142,10 @@ static void dupe_match_unlink(DupeItem *a, DupeItem *b);
 static DupeItem *dupe_match_find_parent(DupeWindow *dw, DupeItem *child);
 
 static gint dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *rank, gint fast);
+static gdouble dupe_match_sim_threshold(DupeMatchType mask);
 
 static void dupe_thumb_step(DupeWindow *dw);
+static void dupe_prepass_cancel(DupeWindow *dw);
 static gint dupe_check_cb(gpointer data);
 
 static void dupe_second_add(DupeWindow *dw, DupeItem *di);
@@ -191,6 +196,28 @@ hard_coded_window_keys dupe_window_keys[] = {
 	{static_cast<GdkModifierType>(0), 0, nullptr}
 };
 
+/**
+ * @brief Compares \a di with the needle of \a dqi, adding a match to \a matches
+ * @returns FALSE if the search was aborted
+ */
+static gboolean dupe_comparison_check(DupeQueueItem *dqi, DupeItem *di, GList **matches)
+{
+	DupeSearchMatch *dsm;
+	gdouble rank = 0;
+
+	if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE))
+		{
+		dsm = g_new0(DupeSearchMatch, 1);
+		dsm->a = di;
+		dsm->b = dqi->needle;
+		dsm->rank = rank;
+		*matches = g_list_prepend(*matches, dsm);
+		dsm->index = dqi->index;
+		}
+
+	return !dqi->dw->abort;
+}
+
 /**
  * @brief The function run in threads for similarity checks
  * @param d1 #DupeQueueItem
@@ -205,41 +232,55 @@ static void dupe_comparison_func(gpointer d1, gpointer d2)
 {
 	auto dqi = static_cast<DupeQueueItem *>(d1);
 	auto dw = static_cast<DupeWindow *>(d2);
-	DupeSearchMatch *dsm;
 	DupeItem *di;
 	GList *matches = nullptr;
-	gdouble rank = 0;
 
 	if (!dw->abort)
 		{
-		GList *work = dqi->work;
-		while (work)
+		if (dw->sim_search)
 			{
-			di = static_cast<DupeItem *>(work->data);
+			std::vector<gint> candidates;
 
-			/* forward for second set, back for simple compare */
+			image_sim_index_find(dw->sim_search, dqi->needle->simd, dupe_match_sim_threshold(dw->match_mask), candidates);
+
+			/* same order as the walk below, which only visits the candidates that can match */
 			if (dw->second_set)
 				{
-				work = work->next;
+				for (gint position : candidates)
+					{
+					di = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_search_items, position));
+					if (!dupe_comparison_check(dqi, di, &matches)) break;
+					}
 				}
 			else
 				{
-				work = work->prev;
-				}
+				for (auto it = candidates.rbegin(); it != candidates.rend(); ++it)
+					{
+					if (*it > dqi->needle->position) continue;
 
-			if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE))
-				{
-				dsm = g_new0(DupeSearchMatch, 1);
-				dsm->a = di;
-				dsm->b = dqi->needle;
-				dsm->rank = rank;
-				matches = g_list_prepend(matches, dsm);
-				dsm->index = dqi->index;
+					di = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_search_items, *it));
+					if (!dupe_comparison_check(dqi, di, &matches)) break;
+					}
 				}
-
-			if (dw->abort)
+			}
+		else
+			{
+			GList *work = dqi->work;
+			while (work)
 				{
-				break;
+				di = static_cast<DupeItem *>(work->data);
+
+				/* forward for second set, back for simple compare */
+				if (dw->second_set)
+					{
+					work = work->next;
+					}
+				else
+					{
+					work = work->prev;
+					}
+
+				if (!dupe_comparison_check(dqi, di, &matches)) break;
 				}
 			}
 
@@ -483,13 +524,75 @@ static void dupe_item_free(DupeItem *di)
  * ------------------------------------------------------------------
  */
 
-static void dupe_item_read_cache(DupeItem *di)
+/**
+ * @brief Returns the similarity index of the folder containing \a fd, opening it on first use
+ */
+static SimIndex *dupe_sim_index_get(DupeWindow *dw, FileData *fd)
+{
+	g_autofree gchar *dir = remove_level_from_path(fd->path);
+	auto si = static_cast<SimIndex *>(g_hash_table_lookup(dw->sim_indexes, dir));
+
+	if (!si)
+		{
+		si = sim_index_open(dir);
+		g_hash_table_insert(dw->sim_indexes, g_steal_pointer(&dir), si);
+		}
+
+	return si;
+}
+
+static void dupe_sim_index_save_cb(gpointer, gpointer value, gpointer)
+{
+	sim_index_save(static_cast<SimIndex *>(value));
+}
+
+static void dupe_sim_indexes_save(DupeWindow *dw)
+{
+	g_hash_table_foreach(dw->sim_indexes, dupe_sim_index_save_cb, nullptr);
+}
+
+static void dupe_item_apply_cache(DupeItem *di, CacheData *cd)
+{
+	if (!di->simd && cd->sim)
+		{
+		di->simd = cd->sim;
+		cd->sim = nullptr;
+		}
+	if (di->width == 0 && di->height == 0 && cd->dimensions)
+		{
+		di->width = cd->width;
+		di->height = cd->height;
+		di->dimensions = (di->width << 16) + di->height;
+		}
+	if (!di->md5sum && cd->have_md5sum)
+		{
+		di->md5sum = md5_digest_to_text(cd->md5sum);
+		}
+}
+
+/**
+ * @brief Fills \a di from the folder similarity index, falling back to the per-file .sim cache
+ *
+ * Data found only in a .sim file is added to the index, so that the next
+ * scan of the folder needs no per-file reads.
+ */
+static void dupe_item_read_cache(DupeWindow *dw, DupeItem *di)
 {
 	gchar *path;
 	CacheData *cd;
 
 	if (!di) return;
 
+	SimIndex *si = dupe_sim_index_get(dw, di->fd);
+
+	cd = sim_index_lookup(si, di->fd);
+	if (cd)
+		{
+		dupe_item_apply_cache(di, cd);
+		cache_sim_data_free(cd);
+		return;
+		}
+
 	path = cache_find_location(CACHE_TYPE_SIM, di->fd->path);
 	if (!path) return;
 
@@ -504,49 +607,52 @@ static void dupe_item_read_cache(DupeItem *di)
 
 	if (cd)
 		{
-		if (!di->simd && cd->sim)
-			{
-			di->simd = cd->sim;
-			cd->sim = nullptr;
-			}
-		if (di->width == 0 && di->height == 0 && cd->dimensions)
-			{
-			di->width = cd->width;
-			di->height = cd->height;
-			di->dimensions = (di->width << 16) + di->height;
-			}
-		if (!di->md5sum && cd->have_md5sum)
-			{
-			di->md5sum = md5_digest_to_text(cd->md5sum);
-			}
+		if (options->thumbnails.enable_caching) sim_index_update(si, di->fd, cd);
+		dupe_item_apply_cache(di, cd);
 		cache_sim_data_free(cd);
 		}
 }
 
-static void dupe_item_write_cache(DupeItem *di)
+/**
+ * @brief Writes the .sim cache file of \a fd
+ * @returns The data written, for the similarity index, or NULL
+ *
+ * Does not touch the #DupeWindow, so it can run in the prepass threads.
+ */
+static CacheData *dupe_cache_write(FileData *fd, gint width, gint height, const gchar *md5sum, ImageSimilarityData *simd)
 {
-	if (!di) return;
+	g_autofree gchar *base = cache_create_location(CACHE_TYPE_SIM, fd->path);
+	if (!base) return nullptr;
 
-	g_autofree gchar *base = cache_create_location(CACHE_TYPE_SIM, di->fd->path);
-	if (base)
+	CacheData *cd;
+
+	cd = cache_sim_data_new();
+	cd->path = cache_get_location(CACHE_TYPE_SIM, fd->path);
+
+	if (width != 0) cache_sim_data_set_dimensions(cd, width, height);
+	if (md5sum)
 		{
-		CacheData *cd;
+		guchar digest[16];
+		if (md5_digest_from_text(md5sum, digest)) cache_sim_data_set_md5sum(cd, digest);
+		}
+	if (simd) cache_sim_data_set_similarity(cd, simd);
 
-		cd = cache_sim_data_new();
-		cd->path = cache_get_location(CACHE_TYPE_SIM, di->fd->path);
+	if (cache_sim_data_save(cd))
+		{
+		filetime_set(cd->path, filetime(fd->path));
+		}
 
-		if (di->width != 0) cache_sim_data_set_dimensions(cd, di->width, di->height);
-		if (di->md5sum)
-			{
-			guchar digest[16];
-			if (md5_digest_from_text(di->md5sum, digest)) cache_sim_data_set_md5sum(cd, digest);
-			}
-		if (di->simd) cache_sim_data_set_similarity(cd, di->simd);
+	return cd;
+}
 
-		if (cache_sim_data_save(cd))
-			{
-			filetime_set(cd->path, filetime(di->fd->path));
-			}
+static void dupe_item_write_cache(DupeWindow *dw, DupeItem *di)
+{
+	if (!di) return;
+
+	CacheData *cd = dupe_cache_write(di->fd, di->width, di->height, di->md5sum, di->simd);
+	if (cd)
+		{
+		sim_index_update(dupe_sim_index_get(dw, di->fd), di->fd, cd);
 		cache_sim_data_free(cd);
 		}
 }
@@ -1417,6 +1523,18 @@ static void dupe_match_rank(DupeWindow *dw)
  * ------------------------------------------------------------------
  */
 
+/**
+ * @brief The similarity \a mask asks for, as a fraction
+ */
+static gdouble dupe_match_sim_threshold(DupeMatchType mask)
+{
+	if (mask & DUPE_MATCH_SIM_HIGH) return 0.95;
+	if (mask & DUPE_MATCH_SIM_MED) return 0.90;
+	if (mask & DUPE_MATCH_SIM_CUSTOM) return static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
+
+	return 0.85;
+}
+
 /**
  * @brief
  * @param[in] a
@@ -1514,12 +1632,7 @@ static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble
 	    mask & DUPE_MATCH_SIM_CUSTOM)
 		{
 		gdouble f;
-		gdouble m;
-
-		if (mask & DUPE_MATCH_SIM_HIGH) m = 0.95;
-		else if (mask & DUPE_MATCH_SIM_MED) m = 0.90;
-		else if (mask & DUPE_MATCH_SIM_CUSTOM) m = static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
-		else m = 0.85;
+		gdouble m = dupe_match_sim_threshold(mask);
 
 		if (fast)
 			{
@@ -2117,6 +2230,47 @@ static void dupe_thumb_step(DupeWindow *dw)
  * ------------------------------------------------------------------
  */
 
+static void dupe_sim_search_free(DupeWindow *dw)
+{
+	image_sim_index_free(dw->sim_search);
+	dw->sim_search = nullptr;
+
+	if (dw->sim_search_items) g_ptr_array_free(dw->sim_search_items, TRUE);
+	dw->sim_search_items = nullptr;
+}
+
+/**
+ * @brief Indexes the similarity data of the set the items of set 1 are compared against
+ *
+ * With a threshold of 0 everything matches, even items without similarity
+ * data, so every pair is compared as before.
+ */
+static void dupe_sim_search_build(DupeWindow *dw)
+{
+	GList *work;
+	gint position = 0;
+
+	dupe_sim_search_free(dw);
+
+	if (dupe_match_sim_threshold(dw->match_mask) <= 0.0) return;
+
+	dw->sim_search = image_sim_index_new();
+	dw->sim_search_items = g_ptr_array_new();
+
+	work = dw->second_set ? dw->second_list : dw->list;
+	while (work)
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+
+		di->position = position;
+		g_ptr_array_add(dw->sim_search_items, di);
+		image_sim_index_add(dw->sim_search, di->simd, position);
+
+		position++;
+		work = work->next;
+		}
+}
+
 static void dupe_check_stop(DupeWindow *dw)
 {
 	if (dw->idle_id > 0)
@@ -2136,7 +2290,7 @@ static void dupe_check_stop(DupeWindow *dw)
 	g_list_free(dw->search_matches);
 	dw->search_matches = nullptr;
 
-	if (dw->idle_id || dw->img_loader || dw->thumb_loader)
+	if (dw->idle_id || dw->prepass_jobs || dw->thumb_loader)
 		{
 		if (dw->idle_id > 0)
 			{
@@ -2165,8 +2319,10 @@ static void dupe_check_stop(DupeWindow *dw)
 	thumb_loader_free(dw->thumb_loader);
 	dw->thumb_loader = nullptr;
 
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
+	dupe_prepass_cancel(dw);
+
+	dupe_sim_search_free(dw);
+	dupe_sim_indexes_save(dw);
 }
 
 static void dupe_check_stop_cb(GtkWidget *, gpointer data)
@@ -2176,151 +2332,334 @@ static void dupe_check_stop_cb(GtkWidget *, gpointer data)
 	dupe_check_stop(dw);
 }
 
-static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
+static void dupe_setup_reset(DupeWindow *dw)
 {
-	auto dw = static_cast<DupeWindow *>(data);
+	dw->setup_point = nullptr;
+	dw->setup_n = 0;
+	dw->setup_time = msec_time();
+	dw->setup_time_count = 0;
+}
+
+static GList *dupe_setup_point_step(DupeWindow *dw, GList *p)
+{
+	if (!p) return nullptr;
+
+	if (p->next) return p->next;
+
+	if (dw->second_set && g_list_first(p) == dw->list) return dw->second_list;
+
+	return nullptr;
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Setup prepass
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * One item of the setup prepass. Checksums, similarity data and the cache
+ * file are computed in the prepass thread pool; images are decoded by
+ * the image loader threads before that.
+ */
+struct DupePrepassJob
+{
+	DupeWindow *dw;
+	DupeItem *di; /**< NULL if the item was removed while the job was running */
+	FileData *fd;
+
+	ImageLoader *il; /**< set while the image is being decoded */
 	GdkPixbuf *pixbuf;
 
-	pixbuf = image_loader_get_pixbuf(il);
+	gboolean need_md5sum;
+	gboolean need_similarity;
 
-	if (dw->setup_point)
-		{
-		auto di = static_cast<DupeItem *>(dw->setup_point->data);
+	gchar *md5sum;
+	gint width;
+	gint height;
+	ImageSimilarityData *simd;
+	CacheData *cd; /**< data written to the .sim cache */
+};
 
-		if (!di->simd)
-			{
-			di->simd = image_sim_new_from_pixbuf(pixbuf);
-			}
-		else
+constexpr gint64 DUPE_PREPASS_SLICE = 10000; /**< µs of main loop time used per prepass step */
+constexpr guint DUPE_PREPASS_POLL = 20; /**< ms between prepass steps while only waiting for jobs */
+
+static guint dupe_prepass_limit()
+{
+	gint threads = (options->threads.duplicates > 0) ? options->threads.duplicates : get_cpu_cores();
+
+	return 2 * MAX(threads, 1);
+}
+
+static void dupe_prepass_job_free(DupePrepassJob *job)
+{
+	image_loader_free(job->il);
+	if (job->pixbuf) g_object_unref(job->pixbuf);
+	file_data_unref(job->fd);
+	g_free(job->md5sum);
+	image_sim_free(job->simd);
+	cache_sim_data_free(job->cd);
+	g_free(job);
+}
+
+static void dupe_prepass_func(gpointer data, gpointer user_data)
+{
+	auto job = static_cast<DupePrepassJob *>(data);
+	auto dw = static_cast<DupeWindow *>(user_data);
+
+	if (!dw->abort)
+		{
+		if (job->need_md5sum)
 			{
-			image_sim_fill_data(di->simd, pixbuf);
+			job->md5sum = md5_text_from_file_utf8(job->fd->path, "");
 			}
 
-		if (di->width == 0 && di->height == 0 && pixbuf)
+		if (job->need_similarity)
 			{
-			di->width = gdk_pixbuf_get_width(pixbuf);
-			di->height = gdk_pixbuf_get_height(pixbuf);
+			job->simd = image_sim_new_from_pixbuf(job->pixbuf);
+
+			if (job->width == 0 && job->height == 0 && job->pixbuf)
+				{
+				job->width = gdk_pixbuf_get_width(job->pixbuf);
+				job->height = gdk_pixbuf_get_height(job->pixbuf);
+				}
 			}
+
 		if (options->thumbnails.enable_caching)
 			{
-			dupe_item_write_cache(di);
+			job->cd = dupe_cache_write(job->fd, job->width, job->height, job->md5sum, job->simd);
 			}
+		}
 
-		image_sim_alternate_processing(di->simd);
+	if (job->pixbuf)
+		{
+		g_object_unref(job->pixbuf);
+		job->pixbuf = nullptr;
 		}
 
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
+	g_async_queue_push(dw->prepass_done, job);
+}
 
-	dw->idle_id = g_idle_add(dupe_check_cb, dw);
+static void dupe_prepass_loader_done_cb(ImageLoader *il, gpointer data)
+{
+	auto job = static_cast<DupePrepassJob *>(data);
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(il);
+
+	if (pixbuf) job->pixbuf = static_cast<GdkPixbuf *>(g_object_ref(pixbuf));
+
+	image_loader_free(job->il);
+	job->il = nullptr;
+
+	g_thread_pool_push(job->dw->prepass_thread_pool, job, nullptr);
 }
 
-static void dupe_setup_reset(DupeWindow *dw)
+static void dupe_prepass_queue(DupeWindow *dw, DupeItem *di, gboolean need_md5sum, gboolean need_similarity)
 {
-	dw->setup_point = nullptr;
-	dw->setup_n = 0;
-	dw->setup_time = msec_time();
-	dw->setup_time_count = 0;
+	auto job = g_new0(DupePrepassJob, 1);
+
+	job->dw = dw;
+	job->di = di;
+	job->fd = file_data_ref(di->fd);
+	job->need_md5sum = need_md5sum;
+	job->need_similarity = need_similarity;
+	job->md5sum = g_strdup(di->md5sum);
+	job->width = di->width;
+	job->height = di->height;
+
+	dw->prepass_jobs = g_list_prepend(dw->prepass_jobs, job);
+
+	if (need_similarity)
+		{
+		job->il = image_loader_new(di->fd);
+		image_loader_set_buffer_size(job->il, 8);
+		image_loader_set_job_class(job->il, IMAGE_LOADER_JOB_BACKGROUND);
+		g_signal_connect(G_OBJECT(job->il), "error", (GCallback)dupe_prepass_loader_done_cb, job);
+		g_signal_connect(G_OBJECT(job->il), "done", (GCallback)dupe_prepass_loader_done_cb, job);
+
+		if (image_loader_start(job->il)) return;
+
+		/* the job still runs, leaving empty similarity data so that the image is not retried */
+		image_loader_free(job->il);
+		job->il = nullptr;
+		}
+
+	g_thread_pool_push(dw->prepass_thread_pool, job, nullptr);
 }
 
-static GList *dupe_setup_point_step(DupeWindow *dw, GList *p)
+static void dupe_prepass_finish(DupeWindow *dw, DupePrepassJob *job)
 {
-	if (!p) return nullptr;
+	DupeItem *di = job->di;
 
-	if (p->next) return p->next;
+	dw->prepass_jobs = g_list_remove(dw->prepass_jobs, job);
+	dw->setup_n++;
 
-	if (dw->second_set && g_list_first(p) == dw->list) return dw->second_list;
+	if (job->cd)
+		{
+		sim_index_update(dupe_sim_index_get(dw, job->fd), job->fd, job->cd);
+		}
 
-	return nullptr;
+	if (di)
+		{
+		if (!di->md5sum && job->md5sum)
+			{
+			di->md5sum = g_steal_pointer(&job->md5sum);
+			}
+		if (di->width == 0 && di->height == 0 && (job->width != 0 || job->height != 0))
+			{
+			di->width = job->width;
+			di->height = job->height;
+			di->dimensions = (di->width << 16) + di->height;
+			}
+		if (job->simd)
+			{
+			image_sim_free(di->simd);
+			di->simd = g_steal_pointer(&job->simd);
+			image_sim_alternate_processing(di->simd);
+			}
+		}
+
+	dupe_prepass_job_free(job);
 }
 
 /**
- * @brief Generates the sumcheck or dimensions
- * @param list Set1 or set2
- * @returns TRUE/FALSE = not completed/completed
+ * @brief Drops all prepass jobs, waiting for the ones in the thread pool
  *
- * Ensures that the DIs contain the MD5SUM or dimensions for all items in
- * the list. One item at a time. Re-enters if not completed.
+ * \a dw->abort must be set, so that queued jobs return at once.
  */
-static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
+static void dupe_prepass_cancel(DupeWindow *dw)
 {
-		if ((dw->match_mask & DUPE_MATCH_SUM) ||
-			(dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
-			(dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT))
+	GList *work = dw->prepass_jobs;
+	while (work)
+		{
+		auto job = static_cast<DupePrepassJob *>(work->data);
+		work = work->next;
+
+		if (job->il)
 			{
-			/* MD5SUM only */
-			if (!dw->setup_point) dw->setup_point = list; // setup_point clear on 1st entry
+			/* never reached the thread pool */
+			dw->prepass_jobs = g_list_remove(dw->prepass_jobs, job);
+			dupe_prepass_job_free(job);
+			}
+		}
 
-			while (dw->setup_point)
-				{
-				auto di = static_cast<DupeItem *>(dw->setup_point->data);
+	while (dw->prepass_jobs)
+		{
+		auto job = static_cast<DupePrepassJob *>(g_async_queue_pop(dw->prepass_done));
 
-				dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-				dw->setup_n++;
+		dw->prepass_jobs = g_list_remove(dw->prepass_jobs, job);
+		dupe_prepass_job_free(job);
+		}
+}
 
-				if (!di->md5sum)
-					{
-					dupe_window_update_progress(dw, _("Reading checksums..."),
-						dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n - 1) / dw->setup_count, FALSE);
+static gboolean dupe_prepass_pending(DupeWindow *dw, DupeItem *di)
+{
+	for (GList *work = dw->prepass_jobs; work; work = work->next)
+		{
+		if (static_cast<DupePrepassJob *>(work->data)->di == di) return TRUE;
+		}
 
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_read_cache(di);
-						if (di->md5sum)
-							{
-							return TRUE;
-							}
-						}
+	return FALSE;
+}
 
-					di->md5sum = md5_text_from_file_utf8(di->fd->path, "");
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_write_cache(di);
-						}
-					return TRUE;
-					}
-				}
-			dupe_setup_reset(dw);
+/**
+ * @brief Detaches a removed item from its running prepass job
+ *
+ * The job still completes and updates the cache.
+ */
+static void dupe_prepass_forget_item(DupeWindow *dw, DupeItem *di)
+{
+	for (GList *work = dw->prepass_jobs; work; work = work->next)
+		{
+		auto job = static_cast<DupePrepassJob *>(work->data);
+
+		if (job->di == di) job->di = nullptr;
+		}
+}
+
+/**
+ * @brief Ensures the checksums, dimensions and similarity data of set 1 and set 2
+ * @returns TRUE/FALSE = not completed/completed
+ *
+ * Uses the cache where possible, otherwise queues the item on the prepass
+ * thread pool, keeping at most dupe_prepass_limit() jobs in flight.
+ * Dimensions alone are read here, as only the image header is needed.
+ * Sets \a dw->prepass_waiting when nothing can be done until a job finishes.
+ */
+static gboolean dupe_prepass_step(DupeWindow *dw)
+{
+	const DupeMatchType mask = dw->match_mask;
+	const gboolean want_md5sum = (mask & DUPE_MATCH_SUM) || (mask & DUPE_MATCH_NAME_CONTENT) || (mask & DUPE_MATCH_NAME_CI_CONTENT);
+	const gboolean want_dimensions = (mask & DUPE_MATCH_DIM);
+	const gboolean want_similarity = (mask & DUPE_MATCH_SIM_HIGH) || (mask & DUPE_MATCH_SIM_MED) ||
+					 (mask & DUPE_MATCH_SIM_LOW) || (mask & DUPE_MATCH_SIM_CUSTOM);
+	const guint limit = dupe_prepass_limit();
+	const gint64 end_time = g_get_monotonic_time() + DUPE_PREPASS_SLICE;
+	gpointer job;
+
+	while ((job = g_async_queue_try_pop(dw->prepass_done)))
+		{
+		dupe_prepass_finish(dw, static_cast<DupePrepassJob *>(job));
+		}
+
+	while (dw->setup_point && g_list_length(dw->prepass_jobs) < limit && g_get_monotonic_time() < end_time)
+		{
+		auto di = static_cast<DupeItem *>(dw->setup_point->data);
+		gboolean need_md5sum = want_md5sum && !di->md5sum;
+		gboolean need_dimensions = want_dimensions && di->width == 0 && di->height == 0;
+		gboolean need_similarity = want_similarity && !di->simd;
+
+		dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
+
+		if (dupe_prepass_pending(dw, di))
+			{
+			/* setup was restarted while the item was in flight */
+			dw->setup_n++;
+			continue;
 			}
 
-		if ((dw->match_mask & DUPE_MATCH_DIM)  )
+		if ((need_md5sum || need_dimensions || need_similarity) && options->thumbnails.enable_caching)
 			{
-			/* Dimensions only */
-			if (!dw->setup_point) dw->setup_point = list;
+			dupe_item_read_cache(dw, di);
 
-			while (dw->setup_point)
+			if (di->md5sum) need_md5sum = FALSE;
+			if (di->width != 0 || di->height != 0) need_dimensions = FALSE;
+			if (need_similarity && cache_sim_data_filled(di->simd))
 				{
-				auto di = static_cast<DupeItem *>(dw->setup_point->data);
-
-				dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-				dw->setup_n++;
-				if (di->width == 0 && di->height == 0)
-					{
-					dupe_window_update_progress(dw, _("Reading dimensions..."),
-						dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n - 1) / dw->setup_count, FALSE);
-
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_read_cache(di);
-						if (di->width != 0 || di->height != 0)
-							{
-							return TRUE;
-							}
-						}
+				image_sim_alternate_processing(di->simd);
+				need_similarity = FALSE;
+				}
+			}
 
-					image_load_dimensions(di->fd, &di->width, &di->height);
-					di->dimensions = (di->width << 16) + di->height;
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_write_cache(di);
-						}
-					return TRUE;
-					}
+		if (need_dimensions && !need_similarity)
+			{
+			image_load_dimensions(di->fd, &di->width, &di->height);
+			di->dimensions = (di->width << 16) + di->height;
+			if (!need_md5sum && options->thumbnails.enable_caching)
+				{
+				dupe_item_write_cache(dw, di);
 				}
-			dupe_setup_reset(dw);
 			}
 
-	return FALSE;
+		if (need_md5sum || need_similarity)
+			{
+			dupe_prepass_queue(dw, di, need_md5sum, need_similarity);
+			}
+		else
+			{
+			dw->setup_n++;
+			}
+		}
+
+	const gchar *status;
+	if (want_similarity) status = _("Reading similarity data...");
+	else if (want_md5sum) status = _("Reading checksums...");
+	else status = _("Reading dimensions...");
+
+	dupe_window_update_progress(dw, status, dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
+
+	dw->prepass_waiting = dw->prepass_jobs && (!dw->setup_point || g_list_length(dw->prepass_jobs) >= limit);
+
+	return dw->setup_point || dw->prepass_jobs;
 }
 
 /**
@@ -2360,77 +2699,29 @@ static gboolean dupe_check_cb(gpointer data)
 
 	if (!dw->setup_done) /* Clear on 1st entry */
 		{
-		if (dw->list)
+		if (dupe_prepass_step(dw))
 			{
-			if (create_checksums_dimensions(dw, dw->list))
-				{
-				return G_SOURCE_CONTINUE;
-				}
-			}
-		if (dw->second_list)
-			{
-			if (create_checksums_dimensions(dw, dw->second_list))
-				{
-				return G_SOURCE_CONTINUE;
-				}
-			}
-		if ((dw->match_mask & DUPE_MATCH_SIM_HIGH ||
-		     dw->match_mask & DUPE_MATCH_SIM_MED ||
-		     dw->match_mask & DUPE_MATCH_SIM_LOW ||
-		     dw->match_mask & DUPE_MATCH_SIM_CUSTOM) &&
-		    !(dw->setup_mask & DUPE_MATCH_SIM_MED) )
-			{
-			/* Similarity only */
-			if (!dw->setup_point) dw->setup_point = dw->list;
-
-			while (dw->setup_point)
-				{
-				auto di = static_cast<DupeItem *>(dw->setup_point->data);
-
-				if (!di->simd)
-					{
-					dupe_window_update_progress(dw, _("Reading similarity data..."),
-						dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
+			if (!dw->prepass_waiting) return G_SOURCE_CONTINUE;
 
-					if (options->thumbnails.enable_caching)
-						{
-						dupe_item_read_cache(di);
-						if (cache_sim_data_filled(di->simd))
-							{
-							image_sim_alternate_processing(di->simd);
-							return G_SOURCE_CONTINUE;
-							}
-						}
-
-					dw->img_loader = image_loader_new(di->fd);
-					image_loader_set_buffer_size(dw->img_loader, 8);
-					g_signal_connect(G_OBJECT(dw->img_loader), "error", (GCallback)dupe_loader_done_cb, dw);
-					g_signal_connect(G_OBJECT(dw->img_loader), "done", (GCallback)dupe_loader_done_cb, dw);
-
-					if (!image_loader_start(dw->img_loader))
-						{
-						image_sim_free(di->simd);
-						di->simd = image_sim_new();
-						image_loader_free(dw->img_loader);
-						dw->img_loader = nullptr;
-						return G_SOURCE_CONTINUE;
-						}
-					dw->idle_id = 0;
-					return G_SOURCE_REMOVE;
-					}
-
-				dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-				dw->setup_n++;
-				}
-			dw->setup_mask = static_cast<DupeMatchType>(dw->setup_mask | DUPE_MATCH_SIM_MED);
-			dupe_setup_reset(dw);
+			/* only waiting for prepass jobs */
+			dw->idle_id = g_timeout_add(DUPE_PREPASS_POLL, dupe_check_cb, dw);
+			return G_SOURCE_REMOVE;
 			}
 
 		/* End of setup not done */
 		dupe_window_update_progress(dw, _("Comparing..."), 0.0, FALSE);
 		dw->setup_done = TRUE;
 		dupe_setup_reset(dw);
+		dupe_sim_indexes_save(dw);
 		dw->setup_count = g_list_length(dw->list);
+
+		if (dw->match_mask == DUPE_MATCH_SIM_HIGH ||
+			dw->match_mask == DUPE_MATCH_SIM_MED ||
+			dw->match_mask == DUPE_MATCH_SIM_LOW ||
+			dw->match_mask == DUPE_MATCH_SIM_CUSTOM)
+			{
+			dupe_sim_search_build(dw);
+			}
 		}
 
 	/* Setup done - dw->working set to NULL below
@@ -2484,6 +2775,7 @@ static gboolean dupe_check_cb(gpointer data)
 			dw->search_matches = nullptr;
 			dw->search_matches_sorted = nullptr;
 			dw->setup_count = 0;
+			dupe_sim_search_free(dw);
 			}
 		else
 			{
@@ -2546,8 +2838,9 @@ static void dupe_check_start(DupeWindow *dw)
 	dw->setup_count = g_list_length(dw->list);
 	if (dw->second_set) dw->setup_count += g_list_length(dw->second_list);
 
-	dw->setup_mask = DUPE_MATCH_NONE;
 	dupe_setup_reset(dw);
+	dw->setup_point = dw->list;
+	if (!dw->setup_point && dw->second_set) dw->setup_point = dw->second_list;
 
 	dw->working = g_list_last(dw->list);
 
@@ -2594,13 +2887,8 @@ static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
 	if (dw->setup_point && dw->setup_point->data == di)
 		{
 		dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
-		if (dw->img_loader)
-			{
-			image_loader_free(dw->img_loader);
-			dw->img_loader = nullptr;
-			dw->idle_id = g_idle_add(dupe_check_cb, dw);
-			}
 		}
+	dupe_prepass_forget_item(dw, di);
 
 	if (di->group && dw->dupes)
 		{
@@ -2719,7 +3007,7 @@ static gboolean dupe_files_add_queue_cb(gpointer data)
 
 	dw->add_files_queue = g_list_remove(dw->add_files_queue, g_list_first(dw->add_files_queue)->data);
 
-	dupe_item_read_cache(di);
+	dupe_item_read_cache(dw, di);
 
 	/* Ensure images in the lists have unique FileDatas */
 	if (!dupe_insert_in_list_cache(dw, di->fd))
@@ -2795,7 +3083,7 @@ static void dupe_files_add(DupeWindow *dw, CollectionData *, CollectInfo *info,
 
 	if (!di) return;
 
-	dupe_item_read_cache(di);
+	dupe_item_read_cache(dw, di);
 
 	/* Ensure images in the lists have unique FileDatas */
 	GList *work;
@@ -4340,6 +4628,10 @@ void dupe_window_close(DupeWindow *dw)
 	file_data_unregister_notify_func(dupe_notify_cb, dw);
 
 	g_thread_pool_free(dw->dupe_comparison_thread_pool, TRUE, TRUE);
+	g_thread_pool_free(dw->prepass_thread_pool, TRUE, TRUE);
+	g_async_queue_unref(dw->prepass_done);
+
+	g_hash_table_destroy(dw->sim_indexes);
 
 	g_free(dw);
 }
@@ -4494,6 +4786,7 @@ DupeWindow *dupe_window_new()
 	dw = g_new0(DupeWindow, 1);
 	dw->add_files_queue = nullptr;
 	dw->add_files_queue_id = 0;
+	dw->sim_indexes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, reinterpret_cast<GDestroyNotify>(sim_index_free));
 
 	dw->match_mask = DUPE_MATCH_NAME;
 	if (options->duplicates_match == DUPE_MATCH_NAME) dw->match_mask = DUPE_MATCH_NAME;
@@ -4761,6 +5054,8 @@ DupeWindow *dupe_window_new()
 	g_mutex_init(&dw->thread_count_mutex);
 	g_mutex_init(&dw->search_matches_mutex);
 	dw->dupe_comparison_thread_pool = g_thread_pool_new(dupe_comparison_func, dw, options->threads.duplicates, FALSE, nullptr);
+	dw->prepass_thread_pool = g_thread_pool_new(dupe_prepass_func, dw, options->threads.duplicates, FALSE, nullptr);
+	dw->prepass_done = g_async_queue_new();
 
 	return dw;
 }
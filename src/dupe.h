@@ -30,6 +30,7 @@ struct CollectInfo;
 struct CollectionData;
 class FileData;
 struct ImageLoader;
+struct ImageSimIndex;
 struct ImageSimilarityData;
 struct ThumbLoader;
 
@@ -82,6 +83,7 @@ struct DupeItem
 	gdouble group_rank;	/**< (sum of all child ranks) / n */
 
 	gint second;
+	gint position; /**< Position in its list, set while a similarity check runs */
 };
 
 struct DupeMatch
@@ -110,6 +112,7 @@ struct DupeWindow
 	GHashTable *list_cache; /**< Caches the #DupeItem-s of all items in list. Used when ensuring #FileData-s are unique */
 	GHashTable *second_list_cache; /**< Caches the #DupeItem-s of all items in second_list. Used when ensuring #FileData-s are unique */
 	GtkWidget *controls_box;
+	GHashTable *sim_indexes; /**< Binary similarity index (#SimIndex) of each source folder, keyed by folder path */
 
 	gboolean show_thumbs;
 
@@ -119,7 +122,6 @@ struct DupeWindow
 	gint setup_count; /**< length of set1 or if 2 sets, total length of both */
 	gint setup_n;			/**< Set to zero on start/reset. These are merely for speed optimization */
 	GList *setup_point;		/**< these are merely for speed optimization */
-	DupeMatchType setup_mask;	/**< these are merely for speed optimization */
 	guint64 setup_time; /**< Time in µsec since Epoch, restored at each phase of operation */
 	guint64 setup_time_count; /**< Time in µsec since time-to-go status display was updated */
 
@@ -128,7 +130,10 @@ struct DupeWindow
 	ThumbLoader *thumb_loader;
 	DupeItem *thumb_item;
 
-	ImageLoader *img_loader;
+	GThreadPool *prepass_thread_pool; /**< Computes checksums and similarity data during setup */
+	GAsyncQueue *prepass_done; /**< Finished prepass jobs, handled in the main thread */
+	GList *prepass_jobs; /**< Prepass jobs in flight, loading or in the thread pool */
+	gboolean prepass_waiting; /**< Set when setup can only wait for prepass jobs */
 
 	GtkTreeSortable *sortable;
 	gint set_count; /**< Index/counter for number of duplicate sets found */
@@ -154,6 +159,8 @@ struct DupeWindow
 	gint thread_count; /**< Incremented each time a similarity check thread item is completed */
 	GMutex thread_count_mutex;
 	gboolean abort; /**< Stop the similarity check thread queue */
+	ImageSimIndex *sim_search; /**< Candidate search over the set compared against, NULL to compare every pair */
+	GPtrArray *sim_search_items; /**< #DupeItem-s of \a sim_search by position */
 };
 
 
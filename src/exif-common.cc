@@ -30,6 +30,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <unordered_map>
 
 #include <glib.h>
 
@@ -58,7 +59,6 @@
 struct ExifData;
 struct ExifItem;
 struct FileCacheData;
-struct ZoneDetect;
 
 
 static gdouble exif_rational_to_double(ExifRational *r, gint sign)
@@ -616,17 +616,98 @@ static gchar *exif_build_formatted_GPSAltitude(ExifData *exif)
 	return g_strdup_printf("%0.f m %s", alt, (ref==0)?_("Above Sea Level"):_("Below Sea Level"));
 }
 
+/*
+ *-------------------------------------------------------------------
+ * timezone lookup
+ *-------------------------------------------------------------------
+ */
+
+namespace
+{
+
+/** Coordinates are memoized in steps of 1/TZ_CACHE_SCALE degrees (about 11 m) */
+constexpr gdouble TZ_CACHE_SCALE = 10000.0;
+constexpr gsize TZ_CACHE_MAX = 8192;
+
+struct ExifTimezone
+{
+	gboolean found; /**< FALSE if the location is not in the database */
+	gchar *timezone;
+	gchar *countryname;
+	gchar *countryalpha2;
+};
+
+struct TimezoneCache
+{
+	GMutex lock;
+	ZoneDetect *cd;
+	gboolean tried; /**< the database was opened, or found missing */
+	std::unordered_map<guint64, ExifTimezone> results;
+};
+
+TimezoneCache tz_cache;
+
+void exif_timezone_clear(ExifTimezone &tz)
+{
+	g_free(tz.timezone);
+	g_free(tz.countryname);
+	g_free(tz.countryalpha2);
+	tz = {};
+}
+
+void tz_cache_clear()
+{
+	for (auto &it : tz_cache.results) exif_timezone_clear(it.second);
+	tz_cache.results.clear();
+}
+
+guint64 tz_cache_key(gdouble latitude, gdouble longitude)
+{
+	auto lat = static_cast<gint32>(std::lround(latitude * TZ_CACHE_SCALE));
+	auto lon = static_cast<gint32>(std::lround(longitude * TZ_CACHE_SCALE));
+
+	return (static_cast<guint64>(static_cast<guint32>(lat)) << 32) | static_cast<guint32>(lon);
+}
+
+void ZoneDetect_onError(int errZD, int errNative)
+{
+	log_printf("Error: ZoneDetect %s (0x%08X)\n", ZDGetErrorString(errZD), (unsigned)errNative);
+}
+
+/**
+ * @brief The shared database handle, opened on first use
+ *
+ * Must be called with tz_cache.lock held.
+ */
+ZoneDetect *tz_cache_database()
+{
+	if (tz_cache.tried) return tz_cache.cd;
+
+	tz_cache.tried = TRUE;
+
+	g_autofree gchar *timezone_path = g_build_filename(get_rc_dir(), TIMEZONE_DATABASE_FILE, NULL);
+	if (!g_file_test(timezone_path, G_FILE_TEST_EXISTS)) return nullptr;
+
+	ZDSetErrorHandler(ZoneDetect_onError);
+	tz_cache.cd = ZDOpenDatabase(timezone_path);
+	if (!tz_cache.cd)
+		{
+		log_printf("Error: Init of timezone database %s failed\n", timezone_path);
+		}
+
+	return tz_cache.cd;
+}
+
 /**
  * @brief Extracts timezone data from a ZoneDetect search structure
  * @param[in] results ZoneDetect search structure
- * @param[out] timezone in the form "Europe/London"
- * @param[out] countryname in the form "United Kingdom"
- * @param[out] countryalpha2 in the form "GB"
- * 
+ * @param[out] tz timezone in the form "Europe/London", countryname in the
+ * form "United Kingdom" and countryalpha2 in the form "GB"
+ *
  * Refer to https://github.com/BertoldVdb/ZoneDetect
  * for structure details
  */
-static void zd_tz(ZoneDetectResult *results, gchar **timezone, gchar **countryname, gchar **countryalpha2)
+void zd_tz(ZoneDetectResult *results, ExifTimezone &tz)
 {
 	gchar *timezone_pre = nullptr;
 	gchar *timezone_id = nullptr;
@@ -640,33 +721,106 @@ static void zd_tz(ZoneDetectResult *results, gchar **timezone, gchar **countryna
 				{
 				if (g_strstr_len(results[index].fieldNames[i], -1, "TimezoneIdPrefix"))
 					{
+					g_free(timezone_pre);
 					timezone_pre = g_strdup(results[index].data[i]);
 					}
 				if (g_strstr_len(results[index].fieldNames[i], -1, "TimezoneId"))
 					{
+					g_free(timezone_id);
 					timezone_id = g_strdup(results[index].data[i]);
 					}
 				if (g_strstr_len(results[index].fieldNames[i], -1, "CountryName"))
 					{
-					*countryname = g_strdup(results[index].data[i]);
+					g_free(tz.countryname);
+					tz.countryname = g_strdup(results[index].data[i]);
 					}
 				if (g_strstr_len(results[index].fieldNames[i], -1, "CountryAlpha2"))
 					{
-					*countryalpha2 = g_strdup(results[index].data[i]);
+					g_free(tz.countryalpha2);
+					tz.countryalpha2 = g_strdup(results[index].data[i]);
 					}
 				}
 			}
 		index++;
 		}
 
-	*timezone = g_strconcat(timezone_pre, timezone_id, NULL);
+	tz.timezone = g_strconcat(timezone_pre, timezone_id, NULL);
 	g_free(timezone_pre);
 	g_free(timezone_id);
 }
 
-static void ZoneDetect_onError(int errZD, int errNative)
+/**
+ * @brief Looks up one location, from the cache if possible
+ * @returns The cached result, or nullptr if there is no database.
+ * Failed lookups are cached too, with ExifTimezone::found unset.
+ *
+ * Must be called with tz_cache.lock held.
+ */
+const ExifTimezone *tz_cache_lookup(gdouble latitude, gdouble longitude)
 {
-	log_printf("Error: ZoneDetect %s (0x%08X)\n", ZDGetErrorString(errZD), (unsigned)errNative);
+	guint64 key = tz_cache_key(latitude, longitude);
+
+	auto it = tz_cache.results.find(key);
+	if (it != tz_cache.results.end()) return &it->second;
+
+	ZoneDetect *cd = tz_cache_database();
+	if (!cd) return nullptr;
+
+	ExifTimezone tz{};
+	ZoneDetectResult *results = ZDLookup(cd, latitude, longitude, nullptr);
+	if (results)
+		{
+		zd_tz(results, tz);
+		tz.found = TRUE;
+		ZDFreeResults(results);
+		}
+
+	if (tz_cache.results.size() >= TZ_CACHE_MAX) tz_cache_clear();
+
+	return &tz_cache.results.emplace(key, tz).first->second;
+}
+
+} // namespace
+
+/**
+ * @brief Gets the timezone and country of a location
+ * @param[out] timezone in the form "Europe/London"
+ * @param[out] countryname in the form "United Kingdom"
+ * @param[out] countryalpha2 in the form "GB"
+ * @returns FALSE if the timezone database is not installed or the lookup failed
+ *
+ * The database is opened once and shared by all threads, results are
+ * memoized by location.
+ */
+gboolean exif_timezone_lookup(gdouble latitude, gdouble longitude, gchar **timezone, gchar **countryname, gchar **countryalpha2)
+{
+	gboolean ret = FALSE;
+
+	g_mutex_lock(&tz_cache.lock);
+	const ExifTimezone *result = tz_cache_lookup(latitude, longitude);
+	if (result && result->found)
+		{
+		*timezone = g_strdup(result->timezone);
+		*countryname = g_strdup(result->countryname);
+		*countryalpha2 = g_strdup(result->countryalpha2);
+		ret = TRUE;
+		}
+	g_mutex_unlock(&tz_cache.lock);
+
+	return ret;
+}
+
+/**
+ * @brief Closes the timezone database, so that an updated one is used
+ */
+void exif_timezone_database_reset()
+{
+	g_mutex_lock(&tz_cache.lock);
+	tz_cache_clear();
+	if (tz_cache.cd) ZDCloseDatabase(tz_cache.cd);
+	tz_cache.cd = nullptr;
+	tz_cache.tried = FALSE;
+	g_mutex_unlock(&tz_cache.lock);
 }
 
 /**
@@ -694,9 +848,6 @@ static gboolean exif_build_tz_data(ExifData *exif, gchar **exif_date_time, gchar
 	gchar *lat_min;
 	gchar *lon_deg;
 	gchar *lon_min;
-	gchar *timezone_path;
-	ZoneDetect *cd;
-	ZoneDetectResult *results;
 	gboolean ret = FALSE;
 
 	text_latitude = exif_get_data_as_text(exif, "Exif.GPSInfo.GPSLatitude");
@@ -731,27 +882,7 @@ static gboolean exif_build_tz_data(ExifData *exif, gchar **exif_date_time, gchar
 			longitude = -longitude;
 			}
 
-		timezone_path = g_build_filename(get_rc_dir(), TIMEZONE_DATABASE_FILE, NULL);
-		if (g_file_test(timezone_path, G_FILE_TEST_EXISTS))
-			{
-			ZDSetErrorHandler(ZoneDetect_onError);
-			cd = ZDOpenDatabase(timezone_path);
-			if (cd)
-				{
-				results = ZDLookup(cd, latitude, longitude, nullptr);
-				if (results)
-					{
-					zd_tz(results, timezone, countryname, countryalpha2);
-					ret = TRUE;
-					}
-				}
-			else
-				{
-				log_printf("Error: Init of timezone database %s failed\n", timezone_path);
-				}
-			ZDCloseDatabase(cd);
-			}
-		g_free(timezone_path);
+		ret = exif_timezone_lookup(latitude, longitude, timezone, countryname, countryalpha2);
 		}
 
 	if (ret && text_date && text_time)
@@ -59,6 +59,10 @@ struct ExifData
 	gchar *path;
 	GList *items;	/**< list of (ExifItem *) */
 	GList *current; /**< for exif_get_next_item */
+	GHashTable *keys; /**< marker key -> first (ExifItem *) with that key */
+
+	gpointer map_data; /**< the mapped file, referenced by the items */
+	gint map_size;
 };
 
 struct ExifTextList
@@ -83,8 +87,13 @@ struct ExifItem
 	guint tag;
 	const ExifMarker *marker;
 	guint elements;
-	gpointer data;
+	gpointer data;	/**< decoded on first use from raw, if set */
 	guint data_len;
+
+	guchar *raw;	/**< the undecoded value in ExifData::map_data */
+	guint raw_len;
+	ExifFormatType raw_format;
+	ExifByteOrder raw_bo;
 };
 
 #define EXIF_MARKER_LIST_END { 0x0000, EXIF_FORMAT_UNKNOWN, 0, NULL, NULL, NULL }
@@ -139,6 +148,8 @@ ExifItem *exif_item_new(ExifFormatType format, guint tag,
 			guint elements, const ExifMarker *marker);
 void exif_item_copy_data(ExifItem *item, gpointer src, guint len,
 			 ExifFormatType src_format, ExifByteOrder bo);
+gpointer exif_item_data(ExifItem *item);
+void exif_add_item(ExifData *exif, ExifItem *item);
 
 gint exif_parse_IFD_table(ExifData *exif,
 			  guchar *tiff, guint offset,
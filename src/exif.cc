@@ -491,8 +491,9 @@ static const ExifMarker *exif_marker_from_tag(guint16 tag, const ExifMarker *lis
  *-----------------------------------------------------------------------------
  */
 
-ExifItem *exif_item_new(ExifFormatType format, guint tag,
-			guint elements, const ExifMarker *marker)
+/* an item without data, for exif_item_new() and items decoded on first use */
+static ExifItem *exif_item_new_empty(ExifFormatType format, guint tag,
+				     guint elements, const ExifMarker *marker)
 {
 	ExifItem *item;
 
@@ -546,7 +547,15 @@ ExifItem *exif_item_new(ExifFormatType format, guint tag,
 			break;
 		}
 
-	item->data = g_malloc0(item->data_len);
+	return item;
+}
+
+ExifItem *exif_item_new(ExifFormatType format, guint tag,
+			guint elements, const ExifMarker *marker)
+{
+	ExifItem *item = exif_item_new_empty(format, tag, elements, marker);
+
+	if (item->data_len > 0) item->data = g_malloc0(item->data_len);
 
 	return item;
 }
@@ -582,9 +591,9 @@ gchar *exif_item_get_data(ExifItem *item, guint *data_len)
 	if (data_len)
 		*data_len = item->data_len;
 #if GLIB_CHECK_VERSION(2,68,0)
-	return static_cast<gchar*>(g_memdup2(item->data, item->data_len));
+	return static_cast<gchar*>(g_memdup2(exif_item_data(item), item->data_len));
 #else
-	return static_cast<gchar*>(g_memdup(item->data, item->data_len));
+	return static_cast<gchar*>(g_memdup(exif_item_data(item), item->data_len));
 #endif
 }
 
@@ -752,19 +761,17 @@ static void rational_from_data(ExifRational *r, gpointer src, ExifByteOrder bo)
 }
 
 /* src_format and item->format must be compatible
- * and not overrun src or item->data.
+ * and not overrun src or dest.
  */
-void exif_item_copy_data(ExifItem *item, gpointer src, guint len,
-			 ExifFormatType src_format, ExifByteOrder bo)
+static void exif_item_decode(ExifItem *item, gpointer dest, gpointer src, guint len,
+			     ExifFormatType src_format, ExifByteOrder bo)
 {
 	gint bs;
 	gint ne;
-	gpointer dest;
 	gint i;
 
 	bs = ExifFormatList[item->format].size;
 	ne = item->elements;
-	dest = item->data;
 
 	if (!dest ||
 	    ExifFormatList[src_format].size * ne > len)
@@ -845,6 +852,34 @@ void exif_item_copy_data(ExifItem *item, gpointer src, guint len,
 		}
 }
 
+void exif_item_copy_data(ExifItem *item, gpointer src, guint len,
+			 ExifFormatType src_format, ExifByteOrder bo)
+{
+	exif_item_decode(item, item->data, src, len, src_format, bo);
+}
+
+/**
+ * @brief The decoded value of an item
+ *
+ * Items parsed from a file keep a reference to the undecoded value and
+ * are decoded here on first use. Items are shared between threads
+ * through the exif cache, so the decoded value is published only once.
+ */
+gpointer exif_item_data(ExifItem *item)
+{
+	if (!item->raw || item->data_len == 0) return item->data;
+
+	if (g_once_init_enter(&item->data))
+		{
+		gpointer data = g_malloc0(item->data_len);
+
+		exif_item_decode(item, data, item->raw, item->raw_len, item->raw_format, item->raw_bo);
+		g_once_init_leave(&item->data, data);
+		}
+
+	return item->data;
+}
+
 static gint exif_parse_IFD_entry(ExifData *exif, guchar *tiff, guint offset,
 				 guint size, ExifByteOrder bo,
 				 gint level,
@@ -932,9 +967,13 @@ static gint exif_parse_IFD_entry(ExifData *exif, guchar *tiff, guint offset,
 		data_offset = offset + EXIF_TIFD_OFFSET_DATA;
 		}
 
-	item = exif_item_new(marker->format, tag, count, marker);
-	exif_item_copy_data(item, tiff + data_offset, data_length, static_cast<ExifFormatType>(format), bo);
-	exif->items = g_list_prepend(exif->items, item);
+	/* the value is only decoded when it is asked for */
+	item = exif_item_new_empty(marker->format, tag, count, marker);
+	item->raw = tiff + data_offset;
+	item->raw_len = data_length;
+	item->raw_format = static_cast<ExifFormatType>(format);
+	item->raw_bo = bo;
+	exif_add_item(exif, item);
 
 	if (list == ExifKnownMarkersList)
 		{
@@ -1056,7 +1095,7 @@ void exif_add_jpeg_color_profile(ExifData *exif, guchar *cp_data, guint cp_lengt
 	item->data = cp_data;
 	item->elements = cp_length;
 	item->data_len = cp_length;
-	exif->items = g_list_prepend(exif->items, item);
+	exif_add_item(exif, item);
 
 }
 
@@ -1198,7 +1237,9 @@ void exif_free(ExifData *exif)
 {
 	if (!exif) return;
 
+	if (exif->keys) g_hash_table_destroy(exif->keys);
 	g_list_free_full(exif->items, reinterpret_cast<GDestroyNotify>(exif_item_free));
+	if (exif->map_data) unmap_file(exif->map_data, exif->map_size);
 	g_free(exif->path);
 	g_free(exif);
 }
@@ -1222,6 +1263,9 @@ ExifData *exif_read(gchar *path, gchar *, GHashTable *)
 
 	exif = g_new0(ExifData, 1);
 	exif->path = g_strdup(path);
+	exif->keys = g_hash_table_new(g_str_hash, g_str_equal);
+	exif->map_data = f;
+	exif->map_size = size;
 
 	res = exif_jpeg_parse(exif, static_cast<guchar *>(f), size, ExifKnownMarkersList);
 	if (res == -2)
@@ -1268,27 +1312,36 @@ ExifData *exif_read(gchar *path, gchar *, GHashTable *)
 	if (res != 0)
 		{
 		exif_free(exif);
-		exif = nullptr;
+		return nullptr;
 		}
 
-	unmap_file(f, size);
-
-	if (exif) exif->items = g_list_reverse(exif->items);
+	exif->items = g_list_reverse(exif->items);
 
 	return exif;
 }
 
-ExifItem *exif_get_item(ExifData *exif, const gchar *key)
+/**
+ * @brief Adds a parsed item to \a exif
+ *
+ * The key index is kept up to date, so exif_get_item() can be used by
+ * the makernote parsers while the file is parsed. The first item added
+ * for a key wins, which is the first one in the list once it is reversed.
+ */
+void exif_add_item(ExifData *exif, ExifItem *item)
 {
-	if (!key) return nullptr;
+	exif->items = g_list_prepend(exif->items, item);
 
-	const auto exif_item_compare_marker_key = [](gconstpointer data, gconstpointer user_data)
-	{
-		return g_strcmp0(static_cast<const ExifItem *>(data)->marker->key, static_cast<const gchar *>(user_data));
-	};
+	if (item->marker && item->marker->key && !g_hash_table_contains(exif->keys, item->marker->key))
+		{
+		g_hash_table_insert(exif->keys, const_cast<gchar *>(item->marker->key), item);
+		}
+}
 
-	GList *work = g_list_find_custom(exif->items, key, exif_item_compare_marker_key);
-	return work ? static_cast<ExifItem*>(work->data) : nullptr;
+ExifItem *exif_get_item(ExifData *exif, const gchar *key)
+{
+	if (!key || !exif->keys) return nullptr;
+
+	return static_cast<ExifItem *>(g_hash_table_lookup(exif->keys, key));
 }
 
 #define EXIF_DATA_AS_TEXT_MAX_COUNT 16
@@ -1307,7 +1360,7 @@ static gchar *exif_item_get_data_as_text_full(ExifItem *item, MetadataFormat for
 	marker = item->marker;
 	if (!marker) return nullptr;
 
-	data = item->data;
+	data = exif_item_data(item);
 	ne = item->elements;
 	if (ne > EXIF_DATA_AS_TEXT_MAX_COUNT) ne = EXIF_DATA_AS_TEXT_MAX_COUNT;
 	string = g_string_new("");
@@ -1343,7 +1396,7 @@ static gchar *exif_item_get_data_as_text_full(ExifItem *item, MetadataFormat for
 				}
 			break;
 		case EXIF_FORMAT_STRING:
-			if (item->data) string = g_string_append(string, (gchar *)(item->data));
+			if (data) string = g_string_append(string, static_cast<gchar *>(data));
 			break;
 		case EXIF_FORMAT_SHORT_UNSIGNED:
 			if (ne == 1 && marker->list && format == METADATA_FORMATTED)
@@ -1441,22 +1494,25 @@ gint exif_item_get_integer(ExifItem *item, gint *value)
 	if (!item) return FALSE;
 	if (!item->elements) return FALSE;
 
+	gpointer data = exif_item_data(item);
+	if (!data) return FALSE;
+
 	switch (item->format)
 		{
 		case EXIF_FORMAT_SHORT:
-			*value = static_cast<gint>((static_cast<gint16 *>(item->data))[0]);
+			*value = static_cast<gint>((static_cast<gint16 *>(data))[0]);
 			return TRUE;
 			break;
 		case EXIF_FORMAT_SHORT_UNSIGNED:
-			*value = static_cast<gint>((static_cast<guint16 *>(item->data))[0]);
+			*value = static_cast<gint>((static_cast<guint16 *>(data))[0]);
 			return TRUE;
 			break;
 		case EXIF_FORMAT_LONG:
-			*value = static_cast<gint>((static_cast<gint32 *>(item->data))[0]);
+			*value = static_cast<gint>((static_cast<gint32 *>(data))[0]);
 			return TRUE;
 			break;
 		case EXIF_FORMAT_LONG_UNSIGNED: /**< @FIXME overflow possible */
-			*value = static_cast<gint>((static_cast<guint32 *>(item->data))[0]);
+			*value = static_cast<gint>((static_cast<guint32 *>(data))[0]);
 			return TRUE;
 		default:
 			/* all other type return FALSE */
@@ -1474,8 +1530,11 @@ ExifRational *exif_item_get_rational(ExifItem *item, gint *sign, guint n)
 	if (item->format == EXIF_FORMAT_RATIONAL ||
 	    item->format == EXIF_FORMAT_RATIONAL_UNSIGNED)
 		{
+		auto data = static_cast<ExifRational *>(exif_item_data(item));
+		if (!data) return nullptr;
+
 		if (sign) *sign = (item->format == EXIF_FORMAT_RATIONAL);
-		return &(static_cast<ExifRational *>(item->data))[n];
+		return &data[n];
 		}
 
 	return nullptr;
@@ -1618,6 +1677,7 @@ struct UnmapData
 };
 
 static GList *exif_unmap_list = nullptr;
+static GMutex exif_unmap_mutex; /* previews are taken in the image loader threads */
 
 guchar *exif_get_preview(ExifData *exif, guint *data_len, gint, gint)
 {
@@ -1665,7 +1725,9 @@ guchar *exif_get_preview(ExifData *exif, guint *data_len, gint, gint)
 		ud->map_data = map_data;
 		ud->map_len = map_len;
 
+		g_mutex_lock(&exif_unmap_mutex);
 		exif_unmap_list = g_list_prepend(exif_unmap_list, ud);
+		g_mutex_unlock(&exif_unmap_mutex);
 		return ud->ptr;
 		}
 
@@ -1676,6 +1738,7 @@ guchar *exif_get_preview(ExifData *exif, guint *data_len, gint, gint)
 
 void exif_free_preview(const guchar *buf)
 {
+	g_mutex_lock(&exif_unmap_mutex);
 	GList *work = exif_unmap_list;
 
 	while (work)
@@ -1684,11 +1747,13 @@ void exif_free_preview(const guchar *buf)
 		if (ud->ptr == buf)
 			{
 			exif_unmap_list = g_list_remove_link(exif_unmap_list, work);
+			g_mutex_unlock(&exif_unmap_mutex);
 			g_free(ud);
 			return;
 			}
 		work = work->next;
 		}
+	g_mutex_unlock(&exif_unmap_mutex);
 	g_assert_not_reached();
 }
 
@@ -168,6 +168,10 @@ guchar *exif_get_preview(ExifData *exif, guint *data_len, gint requested_width,
 void exif_free_preview(const guchar *buf);
 
 gchar *metadata_file_info(FileData *fd, const gchar *key, MetadataFormat format);
+
+gboolean exif_timezone_lookup(gdouble latitude, gdouble longitude, gchar **timezone, gchar **countryname, gchar **countryalpha2);
+void exif_timezone_database_reset();
+
 gchar *metadata_lua_info(FileData *fd, const gchar *key, MetadataFormat format);
 
 #endif
@@ -404,6 +404,22 @@ public:
 
 
 
+namespace
+{
+
+GMutex exif_xmp_mutex;
+
+/* the XMP toolkit is not thread safe, Exiv2 serializes it with this */
+void exif_xmp_lock(void *data, bool lock)
+{
+	if (lock)
+		g_mutex_lock(static_cast<GMutex *>(data));
+	else
+		g_mutex_unlock(static_cast<GMutex *>(data));
+}
+
+} // namespace
+
 void exif_init()
 {
 #ifdef EXV_ENABLE_NLS
@@ -415,6 +431,9 @@ void exif_init()
 	Exiv2::enableBMFF(true);
 #endif
 #endif
+
+	/* files are read in worker threads, the XMP toolkit must be set up before that */
+	Exiv2::XmpParser::initialize(exif_xmp_lock, &exif_xmp_mutex);
 }
 
 
@@ -27,29 +27,75 @@
 /* Set to TRUE to add file cache dumps to the debug output */
 const gboolean debug_file_cache = FALSE;
 
-/* this implements a simple LRU algorithm */
+/* this implements a simple LRU algorithm,
+ * entries are indexed by FileData and kept in an intrusive list, most recently used first
+ */
+
+struct FileCacheEntry {
+	FileData *fd;
+	gulong size;
+
+	FileCacheEntry *prev;
+	FileCacheEntry *next;
+};
 
 struct FileCacheData {
 	FileCacheReleaseFunc release;
-	GList *list;
+	GHashTable *entries; /* FileData * -> FileCacheEntry * */
+	FileCacheEntry *head;
+	FileCacheEntry *tail;
 	gulong max_size;
 	gulong size;
-};
 
-struct FileCacheEntry {
-	FileData *fd;
-	gulong size;
+	/* statistics, see file_cache_dump() */
+	gulong hits;
+	gulong misses;
+	gulong evictions;
 };
 
 static void file_cache_notify_cb(FileData *fd, NotifyType type, gpointer data);
 static void file_cache_remove_fd(FileCacheData *fc, FileData *fd);
 
+static void file_cache_unlink(FileCacheData *fc, FileCacheEntry *fe)
+{
+	if (fe->prev) fe->prev->next = fe->next;
+	else fc->head = fe->next;
+
+	if (fe->next) fe->next->prev = fe->prev;
+	else fc->tail = fe->prev;
+
+	fe->prev = nullptr;
+	fe->next = nullptr;
+}
+
+static void file_cache_link_head(FileCacheData *fc, FileCacheEntry *fe)
+{
+	fe->prev = nullptr;
+	fe->next = fc->head;
+
+	if (fc->head) fc->head->prev = fe;
+	else fc->tail = fe;
+
+	fc->head = fe;
+}
+
+static void file_cache_entry_free(FileCacheData *fc, FileCacheEntry *fe)
+{
+	g_hash_table_remove(fc->entries, fe->fd);
+	file_cache_unlink(fc, fe);
+
+	fc->size -= fe->size;
+	fc->release(fe->fd);
+	file_data_unref(fe->fd);
+	g_free(fe);
+}
+
 FileCacheData *file_cache_new(FileCacheReleaseFunc release, gulong max_size)
 {
-	auto fc = g_new(FileCacheData, 1);
+	auto fc = g_new0(FileCacheData, 1);
 
 	fc->release = release;
-	fc->list = nullptr;
+	fc->entries = g_hash_table_new(g_direct_hash, g_direct_equal);
 	fc->max_size = max_size;
 	fc->size = 0;
 
@@ -58,61 +104,61 @@ FileCacheData *file_cache_new(FileCacheReleaseFunc release, gulong max_size)
 	return fc;
 }
 
-gboolean file_cache_get(FileCacheData *fc, FileData *fd)
+/**
+ * @brief Looks up @a fd and moves it to the front of the LRU list.
+ * @returns The entry, or nullptr if @a fd is not cached or has changed on disk
+ */
+static FileCacheEntry *file_cache_lookup(FileCacheData *fc, FileData *fd)
 {
-	GList *work;
+	auto fe = static_cast<FileCacheEntry *>(g_hash_table_lookup(fc->entries, fd));
+
+	if (!fe) return nullptr;
 
+	/* entry exists */
+	DEBUG_2("cache hit: fc=%p %s", (void *)fc, fd->path);
+	if (fe == fc->head) return fe; /* already at the beginning */
+
+	/* move it to the beginning */
+	DEBUG_2("cache move to front: fc=%p %s", (void *)fc, fd->path);
+	file_cache_unlink(fc, fe);
+	file_cache_link_head(fc, fe);
+
+	if (file_data_check_changed_files(fd)) {
+		/* file has been changed, cance entry is no longer valid */
+		file_cache_remove_fd(fc, fd);
+		return nullptr;
+	}
+
+	return fe;
+}
+
+gboolean file_cache_get(FileCacheData *fc, FileData *fd)
+{
 	g_assert(fc && fd);
 
-	work = fc->list;
-	while (work)
+	if (file_cache_lookup(fc, fd))
 		{
-		auto fce = static_cast<FileCacheEntry *>(work->data);
-		if (fce->fd == fd)
-			{
-			/* entry exists */
-			DEBUG_2("cache hit: fc=%p %s", (void *)fc, fd->path);
-			if (work == fc->list) return TRUE; /* already at the beginning */
-			/* move it to the beginning */
-			DEBUG_2("cache move to front: fc=%p %s", (void *)fc, fd->path);
-			fc->list = g_list_remove_link(fc->list, work);
-			fc->list = g_list_concat(work, fc->list);
-
-			if (file_data_check_changed_files(fd)) {
-				/* file has been changed, cance entry is no longer valid */
-				file_cache_remove_fd(fc, fd);
-				return FALSE;
-			}
-			if (debug_file_cache) file_cache_dump(fc);
-			return TRUE;
-			}
-		work = work->next;
+		fc->hits++;
+		if (debug_file_cache) file_cache_dump(fc);
+		return TRUE;
 		}
+
+	fc->misses++;
 	DEBUG_2("cache miss: fc=%p %s", (void *)fc, fd->path);
 	return FALSE;
 }
 
 void file_cache_set_size(FileCacheData *fc, gulong size)
 {
-	GList *work;
-	FileCacheEntry *last_fe;
-
 	if (debug_file_cache) file_cache_dump(fc);
 
-	work = g_list_last(fc->list);
-	while (fc->size > size && work)
+	while (fc->size > size && fc->tail)
 		{
-		GList *prev;
-		last_fe = static_cast<FileCacheEntry *>(work->data);
-		prev = work->prev;
-		fc->list = g_list_delete_link(fc->list, work);
-		work = prev;
+		FileCacheEntry *last_fe = fc->tail;
 
 		DEBUG_2("file changed - cache remove: fc=%p %s", (void *)fc, last_fe->fd->path);
-		fc->size -= last_fe->size;
-		fc->release(last_fe->fd);
-		file_data_unref(last_fe->fd);
-		g_free(last_fe);
+		fc->evictions++;
+		file_cache_entry_free(fc, last_fe);
 		}
 }
 
@@ -120,13 +166,16 @@ void file_cache_put(FileCacheData *fc, FileData *fd, gulong size)
 {
 	FileCacheEntry *fe;
 
-	if (file_cache_get(fc, fd)) return;
+	g_assert(fc && fd);
+
+	if (file_cache_lookup(fc, fd)) return;
 
 	DEBUG_2("cache add: fc=%p %s", (void *)fc, fd->path);
-	fe = g_new(FileCacheEntry, 1);
+	fe = g_new0(FileCacheEntry, 1);
 	fe->fd = file_data_ref(fd);
 	fe->size = size;
-	fc->list = g_list_prepend(fc->list, fe);
+	g_hash_table_insert(fc->entries, fe->fd, fe);
+	file_cache_link_head(fc, fe);
 	fc->size += size;
 
 	file_cache_set_size(fc, fc->max_size);
@@ -140,42 +189,27 @@ void file_cache_set_max_size(FileCacheData *fc, gulong size)
 
 static void file_cache_remove_fd(FileCacheData *fc, FileData *fd)
 {
-	GList *work;
 	FileCacheEntry *fe;
 
 	if (debug_file_cache) file_cache_dump(fc);
 
-	work = fc->list;
-	while (work)
-		{
-		GList *current = work;
-		fe = static_cast<FileCacheEntry *>(work->data);
-		work = work->next;
-
-		if (fe->fd == fd)
-			{
-			fc->list = g_list_delete_link(fc->list, current);
-
-			DEBUG_1("cache remove: fc=%p %s", (void *)fc, fe->fd->path);
-			fc->size -= fe->size;
-			fc->release(fe->fd);
-			file_data_unref(fe->fd);
-			g_free(fe);
-			}
-		}
+	fe = static_cast<FileCacheEntry *>(g_hash_table_lookup(fc->entries, fd));
+	if (!fe) return;
+
+	DEBUG_1("cache remove: fc=%p %s", (void *)fc, fe->fd->path);
+	file_cache_entry_free(fc, fe);
 }
 
 void file_cache_dump(FileCacheData *fc)
 {
-	GList *work = fc->list;
 	gulong n = 0;
 
-	DEBUG_1("cache dump: fc=%p max size:%lu size:%lu", (void *)fc, fc->max_size, fc->size);
+	DEBUG_1("cache dump: fc=%p max size:%lu size:%lu entries:%u hits:%lu misses:%lu evictions:%lu",
+	        (void *)fc, fc->max_size, fc->size, g_hash_table_size(fc->entries),
+	        fc->hits, fc->misses, fc->evictions);
 
-	while (work)
+	for (FileCacheEntry *fe = fc->head; fe; fe = fe->next)
 		{
-		auto fe = static_cast<FileCacheEntry *>(work->data);
-		work = work->next;
 		DEBUG_1("cache entry: fc=%p [%lu] %s %lu", (void *)fc, ++n, fe->fd->path, fe->size);
 		}
 }
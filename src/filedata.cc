@@ -179,6 +179,31 @@ gboolean filelist_read_lstat(FileData *dir_fd, GList **files, GList **dirs)
 	return FileData::FileList::read_list_lstat(dir_fd, files, dirs);
 }
 
+FileListReader *filelist_read_begin(FileData *dir_fd)
+{
+	return FileData::FileList::read_list_begin(dir_fd);
+}
+
+gboolean filelist_read_step(FileListReader *reader, GList **files, gint64 end_time)
+{
+	return FileData::FileList::read_list_step(reader, files, end_time);
+}
+
+gdouble filelist_read_progress(const FileListReader *reader)
+{
+	return FileData::FileList::read_list_progress(reader);
+}
+
+GList *filelist_read_finish(FileListReader *reader)
+{
+	return FileData::FileList::read_list_finish(reader);
+}
+
+void filelist_read_cancel(FileListReader *reader)
+{
+	FileData::FileList::read_list_cancel(reader);
+}
+
 void filelist_free(GList *list)
 {
 	FileData::FileList::free_list(list);
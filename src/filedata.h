@@ -35,6 +35,7 @@
 
 struct ExifData;
 struct HistMap;
+struct MetadataCache;
 
 #ifdef DEBUG
 #define DEBUG_FILEDATA
@@ -172,7 +173,7 @@ class FileData {
 	time_t exifdate;
 	time_t exifdate_digitized;
 	GHashTable *modified_xmp; /**< hash table which contains unwritten xmp metadata in format: key->list of string values */
-	GList *cached_metadata;
+	MetadataCache *cached_metadata; /**< metadata read often, see metadata.cc */
 	gint rating;
 	gboolean metadata_in_idle_loaded;
 
@@ -368,6 +369,13 @@ class FileData::FileList
 
 	static gboolean read_list(FileData *dir_fd, GList **files, GList **dirs);
 	static gboolean read_list_lstat(FileData *dir_fd, GList **files, GList **dirs);
+
+	struct Reader;
+	static Reader *read_list_begin(FileData *dir_fd);
+	static gboolean read_list_step(Reader *reader, GList **files, gint64 end_time);
+	static gdouble read_list_progress(const Reader *reader);
+	static GList *read_list_finish(Reader *reader);
+	static void read_list_cancel(Reader *reader);
 	static void free_list(GList *list);
 	static GList *copy(GList *list);
 	static GList *from_path_list(GList *list);
@@ -383,6 +391,8 @@ class FileData::FileList
 	static GList *filter_out_sidecars(GList *flist);
 	static gboolean is_hidden_file(const gchar *filepath);
 	static gboolean read_list_real(const gchar *dir_path, GList **files, GList **dirs, gboolean follow_symlinks);
+	static Reader *read_list_open(const gchar *dir_path, gboolean want_files, gboolean want_dirs, gboolean follow_symlinks);
+	static void read_list_close(Reader *reader, GList **files, GList **dirs);
 	static gint sort_file_cb(gconstpointer a, gconstpointer b, gpointer data);
 	static gint sort_path_cb(gconstpointer a, gconstpointer b);
 	static void recursive_append(GList **list, GList *dirs);
@@ -447,6 +457,12 @@ GList *filelist_sort_full(GList *list, SortType method, gboolean ascending, gboo
 
 gboolean filelist_read(FileData *dir_fd, GList **files, GList **dirs);
 gboolean filelist_read_lstat(FileData *dir_fd, GList **files, GList **dirs);
+using FileListReader = FileData::FileList::Reader;
+FileListReader *filelist_read_begin(FileData *dir_fd);
+gboolean filelist_read_step(FileListReader *reader, GList **files, gint64 end_time);
+gdouble filelist_read_progress(const FileListReader *reader);
+GList *filelist_read_finish(FileListReader *reader);
+void filelist_read_cancel(FileListReader *reader);
 void filelist_free(GList *list);
 GList *filelist_copy(GList *list);
 GList *filelist_from_path_list(GList *list);
@@ -503,23 +503,15 @@ void FileData::read_exif_time_data(FileData *file)
 		return;
 		}
 
-	if (!file->exif)
-		{
-		exif_read_fd(file);
-		}
+	g_autofree gchar *tmp = metadata_read_string(file, "Exif.Photo.DateTimeOriginal", METADATA_PLAIN);
+	DEBUG_2("%s read_exif_time_data: reading %p %s", get_exec_time(), (void *)file, file->path);
 
-	if (file->exif)
+	if (tmp)
 		{
-		g_autofree gchar *tmp = exif_get_data_as_text(file->exif, "Exif.Photo.DateTimeOriginal");
-		DEBUG_2("%s read_exif_time_data: reading %p %s", get_exec_time(), (void *)file, file->path);
+		std::tm time_str{};
+		strptime(tmp, "%Y:%m:%d %H:%M:%S", &time_str);
 
-		if (tmp)
-			{
-			std::tm time_str{};
-			strptime(tmp, "%Y:%m:%d %H:%M:%S", &time_str);
-
-			file->exifdate = mktime(&time_str);
-			}
+		file->exifdate = mktime(&time_str);
 		}
 }
 
@@ -531,23 +523,15 @@ void FileData::read_exif_time_digitized_data(FileData *file)
 		return;
 		}
 
-	if (!file->exif)
-		{
-		exif_read_fd(file);
-		}
+	g_autofree gchar *tmp = metadata_read_string(file, "Exif.Photo.DateTimeDigitized", METADATA_PLAIN);
+	DEBUG_2("%s read_exif_time_digitized_data: reading %p %s", get_exec_time(), (void *)file, file->path);
 
-	if (file->exif)
+	if (tmp)
 		{
-		g_autofree gchar *tmp = exif_get_data_as_text(file->exif, "Exif.Photo.DateTimeDigitized");
-		DEBUG_2("%s read_exif_time_digitized_data: reading %p %s", get_exec_time(), (void *)file, file->path);
+		std::tm time_str{};
+		strptime(tmp, "%Y:%m:%d %H:%M:%S", &time_str);
 
-		if (tmp)
-			{
-			std::tm time_str{};
-			strptime(tmp, "%Y:%m:%d %H:%M:%S", &time_str);
-
-			file->exifdate_digitized = mktime(&time_str);
-			}
+		file->exifdate_digitized = mktime(&time_str);
 		}
 }
 
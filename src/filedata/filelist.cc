@@ -26,6 +26,7 @@
 #include "filedata.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 
 #include <cerrno>
@@ -39,6 +40,7 @@
 #include "debug.h"
 #include "filefilter.h"
 #include "main.h"
+#include "misc.h"
 #include "options.h"
 #include "thumb-standard.h"
 #include "typedefs.h"
@@ -106,108 +108,426 @@ gboolean FileData::FileList::is_hidden_file(const gchar *filepath)
 	return res;
 }
 
-gboolean FileData::FileList::read_list_real(const gchar *dir_path, GList **files, GList **dirs, gboolean follow_symlinks)
+/*
+ *-----------------------------------------------------------------------------
+ * directory scanner
+ *-----------------------------------------------------------------------------
+ */
+
+namespace
+{
+
+/** Entries stat'ed by one thread pool job */
+constexpr guint DIR_SCAN_BATCH_SIZE = 256;
+
+struct DirScanEntry
+{
+	gchar *name;
+	struct stat st;
+	gboolean valid; /**< stat succeeded and the entry is not hidden */
+};
+
+struct DirScan;
+
+struct DirScanBatch
+{
+	DirScan *scan;
+	guint index;
+	GArray *entries; /**< #DirScanEntry */
+};
+
+/**
+ * Reads a directory, stat'ing the entries relative to the directory fd.
+ * Names are read on the calling thread; the stat (and hidden file) checks
+ * of each batch of names run in a thread pool, as they are what is slow on
+ * network file systems.
+ */
+struct DirScan
 {
 	DIR *dp;
-	struct dirent *dir;
 	gchar *pathl;
-	GList *dlist = nullptr;
-	GList *flist = nullptr;
-	GList *xmp_files = nullptr;
-	gint (*stat_func)(const gchar *path, struct stat *buf);
-	GHashTable *basename_hash = nullptr;
+	gboolean follow_symlinks;
+	gboolean (*is_hidden)(const gchar *filepath); /**< NULL to list hidden files */
+
+	guint entries; /**< names read */
+	gint cancelled; /**< atomic, set to skip the remaining stat calls */
+	guint batches_queued;
+	guint batches_returned;
+	GAsyncQueue *done; /**< finished #DirScanBatch */
+	GPtrArray *finished; /**< finished batches, by index, until returned in order */
+};
+
+void dir_scan_batch_stat(DirScanBatch *batch)
+{
+	DirScan *scan = batch->scan;
+	gint flags = scan->follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW;
 
-	g_assert(files || dirs);
+	for (guint i = 0; i < batch->entries->len; i++)
+		{
+		auto entry = &g_array_index(batch->entries, DirScanEntry, i);
 
-	if (files) *files = nullptr;
-	if (dirs) *dirs = nullptr;
+		if (g_atomic_int_get(&scan->cancelled)) break;
 
-	pathl = path_from_utf8(dir_path);
-	if (!pathl) return FALSE;
+		if (fstatat(dirfd(scan->dp), entry->name, &entry->st, flags) < 0)
+			{
+			if (errno == EOVERFLOW)
+				{
+				log_printf("stat(): EOVERFLOW, skip '%s/%s'", scan->pathl, entry->name);
+				}
+			continue;
+			}
+
+		if (scan->is_hidden)
+			{
+			g_autofree gchar *filepath = g_build_filename(scan->pathl, entry->name, NULL);
+
+			if (scan->is_hidden(filepath)) continue;
+			}
+
+		entry->valid = TRUE;
+		}
+}
+
+void dir_scan_thread_func(gpointer data, gpointer)
+{
+	auto batch = static_cast<DirScanBatch *>(data);
+
+	dir_scan_batch_stat(batch);
+
+	g_async_queue_push(batch->scan->done, batch);
+}
+
+GThreadPool *dir_scan_thread_pool()
+{
+	/* mostly waiting on the file system, so use more threads than cores */
+	static GThreadPool *pool = g_thread_pool_new(dir_scan_thread_func, nullptr, MAX(4, 2 * get_cpu_cores()), FALSE, nullptr);
 
-	dp = opendir(pathl);
-	if (dp == nullptr)
+	return pool;
+}
+
+void dir_scan_batch_free(DirScanBatch *batch)
+{
+	for (guint i = 0; i < batch->entries->len; i++)
 		{
-		g_free(pathl);
-		return FALSE;
+		g_free(g_array_index(batch->entries, DirScanEntry, i).name);
 		}
+	g_array_free(batch->entries, TRUE);
+	g_free(batch);
+}
 
-	if (files) basename_hash = file_data_basename_hash_new();
+DirScanBatch *dir_scan_batch_new(DirScan *scan)
+{
+	auto batch = g_new0(DirScanBatch, 1);
 
-	if (follow_symlinks)
-		stat_func = stat;
-	else
-		stat_func = lstat;
+	batch->scan = scan;
+	batch->index = scan->batches_queued++;
+	batch->entries = g_array_sized_new(FALSE, TRUE, sizeof(DirScanEntry), DIR_SCAN_BATCH_SIZE);
 
-	while ((dir = readdir(dp)) != nullptr)
+	return batch;
+}
+
+/**
+ * @brief Reads all entry names and queues them for stat
+ *
+ * A directory that fits in one batch is stat'ed on the calling thread.
+ */
+void dir_scan_queue(DirScan *scan)
+{
+	DirScanBatch *batch = nullptr;
+	struct dirent *dir;
+
+	while ((dir = readdir(scan->dp)) != nullptr)
 		{
 		const gchar *name = dir->d_name;
-		g_autofree gchar *filepath = g_build_filename(pathl, name, NULL);
 
-		if (!options->file_filter.show_hidden_files && is_hidden_file(filepath))
+		/* never listed */
+		if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+		if (!batch) batch = dir_scan_batch_new(scan);
+
+		DirScanEntry entry{};
+		entry.name = g_strdup(name);
+		g_array_append_val(batch->entries, entry);
+		scan->entries++;
+
+		if (batch->entries->len >= DIR_SCAN_BATCH_SIZE)
 			{
-			continue;
+			g_thread_pool_push(dir_scan_thread_pool(), batch, nullptr);
+			batch = nullptr;
+			}
+		}
+
+	if (!batch) return;
+
+	if (batch->index == 0)
+		{
+		dir_scan_batch_stat(batch);
+		g_async_queue_push(scan->done, batch);
+		}
+	else
+		{
+		g_thread_pool_push(dir_scan_thread_pool(), batch, nullptr);
+		}
+}
+
+DirScan *dir_scan_open(const gchar *pathl, gboolean follow_symlinks, gboolean (*is_hidden)(const gchar *filepath))
+{
+	DIR *dp = opendir(pathl);
+	if (!dp) return nullptr;
+
+	auto scan = g_new0(DirScan, 1);
+
+	scan->dp = dp;
+	scan->pathl = g_strdup(pathl);
+	scan->follow_symlinks = follow_symlinks;
+	scan->is_hidden = is_hidden;
+	scan->done = g_async_queue_new();
+	scan->finished = g_ptr_array_new();
+
+	dir_scan_queue(scan);
+
+	return scan;
+}
+
+gboolean dir_scan_done(const DirScan *scan)
+{
+	return scan->batches_returned >= scan->batches_queued;
+}
+
+/**
+ * @brief Returns the next batch of entries, in directory order
+ * @param end_time Monotonic time to wait until, G_MAXINT64 to wait as long as needed
+ * @returns The batch, to be freed with dir_scan_batch_free(), or NULL when
+ * all batches were returned or the next one is not ready by \a end_time
+ */
+DirScanBatch *dir_scan_next(DirScan *scan, gint64 end_time = G_MAXINT64)
+{
+	if (dir_scan_done(scan)) return nullptr;
+
+	while (scan->finished->len <= scan->batches_returned || !g_ptr_array_index(scan->finished, scan->batches_returned))
+		{
+		DirScanBatch *batch;
+
+		if (end_time == G_MAXINT64)
+			{
+			batch = static_cast<DirScanBatch *>(g_async_queue_pop(scan->done));
 			}
+		else
+			{
+			gint64 now = g_get_monotonic_time();
+			batch = static_cast<DirScanBatch *>(g_async_queue_timeout_pop(scan->done, MAX(end_time - now, 0)));
+			if (!batch) return nullptr;
+			}
+
+		if (scan->finished->len <= batch->index) g_ptr_array_set_size(scan->finished, batch->index + 1);
+		g_ptr_array_index(scan->finished, batch->index) = batch;
+		}
+
+	return static_cast<DirScanBatch *>(g_ptr_array_index(scan->finished, scan->batches_returned++));
+}
+
+void dir_scan_close(DirScan *scan)
+{
+	DirScanBatch *batch;
+
+	/* batches still in the thread pool use the directory */
+	while ((batch = dir_scan_next(scan))) dir_scan_batch_free(batch);
+
+	closedir(scan->dp);
+	g_ptr_array_free(scan->finished, TRUE);
+	g_async_queue_unref(scan->done);
+	g_free(scan->pathl);
+	g_free(scan);
+}
+
+} // namespace
+
+/**
+ * State of a folder being read, see FileData::FileList::read_list_begin()
+ */
+struct FileData::FileList::Reader
+{
+	DirScan *scan;
+	gchar *prefix; /**< folder path with a trailing separator */
+	gboolean want_files;
+	gboolean want_dirs;
+	guint entries_done;
+
+	GList *dlist;
+	GList *flist;
+	GList *xmp_files;
+	GHashTable *basename_hash;
+};
+
+FileData::FileList::Reader *FileData::FileList::read_list_open(const gchar *dir_path, gboolean want_files, gboolean want_dirs, gboolean follow_symlinks)
+{
+	g_autofree gchar *pathl = path_from_utf8(dir_path);
+	if (!pathl) return nullptr;
+
+	DirScan *scan = dir_scan_open(pathl, follow_symlinks, options->file_filter.show_hidden_files ? nullptr : is_hidden_file);
+	if (!scan) return nullptr;
 
-		struct stat ent_sbuf;
-		if (stat_func(filepath, &ent_sbuf) >= 0)
+	auto reader = g_new0(Reader, 1);
+
+	reader->scan = scan;
+	reader->prefix = g_str_has_suffix(pathl, G_DIR_SEPARATOR_S) ? g_strdup(pathl) : g_strconcat(pathl, G_DIR_SEPARATOR_S, NULL);
+	reader->want_files = want_files;
+	reader->want_dirs = want_dirs;
+	if (want_files) reader->basename_hash = file_data_basename_hash_new();
+
+	return reader;
+}
+
+/**
+ * @brief Starts reading the files of a folder a part at a time
+ * @returns NULL if the folder can not be read
+ *
+ * The entries are stat'ed in the background. Call read_list_step() to collect
+ * them and read_list_finish() for the complete list.
+ */
+FileData::FileList::Reader *FileData::FileList::read_list_begin(FileData *dir_fd)
+{
+	return read_list_open(dir_fd->path, TRUE, FALSE, TRUE);
+}
+
+/**
+ * @brief Collects the entries stat'ed so far
+ * @param files If not NULL, the files found by this call are prepended, referenced.
+ * Sidecars are not grouped yet, so some of them end up as sidecars in the final list.
+ * @param end_time Monotonic time to return at, G_MAXINT64 to read everything
+ * @returns TRUE if there are entries left
+ */
+gboolean FileData::FileList::read_list_step(Reader *reader, GList **files, gint64 end_time)
+{
+	DirScanBatch *batch;
+
+	while ((batch = dir_scan_next(reader->scan, end_time)) != nullptr)
+		{
+		for (guint i = 0; i < batch->entries->len; i++)
 			{
-			if (S_ISDIR(ent_sbuf.st_mode))
+			auto entry = &g_array_index(batch->entries, DirScanEntry, i);
+			const gchar *name = entry->name;
+
+			if (!entry->valid) continue;
+
+			if (S_ISDIR(entry->st.st_mode))
 				{
 				/* we ignore the .thumbnails dir for cleanliness */
-				if (dirs &&
-				    (name[0] != '.' || (name[1] != '\0' && (name[1] != '.' || name[2] != '\0'))) &&
+				if (reader->want_dirs &&
 				    strcmp(name, GQ_CACHE_LOCAL_THUMB) != 0 &&
 				    strcmp(name, GQ_CACHE_LOCAL_METADATA) != 0 &&
 				    strcmp(name, THUMB_FOLDER_LOCAL) != 0)
 					{
-					dlist = g_list_prepend(dlist, file_data_new_local(filepath, &ent_sbuf, TRUE));
+					g_autofree gchar *filepath = g_strconcat(reader->prefix, name, NULL);
+					reader->dlist = g_list_prepend(reader->dlist, file_data_new_local(filepath, &entry->st, TRUE));
 					}
 				}
 			else
 				{
-				if (files && filter_name_exists(name))
+				if (reader->want_files && filter_name_exists(name))
 					{
-					FileData *fd = file_data_new_local(filepath, &ent_sbuf, FALSE);
-					flist = g_list_prepend(flist, fd);
+					g_autofree gchar *filepath = g_strconcat(reader->prefix, name, NULL);
+					FileData *fd = file_data_new_local(filepath, &entry->st, FALSE);
+					reader->flist = g_list_prepend(reader->flist, fd);
+					if (files) *files = g_list_prepend(*files, ::file_data_ref(fd));
 					if (fd->sidecar_priority && !fd->disable_grouping)
 						{
 						if (strcmp(fd->extension, ".xmp") != 0)
-							file_data_basename_hash_insert(basename_hash, fd);
+							file_data_basename_hash_insert(reader->basename_hash, fd);
 						else
-							xmp_files = g_list_append(xmp_files, fd);
+							reader->xmp_files = g_list_append(reader->xmp_files, fd);
 						}
 					}
 				}
 			}
-		else
-			{
-			if (errno == EOVERFLOW)
-				{
-				log_printf("stat(): EOVERFLOW, skip '%s'", filepath);
-				}
-			}
+
+		reader->entries_done += batch->entries->len;
+		dir_scan_batch_free(batch);
+
+		if (end_time != G_MAXINT64 && g_get_monotonic_time() >= end_time) break;
 		}
 
-	closedir(dp);
+	return !dir_scan_done(reader->scan);
+}
 
-	g_free(pathl);
+/**
+ * @brief Fraction of the folder entries collected so far
+ */
+gdouble FileData::FileList::read_list_progress(const Reader *reader)
+{
+	if (reader->scan->entries == 0) return 1.0;
 
-	if (xmp_files)
+	return static_cast<gdouble>(reader->entries_done) / reader->scan->entries;
+}
+
+void FileData::FileList::read_list_close(Reader *reader, GList **files, GList **dirs)
+{
+	read_list_step(reader, nullptr, G_MAXINT64);
+	dir_scan_close(reader->scan);
+
+	if (reader->xmp_files)
 		{
-		g_list_foreach(xmp_files,file_data_basename_hash_insert_cb,basename_hash);
-		g_list_free(xmp_files);
+		g_list_foreach(reader->xmp_files,file_data_basename_hash_insert_cb,reader->basename_hash);
+		g_list_free(reader->xmp_files);
 		}
 
-	if (dirs) *dirs = dlist;
+	if (dirs) *dirs = reader->dlist;
 
 	if (files)
 		{
-		g_hash_table_foreach(basename_hash, file_data_basename_hash_to_sidecars, nullptr);
+		g_hash_table_foreach(reader->basename_hash, file_data_basename_hash_to_sidecars, nullptr);
 
-		*files = filter_out_sidecars(flist);
+		*files = filter_out_sidecars(reader->flist);
 		}
-	if (basename_hash) file_data_basename_hash_free(basename_hash);
+	if (reader->basename_hash) file_data_basename_hash_free(reader->basename_hash);
+
+	g_free(reader->prefix);
+	g_free(reader);
+}
+
+/**
+ * @brief Stops reading and frees \a reader
+ */
+void FileData::FileList::read_list_cancel(Reader *reader)
+{
+	g_atomic_int_set(&reader->scan->cancelled, TRUE);
+	dir_scan_close(reader->scan);
+
+	g_list_free(reader->xmp_files);
+	free_list(reader->flist);
+	free_list(reader->dlist);
+	if (reader->basename_hash) file_data_basename_hash_free(reader->basename_hash);
+
+	g_free(reader->prefix);
+	g_free(reader);
+}
+
+/**
+ * @brief Reads the rest of the folder and frees \a reader
+ * @returns The files of the folder, with sidecars grouped, as read_list() does
+ */
+GList *FileData::FileList::read_list_finish(Reader *reader)
+{
+	GList *files;
+
+	read_list_close(reader, &files, nullptr);
+
+	return files;
+}
+
+gboolean FileData::FileList::read_list_real(const gchar *dir_path, GList **files, GList **dirs, gboolean follow_symlinks)
+{
+	Reader *reader;
+
+	g_assert(files || dirs);
+
+	if (files) *files = nullptr;
+	if (dirs) *dirs = nullptr;
+
+	reader = read_list_open(dir_path, files != nullptr, dirs != nullptr, follow_symlinks);
+	if (!reader) return FALSE;
+
+	read_list_close(reader, files, dirs);
 
 	return TRUE;
 }
@@ -485,7 +485,7 @@ static void canon_mknote_parse_settings(ExifData *exif,
 
 			item = exif_item_new(EXIF_FORMAT_SHORT_UNSIGNED, list[i].tag, 1, &list[i]);
 			exif_item_copy_data(item, &data[list[i].tag], 2, EXIF_FORMAT_SHORT_UNSIGNED, bo);
-			exif->items = g_list_prepend(exif->items, item);
+			exif_add_item(exif, item);
 			}
 
 		i++;
@@ -506,13 +506,13 @@ gboolean format_canon_makernote(ExifData *exif, guchar *tiff, guint offset,
 	item = exif_get_item(exif, "MkN.Canon.Settings1");
 	if (item)
 		{
-		canon_mknote_parse_settings(exif, static_cast<guint16*>(item->data), item->data_len, bo, CanonSet1);
+		canon_mknote_parse_settings(exif, static_cast<guint16*>(exif_item_data(item)), item->data_len, bo, CanonSet1);
 		}
 
 	item = exif_get_item(exif, "MkN.Canon.Settings2");
 	if (item)
 		{
-		canon_mknote_parse_settings(exif, static_cast<guint16*>(item->data), item->data_len, bo, CanonSet2);
+		canon_mknote_parse_settings(exif, static_cast<guint16*>(exif_item_data(item)), item->data_len, bo, CanonSet2);
 		}
 
 	return TRUE;
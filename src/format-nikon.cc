@@ -378,7 +378,7 @@ gboolean format_nikon_makernote(ExifData *exif, guchar *tiff, guint offset,
 		{
 		static ExifMarker marker = { 0x0088, EXIF_FORMAT_STRING, -1,
 					     "Nikon.AutoFocusPoint", "Auto focus point", nullptr };
-		auto array = static_cast<guchar*>(item->data);
+		auto array = static_cast<guchar*>(exif_item_data(item));
 		gchar *text;
 		gint l;
 
@@ -390,7 +390,7 @@ gboolean format_nikon_makernote(ExifData *exif, guchar *tiff, guint offset,
 
 		g_free(text);
 
-		exif->items = g_list_prepend(exif->items, item);
+		exif_add_item(exif, item);
 		}
 
 	item = exif_get_item(exif, "Nikon.ISOSpeed");
@@ -401,9 +401,9 @@ gboolean format_nikon_makernote(ExifData *exif, guchar *tiff, guint offset,
 		ExifItem *shadow;
 
 		shadow = exif_item_new(marker.format, marker.tag, 1, &marker);
-		memcpy(shadow->data, static_cast<char *>(item->data) + 2, 2);
+		memcpy(shadow->data, static_cast<char *>(exif_item_data(item)) + 2, 2);
 
-		exif->items = g_list_prepend(exif->items, shadow);
+		exif_add_item(exif, shadow);
 		}
 
 	item = exif_get_item(exif, "Nikon.WhiteBalance");
@@ -414,9 +414,9 @@ gboolean format_nikon_makernote(ExifData *exif, guchar *tiff, guint offset,
 		ExifItem *shadow;
 
 		shadow = exif_item_new(marker.format, marker.tag, item->data_len, &marker);
-		memcpy(shadow->data, item->data, item->data_len);
+		memcpy(shadow->data, exif_item_data(item), item->data_len);
 
-		exif->items = g_list_prepend(exif->items, shadow);
+		exif_add_item(exif, shadow);
 		}
 
 	return TRUE;
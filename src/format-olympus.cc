@@ -311,7 +311,7 @@ gboolean format_olympus_makernote(ExifData *exif, guchar *tiff, guint offset,
 		{
 		static ExifMarker marker = { 0x0200, EXIF_FORMAT_STRING, -1,
 					     "Olympus.ShootingMode", "Shooting mode", nullptr };
-		auto array = static_cast<guint32 *>(item->data);
+		auto array = static_cast<guint32 *>(exif_item_data(item));
 		gchar *mode;
 		gchar *pdir = nullptr;
 		gchar *text;
@@ -334,7 +334,7 @@ gboolean format_olympus_makernote(ExifData *exif, guchar *tiff, guint offset,
 		g_free(pdir);
 		g_free(mode);
 
-		exif->items = g_list_prepend(exif->items, item);
+		exif_add_item(exif, item);
 		}
 
 	item = exif_get_item(exif, "Olympus.WhiteBalance");
@@ -342,7 +342,7 @@ gboolean format_olympus_makernote(ExifData *exif, guchar *tiff, guint offset,
 		{
 		static ExifMarker marker = { 0x1015, EXIF_FORMAT_STRING, -1,
 					     "Olympus.WhiteBalance", "White balance", nullptr };
-		auto array = static_cast<guint16 *>(item->data);
+		auto array = static_cast<guint16 *>(exif_item_data(item));
 		gchar *mode;
 		gchar *color = nullptr;
 		gchar *text;
@@ -364,7 +364,7 @@ gboolean format_olympus_makernote(ExifData *exif, guchar *tiff, guint offset,
 		g_free(color);
 		g_free(mode);
 
-		exif->items = g_list_prepend(exif->items, item);
+		exif_add_item(exif, item);
 		}
 
 	return TRUE;
@@ -400,7 +400,7 @@ static FormatExifEntry *format_exif_makernote_find(ExifData *exif, guchar *tiff,
 			case FORMAT_EXIF_MATCH_MAKE:
 				if (make &&
 				    make->data_len >= format_exif_list[n].header_length &&
-				    memcmp(make->data, format_exif_list[n].header_pattern,
+				    memcmp(exif_item_data(make), format_exif_list[n].header_pattern,
 						       format_exif_list[n].header_length) == 0)
 					{
 					return &format_exif_list[n];
@@ -22,6 +22,12 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HISTMAP_SSE2 1
+#include <emmintrin.h>
+#endif
 
 #include <gdk/gdk.h>
 #include <glib-object.h>
@@ -29,6 +35,7 @@
 #include "debug.h"
 #include "filedata.h"
 #include "intl.h"
+#include "misc.h"
 #include "pixbuf-util.h"
 
 /*
@@ -42,19 +49,43 @@ namespace
 
 constexpr gint HISTMAP_SIZE = 256;
 
+/** Pixels counted by one thread pool job */
+constexpr gint HISTMAP_SLICE_PIXELS = 1024 * 1024;
+
+struct HistMapCounts {
+	guint32 r[HISTMAP_SIZE];
+	guint32 g[HISTMAP_SIZE];
+	guint32 b[HISTMAP_SIZE];
+	guint32 max[HISTMAP_SIZE];
+};
+
 } // namespace
 
+/**
+ * The histogram of a pixbuf is counted in slices of rows by a thread pool,
+ * each slice into its own counts, which are added to the map as the slice
+ * finishes. The last slice hands the map back to the main loop, which
+ * frees it instead if it was dropped from the FileData meanwhile.
+ */
 struct HistMap {
 	gulong r[HISTMAP_SIZE];
 	gulong g[HISTMAP_SIZE];
 	gulong b[HISTMAP_SIZE];
 	gulong max[HISTMAP_SIZE];
 
-	guint idle_id; /* event source id */
+	gboolean done; /* set in the main thread once all slices are counted */
+	gboolean cancelled; /* set in the main thread when dropped while counting */
+	FileData *fd; /* referenced while counting */
 	GdkPixbuf *pixbuf;
-	gint y;
+	gint pending; /* slices not yet counted, atomic */
+	GMutex lock; /* protects the counts while slices are added */
 };
 
+struct HistMapSlice {
+	HistMap *histmap;
+	gint y;
+	gint end_line;
+};
 
 Histogram *histogram_new()
 {
@@ -153,87 +184,154 @@ const gchar *histogram_label(Histogram *histogram)
 static HistMap *histmap_new()
 {
 	auto histmap = g_new0(HistMap, 1);
+	g_mutex_init(&histmap->lock);
 	return histmap;
 }
 
 void histmap_free(HistMap *histmap)
 {
 	if (!histmap) return;
-	if (histmap->idle_id) g_source_remove(histmap->idle_id);
+	/* a map that is still counting is cancelled instead, see histogram_notify_cb() */
 	if (histmap->pixbuf) g_object_unref(histmap->pixbuf);
+	g_mutex_clear(&histmap->lock);
 	g_free(histmap);
 }
 
-static gboolean histmap_read(HistMap *histmap, gboolean whole)
+/**
+ * @brief Computes the maximum of the color channels of a row of pixels
+ */
+static void histmap_row_max(const guchar *sp, gint w, gint step, guchar *max)
+{
+	gint j = 0;
+
+#ifdef HISTMAP_SSE2
+	if (step == 4)
+		{
+		const __m128i low_byte = _mm_set1_epi32(0xff);
+
+		for (; j + 16 <= w; j += 16)
+			{
+			__m128i m[4];
+
+			for (gint k = 0; k < 4; k++)
+				{
+				/* 4 RGBA pixels, max of R, G and B into the low byte of each */
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sp + (4 * (j + (4 * k)))));
+				__m128i x = _mm_max_epu8(v, _mm_max_epu8(_mm_srli_epi32(v, 8), _mm_srli_epi32(v, 16)));
+
+				m[k] = _mm_and_si128(x, low_byte);
+				}
+
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(max + j), packed);
+			}
+		}
+#endif
+
+	for (sp += j * step; j < w; j++)
+		{
+		max[j] = std::max({sp[0], sp[1], sp[2]});
+		sp += step;
+		}
+}
+
+static void histmap_count(GdkPixbuf *imgpixbuf, gint y, gint end_line, HistMapCounts *counts)
 {
 	gint w;
-	gint h;
-	gint i;
-	gint j;
 	gint srs;
 	gint has_alpha;
 	gint step;
-	gint end_line;
 	guchar *s_pix;
-	GdkPixbuf *imgpixbuf = histmap->pixbuf;
 
 	w = gdk_pixbuf_get_width(imgpixbuf);
-	h = gdk_pixbuf_get_height(imgpixbuf);
 	srs = gdk_pixbuf_get_rowstride(imgpixbuf);
 	s_pix = gdk_pixbuf_get_pixels(imgpixbuf);
 	has_alpha = gdk_pixbuf_get_has_alpha(imgpixbuf);
 
-	if (whole)
+	step = 3 + !!(has_alpha);
+
+	g_autofree guchar *max = static_cast<guchar *>(g_malloc(w));
+
+	for (gint i = y; i < end_line; i++)
 		{
-		end_line = h;
+		const guchar *sp = s_pix + (i * srs); /* 8bit */
+
+		histmap_row_max(sp, w, step, max);
+
+		for (gint j = 0; j < w; j++)
+			{
+			counts->r[sp[0]]++;
+			counts->g[sp[1]]++;
+			counts->b[sp[2]]++;
+			counts->max[max[j]]++;
+
+			sp += step;
+			}
+		}
+}
+
+static gboolean histmap_done_cb(gpointer data)
+{
+	auto histmap = static_cast<HistMap *>(data);
+	FileData *fd = histmap->fd;
+
+	g_object_unref(histmap->pixbuf); /*pixbuf is no longer needed */
+	histmap->pixbuf = nullptr;
+	histmap->fd = nullptr;
+
+	if (histmap->cancelled)
+		{
+		histmap_free(histmap);
 		}
 	else
 		{
-		gint lines = 1 + 16384 / w;
-		end_line = histmap->y + lines;
-		if (end_line > h) end_line = h;
+		histmap->done = TRUE;
+		file_data_send_notification(fd, NOTIFY_HISTMAP);
 		}
+	file_data_unref(fd);
 
-	step = 3 + !!(has_alpha);
-	for (i = histmap->y; i < end_line; i++)
+	return G_SOURCE_REMOVE;
+}
+
+static void histmap_slice_func(gpointer data, gpointer)
+{
+	auto slice = static_cast<HistMapSlice *>(data);
+	HistMap *histmap = slice->histmap;
+	auto counts = g_new0(HistMapCounts, 1);
+
+	histmap_count(histmap->pixbuf, slice->y, slice->end_line, counts);
+
+	g_mutex_lock(&histmap->lock);
+	for (gint i = 0; i < HISTMAP_SIZE; i++)
 		{
-		guchar *sp = s_pix + (i * srs); /* 8bit */
-		for (j = 0; j < w; j++)
-			{
-			guint max = std::max({sp[0], sp[1], sp[2]});
+		histmap->r[i] += counts->r[i];
+		histmap->g[i] += counts->g[i];
+		histmap->b[i] += counts->b[i];
+		histmap->max[i] += counts->max[i];
+		}
+	g_mutex_unlock(&histmap->lock);
 
-			histmap->r[sp[0]]++;
-			histmap->g[sp[1]]++;
-			histmap->b[sp[2]]++;
-			histmap->max[max]++;
+	g_free(counts);
+	g_free(slice);
 
-			sp += step;
-			}
+	if (g_atomic_int_dec_and_test(&histmap->pending))
+		{
+		g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_done_cb, histmap, nullptr);
 		}
-	histmap->y = end_line;
-	return end_line >= h;
 }
 
-const HistMap *histmap_get(FileData *fd)
+static GThreadPool *histmap_thread_pool()
 {
-	if (fd->histmap && !fd->histmap->idle_id) return fd->histmap; /* histmap exists and is finished */
+	static GThreadPool *pool = g_thread_pool_new(histmap_slice_func, nullptr, get_cpu_cores(), FALSE, nullptr);
 
-	return nullptr;
+	return pool;
 }
 
-static gboolean histmap_idle_cb(gpointer data)
+const HistMap *histmap_get(FileData *fd)
 {
-	auto fd = static_cast<FileData *>(data);
-	if (histmap_read(fd->histmap, FALSE))
-		{
-		/* finished */
-		g_object_unref(fd->histmap->pixbuf); /*pixbuf is no longer needed */
-		fd->histmap->pixbuf = nullptr;
-		fd->histmap->idle_id = 0;
-		file_data_send_notification(fd, NOTIFY_HISTMAP);
-		return G_SOURCE_REMOVE;
-		}
-	return G_SOURCE_CONTINUE;
+	if (fd->histmap && fd->histmap->done) return fd->histmap; /* histmap exists and is finished */
+
+	return nullptr;
 }
 
 gboolean histmap_start_idle(FileData *fd)
@@ -243,12 +341,34 @@ gboolean histmap_start_idle(FileData *fd)
 	fd->histmap = histmap_new();
 	fd->histmap->pixbuf = fd->pixbuf;
 	g_object_ref(fd->histmap->pixbuf);
+	fd->histmap->fd = file_data_ref(fd);
+
+	gint w = gdk_pixbuf_get_width(fd->pixbuf);
+	gint h = gdk_pixbuf_get_height(fd->pixbuf);
+	gint lines = 1 + HISTMAP_SLICE_PIXELS / MAX(w, 1);
+	gint slices = (h + lines - 1) / lines;
+
+	if (slices == 0)
+		{
+		histmap_done_cb(fd->histmap);
+		return TRUE;
+		}
+
+	fd->histmap->pending = slices;
+
+	for (gint y = 0; y < h; y += lines)
+		{
+		auto slice = g_new0(HistMapSlice, 1);
+		slice->histmap = fd->histmap;
+		slice->y = y;
+		slice->end_line = MIN(y + lines, h);
+
+		g_thread_pool_push(histmap_thread_pool(), slice, nullptr);
+		}
 
-	fd->histmap->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_idle_cb, fd, nullptr);
 	return TRUE;
 }
 
-
 static void histogram_vgrid(Histogram *histogram, GdkPixbuf *pixbuf, GdkRectangle rect)
 {
 	if (histogram->vgrid == 0) return;
@@ -405,7 +525,11 @@ void histogram_notify_cb(FileData *fd, NotifyType type, gpointer)
 	if ((type & NOTIFY_REREAD) && fd->histmap)
 		{
 		DEBUG_1("Notify histogram: %s %04x", fd->path, type);
-		histmap_free(fd->histmap);
+		/* the slices still being counted use the map, the last one frees it */
+		if (fd->histmap->done)
+			histmap_free(fd->histmap);
+		else
+			fd->histmap->cancelled = TRUE;
 		fd->histmap = nullptr;
 		}
 }
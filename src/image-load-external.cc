@@ -20,19 +20,271 @@
 
 #include "image-load-external.h"
 
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
 #include <glib.h>
 
+#include "debug.h"
 #include "filedata.h"
 #include "image-load.h"
 #include "misc.h"
 #include "options.h"
 #include "ui-fileops.h"
 
+/**
+ * @file
+ *
+ * The selection and extraction tools are not started with a fork of geeqie
+ * for every image. Each tool is run by a long lived shell, the co-process,
+ * which reads the arguments of one call per line from its standard input
+ * and answers with the exit status of the tool on one line. Each tool has
+ * one for every image loader worker, started as they are needed; a call
+ * waits for a free one. Arguments that contain a new line fall back to
+ * runcmd().
+ *
+ * The answer of the selection tool is cached by file extension, size and
+ * modification time.
+ */
+
 namespace
 {
 
+/* one argument line per tool argument, after the file path */
+constexpr const gchar *select_script = "while IFS= read -r f; do \"$0\" \"$f\" </dev/null >&2; echo $?; done";
+constexpr const gchar *extract_script = "while IFS= read -r f && IFS= read -r o; do \"$0\" \"$f\" \"$o\" </dev/null >&2; echo $?; done";
+
+constexpr gsize select_cache_max = 8192;
+
+struct ExternalCoprocess
+{
+	gboolean busy = FALSE;
+	gchar *tool = nullptr;
+	gint sock = -1;
+};
+
+struct ExternalCoprocessPool
+{
+	const gchar *script;
+	GMutex mutex; /* protects busy */
+	GCond cond; /* signalled when a co-process is no longer busy */
+	std::vector<ExternalCoprocess> coprocesses;
+};
+
+ExternalCoprocessPool select_pool{select_script, {}, {}, {}};
+ExternalCoprocessPool extract_pool{extract_script, {}, {}, {}};
+
+struct SelectCache
+{
+	GMutex mutex;
+	gchar *tool;
+	std::unordered_map<std::string, gboolean> decisions;
+};
+
+SelectCache select_cache;
+
+void coprocess_child_setup(gpointer data)
+{
+	gint sock = GPOINTER_TO_INT(data);
+
+	dup2(sock, 0);
+	dup2(sock, 1);
+}
+
+void coprocess_stop(ExternalCoprocess &cp)
+{
+	if (cp.sock != -1) close(cp.sock);
+	cp.sock = -1;
+	g_free(cp.tool);
+	cp.tool = nullptr;
+}
+
+gboolean coprocess_start(ExternalCoprocess &cp, const gchar *script, const gchar *tool)
+{
+	gint socks[2];
+
+	/* other children forked meanwhile must not keep the socket open */
+#ifdef SOCK_CLOEXEC
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, socks) != 0) return FALSE;
+#else
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, socks) != 0) return FALSE;
+	fcntl(socks[0], F_SETFD, FD_CLOEXEC);
+	fcntl(socks[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+	const gchar *argv[] = {"/bin/sh", "-c", script, tool, nullptr};
+	g_autoptr(GError) error = nullptr;
+
+	/* the shell gets its end of the socket as standard input and output */
+	gboolean ok = g_spawn_async(nullptr, const_cast<gchar **>(argv), nullptr, static_cast<GSpawnFlags>(0),
+				    coprocess_child_setup, GINT_TO_POINTER(socks[1]), nullptr, &error);
+	close(socks[1]);
+
+	if (!ok)
+		{
+		log_printf("Unable to start external preview helper %s: %s\n", tool, error->message);
+		close(socks[0]);
+		return FALSE;
+		}
+
+#ifdef SO_NOSIGPIPE
+	gint on = 1;
+	setsockopt(socks[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+	cp.sock = socks[0];
+	cp.tool = g_strdup(tool);
+
+	DEBUG_1("started external preview helper %s", tool);
+
+	return TRUE;
+}
+
+gboolean coprocess_send(gint sock, const gchar *buf, gsize len)
+{
+#ifdef MSG_NOSIGNAL
+	constexpr gint flags = MSG_NOSIGNAL;
+#else
+	constexpr gint flags = 0;
+#endif
+
+	while (len > 0)
+		{
+		gssize n = send(sock, buf, len, flags);
+		if (n <= 0) return FALSE;
+		buf += n;
+		len -= n;
+		}
+
+	return TRUE;
+}
+
+gboolean coprocess_receive(gint sock, gint &status)
+{
+	gchar line[16];
+	gsize p = 0;
+
+	while (p < sizeof(line) - 1)
+		{
+		gchar c;
+
+		if (read(sock, &c, 1) != 1) return FALSE;
+		if (c == '\n') break;
+		line[p++] = c;
+		}
+	line[p] = '\0';
+
+	status = atoi(line);
+
+	return TRUE;
+}
+
+/**
+ * @brief Waits for a co-process of \a pool that is not busy and marks it busy
+ */
+ExternalCoprocess &coprocess_acquire(ExternalCoprocessPool &pool)
+{
+	g_mutex_lock(&pool.mutex);
+
+	/* one for each image loader worker, the first ones are reused most */
+	if (pool.coprocesses.empty()) pool.coprocesses.resize(MAX(get_cpu_cores(), 1));
+
+	while (TRUE)
+		{
+		for (ExternalCoprocess &cp : pool.coprocesses)
+			{
+			if (!cp.busy)
+				{
+				cp.busy = TRUE;
+				g_mutex_unlock(&pool.mutex);
+				return cp;
+				}
+			}
+
+		g_cond_wait(&pool.cond, &pool.mutex);
+		}
+}
+
+void coprocess_release(ExternalCoprocessPool &pool, ExternalCoprocess &cp)
+{
+	g_mutex_lock(&pool.mutex);
+	cp.busy = FALSE;
+	g_cond_signal(&pool.cond);
+	g_mutex_unlock(&pool.mutex);
+}
+
+/**
+ * @brief Runs \a tool with \a args through a free co-process of \a pool
+ * @returns The exit status of the tool, or -1 if the co-process can not be used
+ */
+gint coprocess_run(ExternalCoprocessPool &pool, const gchar *tool, const gchar *const *args)
+{
+	GString *request = g_string_new(nullptr);
+	gint status = -1;
+
+	for (gint i = 0; args[i]; i++)
+		{
+		if (strchr(args[i], '\n'))
+			{
+			g_string_free(request, TRUE);
+			return -1;
+			}
+		g_string_append(request, args[i]);
+		g_string_append_c(request, '\n');
+		}
+
+	ExternalCoprocess &cp = coprocess_acquire(pool);
+
+	if (cp.tool && g_strcmp0(cp.tool, tool) != 0) coprocess_stop(cp);
+
+	/* a co-process that died is started again once */
+	for (gint attempt = 0; attempt < 2 && status == -1; attempt++)
+		{
+		if (cp.sock == -1 && !coprocess_start(cp, pool.script, tool)) break;
+
+		if (!coprocess_send(cp.sock, request->str, request->len) ||
+		    !coprocess_receive(cp.sock, status))
+			{
+			DEBUG_1("external preview helper %s stopped", tool);
+			coprocess_stop(cp);
+			status = -1;
+			}
+		}
+
+	coprocess_release(pool, cp);
+
+	g_string_free(request, TRUE);
+
+	return status;
+}
+
+gint external_run(ExternalCoprocessPool &pool, const gchar *tool, const gchar *const *args)
+{
+	gint status = coprocess_run(pool, tool, args);
+	if (status != -1) return status;
+
+	GString *cmd_line = g_string_new(nullptr);
+	g_string_append_printf(cmd_line, "\"%s\"", tool);
+	for (gint i = 0; args[i]; i++)
+		{
+		g_string_append_printf(cmd_line, " \"%s\"", args[i]);
+		}
+
+	status = runcmd(cmd_line->str);
+	g_string_free(cmd_line, TRUE);
+
+	return status;
+}
+
 struct ImageLoaderExternal : public ImageLoaderBackend
 {
 public:
@@ -54,7 +306,6 @@ private:
 gboolean ImageLoaderExternal::write(const guchar *, gsize &chunk_size, gsize count, GError **)
 {
 	auto il = static_cast<ImageLoader *>(data);
-	gchar *cmd_line;
 	gchar *randname;
 	gchar *tilde_filename;
 
@@ -63,15 +314,13 @@ gboolean ImageLoaderExternal::write(const guchar *, gsize &chunk_size, gsize cou
 	randname = g_strdup("/tmp/geeqie_external_preview_XXXXXX");
 	g_mkstemp(randname);
 
-	cmd_line = g_strdup_printf("\"%s\" \"%s\" \"%s\"" , tilde_filename, il->fd->path, randname);
-
-	runcmd(cmd_line);
+	const gchar *args[] = {il->fd->path, randname, nullptr};
+	external_run(extract_pool, tilde_filename, args);
 
 	pixbuf = gdk_pixbuf_new_from_file(randname, nullptr);
 
 	area_updated_cb(nullptr, 0, 0, gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf), data);
 
-	g_free(cmd_line);
 	unlink_file(randname);
 	g_free(randname);
 	g_free(tilde_filename);
@@ -114,4 +363,46 @@ std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_external()
 	return std::make_unique<ImageLoaderExternal>();
 }
 
+/**
+ * @brief Asks the selection tool whether \a fd is loaded by the extraction tool
+ *
+ * May be called from the image loader threads.
+ */
+gboolean image_loader_external_select(FileData *fd)
+{
+	g_autofree gchar *tool = expand_tilde(options->external_preview.select);
+	g_autofree gchar *extension = g_ascii_strdown(fd->extension ? fd->extension : "", -1);
+	g_autofree gchar *key = g_strdup_printf("%s/%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT, extension, fd->size, static_cast<gint64>(fd->date));
+
+	g_mutex_lock(&select_cache.mutex);
+	if (g_strcmp0(select_cache.tool, tool) != 0)
+		{
+		g_free(select_cache.tool);
+		select_cache.tool = g_strdup(tool);
+		select_cache.decisions.clear();
+		}
+
+	auto it = select_cache.decisions.find(key);
+	if (it != select_cache.decisions.end())
+		{
+		gboolean ret = it->second;
+		g_mutex_unlock(&select_cache.mutex);
+		return ret;
+		}
+	g_mutex_unlock(&select_cache.mutex);
+
+	const gchar *args[] = {fd->path, nullptr};
+	gboolean ret = (external_run(select_pool, tool, args) == 0);
+
+	g_mutex_lock(&select_cache.mutex);
+	if (g_strcmp0(select_cache.tool, tool) == 0)
+		{
+		if (select_cache.decisions.size() >= select_cache_max) select_cache.decisions.clear();
+		select_cache.decisions.emplace(key, ret);
+		}
+	g_mutex_unlock(&select_cache.mutex);
+
+	return ret;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
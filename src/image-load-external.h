@@ -23,9 +23,13 @@
 
 #include <memory>
 
+#include <glib.h>
+
+class FileData;
 struct ImageLoaderBackend;
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_external();
+gboolean image_loader_external_select(FileData *fd);
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
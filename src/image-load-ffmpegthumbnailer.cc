@@ -45,6 +45,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean supports_scaled_decode() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -113,6 +114,11 @@ void ImageLoaderFT::set_size(int width, int height)
 	DEBUG_1("TG: setting size, w=%d, h=%d", width, height);
 }
 
+gboolean ImageLoaderFT::supports_scaled_decode()
+{
+	return TRUE;
+}
+
 gboolean ImageLoaderFT::write(const guchar *, gsize &chunk_size, gsize count, GError **)
 {
 	auto il = static_cast<ImageLoader *>(data);
@@ -21,6 +21,8 @@
 
 #include "image-load-gdk.h"
 
+#include <cstring>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
 #include <glib.h>
@@ -38,6 +40,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean supports_scaled_decode() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gboolean close(GError **error) override;
@@ -91,6 +94,20 @@ void ImageLoaderGdk::set_size(int width, int height)
 	gdk_pixbuf_loader_set_size(loader, width, height);
 }
 
+/* other gdk-pixbuf loaders decode the full image and scale it afterwards */
+gboolean ImageLoaderGdk::supports_scaled_decode()
+{
+	gboolean ret = FALSE;
+	g_auto(GStrv) mime_types = get_format_mime_types();
+
+	for (gint n = 0; mime_types && mime_types[n] && !ret; n++)
+		{
+		if (strstr(mime_types[n], "jpeg")) ret = TRUE;
+		}
+
+	return ret;
+}
+
 gboolean ImageLoaderGdk::write(const guchar *buf, gsize &chunk_size, gsize, GError **error)
 {
 	return gdk_pixbuf_loader_write(loader, buf, chunk_size, error);
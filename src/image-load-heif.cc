@@ -39,6 +39,8 @@ public:
 	~ImageLoaderHEIF() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean supports_scaled_decode() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -48,11 +50,14 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
 	gint page_num;
 	gint page_total;
+	gint requested_width;
+	gint requested_height;
 };
 
 void free_buffer(guchar *, gpointer data)
@@ -60,6 +65,48 @@ void free_buffer(guchar *, gpointer data)
 	heif_image_release(static_cast<const struct heif_image*>(data));
 }
 
+/**
+ * @brief Replaces \a handle by its smallest thumbnail that is at least \a min_width x \a min_height
+ */
+void heif_select_thumbnail(struct heif_image_handle *&handle, gint min_width, gint min_height)
+{
+	gint count = heif_image_handle_get_number_of_thumbnails(handle);
+	if (count < 1) return;
+
+	std::vector<heif_item_id> IDs(count);
+	heif_image_handle_get_list_of_thumbnail_IDs(handle, IDs.data(), count);
+
+	struct heif_image_handle *best = nullptr;
+
+	for (heif_item_id id : IDs)
+		{
+		struct heif_image_handle *thumb;
+
+		if (heif_image_handle_get_thumbnail(handle, id, &thumb).code) continue;
+
+		gint w = heif_image_handle_get_width(thumb);
+		gint h = heif_image_handle_get_height(thumb);
+
+		if (w >= min_width && h >= min_height &&
+		    (!best || w < heif_image_handle_get_width(best)))
+			{
+			if (best) heif_image_handle_release(best);
+			best = thumb;
+			}
+		else
+			{
+			heif_image_handle_release(thumb);
+			}
+		}
+
+	if (best)
+		{
+		DEBUG_1("Using heif thumbnail %d x %d", heif_image_handle_get_width(best), heif_image_handle_get_height(best));
+		heif_image_handle_release(handle);
+		handle = best;
+		}
+}
+
 gboolean ImageLoaderHEIF::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
 {
 	struct heif_context* ctx;
@@ -97,11 +144,22 @@ gboolean ImageLoaderHEIF::write(const guchar *buf, gsize &chunk_size, gsize coun
 		return FALSE;
 		}
 
+	requested_width = heif_image_handle_get_width(handle);
+	requested_height = heif_image_handle_get_height(handle);
+	size_prepared_cb(nullptr, requested_width, requested_height, data);
+
+	/* set_size() may have been called by size_prepared_cb */
+	if (requested_width < heif_image_handle_get_width(handle) || requested_height < heif_image_handle_get_height(handle))
+		{
+		heif_select_thumbnail(handle, requested_width, requested_height);
+		}
+
 	// decode the image and convert colorspace to RGB, saved as 24bit interleaved
 	error_code = heif_decode_image(handle, &img, heif_colorspace_RGB, heif_chroma_interleaved_24bit, nullptr);
 	if (error_code.code)
 		{
 		log_printf("warning: heif reader error: %s\n", error_code.message);
+		heif_image_handle_release(handle);
 		heif_context_free(ctx);
 		return FALSE;
 		}
@@ -123,13 +181,25 @@ gboolean ImageLoaderHEIF::write(const guchar *buf, gsize &chunk_size, gsize coun
 	return TRUE;
 }
 
-void ImageLoaderHEIF::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, AreaPreparedCb, gpointer data)
+void ImageLoaderHEIF::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 	page_num = 0;
 }
 
+void ImageLoaderHEIF::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+gboolean ImageLoaderHEIF::supports_scaled_decode()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderHEIF::get_pixbuf()
 {
 	return pixbuf;
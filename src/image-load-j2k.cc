@@ -30,6 +30,7 @@
 
 #include "debug.h"
 #include "image-load.h"
+#include "image-tile-source.h"
 #include "intl.h"
 #include "misc.h"
 
@@ -241,6 +242,151 @@ ImageLoaderJ2K::~ImageLoaderJ2K()
 	if (pixbuf) g_object_unref(pixbuf);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * tile source
+ *
+ * A region is decoded with opj_set_decode_area(), reduced levels come
+ * from the resolution levels of the codestream.
+ *-------------------------------------------------------------------
+ */
+
+struct ImageTileSourceJ2K : public ImageTileSourceBackend
+{
+public:
+	~ImageTileSourceJ2K() override;
+
+	gboolean open(const gchar *path, gint page_num) override;
+	void get_size(gint &width, gint &height) override;
+	gboolean read(gint x, gint y, gint width, gint height, gint reduce, GdkPixbuf *dest) override;
+
+private:
+	gboolean read_header(opj_stream_t **stream, opj_codec_t **codec, opj_image_t **image);
+
+	gchar *path = nullptr;
+	OPJ_UINT32 x0 = 0;	/**< origin of the image on the reference grid */
+	OPJ_UINT32 y0 = 0;
+	gint width = 0;
+	gint height = 0;
+	OPJ_UINT32 resolutions = 1;
+};
+
+ImageTileSourceJ2K::~ImageTileSourceJ2K()
+{
+	g_free(path);
+}
+
+gboolean ImageTileSourceJ2K::read_header(opj_stream_t **stream, opj_codec_t **codec, opj_image_t **image)
+{
+	opj_dparameters_t parameters;
+
+	*stream = opj_stream_create_default_file_stream(path, OPJ_TRUE);
+	if (!*stream) return FALSE;
+
+	opj_set_default_decoder_parameters(&parameters);
+
+	*codec = opj_create_decompress(OPJ_CODEC_JP2);
+	if (!*codec || opj_setup_decoder(*codec, &parameters) != OPJ_TRUE) return FALSE;
+
+	opj_codec_set_threads(*codec, get_cpu_cores());
+
+	return opj_read_header(*stream, *codec, image) == OPJ_TRUE;
+}
+
+gboolean ImageTileSourceJ2K::open(const gchar *path, gint)
+{
+	g_autoptr(opj_stream_t) stream = nullptr;
+	g_autoptr(opj_codec_t) codec = nullptr;
+	g_autoptr(opj_image_t) image = nullptr;
+
+	this->path = g_strdup(path);
+
+	if (!read_header(&stream, &codec, &image)) return FALSE;
+
+	/* as the loader, rgb only */
+	if (image->numcomps != 3) return FALSE;
+	for (OPJ_UINT32 i = 0; i < image->numcomps; i++)
+		{
+		if (image->comps[i].dx != 1 || image->comps[i].dy != 1) return FALSE;
+		}
+
+	x0 = image->x0;
+	y0 = image->y0;
+	width = image->x1 - image->x0;
+	height = image->y1 - image->y0;
+
+	opj_codestream_info_v2_t *info = opj_get_cstr_info(codec);
+	if (info && info->m_default_tile_info.tccp_info)
+		{
+		resolutions = info->m_default_tile_info.tccp_info[0].numresolutions;
+		}
+	opj_destroy_cstr_info(&info);
+
+	DEBUG_1("J2K tile source: %d x %d, %u resolutions", width, height, resolutions);
+
+	return TRUE;
+}
+
+void ImageTileSourceJ2K::get_size(gint &width, gint &height)
+{
+	width = this->width;
+	height = this->height;
+}
+
+gboolean ImageTileSourceJ2K::read(gint x, gint y, gint width, gint height, gint reduce, GdkPixbuf *dest)
+{
+	g_autoptr(opj_stream_t) stream = nullptr;
+	g_autoptr(opj_codec_t) codec = nullptr;
+	g_autoptr(opj_image_t) image = nullptr;
+	OPJ_UINT32 factor = 0;
+
+	while ((2 << factor) <= reduce && factor + 1 < resolutions) factor++;
+
+	if (!read_header(&stream, &codec, &image)) return FALSE;
+
+	if (opj_set_decoded_resolution_factor(codec, factor) != OPJ_TRUE ||
+	    opj_set_decode_area(codec, image, x0 + x, y0 + y, x0 + x + width, y0 + y + height) != OPJ_TRUE ||
+	    opj_decode(codec, stream, image) != OPJ_TRUE ||
+	    opj_end_decompress(codec, stream) != OPJ_TRUE)
+		{
+		return FALSE;
+		}
+
+	const gint w = image->comps[0].w;
+	const gint h = image->comps[0].h;
+
+	if (w < 1 || h < 1) return FALSE;
+
+	GdkPixbuf *region = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, w, h);
+	const gint rowstride = gdk_pixbuf_get_rowstride(region);
+	guchar *pixels = gdk_pixbuf_get_pixels(region);
+
+	for (gint b = 0; b < 3; b++)
+		{
+		const opj_image_comp_t &comp = image->comps[b];
+		const gint shift = (comp.prec > 8) ? comp.prec - 8 : 0;
+		const gint offset = comp.sgnd ? 1 << (comp.prec - 1) : 0;
+
+		for (gint row = 0; row < h; row++)
+			{
+			const OPJ_INT32 *src = comp.data + (static_cast<gsize>(row) * w);
+			guchar *dst = pixels + (row * rowstride) + b;
+
+			for (gint col = 0; col < w; col++)
+				{
+				*dst = CLAMP((src[col] + offset) >> shift, 0, 255);
+				dst += 3;
+				}
+			}
+		}
+
+	image_tile_source_draw(region, dest, 0, 0,
+			       static_cast<gdouble>(1 << factor) / reduce, static_cast<gdouble>(1 << factor) / reduce);
+	g_object_unref(region);
+
+	return TRUE;
+}
+
 } // namespace
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_j2k()
@@ -248,4 +394,9 @@ std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_j2k()
 	return std::make_unique<ImageLoaderJ2K>();
 }
 
+std::unique_ptr<ImageTileSourceBackend> get_image_tile_source_backend_j2k()
+{
+	return std::make_unique<ImageTileSourceJ2K>();
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -24,8 +24,10 @@
 #include <memory>
 
 struct ImageLoaderBackend;
+struct ImageTileSourceBackend;
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_j2k();
+std::unique_ptr<ImageTileSourceBackend> get_image_tile_source_backend_j2k();
 
 #endif /* IMAGE_LOAD_J2K_H */
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -31,6 +31,7 @@
 
 #include <csetjmp>
 #include <cstdio> // for FILE and size_t in jpeglib.h
+#include <cstring>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
@@ -38,8 +39,11 @@
 #include <jerror.h>
 #include <jpeglib.h>
 
+#include <config.h>
+
 #include "debug.h"
 #include "image-load.h"
+#include "image-tile-source.h"
 #include "intl.h"
 #include "jpeg-parser.h"
 #include "typedefs.h"
@@ -425,6 +429,11 @@ void ImageLoaderJpeg::set_size(int width, int height)
 	requested_height = height;
 }
 
+gboolean ImageLoaderJpeg::supports_scaled_decode()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderJpeg::get_pixbuf()
 {
 	return pixbuf;
@@ -456,4 +465,161 @@ std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_jpeg()
 	return std::make_unique<ImageLoaderJpeg>();
 }
 
+#if HAVE_JPEG_SKIP_SCANLINES
+/*
+ *-------------------------------------------------------------------
+ * tile source
+ *
+ * JPEG has no random access, the rows above a region are skipped by
+ * jpeg_skip_scanlines(), which still has to entropy decode them. The
+ * columns are cropped with jpeg_crop_scanline(), and reduced levels down
+ * to 1/8 come from the DCT scaling.
+ *-------------------------------------------------------------------
+ */
+
+namespace
+{
+
+struct ImageTileSourceJpeg : public ImageTileSourceBackend
+{
+public:
+	~ImageTileSourceJpeg() override;
+
+	gboolean open(const gchar *path, gint page_num) override;
+	void get_size(gint &width, gint &height) override;
+	gboolean read(gint x, gint y, gint width, gint height, gint reduce, GdkPixbuf *dest) override;
+	gboolean whole_rows() override;
+
+private:
+	GMappedFile *mapped_file = nullptr;
+	gint width = 0;
+	gint height = 0;
+};
+
+ImageTileSourceJpeg::~ImageTileSourceJpeg()
+{
+	if (mapped_file) g_mapped_file_unref(mapped_file);
+}
+
+gboolean ImageTileSourceJpeg::open(const gchar *path, gint)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct error_handler_data jerr;
+	gboolean ret;
+
+	mapped_file = g_mapped_file_new(path, FALSE, nullptr);
+	if (!mapped_file) return FALSE;
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = fatal_error_handler;
+	jerr.pub.output_message = output_message_handler;
+	jerr.error = nullptr;
+
+	if (sigsetjmp(jerr.setjmp_buffer, 0))
+		{
+		jpeg_destroy_decompress(&cinfo);
+		return FALSE;
+		}
+
+	jpeg_create_decompress(&cinfo);
+	set_mem_src(&cinfo, g_mapped_file_get_contents(mapped_file), g_mapped_file_get_length(mapped_file));
+	jpeg_read_header(&cinfo, TRUE);
+
+	width = cinfo.image_width;
+	height = cinfo.image_height;
+
+	/* progressive images need the coefficients of the whole image */
+	ret = !jpeg_has_multiple_scans(&cinfo) &&
+	      (cinfo.jpeg_color_space == JCS_YCbCr || cinfo.jpeg_color_space == JCS_RGB || cinfo.jpeg_color_space == JCS_GRAYSCALE);
+
+	jpeg_destroy_decompress(&cinfo);
+
+	return ret;
+}
+
+void ImageTileSourceJpeg::get_size(gint &width, gint &height)
+{
+	width = this->width;
+	height = this->height;
+}
+
+gboolean ImageTileSourceJpeg::whole_rows()
+{
+	return TRUE;
+}
+
+gboolean ImageTileSourceJpeg::read(gint x, gint y, gint width, gint height, gint reduce, GdkPixbuf *dest)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct error_handler_data jerr;
+	const gint denom = MIN(reduce, 8);
+
+	/* the region in output pixels, as scaled by libjpeg */
+	const gint out_x = x / denom;
+	const gint out_y = y / denom;
+	const gint out_w = MIN((x + width + denom - 1) / denom, (this->width + denom - 1) / denom) - out_x;
+	const gint out_h = MIN((y + height + denom - 1) / denom, (this->height + denom - 1) / denom) - out_y;
+
+	if (out_w < 1 || out_h < 1) return TRUE;
+
+	GdkPixbuf *region = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, out_w, out_h);
+	const gint rowstride = gdk_pixbuf_get_rowstride(region);
+	guchar *pixels = gdk_pixbuf_get_pixels(region);
+
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = fatal_error_handler;
+	jerr.pub.output_message = output_message_handler;
+	jerr.error = nullptr;
+
+	if (sigsetjmp(jerr.setjmp_buffer, 0))
+		{
+		jpeg_destroy_decompress(&cinfo);
+		g_object_unref(region);
+		return FALSE;
+		}
+
+	jpeg_create_decompress(&cinfo);
+	set_mem_src(&cinfo, g_mapped_file_get_contents(mapped_file), g_mapped_file_get_length(mapped_file));
+	jpeg_read_header(&cinfo, TRUE);
+
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = denom;
+	cinfo.out_color_space = JCS_RGB;
+
+	jpeg_start_decompress(&cinfo);
+
+	/* the crop is widened to iMCU boundaries */
+	JDIMENSION crop_x = out_x;
+	JDIMENSION crop_w = out_w;
+	jpeg_crop_scanline(&cinfo, &crop_x, &crop_w);
+
+	if (out_y > 0) jpeg_skip_scanlines(&cinfo, out_y);
+
+	JSAMPARRAY line = (*cinfo.mem->alloc_sarray)(reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE,
+						     crop_w * cinfo.output_components, 1);
+
+	for (gint row = 0; row < out_h; row++)
+		{
+		jpeg_read_scanlines(&cinfo, line, 1);
+		memcpy(pixels + (row * rowstride), line[0] + ((out_x - crop_x) * 3), out_w * 3);
+		}
+
+	jpeg_abort_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+
+	image_tile_source_draw(region, dest, 0, 0,
+			       static_cast<gdouble>(denom) / reduce, static_cast<gdouble>(denom) / reduce);
+	g_object_unref(region);
+
+	return TRUE;
+}
+
+} // namespace
+
+std::unique_ptr<ImageTileSourceBackend> get_image_tile_source_backend_jpeg()
+{
+	return std::make_unique<ImageTileSourceJpeg>();
+}
+#endif
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
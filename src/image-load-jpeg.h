@@ -29,6 +29,8 @@
 
 #include "image-load.h"
 
+struct ImageTileSourceBackend;
+
 struct ImageLoaderJpeg : public ImageLoaderBackend
 {
 public:
@@ -36,6 +38,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean supports_scaled_decode() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	void abort() override;
@@ -58,6 +61,7 @@ private:
 };
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_jpeg();
+std::unique_ptr<ImageTileSourceBackend> get_image_tile_source_backend_jpeg();
 
 #endif /* IMAGE_LOAD_JPEG_H */
 
@@ -54,6 +54,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <memory>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -62,10 +63,19 @@
 #include <jxl/codestream_header.h>
 #include <jxl/decode.h> //TODO Use decode_cxx.h?
 #include <jxl/types.h>
+#if __has_include(<jxl/version.h>)
+#include <jxl/version.h>
+#endif
 
 #include "debug.h"
 #include "image-load.h"
 
+#ifdef JPEGXL_COMPUTE_NUMERIC_VERSION
+#if JPEGXL_NUMERIC_VERSION >= JPEGXL_COMPUTE_NUMERIC_VERSION(0, 7, 0)
+#define HAVE_JXL_PROGRESSIVE_DC 1
+#endif
+#endif
+
 namespace
 {
 
@@ -75,6 +85,8 @@ public:
 	~ImageLoaderJPEGXL() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean supports_scaled_decode() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -82,17 +94,28 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
+	size_t requested_width;
+	size_t requested_height;
 };
 
+/* the DC image has 1/8 of the resolution in each direction */
+constexpr size_t jxl_dc_scale = 8;
+
 void free_buffer(guchar *pixels, gpointer)
 {
 	g_free(pixels);
 }
 
-uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, size_t &ysize, size_t &stride)
+/**
+ * @param use_dc Called with the image size, returns true if the DC (1/8 resolution)
+ * pass is enough; the returned buffer then holds it upsampled to the full size
+ */
+uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, size_t &ysize, size_t &stride,
+			   const std::function<bool(size_t, size_t)> &use_dc, bool &dc_only)
 {
 	std::unique_ptr<JxlDecoder, decltype(&JxlDecoderDestroy)> dec{JxlDecoderCreate(nullptr), JxlDecoderDestroy};
 	if (!dec)
@@ -100,11 +123,20 @@ uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, s
 		log_printf("JxlDecoderCreate failed\n");
 		return nullptr;
 		}
-	if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE))
+	int events = JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE;
+#if HAVE_JXL_PROGRESSIVE_DC
+	events |= JXL_DEC_FRAME_PROGRESSION;
+#endif
+	if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), events))
 		{
 		log_printf("JxlDecoderSubscribeEvents failed\n");
 		return nullptr;
 		}
+#if HAVE_JXL_PROGRESSIVE_DC
+	JxlDecoderSetProgressiveDetail(dec.get(), kDC);
+#endif
+
+	dc_only = false;
 
 	/* Avoid compiler warning - used uninitialized */
 	/* This file will be replaced by libjxl at some time */
@@ -137,6 +169,11 @@ uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, s
 				xsize = info.xsize;
 				ysize = info.ysize;
 				stride = info.xsize * 4;
+#if HAVE_JXL_PROGRESSIVE_DC
+				dc_only = use_dc(xsize, ysize);
+#else
+				use_dc(xsize, ysize);
+#endif
 				break;
 			case JXL_DEC_NEED_IMAGE_OUT_BUFFER:
 				{
@@ -160,8 +197,22 @@ uint8_t *JxlMemoryToPixels(const uint8_t *next_in, size_t size, size_t &xsize, s
 					}
 				}
 				break;
+#if HAVE_JXL_PROGRESSIVE_DC
+			case JXL_DEC_FRAME_PROGRESSION:
+				if (dc_only)
+					{
+					if (JXL_DEC_SUCCESS != JxlDecoderFlushImage(dec.get()))
+						{
+						log_printf("JxlDecoderFlushImage failed\n");
+						return nullptr;
+						}
+					return pixels.release();
+					}
+				break;
+#endif
 			case JXL_DEC_FULL_IMAGE:
 				// This means the decoder has decoded all pixels into the buffer.
+				dc_only = false;
 				return pixels.release();
 			case JXL_DEC_SUCCESS:
 				log_printf("Decoding finished before receiving pixel data\n");
@@ -182,13 +233,36 @@ gboolean ImageLoaderJPEGXL::write(const guchar *buf, gsize &chunk_size, gsize co
 	size_t ysize;
 	size_t stride;
 	uint8_t *pixels = nullptr;
+	bool dc_only = false;
+
+	auto use_dc = [this](size_t width, size_t height)
+		{
+		requested_width = width;
+		requested_height = height;
+		size_prepared_cb(nullptr, width, height, data);
+
+		/* set_size() may have been called by size_prepared_cb */
+		return requested_width * jxl_dc_scale <= width && requested_height * jxl_dc_scale <= height;
+		};
 
-	pixels = JxlMemoryToPixels(buf, count, xsize, ysize, stride);
+	pixels = JxlMemoryToPixels(buf, count, xsize, ysize, stride, use_dc, dc_only);
 
 	if (pixels)
 		{
 		pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, TRUE, 8, xsize, ysize, stride, free_buffer, nullptr);
 
+		if (dc_only)
+			{
+			/* the upsampled DC image has no more detail than 1/8 of its size */
+			DEBUG_1("Using jxl DC image");
+			GdkPixbuf *scaled = gdk_pixbuf_scale_simple(pixbuf, (xsize + jxl_dc_scale - 1) / jxl_dc_scale,
+								    (ysize + jxl_dc_scale - 1) / jxl_dc_scale, GDK_INTERP_BILINEAR);
+			g_object_unref(pixbuf);
+			pixbuf = scaled;
+			xsize = gdk_pixbuf_get_width(pixbuf);
+			ysize = gdk_pixbuf_get_height(pixbuf);
+			}
+
 		area_updated_cb(nullptr, 0, 0, xsize, ysize, data);
 
 		chunk_size = count;
@@ -198,12 +272,28 @@ gboolean ImageLoaderJPEGXL::write(const guchar *buf, gsize &chunk_size, gsize co
 	return ret;
 }
 
-void ImageLoaderJPEGXL::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, AreaPreparedCb, gpointer data)
+void ImageLoaderJPEGXL::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 }
 
+void ImageLoaderJPEGXL::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+gboolean ImageLoaderJPEGXL::supports_scaled_decode()
+{
+#if HAVE_JXL_PROGRESSIVE_DC
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
 GdkPixbuf *ImageLoaderJPEGXL::get_pixbuf()
 {
 	return pixbuf;
@@ -50,9 +50,11 @@ struct UnmapData
 };
 
 static GList *libraw_unmap_list = nullptr;
+static GMutex libraw_unmap_mutex; /* previews are taken in the image loader threads */
 
 void libraw_free_preview(const guchar *buf)
 {
+	g_mutex_lock(&libraw_unmap_mutex);
 	GList *work = libraw_unmap_list;
 
 	while (work)
@@ -64,10 +66,12 @@ void libraw_free_preview(const guchar *buf)
 			delete ud->lr;
 			g_free(ud);
 			libraw_unmap_list = g_list_delete_link(libraw_unmap_list, work);
+			g_mutex_unlock(&libraw_unmap_mutex);
 			return;
 			}
 		work = work->next;
 		}
+	g_mutex_unlock(&libraw_unmap_mutex);
 	g_assert_not_reached();
 }
 
@@ -96,7 +100,9 @@ guchar *libraw_get_preview(const gchar *path, gsize &data_len)
 			ud->map_len = map_len;
 			ud->lr = lr.release();
 
+			g_mutex_lock(&libraw_unmap_mutex);
 			libraw_unmap_list = g_list_prepend(libraw_unmap_list, ud);
+			g_mutex_unlock(&libraw_unmap_mutex);
 
 			data_len = ud->lr->imgdata.thumbnail.tlength;
 			return ud->ptr;
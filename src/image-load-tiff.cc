@@ -27,9 +27,14 @@
 
 #include "image-load-tiff.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib-object.h>
@@ -39,6 +44,7 @@
 
 #include "debug.h"
 #include "image-load.h"
+#include "image-tile-source.h"
 
 namespace
 {
@@ -50,6 +56,7 @@ public:
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) override;
 	void set_size(int width, int height) override;
+	gboolean supports_scaled_decode() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	void abort() override;
@@ -74,6 +81,49 @@ private:
 	gint page_total;
 };
 
+struct TiffLevel
+{
+	gint dir;		/**< directory number, -1 for a SubIFD */
+	toff_t offset;		/**< SubIFD offset */
+	guint32 width;
+	guint32 height;
+	gboolean tiled;
+	guint32 block_width;	/**< tile, or strip (the image width) */
+	guint32 block_height;
+};
+
+struct TiffBlock
+{
+	gsize level;
+	guint32 x;
+	guint32 y;
+	GdkPixbuf *pixbuf;
+};
+
+struct ImageTileSourceTiff : public ImageTileSourceBackend
+{
+public:
+	~ImageTileSourceTiff() override;
+
+	gboolean open(const gchar *path, gint page_num) override;
+	void get_size(gint &width, gint &height) override;
+	gboolean read(gint x, gint y, gint width, gint height, gint reduce, GdkPixbuf *dest) override;
+	gboolean whole_rows() override;
+
+private:
+	void add_level(gint dir, toff_t offset);
+	gboolean set_level(gsize level);
+	GdkPixbuf *get_block(gsize level, guint32 x, guint32 y);
+
+	TIFF *tiff = nullptr;
+	std::vector<TiffLevel> levels;	/**< the page first, then its reduced images, largest first */
+	gsize current = G_MAXSIZE;	/**< level of the current directory */
+
+	std::deque<TiffBlock> blocks;	/**< recently decoded, most recent first */
+	gsize blocks_size = 0;
+	std::vector<guint32> raster;
+};
+
 struct GqTiffContext
 {
 	const guchar *buffer;
@@ -156,6 +206,82 @@ void tiff_load_unmap_file (thandle_t, tdata_t, toff_t)
 {
 }
 
+/**
+ * @brief Calls \a func for each reduced resolution image of page \a page_num,
+ * with the image as the current directory
+ * @param func Gets the SubIFD offset, or the directory number (-1 for a SubIFD)
+ *
+ * Reduced images are looked for in the SubIFDs of the page and in the
+ * directories following it that are marked as reduced images.
+ */
+void tiff_foreach_reduced_directory(TIFF *tiff, gint page_num, const std::function<void(toff_t, gint)> &func)
+{
+	auto is_reduced = [tiff]()
+		{
+		guint32 subfile_type = 0;
+
+		return TIFFGetField(tiff, TIFFTAG_SUBFILETYPE, &subfile_type) && (subfile_type & FILETYPE_REDUCEDIMAGE);
+		};
+
+	guint16 subifd_count = 0;
+	toff_t *subifd_offsets = nullptr;
+	std::vector<toff_t> offsets;
+
+	if (!TIFFSetDirectory(tiff, page_num)) return;
+
+	if (TIFFGetField(tiff, TIFFTAG_SUBIFD, &subifd_count, &subifd_offsets))
+		{
+		/* the array belongs to the current directory */
+		offsets.assign(subifd_offsets, subifd_offsets + subifd_count);
+		}
+
+	for (toff_t offset : offsets)
+		{
+		if (TIFFSetSubDirectory(tiff, offset) && is_reduced()) func(offset, -1);
+		}
+
+	for (gint dir = page_num + 1; TIFFSetDirectory(tiff, dir) && is_reduced(); dir++)
+		{
+		func(0, dir);
+		}
+}
+
+/**
+ * @brief Makes the smallest reduced resolution image of page \a page_num
+ * that is at least \a min_width x \a min_height the current directory
+ * @returns FALSE if there is none, page \a page_num is current again then
+ */
+gboolean tiff_set_reduced_directory(TIFF *tiff, gint page_num, guint min_width, guint min_height)
+{
+	guint32 best_width = 0;
+	toff_t best_offset = 0;
+	gint best_dir = -1;
+	gchar emsg[1024];
+
+	tiff_foreach_reduced_directory(tiff, page_num, [&](toff_t offset, gint dir)
+		{
+		guint32 w;
+		guint32 h;
+
+		if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &w) || !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &h)) return;
+		if (w < min_width || h < min_height) return;
+		if (best_width && w >= best_width) return;
+		if (!TIFFRGBAImageOK(tiff, emsg)) return;
+
+		best_width = w;
+		best_offset = offset;
+		best_dir = dir;
+		});
+
+	if (best_width && (best_dir >= 0 ? TIFFSetDirectory(tiff, best_dir) : TIFFSetSubDirectory(tiff, best_offset)))
+		{
+		return TRUE;
+		}
+
+	TIFFSetDirectory(tiff, page_num);
+	return FALSE;
+}
+
 gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
 {
 	TIFF *tiff;
@@ -215,6 +341,19 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 		return FALSE;
 		}
 
+	requested_width = width;
+	requested_height = height;
+	size_prepared_cb(nullptr, requested_width, requested_height, data);
+
+	/* set_size() may have been called by size_prepared_cb */
+	if ((requested_width < static_cast<guint>(width) || requested_height < static_cast<guint>(height)) &&
+	    tiff_set_reduced_directory(tiff, page_num, requested_width, requested_height))
+		{
+		TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
+		TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
+		DEBUG_1("Using reduced resolution TIFF image %d x %d", width, height);
+		}
+
 	rowstride = width * 4;
 	if (rowstride / 4 != width)
 		{ /* overflow */
@@ -231,10 +370,6 @@ gboolean ImageLoaderTiff::write(const guchar *buf, gsize &chunk_size, gsize coun
 		return FALSE;
 		}
 
-	requested_width = width;
-	requested_height = height;
-	size_prepared_cb(nullptr, requested_width, requested_height, data);
-
 	pixels = static_cast<guchar *>(g_try_malloc (bytes));
 
 	if (!pixels)
@@ -359,6 +494,11 @@ void ImageLoaderTiff::set_size(int width, int height)
 	requested_height = height;
 }
 
+gboolean ImageLoaderTiff::supports_scaled_decode()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderTiff::get_pixbuf()
 {
 	return pixbuf;
@@ -395,6 +535,219 @@ gint ImageLoaderTiff::get_page_total()
 	return page_total;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * tile source
+ *-------------------------------------------------------------------
+ */
+
+/** Larger tiles or strips are not decoded by region */
+constexpr guint64 TIFF_BLOCK_MAX_PIXELS = 16 * 1024 * 1024;
+
+/** Decoded tiles or strips kept for the neighbouring requests */
+constexpr gsize TIFF_BLOCK_CACHE_SIZE = 64 * 1024 * 1024;
+
+ImageTileSourceTiff::~ImageTileSourceTiff()
+{
+	for (TiffBlock &block : blocks) g_object_unref(block.pixbuf);
+	if (tiff) TIFFClose(tiff);
+}
+
+/* the current directory, if it can be decoded by tile or strip */
+void ImageTileSourceTiff::add_level(gint dir, toff_t offset)
+{
+	TiffLevel level{dir, offset, 0, 0, FALSE, 0, 0};
+	gchar emsg[1024];
+
+	if (!TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &level.width) ||
+	    !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &level.height) ||
+	    !level.width || !level.height ||
+	    !TIFFRGBAImageOK(tiff, emsg))
+		{
+		return;
+		}
+
+	level.tiled = TIFFIsTiled(tiff);
+	if (level.tiled)
+		{
+		TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &level.block_width);
+		TIFFGetField(tiff, TIFFTAG_TILELENGTH, &level.block_height);
+		}
+	else
+		{
+		level.block_width = level.width;
+		TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &level.block_height);
+		level.block_height = MIN(level.block_height, level.height);
+		}
+
+	if (!level.block_width || !level.block_height ||
+	    static_cast<guint64>(level.block_width) * level.block_height > TIFF_BLOCK_MAX_PIXELS)
+		{
+		DEBUG_1("TIFF blocks of %u x %u are too large to decode by region", level.block_width, level.block_height);
+		return;
+		}
+
+	if (!levels.empty() && level.width >= levels[0].width) return;
+
+	levels.push_back(level);
+}
+
+gboolean ImageTileSourceTiff::open(const gchar *path, gint page_num)
+{
+	TIFFSetWarningHandler(nullptr);
+
+	tiff = TIFFOpen(path, "r");
+	if (!tiff) return FALSE;
+
+	if (!TIFFSetDirectory(tiff, page_num)) return FALSE;
+
+	add_level(page_num, 0);
+	if (levels.empty()) return FALSE;
+
+	tiff_foreach_reduced_directory(tiff, page_num, [this](toff_t offset, gint dir)
+		{
+		add_level(dir, offset);
+		});
+
+	std::sort(levels.begin() + 1, levels.end(), [](const TiffLevel &a, const TiffLevel &b)
+		{
+		return a.width > b.width;
+		});
+
+	DEBUG_1("TIFF tile source: %u x %u, %zu reduced images", levels[0].width, levels[0].height, levels.size() - 1);
+
+	return TRUE;
+}
+
+void ImageTileSourceTiff::get_size(gint &width, gint &height)
+{
+	width = levels[0].width;
+	height = levels[0].height;
+}
+
+gboolean ImageTileSourceTiff::whole_rows()
+{
+	/* strips span the image */
+	return !levels[0].tiled;
+}
+
+gboolean ImageTileSourceTiff::set_level(gsize level)
+{
+	if (level == current) return TRUE;
+
+	const TiffLevel &l = levels[level];
+
+	current = G_MAXSIZE;
+	if (!(l.dir >= 0 ? TIFFSetDirectory(tiff, l.dir) : TIFFSetSubDirectory(tiff, l.offset))) return FALSE;
+
+	current = level;
+	return TRUE;
+}
+
+/* the tile or strip at x, y of the level, cached */
+GdkPixbuf *ImageTileSourceTiff::get_block(gsize level, guint32 x, guint32 y)
+{
+	for (auto it = blocks.begin(); it != blocks.end(); ++it)
+		{
+		if (it->level == level && it->x == x && it->y == y)
+			{
+			TiffBlock block = *it;
+
+			blocks.erase(it);
+			blocks.push_front(block);
+			return block.pixbuf;
+			}
+		}
+
+	if (!set_level(level)) return nullptr;
+
+	const TiffLevel &l = levels[level];
+	const guint32 w = MIN(l.block_width, l.width - x);
+	const guint32 h = MIN(l.block_height, l.height - y);
+
+	raster.resize(static_cast<gsize>(l.block_width) * l.block_height);
+
+	if (!(l.tiled ? TIFFReadRGBATile(tiff, x, y, raster.data()) : TIFFReadRGBAStrip(tiff, y, raster.data())))
+		{
+		return nullptr;
+		}
+
+	/* the origin is the lower left corner, of the whole tile but only of the rows a strip has */
+	const guint32 rows = l.tiled ? l.block_height : h;
+	GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, w, h);
+	const gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+
+	for (guint32 row = 0; row < h; row++)
+		{
+		const guint32 *src = raster.data() + (static_cast<gsize>(rows - 1 - row) * l.block_width);
+		guchar *dst = pixels + (static_cast<gsize>(row) * rowstride);
+
+		for (guint32 col = 0; col < w; col++)
+			{
+			*dst++ = TIFFGetR(src[col]);
+			*dst++ = TIFFGetG(src[col]);
+			*dst++ = TIFFGetB(src[col]);
+			}
+		}
+
+	blocks.push_front({level, x, y, pixbuf});
+	blocks_size += static_cast<gsize>(rowstride) * h;
+
+	while (blocks.size() > 1 && blocks_size > TIFF_BLOCK_CACHE_SIZE)
+		{
+		TiffBlock &old = blocks.back();
+
+		blocks_size -= static_cast<gsize>(gdk_pixbuf_get_rowstride(old.pixbuf)) * gdk_pixbuf_get_height(old.pixbuf);
+		g_object_unref(old.pixbuf);
+		blocks.pop_back();
+		}
+
+	return pixbuf;
+}
+
+gboolean ImageTileSourceTiff::read(gint x, gint y, gint width, gint height, gint reduce, GdkPixbuf *dest)
+{
+	/* the smallest image that still has a pixel for each one of dest */
+	gsize level = 0;
+	for (gsize i = 1; i < levels.size(); i++)
+		{
+		if (static_cast<guint64>(levels[i].width) * reduce >= levels[0].width &&
+		    static_cast<guint64>(levels[i].height) * reduce >= levels[0].height)
+			{
+			level = i;
+			}
+		}
+
+	const TiffLevel &l = levels[level];
+
+	/* level pixels for an image pixel, and dest pixels for a level pixel */
+	const gdouble level_x = static_cast<gdouble>(l.width) / levels[0].width;
+	const gdouble level_y = static_cast<gdouble>(l.height) / levels[0].height;
+	const gdouble scale_x = 1.0 / (level_x * reduce);
+	const gdouble scale_y = 1.0 / (level_y * reduce);
+
+	const auto x1 = static_cast<guint32>(floor(x * level_x));
+	const auto y1 = static_cast<guint32>(floor(y * level_y));
+	const guint32 x2 = MIN(l.width, static_cast<guint32>(ceil((x + width) * level_x)));
+	const guint32 y2 = MIN(l.height, static_cast<guint32>(ceil((y + height) * level_y)));
+
+	for (guint32 by = (y1 / l.block_height) * l.block_height; by < y2; by += l.block_height)
+		{
+		for (guint32 bx = (x1 / l.block_width) * l.block_width; bx < x2; bx += l.block_width)
+			{
+			GdkPixbuf *block = get_block(level, bx, by);
+			if (!block) return FALSE;
+
+			image_tile_source_draw(block, dest,
+					       (bx - (x * level_x)) * scale_x, (by - (y * level_y)) * scale_y,
+					       scale_x, scale_y);
+			}
+		}
+
+	return TRUE;
+}
+
 } // namespace
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_tiff()
@@ -402,4 +755,9 @@ std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_tiff()
 	return std::make_unique<ImageLoaderTiff>();
 }
 
+std::unique_ptr<ImageTileSourceBackend> get_image_tile_source_backend_tiff()
+{
+	return std::make_unique<ImageTileSourceTiff>();
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
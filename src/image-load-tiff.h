@@ -25,8 +25,10 @@
 #include <memory>
 
 struct ImageLoaderBackend;
+struct ImageTileSourceBackend;
 
 std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_tiff();
+std::unique_ptr<ImageTileSourceBackend> get_image_tile_source_backend_tiff();
 
 #endif /* IMAGE_LOAD_TIFF_H */
 
@@ -37,6 +37,8 @@ public:
 	~ImageLoaderWEBP() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
+	gboolean supports_scaled_decode() override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -44,9 +46,12 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
+	gint requested_width;
+	gint requested_height;
 };
 
 void free_buffer(guchar *pixels, gpointer)
@@ -56,56 +61,87 @@ void free_buffer(guchar *pixels, gpointer)
 
 gboolean ImageLoaderWEBP::write(const guchar *buf, gsize &chunk_size, gsize count, GError **)
 {
-	guint8* pixels;
+	WebPDecoderConfig config;
 	gint width;
 	gint height;
-	gboolean res_info;
-	WebPBitstreamFeatures features;
-	VP8StatusCode status_code;
 
-	res_info = WebPGetInfo(buf, count, &width, &height);
-	if (!res_info)
+	if (!WebPInitDecoderConfig(&config) ||
+	    WebPGetFeatures(buf, count, &config.input) != VP8_STATUS_OK)
 		{
 		log_printf("warning: webp reader error\n");
 		return FALSE;
 		}
 
-	status_code = WebPGetFeatures(buf, count, &features);
-	if (status_code != VP8_STATUS_OK)
-		{
-		log_printf("warning: webp reader error\n");
-		return FALSE;
-		}
+	requested_width = config.input.width;
+	requested_height = config.input.height;
+	size_prepared_cb(nullptr, requested_width, requested_height, data);
 
-	if (features.has_alpha)
+	/* set_size() may have been called by size_prepared_cb, let the decoder scale */
+	if (requested_width < config.input.width || requested_height < config.input.height)
 		{
-		pixels = WebPDecodeRGBA(buf, count, &width, &height);
+		config.options.use_scaling = 1;
+		config.options.scaled_width = requested_width;
+		config.options.scaled_height = requested_height;
+		width = requested_width;
+		height = requested_height;
 		}
 	else
 		{
-		pixels = WebPDecodeRGB(buf, count, &width, &height);
+		width = config.input.width;
+		height = config.input.height;
 		}
 
-	if (pixels)
-		{
-		pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, features.has_alpha, 8, width, height, width * (features.has_alpha ? 4 : 3), free_buffer, nullptr);
+	const gboolean has_alpha = config.input.has_alpha;
+	const gint rowstride = width * (has_alpha ? 4 : 3);
+	const gsize size = static_cast<gsize>(rowstride) * height;
+	auto *pixels = static_cast<guint8 *>(g_try_malloc(size));
 
-		area_updated_cb(nullptr, 0, 0, width, height, data);
+	if (!pixels)
+		{
+		log_printf("warning: webp reader error\n");
+		return FALSE;
+		}
 
-		chunk_size = count;
+	config.output.colorspace = has_alpha ? MODE_RGBA : MODE_RGB;
+	config.output.is_external_memory = 1;
+	config.output.u.RGBA.rgba = pixels;
+	config.output.u.RGBA.stride = rowstride;
+	config.output.u.RGBA.size = size;
 
-		return TRUE;
+	if (WebPDecode(buf, count, &config) != VP8_STATUS_OK)
+		{
+		log_printf("warning: webp reader error\n");
+		g_free(pixels);
+		return FALSE;
 		}
 
-	return FALSE;
+	pixbuf = gdk_pixbuf_new_from_data(pixels, GDK_COLORSPACE_RGB, has_alpha, 8, width, height, rowstride, free_buffer, nullptr);
+
+	area_updated_cb(nullptr, 0, 0, width, height, data);
+
+	chunk_size = count;
+
+	return TRUE;
 }
 
-void ImageLoaderWEBP::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, AreaPreparedCb, gpointer data)
+void ImageLoaderWEBP::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 }
 
+void ImageLoaderWEBP::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
+}
+
+gboolean ImageLoaderWEBP::supports_scaled_decode()
+{
+	return TRUE;
+}
+
 GdkPixbuf *ImageLoaderWEBP::get_pixbuf()
 {
 	return pixbuf;
@@ -23,7 +23,9 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <cstring>
+#include <deque>
 
 #include <config.h>
 
@@ -67,6 +69,7 @@
 #endif
 #include "image-load-webp.h"
 #include "image-load-zxscr.h"
+#include "image-tile-source.h"
 #include "jpeg-parser.h"
 #include "misc.h"
 #include "options.h"
@@ -99,6 +102,7 @@ static void image_loader_class_init_wrapper(void *data, void *user_data);
 static void image_loader_class_init(ImageLoaderClass *loader_class);
 static void image_loader_finalize(GObject *object);
 static void image_loader_stop(ImageLoader *il);
+static gboolean image_loader_scheduler_cancel(ImageLoader *il);
 
 GType image_loader_get_type()
 {
@@ -139,6 +143,10 @@ static void image_loader_init(GTypeInstance *instance, gpointer)
 	il->mapped_file = nullptr;
 	il->preview = IMAGE_LOADER_PREVIEW_NONE;
 
+	il->tile_source_path = nullptr;
+	il->tile_source_page_num = 0;
+	il->tile_source = nullptr;
+
 	il->requested_width = 0;
 	il->requested_height = 0;
 	il->actual_width = 0;
@@ -147,6 +155,12 @@ static void image_loader_init(GTypeInstance *instance, gpointer)
 
 	il->can_destroy = TRUE;
 
+	il->job_class = IMAGE_LOADER_JOB_VIEWER;
+	il->job_class_set = FALSE;
+	il->job_queued = FALSE;
+	il->job_running = FALSE;
+	il->job_begun = FALSE;
+
 	il->data_mutex = g_new(GMutex, 1);
 	g_mutex_init(il->data_mutex);
 	il->can_destroy_cond = g_new(GCond, 1);
@@ -257,6 +271,8 @@ static void image_loader_finalize(GObject *object)
 		}
 
 	if (il->pixbuf) g_object_unref(il->pixbuf);
+	image_tile_source_unref(il->tile_source);
+	g_free(il->tile_source_path);
 
 	if (il->error) g_error_free(il->error);
 
@@ -559,9 +575,6 @@ static void image_loader_size_cb(gpointer,
 				 gint width, gint height, gpointer data)
 {
 	auto il = static_cast<ImageLoader *>(data);
-	gchar **mime_types;
-	gboolean scale = FALSE;
-	gint n;
 
 	g_mutex_lock(il->data_mutex);
 	il->actual_width = width;
@@ -574,20 +587,7 @@ static void image_loader_size_cb(gpointer,
 		}
 	g_mutex_unlock(il->data_mutex);
 
-#if HAVE_FFMPEGTHUMBNAILER
-	if (il->fd->format_class == FORMAT_CLASS_VIDEO)
-		scale = TRUE;
-#endif
-	mime_types = il->backend->get_format_mime_types();
-	n = 0;
-	while (mime_types[n] && !scale)
-		{
-		if (strstr(mime_types[n], "jpeg")) scale = TRUE;
-		n++;
-		}
-	g_strfreev(mime_types);
-
-	if (!scale)
+	if (!il->backend->supports_scaled_decode())
 		{
 		image_loader_emit_size(il);
 		return;
@@ -641,25 +641,9 @@ static void image_loader_stop_loader(ImageLoader *il)
 
 static void image_loader_setup_loader(ImageLoader *il)
 {
-	gint external_preview = 1;
-
 	g_mutex_lock(il->data_mutex);
 
-	if (options->external_preview.enable)
-		{
-		gchar *cmd_line;
-		gchar *tilde_filename;
-
-		tilde_filename = expand_tilde(options->external_preview.select);
-
-		cmd_line = g_strdup_printf("\"%s\" \"%s\"" , tilde_filename, il->fd->path);
-
-		external_preview = runcmd(cmd_line);
-		g_free(cmd_line);
-		g_free(tilde_filename);
-		}
-
-	if (external_preview == 0)
+	if (options->external_preview.enable && image_loader_external_select(il->fd))
 		{
 		DEBUG_1("Using custom external loader");
 		il->backend = get_image_loader_backend_external();
@@ -928,10 +912,13 @@ static gboolean image_loader_begin(ImageLoader *il)
 	return TRUE;
 }
 
-/**************************************************************************************/
-/* the following functions are always executed in the main thread */
-
-
+/**
+ * @brief Maps the file, or a usable preview embedded in it
+ *
+ * Runs in the loader thread, so the exif data is read directly and not
+ * through the cache of the main thread. Unsaved metadata changes do not
+ * affect the previews.
+ */
 static gboolean image_loader_setup_source(ImageLoader *il)
 {
 	if (!il || il->backend || il->mapped_file) return FALSE;
@@ -940,7 +927,7 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 
 	if (il->fd)
 		{
-		ExifData *exif = exif_read_fd(il->fd);
+		ExifData *exif = exif_read(il->fd->path, nullptr, nullptr);
 
 		if (options->thumbnails.use_exif)
 			{
@@ -985,7 +972,7 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 			{
 			DEBUG_1("Usable reduced size (preview) image loaded from file %s", il->fd->path);
 			}
-		exif_free_fd(il->fd, exif);
+		exif_free(exif);
 		}
 
 	if (!il->mapped_file)
@@ -1004,6 +991,29 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 	return TRUE;
 }
 
+/**
+ * @brief Opens the image as tiles instead, if it is too large to decode whole
+ * @returns TRUE if the loader is done, with no pixbuf
+ */
+static gboolean image_loader_probe_tile_source(ImageLoader *il)
+{
+	if (!il->tile_source_path) return FALSE;
+
+	ImageTileSource *ts = image_tile_source_new(il->tile_source_path, il->tile_source_page_num);
+	if (!ts) return FALSE;
+
+	g_mutex_lock(il->data_mutex);
+	il->tile_source = ts;
+	il->done = TRUE;
+	g_mutex_unlock(il->data_mutex);
+
+	return TRUE;
+}
+
+/**************************************************************************************/
+/* the following functions are always executed in the main thread */
+
+
 static void image_loader_stop_source(ImageLoader *il)
 {
 	if (!il) return;
@@ -1041,6 +1051,7 @@ static void image_loader_stop(ImageLoader *il)
 		/* stop loader in the other thread */
 		g_mutex_lock(il->data_mutex);
 		il->stopping = TRUE;
+		if (image_loader_scheduler_cancel(il)) il->can_destroy = TRUE; /* no worker holds it */
 		while (!il->can_destroy) g_cond_wait(il->can_destroy_cond, il->data_mutex);
 		g_mutex_unlock(il->data_mutex);
 		}
@@ -1125,87 +1136,208 @@ static gboolean image_loader_start_idle(ImageLoader *il)
 /**************************************************************************************/
 /* execution via thread */
 
-static GThreadPool *image_loader_thread_pool = nullptr;
-
-static GCond *image_loader_prio_cond = nullptr;
-static GMutex *image_loader_prio_mutex = nullptr;
-static gint image_loader_prio_num = 0;
+/*
+ * Threaded loaders are queued by #ImageLoaderJobClass and run on a fixed
+ * number of workers. The pool gets one task per queued loader; a task runs
+ * whichever loader is most urgent when it starts, not necessarily the one it
+ * was pushed for, and does nothing if that loader was cancelled meanwhile.
+ */
 
+static void image_loader_thread_run(gpointer data, gpointer);
 
-static void image_loader_thread_enter_high()
+struct ImageLoaderScheduler
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	image_loader_prio_num++;
-	g_mutex_unlock(image_loader_prio_mutex);
-}
+	GMutex mutex;
+	GThreadPool *pool;
+	std::deque<ImageLoader *> queue[IMAGE_LOADER_JOB_COUNT];
+	ImageLoaderQueueStats stats[IMAGE_LOADER_JOB_COUNT];
+};
 
-static void image_loader_thread_leave_high()
+static ImageLoaderScheduler *image_loader_scheduler()
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	image_loader_prio_num--;
-	if (image_loader_prio_num == 0) g_cond_broadcast(image_loader_prio_cond); /* wake up all low prio threads */
-	g_mutex_unlock(image_loader_prio_mutex);
+	static ImageLoaderScheduler *sched = []()
+		{
+		auto *s = new ImageLoaderScheduler();
+
+		g_mutex_init(&s->mutex);
+		s->pool = g_thread_pool_new(image_loader_thread_run, s, MAX(get_cpu_cores(), 1), FALSE, nullptr);
+
+		return s;
+		}();
+
+	return sched;
 }
 
-static void image_loader_thread_wait_high()
+/* must be called with the scheduler lock held */
+static void image_loader_scheduler_enqueue(ImageLoaderScheduler *sched, ImageLoader *il, gboolean front)
 {
-	g_mutex_lock(image_loader_prio_mutex);
-	while (image_loader_prio_num)
+	il->job_queued = TRUE;
+	il->job_queued_time = g_get_monotonic_time();
+
+	if (front)
+		{
+		sched->queue[il->job_class].push_front(il);
+		}
+	else
 		{
-		g_cond_wait(image_loader_prio_cond, image_loader_prio_mutex);
+		sched->queue[il->job_class].push_back(il);
 		}
+	sched->stats[il->job_class].queued++;
+}
+
+/* must be called with the scheduler lock held */
+static gboolean image_loader_scheduler_dequeue(ImageLoaderScheduler *sched, ImageLoader *il)
+{
+	if (!il->job_queued) return FALSE;
+
+	auto &queue = sched->queue[il->job_class];
+	auto it = std::find(queue.begin(), queue.end(), il);
+	if (it == queue.end()) return FALSE;
+
+	queue.erase(it);
+	sched->stats[il->job_class].queued--;
+	il->job_queued = FALSE;
 
-	g_mutex_unlock(image_loader_prio_mutex);
+	return TRUE;
 }
 
+static void image_loader_scheduler_push(ImageLoader *il, gboolean front)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler();
 
-static void image_loader_thread_run(gpointer data, gpointer)
+	g_mutex_lock(&sched->mutex);
+	image_loader_scheduler_enqueue(sched, il, front);
+	g_mutex_unlock(&sched->mutex);
+
+	g_thread_pool_push(sched->pool, sched, nullptr);
+}
+
+/**
+ * @brief Takes the most urgent queued loader, or nullptr if all were cancelled
+ */
+static ImageLoader *image_loader_scheduler_pop(ImageLoaderScheduler *sched)
 {
-	auto il = static_cast<ImageLoader *>(data);
-	gboolean cont;
-	gboolean err;
+	ImageLoader *il = nullptr;
 
-	if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
+	g_mutex_lock(&sched->mutex);
+	for (gint c = 0; c < IMAGE_LOADER_JOB_COUNT && !il; c++)
 		{
-		/* low prio, wait until high prio tasks finishes */
-		image_loader_thread_wait_high();
+		if (sched->queue[c].empty()) continue;
+
+		il = sched->queue[c].front();
+		sched->queue[c].pop_front();
+		il->job_queued = FALSE;
+		il->job_running = TRUE;
+
+		ImageLoaderQueueStats &stats = sched->stats[c];
+		gint64 wait = g_get_monotonic_time() - il->job_queued_time;
+
+		stats.queued--;
+		stats.running++;
+		stats.started++;
+		stats.wait_total += wait;
+		stats.wait_max = MAX(stats.wait_max, wait);
+
+		DEBUG_1("image loader %p class %d started after %" G_GINT64_FORMAT " us, %u queued", (void *)il, c, wait, stats.queued);
 		}
-	else
+	g_mutex_unlock(&sched->mutex);
+
+	return il;
+}
+
+/**
+ * @brief Requeues a running loader if a more urgent one is waiting
+ * @returns TRUE if the worker was given up, \a il must not be touched then
+ */
+static gboolean image_loader_scheduler_yield(ImageLoader *il)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler();
+	gboolean waiting = FALSE;
+
+	g_mutex_lock(&sched->mutex);
+	for (gint c = 0; c < il->job_class && !waiting; c++)
 		{
-		/* high prio */
-		image_loader_thread_enter_high();
+		waiting = !sched->queue[c].empty();
 		}
 
-	err = !image_loader_begin(il);
-
-	if (err)
+	if (waiting)
 		{
-		/*
-		loader failed, we have to send signal
-		(idle mode returns the image_loader_begin return value directly)
-		(success is always reported indirectly from image_loader_begin)
-		*/
-		image_loader_emit_error(il);
+		sched->stats[il->job_class].running--;
+		il->job_running = FALSE;
+		image_loader_scheduler_enqueue(sched, il, TRUE);
 		}
+	g_mutex_unlock(&sched->mutex);
 
-	cont = !err;
+	if (waiting) g_thread_pool_push(sched->pool, sched, nullptr);
 
-	while (cont && !image_loader_get_is_done(il) && !image_loader_get_stopping(il))
+	return waiting;
+}
+
+static void image_loader_scheduler_finish(ImageLoader *il)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler();
+
+	g_mutex_lock(&sched->mutex);
+	sched->stats[il->job_class].running--;
+	il->job_running = FALSE;
+	g_mutex_unlock(&sched->mutex);
+}
+
+/**
+ * @brief Removes a loader that is waiting for a worker
+ * @returns TRUE if it was queued, no worker holds it then
+ */
+static gboolean image_loader_scheduler_cancel(ImageLoader *il)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler();
+	gboolean ret;
+
+	g_mutex_lock(&sched->mutex);
+	ret = image_loader_scheduler_dequeue(sched, il);
+	g_mutex_unlock(&sched->mutex);
+
+	return ret;
+}
+
+static void image_loader_thread_run(gpointer data, gpointer)
+{
+	auto sched = static_cast<ImageLoaderScheduler *>(data);
+	ImageLoader *il;
+	gboolean cont = TRUE;
+
+	il = image_loader_scheduler_pop(sched);
+	if (!il) return;
+
+	if (!il->job_begun && !image_loader_get_stopping(il))
 		{
-		if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
+		il->job_begun = TRUE;
+
+		if (image_loader_probe_tile_source(il))
 			{
-			/* low prio, wait until high prio tasks finishes */
-			image_loader_thread_wait_high();
+			image_loader_emit_done(il);
+			cont = FALSE;
+			}
+		else if (!image_loader_setup_source(il) || !image_loader_begin(il))
+			{
+			/*
+			loader failed, we have to send signal
+			(idle mode returns the image_loader_begin return value directly)
+			(success is always reported indirectly from image_loader_begin)
+			*/
+			image_loader_emit_error(il);
+			cont = FALSE;
 			}
-		cont = image_loader_continue(il);
 		}
-	image_loader_stop_loader(il);
 
-	if (il->idle_priority <= G_PRIORITY_DEFAULT_IDLE)
+	while (cont && !image_loader_get_is_done(il) && !image_loader_get_stopping(il))
 		{
-		/* high prio */
-		image_loader_thread_leave_high();
+		if (image_loader_scheduler_yield(il)) return;
+
+		cont = image_loader_continue(il);
 		}
+	image_loader_stop_loader(il);
+
+	image_loader_scheduler_finish(il);
 
 	g_mutex_lock(il->data_mutex);
 	il->can_destroy = TRUE;
@@ -1223,21 +1355,15 @@ static gboolean image_loader_start_thread(ImageLoader *il)
 
 	il->thread = TRUE;
 
-	if (!image_loader_setup_source(il)) return FALSE;
-
-        if (!image_loader_thread_pool)
+	if (!il->job_class_set)
 		{
-		image_loader_thread_pool = g_thread_pool_new(image_loader_thread_run, nullptr, -1, FALSE, nullptr);
-		if (!image_loader_prio_cond) image_loader_prio_cond = g_new(GCond, 1);
-		g_cond_init(image_loader_prio_cond);
-		if (!image_loader_prio_mutex) image_loader_prio_mutex = g_new(GMutex, 1);
-		g_mutex_init(image_loader_prio_mutex);
+		il->job_class = (il->idle_priority > G_PRIORITY_DEFAULT_IDLE) ? IMAGE_LOADER_JOB_THUMBNAIL : IMAGE_LOADER_JOB_VIEWER;
 		}
 
+	il->job_begun = FALSE;
 	il->can_destroy = FALSE; /* ImageLoader can't be freed until image_loader_thread_run finishes */
 
-	g_thread_pool_push(image_loader_thread_pool, il, nullptr);
-	DEBUG_1("Thread pool num threads: %u", g_thread_pool_get_num_threads(image_loader_thread_pool));
+	image_loader_scheduler_push(il, FALSE);
 
 	return TRUE;
 }
@@ -1305,6 +1431,77 @@ void image_loader_set_priority(ImageLoader *il, gint priority)
 	il->idle_priority = priority;
 }
 
+/**
+ * @brief Sets the scheduling class of a threaded loader
+ *
+ * Without it the class follows image_loader_set_priority(): a priority
+ * lower than G_PRIORITY_DEFAULT_IDLE means #IMAGE_LOADER_JOB_THUMBNAIL,
+ * anything else #IMAGE_LOADER_JOB_VIEWER. May be used on a started loader,
+ * e.g. when a read ahead image is shown.
+ */
+void image_loader_set_job_class(ImageLoader *il, ImageLoaderJobClass job_class)
+{
+	if (!il) return;
+
+	ImageLoaderScheduler *sched = image_loader_scheduler();
+
+	g_mutex_lock(&sched->mutex);
+	il->job_class_set = TRUE;
+	if (il->job_class != job_class)
+		{
+		if (image_loader_scheduler_dequeue(sched, il))
+			{
+			il->job_class = job_class;
+			image_loader_scheduler_enqueue(sched, il, FALSE);
+			}
+		else
+			{
+			if (il->job_running)
+				{
+				sched->stats[il->job_class].running--;
+				sched->stats[job_class].running++;
+				}
+			il->job_class = job_class;
+			}
+		}
+	g_mutex_unlock(&sched->mutex);
+}
+
+/**
+ * @brief Makes the loader check first whether the image is to be shown as tiles
+ *
+ * The check reads the file headers, so it is done in the loader thread.
+ * If the image is too large to decode whole, the loader is done without a
+ * pixbuf, see image_loader_steal_tile_source(). Must be set before the
+ * loader is started.
+ */
+void image_loader_set_tile_source_probe(ImageLoader *il, gboolean enable)
+{
+	if (!il) return;
+
+	g_free(il->tile_source_path);
+	il->tile_source_path = nullptr;
+
+	/* the loader thread must not read the FileData */
+	if (enable && image_tile_source_candidate(il->fd))
+		{
+		il->tile_source_path = g_strdup(il->fd->path);
+		il->tile_source_page_num = il->fd->page_num;
+		}
+}
+
+/**
+ * @brief Queue depth and latency of a scheduling class since startup
+ */
+void image_loader_get_queue_stats(ImageLoaderJobClass job_class, ImageLoaderQueueStats &stats)
+{
+	ImageLoaderScheduler *sched = image_loader_scheduler();
+
+	g_mutex_lock(&sched->mutex);
+	stats = sched->stats[job_class];
+	g_mutex_unlock(&sched->mutex);
+}
+
 
 gdouble image_loader_get_percent(ImageLoader *il)
 {
@@ -1369,6 +1566,23 @@ const gchar *image_loader_get_error(ImageLoader *il)
 	return ret;
 }
 
+/**
+ * @brief Takes the tile source the loader opened instead of decoding the image
+ * @returns nullptr if the image was decoded as usual
+ */
+ImageTileSource *image_loader_steal_tile_source(ImageLoader *il)
+{
+	ImageTileSource *ret;
+	if (!il) return nullptr;
+
+	g_mutex_lock(il->data_mutex);
+	ret = il->tile_source;
+	il->tile_source = nullptr;
+	g_mutex_unlock(il->data_mutex);
+
+	return ret;
+}
+
 
 /**
  *  @FIXME this can be rather slow and blocks until the size is known
@@ -29,6 +29,7 @@
 #include <glib.h>
 
 class FileData;
+struct ImageTileSource;
 
 #define TYPE_IMAGE_LOADER		(image_loader_get_type())
 
@@ -43,6 +44,8 @@ public:
 
 	virtual void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, AreaPreparedCb area_prepared_cb, gpointer data) = 0;
 	virtual void set_size(int /*width*/, int /*height*/) {};
+	/** TRUE if set_size() makes the backend decode at a reduced size, at least the size set */
+	virtual gboolean supports_scaled_decode() { return FALSE; };
 	virtual gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) = 0;
 	virtual GdkPixbuf *get_pixbuf() = 0;
 	virtual gboolean close(GError **/*error*/) { return TRUE; };
@@ -53,6 +56,29 @@ public:
 	virtual gint get_page_total() { return 0; };
 };
 
+/**
+ * @brief Scheduling class of a threaded loader, most urgent first
+ *
+ * A worker always takes the most urgent queued loader, and a running loader
+ * gives its worker up between chunks while a more urgent one is waiting.
+ */
+enum ImageLoaderJobClass {
+	IMAGE_LOADER_JOB_VIEWER = 0, /**< the image being shown */
+	IMAGE_LOADER_JOB_READ_AHEAD,
+	IMAGE_LOADER_JOB_THUMBNAIL,
+	IMAGE_LOADER_JOB_BACKGROUND, /**< cache maintenance, duplicates and search */
+	IMAGE_LOADER_JOB_COUNT
+};
+
+struct ImageLoaderQueueStats
+{
+	guint queued;     /**< loaders waiting for a worker */
+	guint running;    /**< loaders holding a worker */
+	guint64 started;  /**< times a loader was given a worker */
+	gint64 wait_total; /**< total queue latency, in microseconds */
+	gint64 wait_max;   /**< largest queue latency, in microseconds */
+};
+
 enum ImageLoaderPreview {
 	IMAGE_LOADER_PREVIEW_NONE = 0,
 	IMAGE_LOADER_PREVIEW_EXIF = 1,
@@ -101,9 +127,20 @@ struct ImageLoader
 	GCond *can_destroy_cond;
 	gboolean thread;
 
+	ImageLoaderJobClass job_class;
+	gboolean job_class_set;
+	gboolean job_queued;  /**< waiting in the scheduler queue, protected by the scheduler lock */
+	gboolean job_running; /**< holding a worker, protected by the scheduler lock */
+	gboolean job_begun;
+	gint64 job_queued_time;
+
 	guchar *mapped_file;
 	gsize read_buffer_size;
 	guint idle_read_loop_count;
+
+	gchar *tile_source_path; /**< copied from fd, as the loader thread opens it */
+	gint tile_source_page_num;
+	ImageTileSource *tile_source; /**< set instead of the pixbuf for images shown as tiles */
 };
 
 struct ImageLoaderClass {
@@ -130,6 +167,12 @@ void image_loader_set_buffer_size(ImageLoader *il, guint count);
 
 void image_loader_set_priority(ImageLoader *il, gint priority);
 
+void image_loader_set_job_class(ImageLoader *il, ImageLoaderJobClass job_class);
+
+void image_loader_get_queue_stats(ImageLoaderJobClass job_class, ImageLoaderQueueStats &stats);
+
+void image_loader_set_tile_source_probe(ImageLoader *il, gboolean enable);
+
 gboolean image_loader_start(ImageLoader *il);
 
 
@@ -139,6 +182,7 @@ gboolean image_loader_get_is_done(ImageLoader *il);
 FileData *image_loader_get_fd(ImageLoader *il);
 gboolean image_loader_get_shrunk(ImageLoader *il);
 const gchar *image_loader_get_error(ImageLoader *il);
+ImageTileSource *image_loader_steal_tile_source(ImageLoader *il);
 
 gboolean image_load_dimensions(FileData *fd, gint *width, gint *height);
 
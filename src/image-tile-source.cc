@@ -0,0 +1,535 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "image-tile-source.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+#include <config.h>
+
+#include "debug.h"
+#include "filedata.h"
+#if HAVE_J2K
+#  include "image-load-j2k.h"
+#endif
+#if HAVE_JPEG
+#  include "image-load-jpeg.h"
+#endif
+#if HAVE_TIFF
+#  include "image-load-tiff.h"
+#endif
+#include "typedefs.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *
+ * Images too large to be decoded in one piece are shown with the source
+ * tiles of PixbufRenderer instead: only the tiles on screen are decoded,
+ * at the reduced level the zoom asks for. The backends decode a region
+ * from TIFF tiles or strips (or a reduced resolution image of the file),
+ * from J2K resolution levels or from JPEG MCU rows.
+ *
+ * Source tiles are neither color managed nor rotated.
+ *
+ * The renderer asks for tiles while it draws, so they are decoded by
+ * image_tile_source_read_async() on a worker thread, and handed back on
+ * the main thread once done.
+ */
+
+namespace
+{
+
+/** Images with fewer pixels are decoded whole, as usual */
+constexpr gint64 TILE_SOURCE_MIN_PIXELS = 256 * 1024 * 1024;
+
+/** Files smaller than this are not looked at, they do not hold that many pixels in practice */
+constexpr gint64 TILE_SOURCE_MIN_FILE_SIZE = 1024 * 1024;
+
+constexpr gint TILE_SOURCE_TILE_SIZE = 512;
+
+/** The most reduced level fits in this size */
+constexpr gint TILE_SOURCE_MIN_LEVEL_SIZE = 1024;
+
+/** Memory for the rows cached by ImageTileSourceBackend::whole_rows() backends */
+constexpr gsize TILE_SOURCE_BAND_CACHE_SIZE = 128 * 1024 * 1024;
+
+struct TileSourceBand
+{
+	gint y;
+	gint height;
+	gint reduce;
+	GdkPixbuf *pixbuf;
+};
+
+struct TileSourceRead
+{
+	ImageTileSource *ts;
+	GdkRectangle region;
+	gint dest_width;
+	gint dest_height;
+	ImageTileSourceReadFunc func;	/**< nullptr once cancelled */
+	gpointer data;
+	GdkPixbuf *pixbuf;		/**< the result, nullptr if the read failed or was cancelled */
+};
+
+std::unique_ptr<ImageTileSourceBackend> image_tile_source_backend_new(const gchar *path)
+{
+	guchar buf[12];
+	gsize n;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f) return nullptr;
+
+	n = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+
+#if HAVE_JPEG && HAVE_JPEG_SKIP_SCANLINES
+	if (n >= 2 && buf[0] == 0xff && buf[1] == 0xd8)
+		{
+		return get_image_tile_source_backend_jpeg();
+		}
+#endif
+#if HAVE_TIFF
+	if (n >= 8 &&
+	    (memcmp(buf, "MM\0*", 4) == 0 ||
+	     memcmp(buf, "MM\0+\0\x08\0\0", 8) == 0 ||
+	     memcmp(buf, "II+\0\x08\0\0\0", 8) == 0 ||
+	     memcmp(buf, "II*\0", 4) == 0))
+		{
+		return get_image_tile_source_backend_tiff();
+		}
+#endif
+#if HAVE_J2K
+	if (n >= 12 && memcmp(buf, "\0\0\0\x0CjP\x20\x20\x0D\x0A\x87\x0A", 12) == 0)
+		{
+		return get_image_tile_source_backend_j2k();
+		}
+#endif
+
+	return nullptr;
+}
+
+} // namespace
+
+struct ImageTileSource
+{
+	~ImageTileSource();
+
+	gint ref;
+
+	std::unique_ptr<ImageTileSourceBackend> backend;
+	gint width;
+	gint height;
+	gint max_level;
+
+	GMutex read_mutex;	/**< held while the backend decodes */
+	std::deque<TileSourceBand> bands;	/**< most recent first, protected by read_mutex */
+	gsize bands_size;
+
+	GMutex reads_mutex;
+	GList *reads;	/**< pending #TileSourceRead, protected by reads_mutex */
+};
+
+ImageTileSource::~ImageTileSource()
+{
+	for (TileSourceBand &band : bands) g_object_unref(band.pixbuf);
+
+	g_mutex_clear(&read_mutex);
+	g_mutex_clear(&reads_mutex);
+}
+
+namespace
+{
+
+gsize tile_source_band_size(gint width, gint height)
+{
+	return static_cast<gsize>(width) * height * 3;
+}
+
+/**
+ * @brief Reads the region from the rows of the image it is in, which are
+ * decoded once for all the tiles of a row
+ */
+gboolean tile_source_read_band(ImageTileSource *ts, const GdkRectangle &r, gint reduce, GdkPixbuf *dest)
+{
+	const gint band_w = (ts->width + reduce - 1) / reduce;
+	const gint band_h = (r.height + reduce - 1) / reduce;
+	GdkPixbuf *pixbuf = nullptr;
+
+	if (tile_source_band_size(band_w, band_h) > TILE_SOURCE_BAND_CACHE_SIZE / 2)
+		{
+		return ts->backend->read(r.x, r.y, r.width, r.height, reduce, dest);
+		}
+
+	for (auto it = ts->bands.begin(); it != ts->bands.end(); ++it)
+		{
+		if (it->y == r.y && it->height == r.height && it->reduce == reduce)
+			{
+			TileSourceBand band = *it;
+
+			ts->bands.erase(it);
+			ts->bands.push_front(band);
+			pixbuf = band.pixbuf;
+			break;
+			}
+		}
+
+	if (!pixbuf)
+		{
+		pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, band_w, band_h);
+		gdk_pixbuf_fill(pixbuf, 0x000000ff);
+
+		if (!ts->backend->read(0, r.y, ts->width, r.height, reduce, pixbuf))
+			{
+			g_object_unref(pixbuf);
+			return FALSE;
+			}
+
+		ts->bands.push_front({r.y, r.height, reduce, pixbuf});
+		ts->bands_size += tile_source_band_size(band_w, band_h);
+
+		while (ts->bands.size() > 1 && ts->bands_size > TILE_SOURCE_BAND_CACHE_SIZE)
+			{
+			TileSourceBand &old = ts->bands.back();
+
+			ts->bands_size -= tile_source_band_size(gdk_pixbuf_get_width(old.pixbuf), gdk_pixbuf_get_height(old.pixbuf));
+			g_object_unref(old.pixbuf);
+			ts->bands.pop_back();
+			}
+		}
+
+	image_tile_source_draw(pixbuf, dest, -(r.x / reduce), 0, 1.0, 1.0);
+
+	return TRUE;
+}
+
+} // namespace
+
+/**
+ * @brief Whether \a fd may be large enough to be shown as tiles
+ *
+ * This only looks at the FileData, image_tile_source_new() decides.
+ */
+gboolean image_tile_source_candidate(const FileData *fd)
+{
+	return fd && fd->format_class == FORMAT_CLASS_IMAGE && fd->size >= TILE_SOURCE_MIN_FILE_SIZE;
+}
+
+/**
+ * @brief Opens page \a page_num of \a path for display as tiles
+ * @returns nullptr if the image is small enough to be decoded whole, or
+ * if it can not be decoded by region
+ *
+ * Opening reads the headers of the file, so this is done by the image
+ * loader thread, see image_loader_set_tile_source_probe().
+ */
+ImageTileSource *image_tile_source_new(const gchar *path, gint page_num)
+{
+	gchar *pathl = path_from_utf8(path);
+	std::unique_ptr<ImageTileSourceBackend> backend = image_tile_source_backend_new(pathl);
+	gboolean ok = backend && backend->open(pathl, page_num);
+	g_free(pathl);
+
+	if (!ok) return nullptr;
+
+	gint width;
+	gint height;
+	backend->get_size(width, height);
+
+	if (static_cast<gint64>(width) * height < TILE_SOURCE_MIN_PIXELS) return nullptr;
+
+	DEBUG_1("tile source for %s", path);
+
+	return image_tile_source_new(std::move(backend));
+}
+
+/**
+ * @brief Shows the image of an opened \a backend as tiles, whatever its size
+ */
+ImageTileSource *image_tile_source_new(std::unique_ptr<ImageTileSourceBackend> backend)
+{
+	auto ts = new ImageTileSource();
+
+	ts->ref = 1;
+	ts->backend = std::move(backend);
+	ts->backend->get_size(ts->width, ts->height);
+	ts->max_level = 0;
+	ts->bands_size = 0;
+	ts->reads = nullptr;
+	g_mutex_init(&ts->read_mutex);
+	g_mutex_init(&ts->reads_mutex);
+
+	while ((MAX(ts->width, ts->height) >> ts->max_level) > TILE_SOURCE_MIN_LEVEL_SIZE) ts->max_level++;
+
+	DEBUG_1("tile source: %d x %d, %d levels", ts->width, ts->height, ts->max_level);
+
+	return ts;
+}
+
+ImageTileSource *image_tile_source_ref(ImageTileSource *ts)
+{
+	if (ts) g_atomic_int_inc(&ts->ref);
+
+	return ts;
+}
+
+/**
+ * @brief Drops a reference, pending reads keep their own
+ */
+void image_tile_source_unref(ImageTileSource *ts)
+{
+	if (ts && g_atomic_int_dec_and_test(&ts->ref)) delete ts;
+}
+
+void image_tile_source_get_size(const ImageTileSource *ts, gint &width, gint &height)
+{
+	width = ts->width;
+	height = ts->height;
+}
+
+gint image_tile_source_get_tile_size(const ImageTileSource *)
+{
+	return TILE_SOURCE_TILE_SIZE;
+}
+
+gint image_tile_source_get_max_level(const ImageTileSource *ts)
+{
+	return ts->max_level;
+}
+
+/**
+ * @brief Fills \a dest with the region of the image, as requested by PixbufRenderer
+ *
+ * \a dest may be smaller than the region by a power of two, see
+ * pixbuf_renderer_set_tiles(). The part outside of the image is black.
+ * Reads of the same source are serialized, the backends are not thread safe.
+ */
+gboolean image_tile_source_read(ImageTileSource *ts, gint x, gint y, gint width, gint height, GdkPixbuf *dest)
+{
+	const gint dest_w = gdk_pixbuf_get_width(dest);
+	const gint dest_h = gdk_pixbuf_get_height(dest);
+	const GdkRectangle image_rect{0, 0, ts->width, ts->height};
+	const GdkRectangle request_rect{x, y, width, height};
+	GdkRectangle r;
+	gint reduce = 1;
+
+	while (reduce * dest_w < width) reduce *= 2;
+
+	gdk_pixbuf_fill(dest, 0x000000ff);
+
+	if (!gdk_rectangle_intersect(&image_rect, &request_rect, &r)) return TRUE;
+
+	const gint sub_x = (r.x - x) / reduce;
+	const gint sub_y = (r.y - y) / reduce;
+	const gint sub_w = MIN((r.width + reduce - 1) / reduce, dest_w - sub_x);
+	const gint sub_h = MIN((r.height + reduce - 1) / reduce, dest_h - sub_y);
+
+	if (sub_w < 1 || sub_h < 1) return TRUE;
+
+	GdkPixbuf *sub = gdk_pixbuf_new_subpixbuf(dest, sub_x, sub_y, sub_w, sub_h);
+	gboolean ret;
+	g_mutex_lock(&ts->read_mutex);
+	if (ts->backend->whole_rows())
+		{
+		ret = tile_source_read_band(ts, r, reduce, sub);
+		}
+	else
+		{
+		ret = ts->backend->read(r.x, r.y, r.width, r.height, reduce, sub);
+		}
+	g_mutex_unlock(&ts->read_mutex);
+	g_object_unref(sub);
+
+	if (!ret) DEBUG_1("tile source failed to read %d,%d %d x %d", r.x, r.y, r.width, r.height);
+
+	return ret;
+}
+
+namespace
+{
+
+gboolean tile_source_read_done_cb(gpointer data)
+{
+	auto rd = static_cast<TileSourceRead *>(data);
+	ImageTileSource *ts = rd->ts;
+
+	g_mutex_lock(&ts->reads_mutex);
+	ts->reads = g_list_remove(ts->reads, rd);
+	g_mutex_unlock(&ts->reads_mutex);
+
+	/* func is only changed in the main thread */
+	if (rd->func && rd->pixbuf)
+		{
+		rd->func(ts, rd->region.x, rd->region.y, rd->region.width, rd->region.height, rd->pixbuf, rd->data);
+		}
+
+	if (rd->pixbuf) g_object_unref(rd->pixbuf);
+	image_tile_source_unref(ts);
+	g_free(rd);
+
+	return G_SOURCE_REMOVE;
+}
+
+void tile_source_read_run(gpointer data, gpointer)
+{
+	auto rd = static_cast<TileSourceRead *>(data);
+	ImageTileSource *ts = rd->ts;
+
+	g_mutex_lock(&ts->reads_mutex);
+	const gboolean cancelled = !rd->func;
+	g_mutex_unlock(&ts->reads_mutex);
+
+	if (!cancelled)
+		{
+		GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rd->dest_width, rd->dest_height);
+
+		if (image_tile_source_read(ts, rd->region.x, rd->region.y, rd->region.width, rd->region.height, pixbuf))
+			{
+			rd->pixbuf = pixbuf;
+			}
+		else
+			{
+			g_object_unref(pixbuf);
+			}
+		}
+
+	g_idle_add(tile_source_read_done_cb, rd);
+}
+
+/* one thread, the reads of a source are serialized anyway and the reads of a file stay sequential */
+GThreadPool *tile_source_read_pool()
+{
+	static GThreadPool *pool = g_thread_pool_new(tile_source_read_run, nullptr, 1, FALSE, nullptr);
+
+	return pool;
+}
+
+} // namespace
+
+/**
+ * @brief Reads a region as image_tile_source_read() does, in a worker thread
+ * @param dest_width,dest_height Size of the pixbuf to fill
+ * @param func Called in the main thread with the filled pixbuf, unless the read
+ * failed or was cancelled
+ *
+ * A read that is already pending for the same region and \a data is not queued again.
+ */
+void image_tile_source_read_async(ImageTileSource *ts, gint x, gint y, gint width, gint height,
+				  gint dest_width, gint dest_height,
+				  ImageTileSourceReadFunc func, gpointer data)
+{
+	const GdkRectangle region{x, y, width, height};
+
+	if (!ts || !func || dest_width < 1 || dest_height < 1) return;
+
+	g_mutex_lock(&ts->reads_mutex);
+	for (GList *work = ts->reads; work; work = work->next)
+		{
+		auto rd = static_cast<TileSourceRead *>(work->data);
+
+		if (rd->func == func && rd->data == data && gdk_rectangle_equal(&rd->region, &region) &&
+		    rd->dest_width == dest_width && rd->dest_height == dest_height)
+			{
+			g_mutex_unlock(&ts->reads_mutex);
+			return;
+			}
+		}
+
+	auto rd = g_new0(TileSourceRead, 1);
+	rd->ts = image_tile_source_ref(ts);
+	rd->region = region;
+	rd->dest_width = dest_width;
+	rd->dest_height = dest_height;
+	rd->func = func;
+	rd->data = data;
+
+	ts->reads = g_list_prepend(ts->reads, rd);
+	g_mutex_unlock(&ts->reads_mutex);
+
+	g_thread_pool_push(tile_source_read_pool(), rd, nullptr);
+}
+
+/**
+ * @brief Cancels the pending reads for \a data, of \a region only if not nullptr
+ *
+ * Reads not started yet are skipped, and no callback is made for any of them.
+ */
+void image_tile_source_read_cancel(ImageTileSource *ts, gpointer data, const GdkRectangle *region)
+{
+	if (!ts) return;
+
+	g_mutex_lock(&ts->reads_mutex);
+	for (GList *work = ts->reads; work; work = work->next)
+		{
+		auto rd = static_cast<TileSourceRead *>(work->data);
+
+		if (rd->data == data && (!region || gdk_rectangle_equal(&rd->region, region))) rd->func = nullptr;
+		}
+	g_mutex_unlock(&ts->reads_mutex);
+}
+
+/**
+ * @brief Hands the pending reads for \a data over to \a new_data
+ */
+void image_tile_source_read_move(ImageTileSource *ts, gpointer data, gpointer new_data)
+{
+	if (!ts) return;
+
+	g_mutex_lock(&ts->reads_mutex);
+	for (GList *work = ts->reads; work; work = work->next)
+		{
+		auto rd = static_cast<TileSourceRead *>(work->data);
+
+		if (rd->data == data) rd->data = new_data;
+		}
+	g_mutex_unlock(&ts->reads_mutex);
+}
+
+/**
+ * @brief Draws \a src scaled by \a scale_x x \a scale_y at \a offset_x, \a offset_y of \a dest
+ *
+ * For the backends, which decode a region in pieces or at a finer
+ * resolution than was asked for.
+ */
+void image_tile_source_draw(GdkPixbuf *src, GdkPixbuf *dest, gdouble offset_x, gdouble offset_y, gdouble scale_x, gdouble scale_y)
+{
+	const gint x1 = MAX(0, static_cast<gint>(floor(offset_x)));
+	const gint y1 = MAX(0, static_cast<gint>(floor(offset_y)));
+	const gint x2 = MIN(gdk_pixbuf_get_width(dest), static_cast<gint>(ceil(offset_x + (gdk_pixbuf_get_width(src) * scale_x))));
+	const gint y2 = MIN(gdk_pixbuf_get_height(dest), static_cast<gint>(ceil(offset_y + (gdk_pixbuf_get_height(src) * scale_y))));
+
+	if (x2 <= x1 || y2 <= y1) return;
+
+	if (scale_x == 1.0 && scale_y == 1.0 && offset_x == floor(offset_x) && offset_y == floor(offset_y))
+		{
+		gdk_pixbuf_copy_area(src, x1 - static_cast<gint>(offset_x), y1 - static_cast<gint>(offset_y),
+				     x2 - x1, y2 - y1, dest, x1, y1);
+		}
+	else
+		{
+		gdk_pixbuf_scale(src, dest, x1, y1, x2 - x1, y2 - y1,
+				 offset_x, offset_y, scale_x, scale_y, GDK_INTERP_BILINEAR);
+		}
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
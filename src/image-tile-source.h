@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef IMAGE_TILE_SOURCE_H
+#define IMAGE_TILE_SOURCE_H
+
+#include <memory>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gdk/gdk.h>
+#include <glib.h>
+
+class FileData;
+
+/**
+ * @brief Decodes a region of an image without decoding the rest of it
+ */
+struct ImageTileSourceBackend
+{
+	virtual ~ImageTileSourceBackend() = default;
+
+	/* FALSE if the file can not be decoded by region */
+	virtual gboolean open(const gchar *path, gint page_num) = 0;
+	virtual void get_size(gint &width, gint &height) = 0;
+
+	/* The region is inside the image, dest is the region reduced by the power of two
+	 * reduce, rounded up. The backend may decode at a finer resolution and scale down.
+	 */
+	virtual gboolean read(gint x, gint y, gint width, gint height, gint reduce, GdkPixbuf *dest) = 0;
+
+	/* TRUE if a region costs about as much as the whole rows of it, the rows are then read once and cached */
+	virtual gboolean whole_rows() { return FALSE; }
+};
+
+void image_tile_source_draw(GdkPixbuf *src, GdkPixbuf *dest, gdouble offset_x, gdouble offset_y, gdouble scale_x, gdouble scale_y);
+
+struct ImageTileSource;
+
+using ImageTileSourceReadFunc = void (*)(ImageTileSource *ts, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf, gpointer data);
+
+gboolean image_tile_source_candidate(const FileData *fd);
+ImageTileSource *image_tile_source_new(const gchar *path, gint page_num);
+ImageTileSource *image_tile_source_new(std::unique_ptr<ImageTileSourceBackend> backend);
+ImageTileSource *image_tile_source_ref(ImageTileSource *ts);
+void image_tile_source_unref(ImageTileSource *ts);
+
+void image_tile_source_get_size(const ImageTileSource *ts, gint &width, gint &height);
+gint image_tile_source_get_tile_size(const ImageTileSource *ts);
+gint image_tile_source_get_max_level(const ImageTileSource *ts);
+
+gboolean image_tile_source_read(ImageTileSource *ts, gint x, gint y, gint width, gint height, GdkPixbuf *dest);
+
+void image_tile_source_read_async(ImageTileSource *ts, gint x, gint y, gint width, gint height,
+				  gint dest_width, gint dest_height,
+				  ImageTileSourceReadFunc func, gpointer data);
+void image_tile_source_read_cancel(ImageTileSource *ts, gpointer data, const GdkRectangle *region);
+void image_tile_source_read_move(ImageTileSource *ts, gpointer data, gpointer new_data);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -37,6 +37,7 @@
 #include "filedata.h"
 #include "history-list.h"
 #include "image-load.h"
+#include "image-tile-source.h"
 #include "intl.h"
 #include "layout-image.h"
 #include "layout.h"
@@ -52,8 +53,14 @@ struct FileCacheData;
 
 static GList *image_list = nullptr;
 
+/** Source tiles kept by the renderer for an image shown as tiles */
+static constexpr gint IMAGE_TILE_SOURCE_CACHE = 32;
+
 static void image_read_ahead_start(ImageWindow *imd);
+static void image_read_ahead_window_next(ImageWindow *imd);
+static void image_load_tiles(ImageWindow *imd, ImageTileSource *ts);
 static void image_cache_set(ImageWindow *imd, FileData *fd);
+static FileCacheData *image_get_cache();
 
 // For draw rectangle function
 static gint pixbuf_start_x;
@@ -399,6 +406,15 @@ static void image_zoom_cb(PixbufRenderer *, gdouble, gpointer data)
 	image_update_util(imd);
 }
 
+/* the window moved to a monitor of another scale, or the scale was changed */
+static void image_scale_factor_cb(GObject *, GParamSpec *, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+
+	/* tiles are rendered while the main thread waits, so this is not used by a worker now */
+	if (imd->cm) static_cast<ColorMan *>(imd->cm)->scale_factor = scale_factor();
+}
+
 /*
  *-------------------------------------------------------------------
  * misc
@@ -783,6 +799,9 @@ static void image_read_ahead_cancel(ImageWindow *imd)
 	image_loader_free(imd->read_ahead_il);
 	imd->read_ahead_il = nullptr;
 
+	image_tile_source_unref(imd->read_ahead_tile_source);
+	imd->read_ahead_tile_source = nullptr;
+
 	file_data_unref(imd->read_ahead_fd);
 	imd->read_ahead_fd = nullptr;
 }
@@ -795,7 +814,11 @@ static void image_read_ahead_done_cb(ImageLoader *, gpointer data)
 
 	DEBUG_1("%s read ahead done for :%s", get_exec_time(), imd->read_ahead_fd->path);
 
-	if (!imd->read_ahead_fd->pixbuf)
+	/* shown as tiles, kept for image_read_ahead_check() */
+	image_tile_source_unref(imd->read_ahead_tile_source);
+	imd->read_ahead_tile_source = image_loader_steal_tile_source(imd->read_ahead_il);
+
+	if (!imd->read_ahead_fd->pixbuf && !imd->read_ahead_tile_source)
 		{
 		imd->read_ahead_fd->pixbuf = image_loader_get_pixbuf(imd->read_ahead_il);
 		if (imd->read_ahead_fd->pixbuf)
@@ -808,6 +831,8 @@ static void image_read_ahead_done_cb(ImageLoader *, gpointer data)
 	imd->read_ahead_il = nullptr;
 
 	image_complete_util(imd, TRUE);
+
+	image_read_ahead_window_next(imd);
 }
 
 static void image_read_ahead_error_cb(ImageLoader *il, gpointer data)
@@ -819,7 +844,11 @@ static void image_read_ahead_error_cb(ImageLoader *il, gpointer data)
 static void image_read_ahead_start(ImageWindow *imd)
 {
 	/* already started ? */
-	if (!imd->read_ahead_fd || imd->read_ahead_il || imd->read_ahead_fd->pixbuf) return;
+	if (!imd->read_ahead_fd || imd->read_ahead_il || imd->read_ahead_fd->pixbuf || imd->read_ahead_tile_source)
+		{
+		image_read_ahead_window_next(imd);
+		return;
+		}
 
 	/* still loading ?, do later */
 	if (imd->il /*|| imd->cm*/) return;
@@ -829,6 +858,8 @@ static void image_read_ahead_start(ImageWindow *imd)
 	imd->read_ahead_il = image_loader_new(imd->read_ahead_fd);
 
 	image_loader_delay_area_ready(imd->read_ahead_il, TRUE); /* we will need the area_ready signals later */
+	image_loader_set_job_class(imd->read_ahead_il, IMAGE_LOADER_JOB_READ_AHEAD);
+	image_loader_set_tile_source_probe(imd->read_ahead_il, TRUE);
 
 	g_signal_connect(G_OBJECT(imd->read_ahead_il), "error", (GCallback)image_read_ahead_error_cb, imd);
 	g_signal_connect(G_OBJECT(imd->read_ahead_il), "done", (GCallback)image_read_ahead_done_cb, imd);
@@ -853,6 +884,158 @@ static void image_read_ahead_set(ImageWindow *imd, FileData *fd)
 	image_read_ahead_start(imd);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * read ahead window
+ *
+ * Beyond the single read ahead image above, a list of images around
+ * the current one is decoded into the image cache, one at a time and
+ * only while nothing else is loading. The window is bounded by the
+ * memory budget options->image.read_ahead_max.
+ *-------------------------------------------------------------------
+ */
+
+static void image_read_ahead_window_cancel_loader(ImageWindow *imd)
+{
+	if (!imd->read_ahead_window_fd) return;
+
+	DEBUG_1("%s read ahead window cancelled for :%s", get_exec_time(), imd->read_ahead_window_fd->path);
+
+	image_loader_free(imd->read_ahead_window_il);
+	imd->read_ahead_window_il = nullptr;
+
+	file_data_unref(imd->read_ahead_window_fd);
+	imd->read_ahead_window_fd = nullptr;
+}
+
+static void image_read_ahead_window_clear(ImageWindow *imd)
+{
+	g_list_free_full(imd->read_ahead_window, reinterpret_cast<GDestroyNotify>(file_data_unref));
+	imd->read_ahead_window = nullptr;
+	imd->read_ahead_window_size = 0;
+}
+
+static void image_read_ahead_window_cancel(ImageWindow *imd)
+{
+	image_read_ahead_window_cancel_loader(imd);
+	image_read_ahead_window_clear(imd);
+}
+
+static void image_read_ahead_window_done_cb(ImageLoader *, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+	FileData *fd = imd->read_ahead_window_fd;
+
+	if (!fd || !imd->read_ahead_window_il) return;
+
+	DEBUG_1("%s read ahead window done for :%s", get_exec_time(), fd->path);
+
+	/* shown as tiles, nothing to cache */
+	image_tile_source_unref(image_loader_steal_tile_source(imd->read_ahead_window_il));
+
+	if (!fd->pixbuf)
+		{
+		fd->pixbuf = image_loader_get_pixbuf(imd->read_ahead_window_il);
+		if (fd->pixbuf)
+			{
+			g_object_ref(fd->pixbuf);
+			image_cache_set(imd, fd);
+
+			imd->read_ahead_window_last = static_cast<gulong>(gdk_pixbuf_get_rowstride(fd->pixbuf)) * gdk_pixbuf_get_height(fd->pixbuf);
+			imd->read_ahead_window_size += imd->read_ahead_window_last;
+			}
+		}
+
+	image_read_ahead_window_cancel_loader(imd);
+
+	image_read_ahead_window_next(imd);
+}
+
+static void image_read_ahead_window_error_cb(ImageLoader *il, gpointer data)
+{
+	/* as with the read ahead, keep whatever was decoded */
+	image_read_ahead_window_done_cb(il, data);
+}
+
+static gulong image_read_ahead_window_budget(ImageWindow *imd)
+{
+	gulong budget = static_cast<gulong>(MIN(options->image.read_ahead_max, options->image.image_cache_max)) * 1048576;
+	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
+
+	/* the image on display has to stay in the cache too */
+	if (pixbuf)
+		{
+		const gulong size = static_cast<gulong>(gdk_pixbuf_get_rowstride(pixbuf)) * gdk_pixbuf_get_height(pixbuf);
+		budget = (budget > size) ? budget - size : 0;
+		}
+
+	return budget;
+}
+
+static void image_read_ahead_window_next(ImageWindow *imd)
+{
+	/* one at a time, and the image on display and the read ahead image go first */
+	if (imd->read_ahead_window_il || imd->il || imd->read_ahead_il) return;
+
+	while (imd->read_ahead_window)
+		{
+		auto fd = static_cast<FileData *>(imd->read_ahead_window->data);
+		imd->read_ahead_window = g_list_delete_link(imd->read_ahead_window, imd->read_ahead_window);
+
+		if (fd == imd->image_fd || fd == imd->read_ahead_fd || file_cache_get(image_get_cache(), fd))
+			{
+			file_data_unref(fd);
+			continue;
+			}
+
+		if (imd->read_ahead_window_size + imd->read_ahead_window_last > image_read_ahead_window_budget(imd))
+			{
+			DEBUG_1("read ahead window budget reached at :%s", fd->path);
+			file_data_unref(fd);
+			image_read_ahead_window_cancel(imd);
+			return;
+			}
+
+		DEBUG_1("%s read ahead window started for :%s", get_exec_time(), fd->path);
+
+		imd->read_ahead_window_fd = fd;
+		imd->read_ahead_window_il = image_loader_new(fd);
+
+		image_loader_delay_area_ready(imd->read_ahead_window_il, TRUE); /* in case it is handed over to image_read_ahead_check() */
+		image_loader_set_job_class(imd->read_ahead_window_il, IMAGE_LOADER_JOB_READ_AHEAD);
+		image_loader_set_tile_source_probe(imd->read_ahead_window_il, TRUE);
+
+		g_signal_connect(G_OBJECT(imd->read_ahead_window_il), "error", (GCallback)image_read_ahead_window_error_cb, imd);
+		g_signal_connect(G_OBJECT(imd->read_ahead_window_il), "done", (GCallback)image_read_ahead_window_done_cb, imd);
+
+		if (image_loader_start(imd->read_ahead_window_il)) return;
+
+		image_read_ahead_window_cancel_loader(imd);
+		}
+}
+
+static void image_read_ahead_window_set(ImageWindow *imd, GList *list)
+{
+	/* a load that is no longer wanted is stale, the user jumped elsewhere */
+	if (imd->read_ahead_window_fd && !g_list_find(list, imd->read_ahead_window_fd))
+		{
+		image_read_ahead_window_cancel_loader(imd);
+		}
+
+	image_read_ahead_window_clear(imd);
+
+	for (GList *work = list; work; work = work->next)
+		{
+		auto fd = static_cast<FileData *>(work->data);
+
+		if (fd == imd->read_ahead_window_fd) continue;
+		imd->read_ahead_window = g_list_prepend(imd->read_ahead_window, file_data_ref(fd));
+		}
+	imd->read_ahead_window = g_list_reverse(imd->read_ahead_window);
+
+	image_read_ahead_window_next(imd);
+}
+
 /*
  *-------------------------------------------------------------------
  * post buffering
@@ -929,6 +1112,22 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 
 	DEBUG_1("%s image done", get_exec_time());
 
+	ImageTileSource *ts = image_loader_steal_tile_source(imd->il);
+	if (ts)
+		{
+		g_object_set(G_OBJECT(imd->pr), "loading", FALSE, NULL);
+		image_state_unset(imd, IMAGE_STATE_LOADING);
+
+		image_loader_free(imd->il);
+		imd->il = nullptr;
+
+		image_load_tiles(imd, ts);
+
+		image_read_ahead_start(imd);
+		image_read_ahead_window_next(imd);
+		return;
+		}
+
 	if (options->image.enable_read_ahead && imd->image_fd && !imd->image_fd->pixbuf && image_loader_get_pixbuf(imd->il))
 		{
 		imd->image_fd->pixbuf = static_cast<GdkPixbuf*>(g_object_ref(image_loader_get_pixbuf(imd->il)));
@@ -958,6 +1157,7 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 	imd->il = nullptr;
 
 	image_read_ahead_start(imd);
+	image_read_ahead_window_next(imd);
 }
 
 static void image_load_size_cb(ImageLoader *, guint width, guint height, gpointer data)
@@ -997,6 +1197,18 @@ static void image_load_set_signals(ImageWindow *imd, gboolean override_old_signa
 
 static gboolean image_read_ahead_check(ImageWindow *imd)
 {
+	if (!imd->il && imd->image_fd && imd->read_ahead_window_il &&
+	    imd->read_ahead_window_fd == imd->image_fd)
+		{
+		/* the image is being decoded by the read ahead window, take it over */
+		image_read_ahead_cancel(imd);
+
+		imd->read_ahead_fd = imd->read_ahead_window_fd;
+		imd->read_ahead_il = imd->read_ahead_window_il;
+		imd->read_ahead_window_fd = nullptr;
+		imd->read_ahead_window_il = nullptr;
+		}
+
 	if (!imd->read_ahead_fd) return FALSE;
 	if (imd->il) return FALSE;
 
@@ -1010,6 +1222,7 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 		{
 		imd->il = imd->read_ahead_il;
 		imd->read_ahead_il = nullptr;
+		image_loader_set_job_class(imd->il, IMAGE_LOADER_JOB_VIEWER);
 
 		image_load_set_signals(imd, TRUE);
 
@@ -1034,6 +1247,18 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 		file_data_unref(imd->read_ahead_fd);
 		imd->read_ahead_fd = nullptr;
 
+		return TRUE;
+		}
+	if (imd->read_ahead_tile_source)
+		{
+		ImageTileSource *ts = imd->read_ahead_tile_source;
+		imd->read_ahead_tile_source = nullptr;
+
+		image_load_tiles(imd, ts);
+
+		file_data_unref(imd->read_ahead_fd);
+		imd->read_ahead_fd = nullptr;
+
 		return TRUE;
 		}
 
@@ -1041,6 +1266,179 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 	return FALSE;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * tiles
+ *-------------------------------------------------------------------
+ */
+
+static gint image_tile_request_cb(PixbufRenderer *, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+
+	if (!imd->func_tile_request) return FALSE;
+
+	return imd->func_tile_request(imd, x, y, width, height, pixbuf, imd->data_tile);
+}
+
+static void image_tile_dispose_cb(PixbufRenderer *, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+
+	if (imd->func_tile_dispose) imd->func_tile_dispose(imd, x, y, width, height, pixbuf, imd->data_tile);
+}
+
+/**
+ * @brief Displays an image made of tiles that are requested when needed
+ *
+ * See pixbuf_renderer_set_tiles().
+ */
+void image_set_image_as_tiles(ImageWindow *imd, gint width, gint height,
+			      gint tile_width, gint tile_height, gint cache_size, gint max_level,
+			      ImageWindow::TileRequestFunc func_tile_request,
+			      ImageWindow::TileDisposeFunc func_tile_dispose,
+			      gpointer data,
+			      gdouble zoom)
+{
+	imd->func_tile_request = func_tile_request;
+	imd->func_tile_dispose = func_tile_dispose;
+	imd->data_tile = data;
+
+	pixbuf_renderer_set_tiles(PIXBUF_RENDERER(imd->pr), width, height,
+				  tile_width, tile_height, cache_size, max_level,
+				  image_tile_request_cb, image_tile_dispose_cb, imd, zoom);
+}
+
+/** The tile image_tile_source_done_cb() hands to the renderer, while it does */
+struct ImageTileDone
+{
+	GdkRectangle region;
+	GdkPixbuf *pixbuf;
+};
+
+static const ImageTileDone *image_tile_done = nullptr;
+
+static void image_tile_source_done_cb(ImageTileSource *, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+	const ImageTileDone done{{x, y, width, height}, pixbuf};
+
+	/* the renderer requests the tiles of the area again, see image_tile_source_request_cb() */
+	image_tile_done = &done;
+	pixbuf_renderer_area_changed(PIXBUF_RENDERER(imd->pr), x, y, width, height);
+	image_tile_done = nullptr;
+}
+
+/**
+ * @brief Queues the decoding of a tile, it is blank until image_tile_source_done_cb()
+ */
+static gint image_tile_source_request_cb(ImageWindow *imd, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf, gpointer)
+{
+	/* the source is gone once the image changes */
+	if (!imd->tile_source) return FALSE;
+
+	const gint dest_width = gdk_pixbuf_get_width(pixbuf);
+	const gint dest_height = gdk_pixbuf_get_height(pixbuf);
+
+	if (image_tile_done)
+		{
+		const GdkRectangle region{x, y, width, height};
+
+		if (!gdk_rectangle_equal(&image_tile_done->region, &region) ||
+		    gdk_pixbuf_get_width(image_tile_done->pixbuf) != dest_width ||
+		    gdk_pixbuf_get_height(image_tile_done->pixbuf) != dest_height)
+			{
+			return FALSE;
+			}
+
+		gdk_pixbuf_copy_area(image_tile_done->pixbuf, 0, 0, dest_width, dest_height, pixbuf, 0, 0);
+		return TRUE;
+		}
+
+	image_tile_source_read_async(imd->tile_source, x, y, width, height, dest_width, dest_height,
+				     image_tile_source_done_cb, imd);
+
+	return FALSE;
+}
+
+static void image_tile_source_dispose_cb(ImageWindow *imd, gint x, gint y, gint width, gint height, GdkPixbuf *, gpointer)
+{
+	const GdkRectangle region{x, y, width, height};
+
+	/* no longer visible, not worth decoding */
+	image_tile_source_read_cancel(imd->tile_source, imd, &region);
+}
+
+static void image_tile_source_close(ImageWindow *imd)
+{
+	image_tile_source_read_cancel(imd->tile_source, imd, nullptr);
+	image_tile_source_unref(imd->tile_source);
+	imd->tile_source = nullptr;
+}
+
+/* the renderer tiles of source are taken over by imd, and with them the pending reads */
+static void image_tile_source_sync(ImageWindow *imd, ImageWindow *source, gboolean move)
+{
+	image_tile_source_close(imd);
+
+	if (!source->tile_source) return;
+
+	image_tile_source_read_move(source->tile_source, source, imd);
+
+	if (move)
+		{
+		imd->tile_source = source->tile_source;
+		source->tile_source = nullptr;
+		}
+	else
+		{
+		imd->tile_source = image_tile_source_ref(source->tile_source);
+		}
+
+	imd->func_tile_request = source->func_tile_request;
+	imd->func_tile_dispose = source->func_tile_dispose;
+	imd->data_tile = source->data_tile;
+}
+
+/**
+ * @brief Shows an image too large to decode whole as tiles, decoded as they come into view
+ * @param ts Opened by the image loader, see image_loader_set_tile_source_probe()
+ */
+static void image_load_tiles(ImageWindow *imd, ImageTileSource *ts)
+{
+	PixbufRenderer *pr;
+	gint width;
+	gint height;
+
+	image_tile_source_get_size(ts, width, height);
+	DEBUG_1("%s image as tiles: %d x %d", get_exec_time(), width, height);
+
+	image_tile_source_close(imd);
+	imd->tile_source = ts;
+
+	pr = PIXBUF_RENDERER(imd->pr);
+
+	/* tiles are not rotated or color managed */
+	imd->orientation = EXIF_ORIENTATION_TOP_LEFT;
+	color_man_free(static_cast<ColorMan *>(imd->cm));
+	imd->cm = nullptr;
+
+	if (imd->desaturate || imd->overunderexposed)
+		pixbuf_renderer_set_post_process_func(pr, image_post_process_tile_color_cb, imd, FALSE);
+	else
+		pixbuf_renderer_set_post_process_func(pr, nullptr, nullptr, FALSE);
+
+	pixbuf_renderer_set_orientation(pr, imd->orientation);
+
+	image_set_image_as_tiles(imd, width, height,
+				 image_tile_source_get_tile_size(ts), image_tile_source_get_tile_size(ts),
+				 IMAGE_TILE_SOURCE_CACHE, image_tile_source_get_max_level(ts),
+				 image_tile_source_request_cb, image_tile_source_dispose_cb, nullptr,
+				 image_zoom_get(imd));
+
+	image_state_set(imd, IMAGE_STATE_IMAGE);
+}
+
 static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 {
 	DEBUG_1("%s image begin", get_exec_time());
@@ -1074,6 +1472,7 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 	g_object_set(G_OBJECT(imd->pr), "loading", TRUE, NULL);
 
 	imd->il = image_loader_new(fd);
+	image_loader_set_tile_source_probe(imd->il, TRUE);
 
 	image_load_set_signals(imd, FALSE);
 
@@ -1113,6 +1512,8 @@ static void image_reset(ImageWindow *imd)
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
+	image_tile_source_close(imd);
+
 	color_man_free(static_cast<ColorMan *>(imd->cm));
 	imd->cm = nullptr;
 
@@ -1594,6 +1995,10 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 
 	imd->user_stereo = source->user_stereo;
 
+	image_tile_source_sync(imd, source, TRUE);
+
+	/* the tiles are requested from imd from now on */
+	if (imd->tile_source) PIXBUF_RENDERER(source->pr)->func_tile_data = imd;
 	pixbuf_renderer_move(PIXBUF_RENDERER(imd->pr), PIXBUF_RENDERER(source->pr));
 
 	if (imd->cm || imd->desaturate || imd->overunderexposed)
@@ -1647,6 +2052,10 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->read_ahead_fd = source->read_ahead_fd;
 	source->read_ahead_fd = nullptr;
 
+	/* the read ahead window is cheap to rebuild on the next navigation */
+	image_read_ahead_window_cancel(imd);
+	image_read_ahead_window_cancel(source);
+
 	imd->completed = source->completed;
 	imd->state = source->state;
 	source->state = IMAGE_STATE_NONE;
@@ -1656,7 +2065,10 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 
 	imd->user_stereo = source->user_stereo;
 
+	image_tile_source_sync(imd, source, FALSE);
+
 	pixbuf_renderer_copy(PIXBUF_RENDERER(imd->pr), PIXBUF_RENDERER(source->pr));
+	if (imd->tile_source) PIXBUF_RENDERER(imd->pr)->func_tile_data = imd;
 
 	if (imd->cm || imd->desaturate || imd->overunderexposed)
 		pixbuf_renderer_set_post_process_func(PIXBUF_RENDERER(imd->pr), image_post_process_tile_color_cb, imd, (imd->cm != nullptr) );
@@ -1836,13 +2248,8 @@ void image_stereo_pixbuf_set(ImageWindow *imd, StereoPixbufData stereo_mode)
 	image_reload(imd);
 }
 
-/**
- * @brief Read ahead, pass NULL to cancel
- */
-void image_prebuffer_set(ImageWindow *imd, FileData *fd)
+static void image_prebuffer_set_real(ImageWindow *imd, FileData *fd)
 {
-	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr))) return;
-
 	if (fd)
 		{
 		if (!file_cache_get(image_get_cache(), fd))
@@ -1853,9 +2260,38 @@ void image_prebuffer_set(ImageWindow *imd, FileData *fd)
 	else
 		{
 		image_read_ahead_cancel(imd);
+		image_read_ahead_window_cancel(imd);
 		}
 }
 
+/**
+ * @brief Read ahead, pass NULL to cancel
+ */
+void image_prebuffer_set(ImageWindow *imd, FileData *fd)
+{
+	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr))) return;
+
+	image_read_ahead_window_clear(imd);
+	image_prebuffer_set_real(imd, fd);
+}
+
+/**
+ * @brief Read ahead a list of images, in order of priority.
+ *
+ * The first image is handled as by image_prebuffer_set(), the others are
+ * decoded into the image cache while the memory budget allows.
+ * Pass NULL to cancel.
+ */
+void image_prebuffer_set_list(ImageWindow *imd, GList *list)
+{
+	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr))) return;
+
+	/* drop the old window first, so that the read ahead does not continue it */
+	image_read_ahead_window_clear(imd);
+	image_prebuffer_set_real(imd, list ? static_cast<FileData *>(list->data) : nullptr);
+	if (list) image_read_ahead_window_set(imd, list->next);
+}
+
 static void image_notify_cb(FileData *fd, NotifyType type, gpointer data)
 {
 	auto imd = static_cast<ImageWindow *>(data);
@@ -2120,6 +2556,7 @@ static void image_free(ImageWindow *imd)
 	image_reset(imd);
 
 	image_read_ahead_cancel(imd);
+	image_read_ahead_window_cancel(imd);
 
 	file_data_unref(imd->image_fd);
 	g_free(imd->title);
@@ -2245,6 +2682,8 @@ ImageWindow *image_new(gboolean frame)
 			 G_CALLBACK(image_render_complete_cb), imd);
 	g_signal_connect(G_OBJECT(imd->pr), "drag",
 			 G_CALLBACK(image_drag_cb), imd);
+	g_signal_connect(G_OBJECT(imd->pr), "notify::scale-factor",
+			 G_CALLBACK(image_scale_factor_cb), imd);
 
 	file_data_register_notify_func(image_notify_cb, imd, NOTIFY_PRIORITY_LOW);
 
@@ -33,6 +33,7 @@ struct CollectInfo;
 struct CollectionData;
 class FileData;
 struct ImageLoader;
+struct ImageTileSource;
 
 enum RectangleDrawAspectRatio
 {
@@ -66,6 +67,7 @@ struct ImageWindow
 
 	ImageLoader *il;        /**< @FIXME image loader should probably go to FileData, but it must first support
 				   sending callbacks to multiple ImageWindows in parallel */
+	ImageTileSource *tile_source;	/**< instead of il, for images too large to load whole */
 
 	gint has_frame;  /**< not boolean, see image_new() */
 
@@ -128,6 +130,14 @@ struct ImageWindow
 
 	FileData *read_ahead_fd;
 	ImageLoader *read_ahead_il;
+	ImageTileSource *read_ahead_tile_source;	/**< instead of a pixbuf, if read_ahead_fd is shown as tiles */
+
+	/* further images to decode into the image cache, see image_prebuffer_set_list() */
+	GList *read_ahead_window;
+	FileData *read_ahead_window_fd;
+	ImageLoader *read_ahead_window_il;
+	gulong read_ahead_window_size;	/**< bytes decoded for the current window */
+	gulong read_ahead_window_last;	/**< size of the last decoded image, used as estimate */
 
 	gint prev_color_row;
 
@@ -224,6 +234,7 @@ StereoPixbufData image_stereo_pixbuf_get(ImageWindow *imd);
 void image_stereo_pixbuf_set(ImageWindow *imd, StereoPixbufData stereo_mode);
 
 void image_prebuffer_set(ImageWindow *imd, FileData *fd);
+void image_prebuffer_set_list(ImageWindow *imd, GList *list);
 
 void image_auto_refresh_enable(ImageWindow *imd, gboolean enable);
 
@@ -247,7 +258,7 @@ void image_to_root_window(ImageWindow *imd, gboolean scaled);
 
 
 void image_set_image_as_tiles(ImageWindow *imd, gint width, gint height,
-			      gint tile_width, gint tile_height, gint cache_size,
+			      gint tile_width, gint tile_height, gint cache_size, gint max_level,
 			      ImageWindow::TileRequestFunc func_tile_request,
 			      ImageWindow::TileDisposeFunc func_tile_dispose,
 			      gpointer data,
@@ -1394,11 +1394,41 @@ void layout_image_set_with_ahead(LayoutWindow *lw, FileData *fd, FileData *read_
 	if (options->image.enable_read_ahead) image_prebuffer_set(lw->image, read_ahead_fd);
 }
 
+/**
+ * @brief Builds the list of images to read ahead of @a index, in order of priority.
+ * @param step 1 when navigating forwards, -1 when navigating backwards
+ *
+ * The first entry is @a read_ahead_fd, followed by the further images in the
+ * direction of navigation and then those behind the current image.
+ */
+static GList *layout_image_read_ahead_list(LayoutWindow *lw, gint index, gint step, FileData *read_ahead_fd)
+{
+	GList *list = nullptr;
+
+	const auto add = [&list](FileData *fd)
+	{
+		if (fd && !g_list_find(list, fd)) list = g_list_prepend(list, fd);
+	};
+
+	add(read_ahead_fd);
+	for (gint i = 1; i <= options->image.read_ahead_forward; i++)
+		{
+		add(layout_list_get_fd(lw, index + step * i));
+		}
+	for (gint i = 1; i <= options->image.read_ahead_backward; i++)
+		{
+		add(layout_list_get_fd(lw, index - step * i));
+		}
+
+	return g_list_reverse(list);
+}
+
 void layout_image_set_index(LayoutWindow *lw, gint index)
 {
 	FileData *fd;
 	FileData *read_ahead_fd;
 	gint old;
+	gboolean read_ahead_window = TRUE;
 
 	if (!layout_valid(&lw)) return;
 
@@ -1446,13 +1476,26 @@ void layout_image_set_index(LayoutWindow *lw, gint index)
 				}
 
 			read_ahead_fd = layout_list_get_fd(lw, newindex);
+			read_ahead_window = FALSE;
 			}
 
 		while (x)
 			x = g_list_remove(x, x->data);
 		}
 
-	layout_image_set_with_ahead(lw, fd, read_ahead_fd);
+	if (!read_ahead_window || !options->image.enable_read_ahead)
+		{
+		layout_image_set_with_ahead(lw, fd, read_ahead_fd);
+		return;
+		}
+
+	if (!layout_valid(&lw)) return;
+
+	layout_image_set_fd(lw, fd);
+
+	GList *read_ahead_list = layout_image_read_ahead_list(lw, index, (old > index) ? -1 : 1, read_ahead_fd);
+	image_prebuffer_set_list(lw->image, read_ahead_list);
+	g_list_free(read_ahead_list);
 }
 
 static void layout_image_set_collection_real(LayoutWindow *lw, CollectionData *cd, CollectInfo *info, gboolean forward)
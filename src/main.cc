@@ -55,6 +55,7 @@
 #include "third-party/backward.h"
 #endif
 
+#include "cache-exif-index.h"
 #include "cache-maint.h"
 #include "cache.h"
 #include "collect-io.h"
@@ -966,6 +967,7 @@ static void exit_program_final()
 	remote_close(remote_connection);
 
 	collect_manager_flush();
+	exif_index_flush();
 
 	/* Save the named windows */
 	if (layout_window_list && layout_window_list->next)
@@ -32,37 +32,219 @@
 
 #include "md5-util.h"
 
-#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include "typedefs.h"
+#include <cerrno>
+#include <cstring>
 
 namespace
 {
 
 constexpr gsize MD5_SIZE = 16;
 
+/** The read buffer size */
+constexpr gsize MD5_CHUNK_SIZE = 1024 * 1024;
+
+/** Digests remembered by md5_cache_lookup(), the least recently used are dropped */
+constexpr guint MD5_CACHE_SIZE = 16384;
+
+/**
+ * Identifies the contents of a file without reading it. The digest of a
+ * file is reused while none of these change.
+ */
+struct Md5CacheKey
+{
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	glong mtime_nsec;
+};
+
+struct Md5CacheEntry
+{
+	Md5CacheKey key;
+	guchar digest[MD5_SIZE];
+	GList link; /**< in md5_cache_lru */
+};
+
+GMutex md5_cache_mutex;
+GHashTable *md5_cache; /**< #Md5CacheEntry -> itself */
+GQueue md5_cache_lru = G_QUEUE_INIT; /**< #Md5CacheEntry, most recently used first */
+
+guint md5_cache_key_hash(gconstpointer data)
+{
+	auto key = static_cast<const Md5CacheKey *>(data);
+
+	guint64 h = key->ino;
+	h = (h * 31) + key->size;
+	h = (h * 31) + key->mtime;
+	h = (h * 31) + key->mtime_nsec;
+	h = (h * 31) + key->dev;
+
+	return h ^ (h >> 32);
+}
+
+gboolean md5_cache_key_equal(gconstpointer a, gconstpointer b)
+{
+	auto ka = static_cast<const Md5CacheKey *>(a);
+	auto kb = static_cast<const Md5CacheKey *>(b);
+
+	return ka->dev == kb->dev && ka->ino == kb->ino && ka->size == kb->size &&
+	       ka->mtime == kb->mtime && ka->mtime_nsec == kb->mtime_nsec;
+}
+
+void md5_cache_key_from_stat(const struct stat *st, Md5CacheKey &key)
+{
+	memset(&key, 0, sizeof(key));
+	key.dev = st->st_dev;
+	key.ino = st->st_ino;
+	key.size = st->st_size;
+	key.mtime = st->st_mtim.tv_sec;
+	key.mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+void md5_cache_touch(Md5CacheEntry *entry)
+{
+	if (md5_cache_lru.head == &entry->link) return;
+
+	g_queue_unlink(&md5_cache_lru, &entry->link);
+	g_queue_push_head_link(&md5_cache_lru, &entry->link);
+}
+
+gboolean md5_cache_lookup(const Md5CacheKey &key, guchar digest[MD5_SIZE])
+{
+	g_mutex_lock(&md5_cache_mutex);
+
+	auto entry = md5_cache ? static_cast<Md5CacheEntry *>(g_hash_table_lookup(md5_cache, &key)) : nullptr;
+	if (entry)
+		{
+		memcpy(digest, entry->digest, MD5_SIZE);
+		md5_cache_touch(entry);
+		}
+
+	g_mutex_unlock(&md5_cache_mutex);
+
+	return entry != nullptr;
+}
+
+void md5_cache_insert(const Md5CacheKey &key, const guchar digest[MD5_SIZE])
+{
+	g_mutex_lock(&md5_cache_mutex);
+
+	if (!md5_cache)
+		{
+		md5_cache = g_hash_table_new_full(md5_cache_key_hash, md5_cache_key_equal, nullptr, g_free);
+		}
+
+	auto entry = static_cast<Md5CacheEntry *>(g_hash_table_lookup(md5_cache, &key));
+	if (entry)
+		{
+		/* hashed by another thread meanwhile */
+		memcpy(entry->digest, digest, MD5_SIZE);
+		md5_cache_touch(entry);
+		g_mutex_unlock(&md5_cache_mutex);
+		return;
+		}
+
+	entry = g_new0(Md5CacheEntry, 1);
+	entry->key = key;
+	memcpy(entry->digest, digest, MD5_SIZE);
+	entry->link.data = entry;
+
+	g_hash_table_insert(md5_cache, &entry->key, entry);
+	g_queue_push_head_link(&md5_cache_lru, &entry->link);
+
+	while (md5_cache_lru.length > MD5_CACHE_SIZE)
+		{
+		GList *old = g_queue_pop_tail_link(&md5_cache_lru);
+
+		g_hash_table_remove(md5_cache, &static_cast<Md5CacheEntry *>(old->data)->key);
+		}
+
+	g_mutex_unlock(&md5_cache_mutex);
+}
+
+gboolean md5_update_from_fd_read(GChecksum *md5, gint fd)
+{
+	g_autofree guchar *buf = static_cast<guchar *>(g_malloc(MD5_CHUNK_SIZE));
+	gssize nb_bytes_read;
+
+	while (TRUE)
+		{
+		nb_bytes_read = read(fd, buf, MD5_CHUNK_SIZE);
+		if (nb_bytes_read < 0 && errno == EINTR) continue;
+		if (nb_bytes_read <= 0) break;
+
+		g_checksum_update(md5, buf, nb_bytes_read);
+		}
+
+	return nb_bytes_read == 0;
+}
+
 /**
- * md5_update_from_file: get the md5 hash of a file
- * @md5: MD5 checksumming context
+ * md5_digest_from_file: get the md5 digest of a file
  * @path: file name
+ * @digest: 16 bytes buffer receiving the hash code
  * @return: TRUE on success
  *
- * Get the md5 hash of a file.
+ * The file is read in large chunks and the kernel is told it is read
+ * sequentially. It is not mapped: a file truncated by another process
+ * while it is hashed would raise SIGBUS. The digest is remembered by
+ * device, inode, size and modification time, so unchanged files are not
+ * read again. Safe to call from several threads at once.
  **/
-gboolean md5_update_from_file(GChecksum *md5, const gchar *path)
+gboolean md5_digest_from_file(const gchar *path, guchar digest[MD5_SIZE])
 {
-	guchar tmp_buf[1024];
-	gint nb_bytes_read;
+	gint fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return FALSE;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		{
+		close(fd);
+		return FALSE;
+		}
 
-	g_autoptr(FILE) fp = fopen(path, "r");
-	if (!fp) return FALSE;
+	Md5CacheKey key;
+	md5_cache_key_from_stat(&st, key);
 
-	while ((nb_bytes_read = fread(tmp_buf, sizeof (guchar), sizeof(tmp_buf), fp)) > 0)
+	if (S_ISREG(st.st_mode) && md5_cache_lookup(key, digest))
 		{
-		g_checksum_update(md5, tmp_buf, nb_bytes_read);
+		close(fd);
+		return TRUE;
 		}
 
-	return ferror(fp) == 0;
+	g_autoptr(GChecksum) md5 = g_checksum_new(G_CHECKSUM_MD5);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	gboolean success = md5_update_from_fd_read(md5, fd);
+
+	/* a file changed while it was read is hashed again next time */
+	Md5CacheKey key_after;
+	gboolean unchanged = success && fstat(fd, &st) == 0;
+	if (unchanged)
+		{
+		md5_cache_key_from_stat(&st, key_after);
+		unchanged = md5_cache_key_equal(&key, &key_after);
+		}
+
+	close(fd);
+
+	if (!success) return FALSE;
+
+	gsize digest_size = MD5_SIZE;
+	g_checksum_get_digest(md5, digest, &digest_size);
+	if (digest_size != MD5_SIZE) return FALSE;
+
+	if (unchanged && S_ISREG(st.st_mode)) md5_cache_insert(key, digest);
+
+	return TRUE;
 }
 
 } // namespace
@@ -97,16 +279,7 @@ gchar *md5_get_string(const guchar *buffer, gint buffer_size)
  **/
 gboolean md5_get_digest_from_file(const gchar *path, guchar digest[16])
 {
-	g_autoptr(GChecksum) md5 = g_checksum_new(G_CHECKSUM_MD5);
-	if (!md5) return FALSE;
-
-	if (!md5_update_from_file(md5, path)) return FALSE;
-
-	gsize digest_size = MD5_SIZE;
-	g_checksum_get_digest(md5, digest, &digest_size);
-	if (digest_size != MD5_SIZE) return FALSE;
-
-	return TRUE;
+	return md5_digest_from_file(path, digest);
 }
 
 /**
@@ -119,12 +292,11 @@ gboolean md5_get_digest_from_file(const gchar *path, guchar digest[16])
  **/
 gchar *md5_get_string_from_file(const gchar *path)
 {
-	g_autoptr(GChecksum) md5 = g_checksum_new(G_CHECKSUM_MD5);
-	if (!md5) return nullptr;
+	guchar digest[MD5_SIZE];
 
-	if (!md5_update_from_file(md5, path)) return nullptr;
+	if (!md5_digest_from_file(path, digest)) return nullptr;
 
-	return g_strdup(g_checksum_get_string(md5));
+	return md5_digest_to_text(digest);
 }
 
 /**
@@ -21,6 +21,7 @@
 
 #include "metadata.h"
 
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -35,6 +36,7 @@
 
 #include <config.h>
 
+#include "cache-exif-index.h"
 #include "cache.h"
 #include "debug.h"
 #include "exif.h"
@@ -60,11 +62,6 @@ enum MetadataKey {
 	MK_COMMENT
 };
 
-struct MetadataCacheEntry {
-	gchar *key;
-	GList *values;
-};
-
 /* If contents change, keep GuideOptionsMetadata.xml up to date */
 /**
  *  @brief Tags that will be written to all files in a group - selected by: options->metadata.sync_grouped_files, Preferences/Metadata/Write The Same Description Tags To All Grouped Sidecars
@@ -94,20 +91,6 @@ constexpr std::array<const gchar *, 22> group_keys{
 	"Xmp.xmp.Rating",
 };
 
-gint metadata_cache_entry_compare_key(const MetadataCacheEntry *entry, const gchar *key)
-{
-	return strcmp(entry->key, key);
-}
-
-void metadata_cache_entry_free(MetadataCacheEntry *entry)
-{
-	if (!entry) return;
-
-	g_free(entry->key);
-	g_list_free_full(entry->values, g_free);
-	g_free(entry);
-}
-
 void string_list_free(gpointer data)
 {
 	g_list_free_full(static_cast<GList *>(data), g_free);
@@ -136,76 +119,183 @@ static gboolean metadata_file_read(gchar *path, GList **keywords, gchar **commen
  *-------------------------------------------------------------------
  */
 
-/* fd->cached_metadata list of MetadataCacheEntry */
+/*
+ * fd->cached_metadata is a single block: the header, the entries, then the
+ * values of all entries. Keys are quarks and values interned strings, so
+ * they are shared by all files and a file holds only pointers. A file has
+ * a handful of keys at most, finding one is a scan of a few integers.
+ */
 
-static void metadata_cache_update(FileData *fd, const gchar *key, const GList *values)
+struct MetadataCacheEntry
 {
-	GList *work;
+	GQuark key;
+	guint first; /**< index of the first value in MetadataCache::values */
+	guint count;
+};
+
+struct MetadataCache
+{
+	guint n_entries;
+	guint n_values;
+	MetadataCacheEntry *entries; /**< in this block */
+	const gchar **values; /**< in this block */
+};
+
+static gsize metadata_cache_block_size(guint n_entries, guint n_values)
+{
+	return sizeof(MetadataCache) + n_entries * sizeof(MetadataCacheEntry) + n_values * sizeof(const gchar *);
+}
+
+static MetadataCache *metadata_cache_new(guint n_entries, guint n_values)
+{
+	auto cache = static_cast<MetadataCache *>(g_malloc(metadata_cache_block_size(n_entries, n_values)));
+
+	cache->n_entries = n_entries;
+	cache->n_values = n_values;
+	cache->entries = reinterpret_cast<MetadataCacheEntry *>(cache + 1);
+	cache->values = reinterpret_cast<const gchar **>(cache->entries + n_entries);
 
-	work = g_list_find_custom(fd->cached_metadata, key, reinterpret_cast<GCompareFunc>(metadata_cache_entry_compare_key));
-	if (work)
+	return cache;
+}
+
+static const MetadataCacheEntry *metadata_cache_find(const MetadataCache *cache, GQuark key)
+{
+	if (!cache || !key) return nullptr;
+
+	for (guint i = 0; i < cache->n_entries; i++)
 		{
-		/* key found - just replace values */
-		auto *entry = static_cast<MetadataCacheEntry *>(work->data);
+		if (cache->entries[i].key == key) return &cache->entries[i];
+		}
 
-		g_list_free_full(entry->values, g_free);
-		entry->values = string_list_copy(values);
-		DEBUG_1("updated %s %s\n", key, fd->path);
-		return;
+	return nullptr;
+}
+
+/**
+ * @brief Copies \a cache without the key \a except, leaving room for more entries and values
+ */
+static MetadataCache *metadata_cache_copy(const MetadataCache *cache, GQuark except, guint extra_entries, guint extra_values)
+{
+	const MetadataCacheEntry *skip = metadata_cache_find(cache, except);
+	guint n_entries = (cache ? cache->n_entries : 0) - (skip ? 1 : 0);
+	guint n_values = (cache ? cache->n_values : 0) - (skip ? skip->count : 0);
+	MetadataCache *copy = metadata_cache_new(n_entries + extra_entries, n_values + extra_values);
+
+	copy->n_entries = 0;
+	copy->n_values = 0;
+
+	for (guint i = 0; cache && i < cache->n_entries; i++)
+		{
+		const MetadataCacheEntry *entry = &cache->entries[i];
+
+		if (entry == skip) continue;
+
+		MetadataCacheEntry *dest = &copy->entries[copy->n_entries++];
+		dest->key = entry->key;
+		dest->first = copy->n_values;
+		dest->count = entry->count;
+
+		for (guint n = 0; n < entry->count; n++)
+			{
+			copy->values[copy->n_values++] = cache->values[entry->first + n];
+			}
 		}
 
-	/* key not found - prepend new entry */
-	auto *entry = g_new0(MetadataCacheEntry, 1);
-	entry->key = g_strdup(key);
-	entry->values = string_list_copy(values);
+	return copy;
+}
+
+static void metadata_cache_update(FileData *fd, const gchar *key, const GList *values)
+{
+	GQuark quark = g_quark_from_string(key);
+	guint count = g_list_length(const_cast<GList *>(values));
+	MetadataCache *cache = metadata_cache_copy(fd->cached_metadata, quark, 1, count);
 
-	fd->cached_metadata = g_list_prepend(fd->cached_metadata, entry);
-	DEBUG_1("added %s %s\n", key, fd->path);
+	MetadataCacheEntry *entry = &cache->entries[cache->n_entries++];
+	entry->key = quark;
+	entry->first = cache->n_values;
+	entry->count = count;
+
+	for (const GList *work = values; work; work = work->next)
+		{
+		cache->values[cache->n_values++] = g_intern_string(static_cast<const gchar *>(work->data));
+		}
+
+	g_free(fd->cached_metadata);
+	fd->cached_metadata = cache;
+	DEBUG_1("updated %s %s\n", key, fd->path);
 }
 
-static const GList *metadata_cache_get(FileData *fd, const gchar *key)
+/**
+ * @returns TRUE if \a key is cached, \a values is then set to a copy of the values
+ */
+static gboolean metadata_cache_get(FileData *fd, const gchar *key, GList **values)
 {
-	GList *work;
+	const MetadataCacheEntry *entry = metadata_cache_find(fd->cached_metadata, g_quark_try_string(key));
 
-	work = g_list_find_custom(fd->cached_metadata, key, reinterpret_cast<GCompareFunc>(metadata_cache_entry_compare_key));
-	if (work)
+	if (!entry)
 		{
-		/* key found */
-		auto *entry = static_cast<MetadataCacheEntry *>(work->data);
+		DEBUG_1("not found %s %s\n", key, fd->path);
+		return FALSE;
+		}
 
-		DEBUG_1("found %s %s\n", key, fd->path);
-		return entry->values;
+	*values = nullptr;
+	for (guint n = entry->count; n > 0; n--)
+		{
+		*values = g_list_prepend(*values, g_strdup(fd->cached_metadata->values[entry->first + n - 1]));
 		}
-	DEBUG_1("not found %s %s\n", key, fd->path);
-	return nullptr;
+
+	DEBUG_1("found %s %s\n", key, fd->path);
+	return TRUE;
 }
 
 static void metadata_cache_remove(FileData *fd, const gchar *key)
 {
-	GList *work;
+	GQuark quark = g_quark_try_string(key);
 
-	work = g_list_find_custom(fd->cached_metadata, key, reinterpret_cast<GCompareFunc>(metadata_cache_entry_compare_key));
-	if (work)
+	if (!metadata_cache_find(fd->cached_metadata, quark))
 		{
-		/* key found */
-		auto *entry = static_cast<MetadataCacheEntry *>(work->data);
-
-		metadata_cache_entry_free(entry);
-		fd->cached_metadata = g_list_delete_link(fd->cached_metadata, work);
-		DEBUG_1("removed %s %s\n", key, fd->path);
+		DEBUG_1("not removed %s %s\n", key, fd->path);
 		return;
 		}
-	DEBUG_1("not removed %s %s\n", key, fd->path);
+
+	MetadataCache *cache = nullptr;
+	if (fd->cached_metadata->n_entries > 1) cache = metadata_cache_copy(fd->cached_metadata, quark, 0, 0);
+
+	g_free(fd->cached_metadata);
+	fd->cached_metadata = cache;
+	DEBUG_1("removed %s %s\n", key, fd->path);
 }
 
 void metadata_cache_free(FileData *fd)
 {
 	if (fd->cached_metadata) DEBUG_1("freed %s\n", fd->path);
 
-	g_list_free_full(fd->cached_metadata, reinterpret_cast<GDestroyNotify>(metadata_cache_entry_free));
+	g_free(fd->cached_metadata);
 	fd->cached_metadata = nullptr;
 }
 
+/**
+ * @brief The memory used by the metadata cache of the files in \a list
+ *
+ * The interned keys and values are shared by all files and not included.
+ */
+gsize metadata_cache_size(const GList *list)
+{
+	gsize size = 0;
+
+	for (const GList *work = list; work; work = work->next)
+		{
+		auto fd = static_cast<const FileData *>(work->data);
+
+		if (fd->cached_metadata)
+			{
+			size += metadata_cache_block_size(fd->cached_metadata->n_entries, fd->cached_metadata->n_values);
+			}
+		if (fd->sidecar_files) size += metadata_cache_size(fd->sidecar_files);
+		}
+
+	return size;
+}
+
 
 /*
  *-------------------------------------------------------------------
@@ -215,6 +305,7 @@ void metadata_cache_free(FileData *fd)
 
 static GList *metadata_write_queue = nullptr;
 static guint metadata_write_idle_id = 0; /* event source id */
+static GHashTable *metadata_write_in_progress = nullptr; /**< FileData -> edited while written, for metadata_write_perform_async() */
 
 static void metadata_write_queue_add(FileData *fd)
 {
@@ -334,6 +425,7 @@ gboolean metadata_write_perform(FileData *fd)
 
 	success = (fd->change->dest) ? exif_write_sidecar(exif, fd->change->dest) : exif_write(exif); /* write modified metadata */
 	exif_free_fd(fd, exif);
+	exif_index_forget(fd);
 
 	if (fd->change->dest)
 		/* this will create a FileData for the sidecar and link it to the main file
@@ -350,6 +442,172 @@ gboolean metadata_write_perform(FileData *fd)
 	return success;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * writing in the background
+ *-------------------------------------------------------------------
+ */
+
+struct MetadataWriteJob
+{
+	FileData *fd;
+	gchar *path;
+	gchar *sidecar_path;
+	gchar *dest;
+	GHashTable *modified_xmp; /**< copy of fd->modified_xmp */
+
+	gboolean success;
+
+	MetadataWriteDoneFunc done_func;
+	gpointer done_data;
+};
+
+static GHashTable *metadata_modified_xmp_copy(GHashTable *modified_xmp)
+{
+	GHashTable *copy = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, string_list_free);
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	if (!modified_xmp) return copy;
+
+	g_hash_table_iter_init(&iter, modified_xmp);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+		g_hash_table_insert(copy, g_strdup(static_cast<gchar *>(key)), string_list_copy(static_cast<GList *>(value)));
+		}
+
+	return copy;
+}
+
+/* the writes of a batch are synced by the workers, so the waits overlap */
+static void metadata_write_sync(const gchar *path)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	gint fd = open(pathl, O_RDONLY);
+
+	if (fd < 0) return;
+
+	if (fsync(fd) != 0) log_printf("Unable to sync %s\n", path);
+	close(fd);
+}
+
+static gboolean metadata_write_done_cb(gpointer data)
+{
+	auto job = static_cast<MetadataWriteJob *>(data);
+	FileData *fd = job->fd;
+	GHashTable *edited = nullptr;
+
+	if (job->dest)
+		/* as in metadata_write_perform() */
+		file_data_unref(file_data_new_group(job->dest));
+
+	if (job->success) metadata_legacy_delete(fd, job->dest);
+	exif_index_forget(fd);
+
+	/* changes made while the file was written must not be discarded with the queue entry */
+	if (GPOINTER_TO_INT(g_hash_table_lookup(metadata_write_in_progress, fd)) && fd->modified_xmp)
+		{
+		edited = metadata_modified_xmp_copy(fd->modified_xmp);
+		}
+	g_hash_table_remove(metadata_write_in_progress, fd);
+
+	job->done_func(fd, job->success, job->done_data);
+
+	if (edited)
+		{
+		GHashTableIter iter;
+		gpointer key;
+		gpointer value;
+
+		g_hash_table_iter_init(&iter, edited);
+		while (g_hash_table_iter_next(&iter, &key, &value))
+			{
+			metadata_write_list(fd, static_cast<gchar *>(key), static_cast<GList *>(value));
+			}
+		g_hash_table_destroy(edited);
+		}
+
+	file_data_unref(fd);
+	g_hash_table_destroy(job->modified_xmp);
+	g_free(job->path);
+	g_free(job->sidecar_path);
+	g_free(job->dest);
+	g_free(job);
+
+	layout_util_status_update_write_all();
+
+	return G_SOURCE_REMOVE;
+}
+
+static void metadata_write_thread_func(gpointer data, gpointer)
+{
+	auto job = static_cast<MetadataWriteJob *>(data);
+	ExifData *exif;
+
+	exif = exif_read(job->path, job->sidecar_path, job->modified_xmp);
+	if (exif)
+		{
+		job->success = (job->dest) ? exif_write_sidecar(exif, job->dest) : exif_write(exif);
+		exif_free(exif);
+		}
+
+	if (job->success) metadata_write_sync(job->dest ? job->dest : job->path);
+
+	g_idle_add(metadata_write_done_cb, job);
+}
+
+static GThreadPool *metadata_write_thread_pool()
+{
+	static GThreadPool *pool = g_thread_pool_new(metadata_write_thread_func, nullptr, MAX(get_cpu_cores() / 2, 1), FALSE, nullptr);
+
+	return pool;
+}
+
+/**
+ * @brief Writes the changed metadata of \a fd like metadata_write_perform(), without blocking
+ * @param done_func Called on the main thread when the file is written
+ *
+ * The metadata are written through Exiv2 by a pool of worker threads, from
+ * a copy of the changes made so far. Changes made while the file is written
+ * stay in the write queue. Writing legacy metadata files is quick and done
+ * before returning.
+ */
+void metadata_write_perform_async(FileData *fd, MetadataWriteDoneFunc done_func, gpointer done_data)
+{
+	guint lf;
+
+	g_assert(fd->change);
+
+	lf = strlen(GQ_CACHE_EXT_METADATA);
+	if (!fd->change->dest ||
+	    g_ascii_strncasecmp(fd->change->dest + strlen(fd->change->dest) - lf, GQ_CACHE_EXT_METADATA, lf) != 0)
+		{
+		auto job = g_new0(MetadataWriteJob, 1);
+
+		job->fd = file_data_ref(fd);
+		job->path = g_strdup(fd->path);
+		job->dest = g_strdup(fd->change->dest);
+		job->modified_xmp = metadata_modified_xmp_copy(fd->modified_xmp);
+		job->done_func = done_func;
+		job->done_data = done_data;
+
+		/* as in exif_read_fd() */
+#if HAVE_EXIV2
+		job->sidecar_path = cache_find_location(CACHE_TYPE_XMP_METADATA, fd->path);
+		if (!job->sidecar_path) job->sidecar_path = file_data_get_sidecar_path(fd, TRUE);
+#endif
+
+		if (!metadata_write_in_progress) metadata_write_in_progress = g_hash_table_new(g_direct_hash, g_direct_equal);
+		g_hash_table_insert(metadata_write_in_progress, fd, GINT_TO_POINTER(FALSE));
+
+		g_thread_pool_push(metadata_write_thread_pool(), job, nullptr);
+		return;
+		}
+
+	done_func(fd, metadata_write_perform(fd), done_data);
+}
+
 gint metadata_queue_length()
 {
 	return g_list_length(metadata_write_queue);
@@ -382,6 +640,11 @@ gboolean metadata_write_list(FileData *fd, const gchar *key, const GList *values
 		}
 	g_hash_table_insert(fd->modified_xmp, g_strdup(key), string_list_copy(const_cast<GList *>(values)));
 
+	if (metadata_write_in_progress && g_hash_table_contains(metadata_write_in_progress, fd))
+		{
+		g_hash_table_insert(metadata_write_in_progress, fd, GINT_TO_POINTER(TRUE));
+		}
+
 	metadata_cache_remove(fd, key);
 
 	if (fd->exif)
@@ -667,7 +930,6 @@ GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format)
 {
 	ExifData *exif;
 	GList *list = nullptr;
-	const GList *cache_values;
 	if (!fd) return nullptr;
 
 	/* unwritten data override everything */
@@ -679,9 +941,9 @@ GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format)
 
 
 	if (format == METADATA_PLAIN && strcmp(key, KEYWORD_KEY) == 0
-	    && (cache_values = metadata_cache_get(fd, key)))
+	    && metadata_cache_get(fd, key, &list))
 		{
-		return string_list_copy(cache_values);
+		return list;
 		}
 
 	/*
@@ -718,10 +980,15 @@ GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format)
 		}
 #endif
 
-	exif = exif_read_fd(fd); /* this is cached, thus inexpensive */
-	if (!exif) return nullptr;
-	list = exif_get_metadata(exif, key, format);
-	exif_free_fd(fd, exif);
+	/* the index spares reading the file for the frequently used keys */
+	if (!exif_index_lookup(fd, key, format, &list))
+		{
+		exif = exif_read_fd(fd); /* this is cached, thus inexpensive */
+		if (!exif) return nullptr;
+		exif_index_update(fd, exif);
+		list = exif_get_metadata(exif, key, format);
+		exif_free_fd(fd, exif);
+		}
 
 	if (format == METADATA_PLAIN && strcmp(key, KEYWORD_KEY) == 0)
 		{
@@ -744,6 +1011,62 @@ gchar *metadata_read_string(FileData *fd, const gchar *key, MetadataFormat forma
 	return nullptr;
 }
 
+/**
+ * @brief Reads plain values of the image metadata from a worker thread
+ * @param file The file, from exif_index_file_init() on the main thread
+ * @param sidecar_path The sidecar of the file, from file_data_get_sidecar_path()
+ * @param keys nullptr terminated, must not include the keys of the legacy metadata files
+ * @param values Set to the first value of each key, or nullptr
+ * @returns FALSE if the metadata could not be read
+ *
+ * Unlike metadata_read_string() this does not use the caches of the main
+ * thread, the metadata index is used and updated. Unsaved changes are not
+ * seen, the caller must read files with pending changes on the main thread.
+ */
+gboolean metadata_read_strings_thread(const ExifIndexFile &file, const gchar *sidecar_path, const gchar *const *keys, gchar **values)
+{
+	ExifData *exif = nullptr;
+	gboolean ret = TRUE;
+
+	for (gint i = 0; keys[i]; i++) values[i] = nullptr;
+
+	for (gint i = 0; keys[i]; i++)
+		{
+		GList *list = nullptr;
+
+		if (!exif_index_lookup_file(file, keys[i], METADATA_PLAIN, &list))
+			{
+			if (!exif)
+				{
+				g_autofree gchar *xmp_path = nullptr;
+#if HAVE_EXIV2
+				xmp_path = cache_find_location(CACHE_TYPE_XMP_METADATA, file.path);
+#endif
+				exif = exif_read(file.path, xmp_path ? xmp_path : const_cast<gchar *>(sidecar_path), nullptr);
+				if (!exif)
+					{
+					ret = FALSE;
+					break;
+					}
+				exif_index_update_file(file, exif);
+				}
+
+			list = exif_get_metadata(exif, keys[i], METADATA_PLAIN);
+			}
+
+		if (list)
+			{
+			values[i] = static_cast<gchar *>(list->data);
+			list->data = nullptr;
+			g_list_free_full(list, g_free);
+			}
+		}
+
+	if (exif) exif_free(exif);
+
+	return ret;
+}
+
 guint64 metadata_read_int(FileData *fd, const gchar *key, guint64 fallback)
 {
 	guint64 ret;
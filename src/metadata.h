@@ -27,6 +27,7 @@
 
 #include "typedefs.h"
 
+struct ExifIndexFile;
 class FileData;
 
 #define COMMENT_KEY "Xmp.dc.description"
@@ -35,9 +36,12 @@ class FileData;
 #define RATING_KEY "Xmp.xmp.Rating"
 
 void metadata_cache_free(FileData *fd);
+gsize metadata_cache_size(const GList *list);
 
 gboolean metadata_write_queue_remove(FileData *fd);
 gboolean metadata_write_perform(FileData *fd);
+using MetadataWriteDoneFunc = void (*)(FileData *fd, gboolean success, gpointer data);
+void metadata_write_perform_async(FileData *fd, MetadataWriteDoneFunc done_func, gpointer done_data);
 gboolean metadata_write_queue_confirm(gboolean force_dialog, FileUtilDoneFunc done_func, gpointer done_data);
 void metadata_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
@@ -50,6 +54,7 @@ gboolean metadata_write_int(FileData *fd, const gchar *key, guint64 value);
 
 GList *metadata_read_list(FileData *fd, const gchar *key, MetadataFormat format);
 gchar *metadata_read_string(FileData *fd, const gchar *key, MetadataFormat format);
+gboolean metadata_read_strings_thread(const ExifIndexFile &file, const gchar *sidecar_path, const gchar *const *keys, gchar **values);
 guint64 metadata_read_int(FileData *fd, const gchar *key, guint64 fallback);
 gdouble metadata_read_GPS_coord(FileData *fd, const gchar *key, gdouble fallback);
 gdouble metadata_read_GPS_direction(FileData *fd, const gchar *key, gdouble fallback);
@@ -123,6 +123,9 @@ ConfOptions *init_options(ConfOptions *options)
 	options->image.alpha_color_2.green = static_cast<gdouble>(0x006666) / 65535;
 	options->image.alpha_color_2.blue = static_cast<gdouble>(0x006666) / 65535;
 	options->image.enable_read_ahead = TRUE;
+	options->image.read_ahead_forward = 2;
+	options->image.read_ahead_backward = 1;
+	options->image.read_ahead_max = 96;
 	options->image.exif_rotate_enable = TRUE;
 	options->image.fit_window_to_image = FALSE;
 	options->image.limit_autofit_size = FALSE;
@@ -238,6 +241,7 @@ ConfOptions *init_options(ConfOptions *options)
 	options->printer.page_text_position = HEADER_1;
 
 	options->threads.duplicates = get_cpu_cores() - 1;
+	options->threads.image_render = get_cpu_cores();
 
 	options->disabled_plugins = nullptr;
 
@@ -182,6 +182,9 @@ struct ConfOptions
 		gint tile_cache_max;	/**< in megabytes */
 		gint image_cache_max;   /**< in megabytes */
 		gboolean enable_read_ahead;
+		gint read_ahead_forward;	/**< images to decode ahead in the direction of navigation */
+		gint read_ahead_backward;	/**< images to decode behind the current one */
+		gint read_ahead_max;	/**< in megabytes, limit for the decoded images read ahead */
 
 		ZoomMode zoom_mode;
 		gboolean zoom_2pass;
@@ -398,6 +401,7 @@ struct ConfOptions
 	/* Threads */
 	struct {
 		gint duplicates;
+		gint image_render;
 	} threads;
 
 	/* Selectable bars */
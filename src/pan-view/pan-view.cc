@@ -1128,7 +1128,7 @@ static gint pan_layout_update_idle_cb(gpointer data)
 		pan_grid_build(pw, width, height, 1000);
 
 		pixbuf_renderer_set_tiles(PIXBUF_RENDERER(pw->imd->pr), width, height,
-					  PAN_TILE_SIZE, PAN_TILE_SIZE, 10,
+					  PAN_TILE_SIZE, PAN_TILE_SIZE, 10, 0,
 					  pan_window_request_tile_cb,
 					  pan_window_dispose_tile_cb, pw, 1.0);
 
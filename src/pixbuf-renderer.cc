@@ -430,6 +430,7 @@ static void pixbuf_renderer_init(PixbufRenderer *pr)
 
 	pr->source_tiles_enabled = FALSE;
 	pr->source_tiles = nullptr;
+	pr->source_tiles_max_level = 0;
 
 	pr->orientation = 1;
 
@@ -914,12 +915,38 @@ static void pr_source_tile_unset(PixbufRenderer *pr)
 	pr->source_tiles_enabled = FALSE;
 }
 
+/**
+ * @brief The image area covered by \a st
+ */
+void pr_source_tile_extent(const PixbufRenderer *pr, const SourceTile *st, gint &width, gint &height)
+{
+	width = pr->source_tile_width << st->level;
+	height = pr->source_tile_height << st->level;
+}
+
+/**
+ * @brief The level source tiles are requested at for the current scale
+ *
+ * The highest level whose tiles still have at least one pixel per
+ * screen pixel.
+ */
+static gint pr_source_tile_level(PixbufRenderer *pr)
+{
+	gint level = 0;
+
+	while (level < pr->source_tiles_max_level && pr->scale * (2 << level) <= 1.0) level++;
+
+	return level;
+}
+
 static gboolean pr_source_tile_visible(PixbufRenderer *pr, SourceTile *st)
 {
 	gint x1;
 	gint y1;
 	gint x2;
 	gint y2;
+	gint w;
+	gint h;
 
 	if (!st) return FALSE;
 
@@ -928,13 +955,15 @@ static gboolean pr_source_tile_visible(PixbufRenderer *pr, SourceTile *st)
 	x2 = pr->x_scroll + pr->vis_width;
 	y2 = pr->y_scroll + pr->vis_height;
 
+	pr_source_tile_extent(pr, st, w, h);
+
 	return static_cast<gdouble>(st->x) * pr->scale <= static_cast<gdouble>(x2) &&
-		 static_cast<gdouble>(st->x + pr->source_tile_width) * pr->scale >= static_cast<gdouble>(x1) &&
+		 static_cast<gdouble>(st->x + w) * pr->scale >= static_cast<gdouble>(x1) &&
 		 static_cast<gdouble>(st->y) * pr->scale <= static_cast<gdouble>(y2) &&
-		 static_cast<gdouble>(st->y + pr->source_tile_height) * pr->scale >= static_cast<gdouble>(y1);
+		 static_cast<gdouble>(st->y + h) * pr->scale >= static_cast<gdouble>(y1);
 }
 
-static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
+static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y, gint level)
 {
 	SourceTile *st = nullptr;
 	gint count;
@@ -956,14 +985,17 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 			needle = static_cast<SourceTile *>(work->data);
 			work = work->prev;
 
-			if (!pr_source_tile_visible(pr, needle))
+			if (!pr_source_tile_visible(pr, needle) || needle->level != level)
 				{
 				pr->source_tiles = g_list_remove(pr->source_tiles, needle);
 
 				if (pr->func_tile_dispose)
 					{
-					pr->func_tile_dispose(pr, needle->x, needle->y,
-							      pr->source_tile_width, pr->source_tile_height,
+					gint w;
+					gint h;
+
+					pr_source_tile_extent(pr, needle, w, h);
+					pr->func_tile_dispose(pr, needle->x, needle->y, w, h,
 							      needle->pixbuf, pr->func_tile_data);
 					}
 
@@ -988,8 +1020,9 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 					    pr->source_tile_width, pr->source_tile_height);
 		}
 
-	st->x = ROUND_DOWN(x, pr->source_tile_width);
-	st->y = ROUND_DOWN(y, pr->source_tile_height);
+	st->level = level;
+	st->x = ROUND_DOWN(x, pr->source_tile_width << level);
+	st->y = ROUND_DOWN(y, pr->source_tile_height << level);
 	st->blank = TRUE;
 
 	pr->source_tiles = g_list_prepend(pr->source_tiles, st);
@@ -997,21 +1030,24 @@ static SourceTile *pr_source_tile_new(PixbufRenderer *pr, gint x, gint y)
 	return st;
 }
 
-static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y)
+static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y, gint level)
 {
 	SourceTile *st;
+	gint w;
+	gint h;
 
-	st = pr_source_tile_new(pr, x, y);
+	st = pr_source_tile_new(pr, x, y, level);
 	if (!st) return nullptr;
 
+	pr_source_tile_extent(pr, st, w, h);
+
 	if (pr->func_tile_request &&
-	    pr->func_tile_request(pr, st->x, st->y,
-				   pr->source_tile_width, pr->source_tile_height, st->pixbuf, pr->func_tile_data))
+	    pr->func_tile_request(pr, st->x, st->y, w, h, st->pixbuf, pr->func_tile_data))
 		{
 		st->blank = FALSE;
 		}
 
-	GdkRectangle rect{st->x, st->y, pr->source_tile_width, pr->source_tile_height};
+	GdkRectangle rect{st->x, st->y, w, h};
 	pr_scale_region(rect, pr->scale);
 
 	pr->renderer->invalidate_region(pr->renderer, rect);
@@ -1019,17 +1055,20 @@ static SourceTile *pr_source_tile_request(PixbufRenderer *pr, gint x, gint y)
 	return st;
 }
 
-static SourceTile *pr_source_tile_find(PixbufRenderer *pr, gint x, gint y)
+static SourceTile *pr_source_tile_find(PixbufRenderer *pr, gint x, gint y, gint level)
 {
 	GList *work;
+	const gint w = pr->source_tile_width << level;
+	const gint h = pr->source_tile_height << level;
 
 	work = pr->source_tiles;
 	while (work)
 		{
 		auto st = static_cast<SourceTile *>(work->data);
 
-		if (x >= st->x && x < st->x + pr->source_tile_width &&
-		    y >= st->y && y < st->y + pr->source_tile_height)
+		if (st->level == level &&
+		    x >= st->x && x < st->x + w &&
+		    y >= st->y && y < st->y + h)
 			{
 			if (work != pr->source_tiles)
 				{
@@ -1052,23 +1091,26 @@ GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w,
 	GList *list = nullptr;
 	gint sx;
 	gint sy;
+	const gint level = pr_source_tile_level(pr);
+	const gint tile_w = pr->source_tile_width << level;
+	const gint tile_h = pr->source_tile_height << level;
 
 	if (x < 0) x = 0;
 	if (y < 0) y = 0;
 	if (w > pr->image_width) w = pr->image_width;
 	if (h > pr->image_height) h = pr->image_height;
 
-	sx = ROUND_DOWN(x, pr->source_tile_width);
-	sy = ROUND_DOWN(y, pr->source_tile_height);
+	sx = ROUND_DOWN(x, tile_w);
+	sy = ROUND_DOWN(y, tile_h);
 
-	for (x1 = sx; x1 < x + w; x1+= pr->source_tile_width)
+	for (x1 = sx; x1 < x + w; x1+= tile_w)
 		{
-		for (y1 = sy; y1 < y + h; y1 += pr->source_tile_height)
+		for (y1 = sy; y1 < y + h; y1 += tile_h)
 			{
 			SourceTile *st;
 
-			st = pr_source_tile_find(pr, x1, y1);
-			if (!st && request) st = pr_source_tile_request(pr, x1, y1);
+			st = pr_source_tile_find(pr, x1, y1, level);
+			if (!st && request) st = pr_source_tile_request(pr, x1, y1, level);
 
 			if (st) list = g_list_prepend(list, st);
 			}
@@ -1082,7 +1124,7 @@ static void pr_source_tile_changed(PixbufRenderer *pr, gint x, gint y, gint widt
 	if (width < 1 || height < 1) return;
 
 	const GdkRectangle request_rect{x, y, width, height};
-	GdkRectangle st_rect{0, 0, pr->source_tile_width, pr->source_tile_height};
+	GdkRectangle st_rect;
 	GdkRectangle r;
 
 	for (GList *work = pr->source_tiles; work; work = work->next)
@@ -1091,6 +1133,23 @@ static void pr_source_tile_changed(PixbufRenderer *pr, gint x, gint y, gint widt
 
 		st_rect.x = st->x;
 		st_rect.y = st->y;
+		pr_source_tile_extent(pr, st, st_rect.width, st_rect.height);
+
+		if (st->level > 0)
+			{
+			/* a reduced tile is requested again as a whole */
+			if (gdk_rectangle_intersect(&st_rect, &request_rect, nullptr) &&
+			    pr->func_tile_request &&
+			    pr->func_tile_request(pr, st_rect.x, st_rect.y, st_rect.width, st_rect.height, st->pixbuf, pr->func_tile_data))
+				{
+				st->blank = FALSE;
+				pr_scale_region(st_rect, pr->scale);
+
+				pr->renderer->invalidate_region(pr->renderer, st_rect);
+				if (pr->renderer2) pr->renderer2->invalidate_region(pr->renderer2, st_rect);
+				}
+			continue;
+			}
 
 		if (gdk_rectangle_intersect(&st_rect, &request_rect, &r))
 			{
@@ -1100,6 +1159,8 @@ static void pr_source_tile_changed(PixbufRenderer *pr, gint x, gint y, gint widt
 			if (pr->func_tile_request &&
 			    pr->func_tile_request(pr, r.x, r.y, r.width, r.height, pixbuf, pr->func_tile_data))
 				{
+				/* a tile requested asynchronously is filled in here, when done */
+				if (gdk_rectangle_equal(&r, &st_rect)) st->blank = FALSE;
 				pr_scale_region(r, pr->scale);
 
 				pr->renderer->invalidate_region(pr->renderer, r);
@@ -1112,9 +1173,19 @@ static void pr_source_tile_changed(PixbufRenderer *pr, gint x, gint y, gint widt
 
 /**
  * @brief Display an on-request array of pixbuf tiles
+ * @param max_level Number of reduced levels \a func_request can fill
+ *
+ * Tiles are requested in image coordinates. At level n the tile pixbuf of
+ * tile_width x tile_height covers (tile_width << n) x (tile_height << n)
+ * image pixels, the level is picked from the zoom. With a \a max_level
+ * of 0 the pixbuf is always the size of the requested area.
+ *
+ * A tile \a func_request returns FALSE for stays blank. It can be filled
+ * later by pixbuf_renderer_area_changed() on its area, which requests the
+ * tiles of the area again.
  */
 void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
-			       gint tile_width, gint tile_height, gint cache_size,
+			       gint tile_width, gint tile_height, gint cache_size, gint max_level,
 			       PixbufRendererTileRequestFunc func_request,
 			       PixbufRendererTileDisposeFunc func_dispose,
 			       gpointer user_data,
@@ -1136,6 +1207,7 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
 	pr->source_tiles_cache_size = cache_size;
 	pr->source_tile_width = tile_width;
 	pr->source_tile_height = tile_height;
+	pr->source_tiles_max_level = MAX(max_level, 0);
 
 	pr->image_width = width;
 	pr->image_height = height;
@@ -2589,6 +2661,7 @@ void pixbuf_renderer_move(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->source_tiles_cache_size = source->source_tiles_cache_size;
 		pr->source_tile_width = source->source_tile_width;
 		pr->source_tile_height = source->source_tile_height;
+		pr->source_tiles_max_level = source->source_tiles_max_level;
 		pr->image_width = source->image_width;
 		pr->image_height = source->image_height;
 
@@ -2646,6 +2719,7 @@ void pixbuf_renderer_copy(PixbufRenderer *pr, PixbufRenderer *source)
 		pr->source_tiles_cache_size = source->source_tiles_cache_size;
 		pr->source_tile_width = source->source_tile_width;
 		pr->source_tile_height = source->source_tile_height;
+		pr->source_tiles_max_level = source->source_tiles_max_level;
 		pr->image_width = source->image_width;
 		pr->image_height = source->image_height;
 
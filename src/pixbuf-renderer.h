@@ -74,6 +74,9 @@ struct PixbufRenderer;
 using PixbufRendererTileRequestFunc = gint (*)(PixbufRenderer *, gint, gint, gint, gint, GdkPixbuf *, gpointer);
 using PixbufRendererTileDisposeFunc = void (*)(PixbufRenderer *, gint, gint, gint, gint, GdkPixbuf *, gpointer);
 
+/* Called for each rendered tile. This may happen on a render worker thread while
+ * the main thread waits, so it must only modify the passed tile pixbuf.
+ */
 using PixbufRendererPostProcessFunc = void (*)(PixbufRenderer *, GdkPixbuf **, gint, gint, gint, gint, gpointer);
 
 enum ImageRenderType {
@@ -183,6 +186,7 @@ struct PixbufRenderer
 	GList *source_tiles;	/**< list of active source tiles */
 	gint source_tile_width;
 	gint source_tile_height;
+	gint source_tiles_max_level;	/**< see pixbuf_renderer_set_tiles() */
 
 	PixbufRendererTileRequestFunc func_tile_request;
 	PixbufRendererTileDisposeFunc func_tile_dispose;
@@ -262,7 +266,7 @@ void pixbuf_renderer_set_stereo_data(PixbufRenderer *pr, StereoPixbufData stereo
 void pixbuf_renderer_set_post_process_func(PixbufRenderer *pr, PixbufRendererPostProcessFunc func, gpointer user_data, gboolean slow);
 
 void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
-			       gint tile_width, gint tile_height, gint cache_size,
+			       gint tile_width, gint tile_height, gint cache_size, gint max_level,
 			       PixbufRendererTileRequestFunc func_request,
 			       PixbufRendererTileDisposeFunc func_dispose,
 			       gpointer user_data,
@@ -330,6 +334,7 @@ struct SourceTile
 {
 	gint x;
 	gint y;
+	gint level;	/**< the tile covers source_tile_width << level image pixels */
 	GdkPixbuf *pixbuf;
 	gboolean blank;
 };
@@ -351,6 +356,7 @@ GdkRectangle pr_coords_map_orientation_reverse(gint orientation,
 void pr_scale_region(GdkRectangle &region, gdouble scale);
 
 GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w, gint h, gboolean request);
+void pr_source_tile_extent(const PixbufRenderer *pr, const SourceTile *st, gint &width, gint &height);
 
 void pr_create_anaglyph(guint mode, GdkPixbuf *pixbuf, GdkPixbuf *right, gint x, gint y, gint w, gint h);
 
@@ -54,6 +54,7 @@
 #include "compat.h"
 #include "debug.h"
 #include "editors.h"
+#include "exif.h"
 #include "filedata.h"
 #include "filefilter.h"
 #include "fullscreen.h"
@@ -395,6 +396,9 @@ static void config_window_apply()
 	options->image.zoom_style = c_options->image.zoom_style;
 
 	options->image.enable_read_ahead = c_options->image.enable_read_ahead;
+	options->image.read_ahead_forward = c_options->image.read_ahead_forward;
+	options->image.read_ahead_backward = c_options->image.read_ahead_backward;
+	options->image.read_ahead_max = c_options->image.read_ahead_max;
 
 	options->appimage_notifications = c_options->appimage_notifications;
 
@@ -514,6 +518,7 @@ static void config_window_apply()
 	options->star_rating.rejected = c_options->star_rating.rejected;
 
 	options->threads.duplicates = c_options->threads.duplicates > 0 ? c_options->threads.duplicates : -1;
+	options->threads.image_render = c_options->threads.image_render > 0 ? c_options->threads.image_render : -1;
 
 	options->alternate_similarity_algorithm.enabled = c_options->alternate_similarity_algorithm.enabled;
 	options->alternate_similarity_algorithm.grayscale = c_options->alternate_similarity_algorithm.grayscale;
@@ -2166,8 +2171,18 @@ static void config_tab_general(GtkWidget *notebook)
 
 	pref_spin_new_int(group, _("Decoded image cache size (MiB):"), nullptr,
 			  0, 99999, 1, options->image.image_cache_max, &c_options->image.image_cache_max);
-	pref_checkbox_new_int(group, _("Preload next image"),
-			      options->image.enable_read_ahead, &c_options->image.enable_read_ahead);
+	ct_button = pref_checkbox_new_int(group, _("Preload next image"),
+					  options->image.enable_read_ahead, &c_options->image.enable_read_ahead);
+
+	subgroup = pref_box_new(group, FALSE, GTK_ORIENTATION_VERTICAL, PREF_PAD_GAP);
+	pref_checkbox_link_sensitivity(ct_button, subgroup);
+
+	pref_spin_new_int(subgroup, _("Images to preload ahead:"), nullptr,
+			  0, 32, 1, options->image.read_ahead_forward, &c_options->image.read_ahead_forward);
+	pref_spin_new_int(subgroup, _("Images to preload behind:"), nullptr,
+			  0, 32, 1, options->image.read_ahead_backward, &c_options->image.read_ahead_backward);
+	pref_spin_new_int(subgroup, _("Preload memory limit (MiB):"), nullptr,
+			  0, 99999, 1, options->image.read_ahead_max, &c_options->image.read_ahead_max);
 
 	pref_checkbox_new_int(group, _("Refresh on file change"),
 			      options->update_on_time_change, &c_options->update_on_time_change);
@@ -3896,6 +3911,7 @@ static void config_tab_advanced(GtkWidget *notebook)
 	GList *extensions_list = nullptr;
 	GtkWidget *alternate_checkbox;
 	GtkWidget *dupes_threads_spin;
+	GtkWidget *render_threads_spin;
 	GtkWidget *group;
 	GtkWidget *subgroup;
 	GtkWidget *tabcomp;
@@ -3962,7 +3978,7 @@ static void config_tab_advanced(GtkWidget *notebook)
 	pref_line(vbox, PREF_PAD_SPACE);
 	group = pref_group_new(vbox, FALSE, _("Thread pool limits"), GTK_ORIENTATION_VERTICAL);
 
-	threads_string_label = pref_label_new(group, _("This option limits the number of threads (or cpu cores) that Geeqie will use when running duplicate checks.\nThe value 0 means all available cores will be used."));
+	threads_string_label = pref_label_new(group, _("These options limit the number of threads (or cpu cores) that Geeqie will use when running duplicate checks and rendering images.\nThe value 0 means all available cores will be used."));
 	gtk_label_set_line_wrap(GTK_LABEL(threads_string_label), TRUE);
 
 	pref_spacer(vbox, PREF_PAD_GROUP);
@@ -3970,6 +3986,9 @@ static void config_tab_advanced(GtkWidget *notebook)
 	dupes_threads_spin = pref_spin_new_int(vbox, _("Duplicate check:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.duplicates, &c_options->threads.duplicates);
 	gtk_widget_set_tooltip_markup(dupes_threads_spin, _("Set to 0 for unlimited"));
 
+	render_threads_spin = pref_spin_new_int(vbox, _("Image rendering:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.image_render, &c_options->threads.image_render);
+	gtk_widget_set_tooltip_markup(render_threads_spin, _("Set to 0 for unlimited"));
+
 	pref_spacer(group, PREF_PAD_GROUP);
 
 	pref_line(vbox, PREF_PAD_SPACE);
@@ -4323,6 +4342,7 @@ static void timezone_async_ready_cb(GObject *source_object, GAsyncResult *res, g
 			if (isfile(timezone_bin))
 				{
 				move_file(timezone_bin, tz->timezone_database_user);
+				exif_timezone_database_reset();
 				}
 			else
 				{
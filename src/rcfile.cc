@@ -488,6 +488,9 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_INT(*options, image.tile_cache_max);
 	WRITE_NL(); WRITE_INT(*options, image.image_cache_max);
 	WRITE_NL(); WRITE_BOOL(*options, image.enable_read_ahead);
+	WRITE_NL(); WRITE_INT(*options, image.read_ahead_forward);
+	WRITE_NL(); WRITE_INT(*options, image.read_ahead_backward);
+	WRITE_NL(); WRITE_INT(*options, image.read_ahead_max);
 	WRITE_NL(); WRITE_BOOL(*options, image.exif_rotate_enable);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color_in_fullscreen);
@@ -615,6 +618,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 
 	/* Threads */
 	WRITE_NL(); WRITE_INT(*options, threads.duplicates);
+	WRITE_NL(); WRITE_INT(*options, threads.image_render);
 	WRITE_SEPARATOR();
 
 	/* user-definable mouse buttons */
@@ -985,6 +989,9 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_UINT_CLAMP(*options, image.zoom_quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
 		if (READ_INT(*options, image.zoom_increment)) continue;
 		if (READ_BOOL(*options, image.enable_read_ahead)) continue;
+		if (READ_INT_CLAMP(*options, image.read_ahead_forward, 0, 32)) continue;
+		if (READ_INT_CLAMP(*options, image.read_ahead_backward, 0, 32)) continue;
+		if (READ_INT(*options, image.read_ahead_max)) continue;
 		if (READ_BOOL(*options, image.exif_rotate_enable)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color_in_fullscreen)) continue;
@@ -1117,6 +1124,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		/* Threads */
 		if (READ_INT(*options, threads.duplicates)) continue;
+		if (READ_INT(*options, threads.image_render)) continue;
 
 		/* user-definable mouse buttons */
 		if (READ_CHAR(*options, mouse_button_8)) continue;
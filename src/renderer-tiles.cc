@@ -26,6 +26,7 @@
 #include <cstring>
 #include <functional>
 #include <utility>
+#include <vector>
 
 #include <cairo.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -35,6 +36,7 @@
 #include <gtk/gtk.h>
 
 #include "debug.h"
+#include "misc.h"
 #include "options.h"
 #include "pixbuf-renderer.h"
 #include "typedefs.h"
@@ -92,6 +94,10 @@ struct ImageTile
 	QueueData *qd2;
 
 	guint size;		/* est. memory used by pixmap and pixbuf */
+
+	gint64 key;		/* key into RendererTiles::tiles, see rt_tile_key() */
+	ImageTile *lru_prev;	/* more recently used tile */
+	ImageTile *lru_next;	/* less recently used tile */
 };
 
 struct QueueData
@@ -126,7 +132,9 @@ struct RendererTiles
 
 	gint tile_width;
 	gint tile_height;
-	GList *tiles;		/* list of buffer tiles */
+	GHashTable *tiles;	/* buffer tiles, indexed by grid position */
+	ImageTile *tiles_mru;	/* head of LRU list of buffer tiles */
+	ImageTile *tiles_lru;	/* tail of LRU list of buffer tiles */
 	gint tile_cache_size;	/* allocated size of pixmaps/pixbufs */
 	GList *draw_queue;	/* list of areas to redraw */
 	GList *draw_queue_2pass;/* list when 2 pass is enabled */
@@ -138,6 +146,7 @@ struct RendererTiles
 	guint draw_idle_id; /* event source id */
 
 	GdkPixbuf *spare_tile;
+	GPtrArray *render_spare_tiles;	/* per job scratch buffers for the render thread pool */
 
 	gint stereo_mode;
 	gint stereo_off_x;
@@ -294,10 +303,50 @@ void rt_tile_free(ImageTile *it)
 	g_free(it);
 }
 
+inline gint64 rt_tile_key(gint x, gint y)
+{
+	return (static_cast<gint64>(x) << 32) | static_cast<guint32>(y);
+}
+
+void rt_tile_lru_unlink(RendererTiles *rt, ImageTile *it)
+{
+	if (it->lru_prev) it->lru_prev->lru_next = it->lru_next;
+	else rt->tiles_mru = it->lru_next;
+
+	if (it->lru_next) it->lru_next->lru_prev = it->lru_prev;
+	else rt->tiles_lru = it->lru_prev;
+
+	it->lru_prev = nullptr;
+	it->lru_next = nullptr;
+}
+
+void rt_tile_lru_push_front(RendererTiles *rt, ImageTile *it)
+{
+	it->lru_prev = nullptr;
+	it->lru_next = rt->tiles_mru;
+
+	if (rt->tiles_mru) rt->tiles_mru->lru_prev = it;
+	else rt->tiles_lru = it;
+
+	rt->tiles_mru = it;
+}
+
 void rt_tile_free_all(RendererTiles *rt)
 {
-	g_list_free_full(rt->tiles, reinterpret_cast<GDestroyNotify>(rt_tile_free));
-	rt->tiles = nullptr;
+	ImageTile *it = rt->tiles_mru;
+
+	g_hash_table_remove_all(rt->tiles);
+
+	while (it)
+		{
+		ImageTile *next = it->lru_next;
+
+		rt_tile_free(it);
+		it = next;
+		}
+
+	rt->tiles_mru = nullptr;
+	rt->tiles_lru = nullptr;
 	rt->tile_cache_size = 0;
 }
 
@@ -311,7 +360,9 @@ ImageTile *rt_tile_add(RendererTiles *rt, gint x, gint y)
 	if (it->x + it->w > pr->width) it->w = pr->width - it->x;
 	if (it->y + it->h > pr->height) it->h = pr->height - it->y;
 
-	rt->tiles = g_list_prepend(rt->tiles, it);
+	it->key = rt_tile_key(x, y);
+	g_hash_table_insert(rt->tiles, &it->key, it);
+	rt_tile_lru_push_front(rt, it);
 	rt->tile_cache_size += it->size;
 
 	return it;
@@ -337,7 +388,8 @@ void rt_tile_remove(RendererTiles *rt, ImageTile *it)
 		g_free(qd);
 		}
 
-	rt->tiles = g_list_remove(rt->tiles, it);
+	g_hash_table_remove(rt->tiles, &it->key);
+	rt_tile_lru_unlink(rt, it);
 	rt->tile_cache_size -= it->size;
 
 	rt_tile_free(it);
@@ -346,10 +398,10 @@ void rt_tile_remove(RendererTiles *rt, ImageTile *it)
 void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
 {
 	PixbufRenderer *pr = rt->pr;
-	GList *work;
+	ImageTile *work;
 	guint tile_max;
 
-	work = g_list_last(rt->tiles);
+	work = rt->tiles_lru;
 
 	if (pr->source_tiles_enabled && pr->scale < 1.0)
 		{
@@ -368,28 +420,26 @@ void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
 		{
 		ImageTile *needle;
 
-		needle = static_cast<ImageTile *>(work->data);
-		work = work->prev;
+		needle = work;
+		work = work->lru_prev;
 		if (needle != it &&
 		    ((!needle->qd && !needle->qd2) || !rt_tile_is_visible(rt, needle))) rt_tile_remove(rt, needle);
 		}
 }
 
+void rt_tile_invalidate(ImageTile *it)
+{
+	it->render_done = TILE_RENDER_NONE;
+	it->render_todo = TILE_RENDER_ALL;
+}
+
 void rt_tile_invalidate_all(RendererTiles *rt)
 {
 	PixbufRenderer *pr = rt->pr;
-	GList *work;
 
-	work = rt->tiles;
-	while (work)
+	for (ImageTile *it = rt->tiles_mru; it; it = it->lru_next)
 		{
-		ImageTile *it;
-
-		it = static_cast<ImageTile *>(work->data);
-		work = work->next;
-
-		it->render_done = TILE_RENDER_NONE;
-		it->render_todo = TILE_RENDER_ALL;
+		rt_tile_invalidate(it);
 		it->blank = FALSE;
 
 		it->w = MIN(rt->tile_width, pr->width - it->x);
@@ -405,37 +455,50 @@ void rt_tile_invalidate_region(RendererTiles *rt, GdkRectangle region)
 	gint y1 = ROUND_DOWN(region.y, rt->tile_height);
 	gint y2 = ROUND_UP(region.y + region.height, rt->tile_height);
 
-	for (GList *work = rt->tiles; work; work = work->next)
+	const auto tile_in_region = [x1, x2, y1, y2](const ImageTile *it)
+	{
+		return it->x < x2 && it->x + it->w > x1 &&
+		       it->y < y2 && it->y + it->h > y1;
+	};
+
+	const gint64 cells = static_cast<gint64>((x2 - x1) / rt->tile_width) * ((y2 - y1) / rt->tile_height);
+
+	/* probe the grid when the region is small compared to the cache,
+	 * otherwise it is cheaper to walk the cached tiles */
+	if (cells > g_hash_table_size(rt->tiles))
 		{
-		auto *it = static_cast<ImageTile *>(work->data);
+		for (ImageTile *it = rt->tiles_mru; it; it = it->lru_next)
+			{
+			if (tile_in_region(it)) rt_tile_invalidate(it);
+			}
+		return;
+		}
 
-		if (it->x < x2 && it->x + it->w > x1 &&
-		    it->y < y2 && it->y + it->h > y1)
+	for (gint y = y1; y < y2; y += rt->tile_height)
+		{
+		for (gint x = x1; x < x2; x += rt->tile_width)
 			{
-			it->render_done = TILE_RENDER_NONE;
-			it->render_todo = TILE_RENDER_ALL;
+			const gint64 key = rt_tile_key(x, y);
+			auto *it = static_cast<ImageTile *>(g_hash_table_lookup(rt->tiles, &key));
+
+			if (it && tile_in_region(it)) rt_tile_invalidate(it);
 			}
 		}
 }
 
 ImageTile *rt_tile_get(RendererTiles *rt, gint x, gint y, gboolean only_existing)
 {
-	GList *work;
+	const gint64 key = rt_tile_key(x, y);
+	auto *it = static_cast<ImageTile *>(g_hash_table_lookup(rt->tiles, &key));
 
-	work = rt->tiles;
-	while (work)
+	if (it)
 		{
-		ImageTile *it;
-
-		it = static_cast<ImageTile *>(work->data);
-		if (it->x == x && it->y == y)
+		if (it != rt->tiles_mru)
 			{
-			rt->tiles = g_list_delete_link(rt->tiles, work);
-			rt->tiles = g_list_prepend(rt->tiles, it);
-			return it;
+			rt_tile_lru_unlink(rt, it);
+			rt_tile_lru_push_front(rt, it);
 			}
-
-		work = work->next;
+		return it;
 		}
 
 	if (only_existing) return nullptr;
@@ -802,13 +865,13 @@ void rt_hierarchy_changed_cb(GtkWidget *, GtkWidget *, gpointer data)
  *-------------------------------------------------------------------
  */
 
-GdkPixbuf *rt_get_spare_tile(RendererTiles *rt)
+GdkPixbuf *rt_get_spare_tile(const RendererTiles *rt, GdkPixbuf **spare_tile)
 {
-	if (!rt->spare_tile) rt->spare_tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width * rt->hidpi_scale, rt->tile_height * rt->hidpi_scale);
-	return rt->spare_tile;
+	if (!*spare_tile) *spare_tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width * rt->hidpi_scale, rt->tile_height * rt->hidpi_scale);
+	return *spare_tile;
 }
 
-void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_rotate_90_clockwise(const RendererTiles *rt, GdkPixbuf **spare_tile, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -829,7 +892,7 @@ void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gi
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_get_spare_tile(rt, spare_tile);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (tw - 1) * COLOR_BYTES;
@@ -846,11 +909,11 @@ void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gi
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare_tile = src;
 	*tile = dest;
 }
 
-void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_rotate_90_counter_clockwise(const RendererTiles *rt, GdkPixbuf **spare_tile, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -871,7 +934,7 @@ void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gi
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_get_spare_tile(rt, spare_tile);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (th - 1) * drs;
@@ -888,11 +951,11 @@ void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gi
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare_tile = src;
 	*tile = dest;
 }
 
-void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_mirror_only(const RendererTiles *rt, GdkPixbuf **spare_tile, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -913,7 +976,7 @@ void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gi
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_get_spare_tile(rt, spare_tile);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi =  d_pix + (tw - x - 1) * COLOR_BYTES;
@@ -930,11 +993,11 @@ void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gi
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare_tile = src;
 	*tile = dest;
 }
 
-void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_mirror_and_flip(const RendererTiles *rt, GdkPixbuf **spare_tile, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -953,7 +1016,7 @@ void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_get_spare_tile(rt, spare_tile);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (th - 1) * drs + (tw - 1) * COLOR_BYTES;
@@ -970,11 +1033,11 @@ void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare_tile = src;
 	*tile = dest;
 }
 
-void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_flip_only(const RendererTiles *rt, GdkPixbuf **spare_tile, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -993,7 +1056,7 @@ void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_get_spare_tile(rt, spare_tile);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + (th - 1) * drs + (x * COLOR_BYTES);
@@ -1005,11 +1068,11 @@ void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint
 		memcpy(dp, sp, w * COLOR_BYTES);
 		}
 
-	rt->spare_tile = src;
+	*spare_tile = src;
 	*tile = dest;
 }
 
-void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
+void rt_tile_apply_orientation(const RendererTiles *rt, GdkPixbuf **spare_tile, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
 {
 	switch (orientation)
 		{
@@ -1019,43 +1082,43 @@ void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **
 		case EXIF_ORIENTATION_TOP_RIGHT:
 			/* mirrored */
 			{
-				rt_tile_mirror_only(rt, pixbuf, x, y, w, h);
+				rt_tile_mirror_only(rt, spare_tile, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_BOTTOM_RIGHT:
 			/* upside down */
 			{
-				rt_tile_mirror_and_flip(rt, pixbuf, x, y, w, h);
+				rt_tile_mirror_and_flip(rt, spare_tile, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_BOTTOM_LEFT:
 			/* flipped */
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
+				rt_tile_flip_only(rt, spare_tile, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_LEFT_TOP:
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
+				rt_tile_flip_only(rt, spare_tile, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_clockwise(rt, spare_tile, pixbuf, x, rt->tile_height - y - h, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_RIGHT_TOP:
 			/* rotated -90 (270) */
 			{
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_clockwise(rt, spare_tile, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_RIGHT_BOTTOM:
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
+				rt_tile_flip_only(rt, spare_tile, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_counter_clockwise(rt, spare_tile, pixbuf, x, rt->tile_height - y - h, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_LEFT_BOTTOM:
 			/* rotated 90 */
 			{
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_counter_clockwise(rt, spare_tile, pixbuf, x, y, w, h);
 			}
 			break;
 		default:
@@ -1117,14 +1180,22 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 	for (GList *work = list; work; work = work->next)
 		{
 		const auto st = static_cast<SourceTile *>(work->data);
+		gint st_w;
+		gint st_h;
+
+		// A reduced level SourceTile covers more of the image than its pixbuf holds,
+		// so its pixels are scaled by a correspondingly larger factor.
+		pr_source_tile_extent(pr, st, st_w, st_h);
+		const gdouble st_scale_x = scale_x * (1 << st->level);
+		const gdouble st_scale_y = scale_y * (1 << st->level);
 
 		// The scaled (output) coordinates that are covered by this SourceTile.
 		// To avoid aliasing line artifacts due to under-drawing, we expand the
 		// render area to the nearest whole pixel.
 		st_rect.x = floor(st->x * scale_x);
 		st_rect.y = floor(st->y * scale_y);
-		st_rect.width = ceil((st->x + pr->source_tile_width) * scale_x) - st_rect.x;
-		st_rect.height = ceil((st->y + pr->source_tile_height) * scale_y) - st_rect.y;
+		st_rect.width = ceil((st->x + st_w) * scale_x) - st_rect.x;
+		st_rect.height = ceil((st->y + st_h) * scale_y) - st_rect.y;
 
 		// We find the overlapping region r between the ImageTile (output)
 		// region and the region that's covered by this SourceTile (input).
@@ -1184,7 +1255,7 @@ gboolean rt_source_tile_render(RendererTiles *rt, ImageTile *it,
 				gdk_pixbuf_scale(st->pixbuf, it->pixbuf,
 				                 r.x - it->x, r.y - it->y, rt->hidpi_scale * r.width, rt->hidpi_scale * r.height,
 				                 offset_x, offset_y,
-				                 rt->hidpi_scale * scale_x, rt->hidpi_scale * scale_y,
+				                 rt->hidpi_scale * st_scale_x, rt->hidpi_scale * st_scale_y,
 				                 interp_type);
 				draw = TRUE;
 				}
@@ -1324,17 +1395,65 @@ gint rt_get_orientation(RendererTiles *rt)
 }
 
 
-void rt_tile_render(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+struct TileRenderBatch
 {
-	PixbufRenderer *pr = rt->pr;
-	gboolean has_alpha;
-	gboolean draw = FALSE;
-	gint orientation = rt_get_orientation(rt);
-	gboolean wide_image = FALSE;
+	GMutex mutex;
+	GCond cond;
+	gint pending;
+};
 
-	if (it->render_todo == TILE_RENDER_NONE && it->surface && !new_data) return;
+/**
+ * @brief Parameters and result of rendering one ImageTile region.
+ *
+ * Filled in on the main thread by rt_tile_render_begin(). The pixel work
+ * in rt_tile_render_pixbuf() only touches the job and its tile's pixbuf,
+ * so several jobs may run on the render thread pool at the same time.
+ */
+struct TileRenderJob
+{
+	RendererTiles *rt;
+	ImageTile *it;
+	GdkPixbuf *spare_tile;	/* scratch buffer owned by this job */
+
+	gint x;
+	gint y;
+	gint w;
+	gint h;
+
+	gboolean fast;
+	gint orientation;
+
+	gboolean draw;		/* it->pixbuf has new content for it->surface */
+
+	TileRenderBatch *batch;
+};
+
+GThreadPool *rt_render_thread_pool = nullptr;
+
+gint rt_render_threads()
+{
+	return options->threads.image_render > 0 ? options->threads.image_render : get_cpu_cores();
+}
+
+void rt_tile_post_process(TileRenderJob *job)
+{
+	PixbufRenderer *pr = job->rt->pr;
+
+	if (pr->func_post_process && (!pr->post_process_slow || !job->fast))
+		pr->func_post_process(pr, &job->it->pixbuf, job->x, job->y, job->w, job->h, pr->post_process_user_data);
+}
+
+/**
+ * @brief Does the main thread part of rendering a tile region: updates the
+ *        render state of the tile and makes sure it has a pixbuf and surface.
+ * @retval FALSE There is nothing to render.
+ */
+gboolean rt_tile_render_begin(RendererTiles *rt, ImageTile *it,
+                              gint x, gint y, gint w, gint h,
+                              gboolean new_data, gboolean fast,
+                              TileRenderJob &job)
+{
+	if (it->render_todo == TILE_RENDER_NONE && it->surface && !new_data) return FALSE;
 
 	if (it->render_done != TILE_RENDER_ALL)
 		{
@@ -1347,7 +1466,7 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 	else if (it->render_todo != TILE_RENDER_AREA)
 		{
 		if (!fast) it->render_todo = TILE_RENDER_NONE;
-		return;
+		return FALSE;
 		}
 
 	if (!fast) it->render_todo = TILE_RENDER_NONE;
@@ -1355,118 +1474,176 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 	if (new_data) it->blank = FALSE;
 
 	rt_tile_prepare(rt, it);
+
+	job.rt = rt;
+	job.it = it;
+	job.x = x;
+	job.y = y;
+	job.w = w;
+	job.h = h;
+	job.fast = fast;
+	job.orientation = rt_get_orientation(rt);
+	job.draw = FALSE;
+	job.batch = nullptr;
+
+	return TRUE;
+}
+
+/**
+ * @brief Scales, composites, rotates and post-processes the image data of
+ *        a tile region into the tile pixbuf.
+ *
+ * Only valid when the renderer draws from pr->pixbuf (not source tiles).
+ * Reads renderer state but does not modify it, so it may run on a worker
+ * thread while the main thread waits for the batch to complete.
+ */
+void rt_tile_render_pixbuf(TileRenderJob *job)
+{
+	RendererTiles *rt = job->rt;
+	PixbufRenderer *pr = rt->pr;
+	ImageTile *it = job->it;
+	const gint orientation = job->orientation;
+	gboolean has_alpha;
+	gboolean wide_image = FALSE;
+	gdouble scale_x;
+	gdouble scale_y;
+	gdouble src_x;
+	gdouble src_y;
+
+	if (pr->image_width == 0 || pr->image_height == 0) return;
+
 	has_alpha = (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf));
 
 	/** @FIXME checker colors for alpha should be configurable,
 	 * also should be drawn for blank = TRUE
 	 */
 
-	if (it->blank)
-		{
-		/* no data, do fast rect fill */
-		cairo_t *cr;
-		cr = cairo_create(it->surface);
-		cairo_rectangle (cr, 0, 0, it->w, it->h);
-		cairo_set_source_rgb(cr, 0, 0, 0);
-		cairo_fill (cr);
-		cairo_destroy (cr);
-		}
-	else if (pr->source_tiles_enabled)
-		{
-		draw = rt_source_tile_render(rt, it, x, y, w, h, new_data, fast);
-		}
-	else
-		{
-		gdouble scale_x;
-		gdouble scale_y;
-		gdouble src_x;
-		gdouble src_y;
-
-		if (pr->image_width == 0 || pr->image_height == 0) return;
-
-		scale_x = rt->hidpi_scale * static_cast<gdouble>(pr->width) / pr->image_width;
-		scale_y = rt->hidpi_scale * static_cast<gdouble>(pr->height) / pr->image_height;
+	scale_x = rt->hidpi_scale * static_cast<gdouble>(pr->width) / pr->image_width;
+	scale_y = rt->hidpi_scale * static_cast<gdouble>(pr->height) / pr->image_height;
 
-		pr_tile_coords_map_orientation(orientation, it->x, it->y,
-		                               pr->width, pr->height,
-		                               rt->tile_width, rt->tile_height,
-		                               src_x, src_y);
-		GdkRectangle pb_rect = pr_tile_region_map_orientation(orientation,
-		                                                      {x, y, w, h},
-		                                                      rt->tile_width,
-		                                                      rt->tile_height);
+	pr_tile_coords_map_orientation(orientation, it->x, it->y,
+	                               pr->width, pr->height,
+	                               rt->tile_width, rt->tile_height,
+	                               src_x, src_y);
+	GdkRectangle pb_rect = pr_tile_region_map_orientation(orientation,
+	                                                      {job->x, job->y, job->w, job->h},
+	                                                      rt->tile_width,
+	                                                      rt->tile_height);
 
-		src_x *= rt->hidpi_scale;
-		src_y *= rt->hidpi_scale;
-		pr_scale_region(pb_rect, rt->hidpi_scale);
+	src_x *= rt->hidpi_scale;
+	src_y *= rt->hidpi_scale;
+	pr_scale_region(pb_rect, rt->hidpi_scale);
 
-		switch (orientation)
-			{
-			case EXIF_ORIENTATION_LEFT_TOP:
-			case EXIF_ORIENTATION_RIGHT_TOP:
-			case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			case EXIF_ORIENTATION_LEFT_BOTTOM:
-				std::swap(scale_x, scale_y);
-				break;
-			default:
-				/* nothing to do */
-				break;
-			}
-
-		/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
-		 * small sizes for anything but GDK_INTERP_NEAREST
-		 */
-		if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
-		if (pr->image_width > 32767) wide_image = TRUE;
+	switch (orientation)
+		{
+		case EXIF_ORIENTATION_LEFT_TOP:
+		case EXIF_ORIENTATION_RIGHT_TOP:
+		case EXIF_ORIENTATION_RIGHT_BOTTOM:
+		case EXIF_ORIENTATION_LEFT_BOTTOM:
+			std::swap(scale_x, scale_y);
+			break;
+		default:
+			/* nothing to do */
+			break;
+		}
 
+	/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
+	 * small sizes for anything but GDK_INTERP_NEAREST
+	 */
+	if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) job->fast = TRUE;
+	if (pr->image_width > 32767) wide_image = TRUE;
+
+	rt_tile_get_region(has_alpha, pr->ignore_alpha,
+	                   pr->pixbuf, it->pixbuf, pb_rect,
+	                   static_cast<gdouble>(0.0) - src_x - get_right_pixbuf_offset(rt) * scale_x,
+	                   static_cast<gdouble>(0.0) - src_y,
+	                   scale_x, scale_y,
+	                   (job->fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
+	                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
+	if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
+	    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
+		{
+		GdkPixbuf *right_pb = rt_get_spare_tile(rt, &job->spare_tile);
 		rt_tile_get_region(has_alpha, pr->ignore_alpha,
-		                   pr->pixbuf, it->pixbuf, pb_rect,
-		                   static_cast<gdouble>(0.0) - src_x - get_right_pixbuf_offset(rt) * scale_x,
+		                   pr->pixbuf, right_pb, pb_rect,
+		                   static_cast<gdouble>(0.0) - src_x - get_left_pixbuf_offset(rt) * scale_x,
 		                   static_cast<gdouble>(0.0) - src_y,
 		                   scale_x, scale_y,
-		                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
+		                   (job->fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
 		                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-		if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
-		    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
-			{
-			GdkPixbuf *right_pb = rt_get_spare_tile(rt);
-			rt_tile_get_region(has_alpha, pr->ignore_alpha,
-			                   pr->pixbuf, right_pb, pb_rect,
-			                   static_cast<gdouble>(0.0) - src_x - get_left_pixbuf_offset(rt) * scale_x,
-			                   static_cast<gdouble>(0.0) - src_y,
-			                   scale_x, scale_y,
-			                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-			                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
-			/* do not care about freeing spare_tile, it will be reused */
-			}
-		rt_tile_apply_orientation(rt, orientation, &it->pixbuf, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
-		draw = TRUE;
+		pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
+		/* do not care about freeing spare_tile, it will be reused */
 		}
+	rt_tile_apply_orientation(rt, &job->spare_tile, orientation, &it->pixbuf, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
 
-	if (draw && it->pixbuf && !it->blank)
-		{
-		cairo_t *cr;
+	rt_tile_post_process(job);
+	job->draw = TRUE;
+}
 
-		if (pr->func_post_process && (!pr->post_process_slow || !fast))
-			pr->func_post_process(pr, &it->pixbuf, x, y, w, h, pr->post_process_user_data);
+/**
+ * @brief Copies the rendered tile pixbuf to the tile surface.
+ */
+void rt_tile_render_end(TileRenderJob *job)
+{
+	ImageTile *it = job->it;
+	cairo_t *cr;
 
-		cr = cairo_create(it->surface);
-		cairo_rectangle (cr, x, y, w, h);
-		rt_hidpi_aware_draw(rt, cr, it->pixbuf, 0, 0);
-		cairo_destroy (cr);
-		}
+	if (!job->draw || !it->pixbuf || it->blank) return;
+
+	cr = cairo_create(it->surface);
+	cairo_rectangle (cr, job->x, job->y, job->w, job->h);
+	rt_hidpi_aware_draw(job->rt, cr, it->pixbuf, 0, 0);
+	cairo_destroy (cr);
 }
 
+void rt_tile_render_blank(ImageTile *it)
+{
+	/* no data, do fast rect fill */
+	cairo_t *cr;
+	cr = cairo_create(it->surface);
+	cairo_rectangle (cr, 0, 0, it->w, it->h);
+	cairo_set_source_rgb(cr, 0, 0, 0);
+	cairo_fill (cr);
+	cairo_destroy (cr);
+}
 
-void rt_tile_expose(RendererTiles *rt, ImageTile *it,
+void rt_tile_render(RendererTiles *rt, ImageTile *it,
                     gint x, gint y, gint w, gint h,
                     gboolean new_data, gboolean fast)
 {
 	PixbufRenderer *pr = rt->pr;
-	cairo_t *cr;
+	TileRenderJob job{};
+
+	if (!rt_tile_render_begin(rt, it, x, y, w, h, new_data, fast, job)) return;
+
+	if (it->blank)
+		{
+		rt_tile_render_blank(it);
+		}
+	else if (pr->source_tiles_enabled)
+		{
+		job.draw = rt_source_tile_render(rt, it, job.x, job.y, job.w, job.h, new_data, fast);
+		if (job.draw && it->pixbuf) rt_tile_post_process(&job);
+		}
+	else
+		{
+		job.spare_tile = rt->spare_tile;
+		rt_tile_render_pixbuf(&job);
+		rt->spare_tile = job.spare_tile;
+		}
+
+	rt_tile_render_end(&job);
+}
+
+/**
+ * @brief Clamps a tile region to the visible area.
+ * @retval FALSE Nothing of the region is visible.
+ */
+gboolean rt_tile_expose_clamp(RendererTiles *rt, ImageTile *it,
+                              gint &x, gint &y, gint &w, gint &h)
+{
+	PixbufRenderer *pr = rt->pr;
 
-	/* clamp to visible */
 	if (it->x + x < rt->x_scroll)
 		{
 		w -= rt->x_scroll - it->x - x;
@@ -1476,7 +1653,7 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		w = rt->x_scroll + pr->vis_width - it->x - x;
 		}
-	if (w < 1) return;
+	if (w < 1) return FALSE;
 	if (it->y + y < rt->y_scroll)
 		{
 		h -= rt->y_scroll - it->y - y;
@@ -1486,9 +1663,19 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		h = rt->y_scroll + pr->vis_height - it->y - y;
 		}
-	if (h < 1) return;
+	if (h < 1) return FALSE;
 
-	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+	return TRUE;
+}
+
+/**
+ * @brief Copies a region of the tile surface to the window surface.
+ */
+void rt_tile_expose_draw(RendererTiles *rt, ImageTile *it,
+                         gint x, gint y, gint w, gint h)
+{
+	PixbufRenderer *pr = rt->pr;
+	cairo_t *cr;
 
 	cr = cairo_create(rt->surface);
 	cairo_set_source_surface(cr, it->surface, pr->x_offset + (it->x - rt->x_scroll) + rt->stereo_off_x, pr->y_offset + (it->y - rt->y_scroll) + rt->stereo_off_y);
@@ -1508,6 +1695,17 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 	gtk_widget_queue_draw(GTK_WIDGET(rt->pr));
 }
 
+void rt_tile_expose(RendererTiles *rt, ImageTile *it,
+                    gint x, gint y, gint w, gint h,
+                    gboolean new_data, gboolean fast)
+{
+	if (!rt_tile_expose_clamp(rt, it, x, y, w, h)) return;
+
+	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+
+	rt_tile_expose_draw(rt, it, x, y, w, h);
+}
+
 
 gboolean rt_tile_is_visible(RendererTiles *rt, ImageTile *it)
 {
@@ -1582,11 +1780,172 @@ gboolean rt_queue_schedule_next_draw(RendererTiles *rt, gboolean force_set)
 }
 
 
+void rt_render_thread_func(gpointer data, gpointer)
+{
+	auto job = static_cast<TileRenderJob *>(data);
+	TileRenderBatch *batch = job->batch;
+
+	rt_tile_render_pixbuf(job);
+
+	g_mutex_lock(&batch->mutex);
+	batch->pending--;
+	g_cond_signal(&batch->cond);
+	g_mutex_unlock(&batch->mutex);
+}
+
+/**
+ * @brief Renders the pixel data of a batch of tiles in parallel and waits
+ *        for all of them. The first job is run by the calling thread.
+ */
+void rt_render_jobs(RendererTiles *rt, TileRenderJob *jobs, gint n)
+{
+	TileRenderBatch batch;
+
+	if (n < 1) return;
+
+	if (rt->render_spare_tiles->len < static_cast<guint>(n)) g_ptr_array_set_size(rt->render_spare_tiles, n);
+	for (gint i = 0; i < n; i++)
+		{
+		jobs[i].spare_tile = static_cast<GdkPixbuf *>(g_ptr_array_index(rt->render_spare_tiles, i));
+		}
+
+	if (n > 1)
+		{
+		const gint threads = rt_render_threads() - 1;
+
+		if (!rt_render_thread_pool)
+			{
+			rt_render_thread_pool = g_thread_pool_new(rt_render_thread_func, nullptr, threads, FALSE, nullptr);
+			}
+		else if (g_thread_pool_get_max_threads(rt_render_thread_pool) != threads)
+			{
+			g_thread_pool_set_max_threads(rt_render_thread_pool, threads, nullptr);
+			}
+
+		g_mutex_init(&batch.mutex);
+		g_cond_init(&batch.cond);
+		batch.pending = n - 1;
+
+		for (gint i = 1; i < n; i++)
+			{
+			jobs[i].batch = &batch;
+			g_thread_pool_push(rt_render_thread_pool, &jobs[i], nullptr);
+			}
+		}
+
+	rt_tile_render_pixbuf(&jobs[0]);
+
+	if (n > 1)
+		{
+		g_mutex_lock(&batch.mutex);
+		while (batch.pending > 0) g_cond_wait(&batch.cond, &batch.mutex);
+		g_mutex_unlock(&batch.mutex);
+
+		g_cond_clear(&batch.cond);
+		g_mutex_clear(&batch.mutex);
+		}
+
+	for (gint i = 0; i < n; i++)
+		{
+		g_ptr_array_index(rt->render_spare_tiles, i) = jobs[i].spare_tile;
+		}
+}
+
+/**
+ * @brief Finishes an item that has been unlinked from its queue, moving it
+ *        to the 2pass queue when it was only drawn fast.
+ */
+void rt_queue_item_done(RendererTiles *rt, QueueData *qd, gboolean first_pass, gboolean fast)
+{
+	if (first_pass)
+		{
+		qd->it->qd = nullptr;
+		if (fast)
+			{
+			if (qd->it->qd2)
+				{
+				rt_queue_merge(qd->it->qd2, qd);
+				g_free(qd);
+				}
+			else
+				{
+				qd->it->qd2 = qd;
+				rt->draw_queue_2pass = g_list_append(rt->draw_queue_2pass, qd);
+				}
+			}
+		else
+			{
+			g_free(qd);
+			}
+		}
+	else
+		{
+		qd->it->qd2 = nullptr;
+		g_free(qd);
+		}
+}
+
+/**
+ * @brief Renders one queue item.
+ * @retval TRUE The pixel work was deferred to @a jobs; the item must be
+ *         exposed and finished after the batch has been rendered.
+ */
+gboolean rt_queue_item_render(RendererTiles *rt, QueueData *qd, gboolean fast, gboolean batch,
+                              std::vector<TileRenderJob> &jobs, std::vector<GdkRectangle> &exposed)
+{
+	PixbufRenderer *pr = rt->pr;
+	ImageTile *it = qd->it;
+
+	if (!gtk_widget_get_realized(GTK_WIDGET(pr))) return FALSE;
+
+	if (rt_tile_is_visible(rt, it))
+		{
+		if (!batch)
+			{
+			rt_tile_expose(rt, it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+			return FALSE;
+			}
+
+		gint x = qd->x;
+		gint y = qd->y;
+		gint w = qd->w;
+		gint h = qd->h;
+		TileRenderJob job{};
+
+		if (!rt_tile_expose_clamp(rt, it, x, y, w, h)) return FALSE;
+
+		if (rt_tile_render_begin(rt, it, x, y, w, h, qd->new_data, fast, job))
+			{
+			if (!it->blank)
+				{
+				jobs.push_back(job);
+				exposed.push_back({x, y, w, h});
+				return TRUE;
+				}
+
+			rt_tile_render_blank(it);
+			}
+
+		rt_tile_expose_draw(rt, it, x, y, w, h);
+		}
+	else if (qd->new_data)
+		{
+		/* if new pixel data, and we already have a pixmap, update the tile */
+		it->blank = FALSE;
+		if (it->surface && it->render_done == TILE_RENDER_ALL)
+			{
+			rt_tile_render(rt, it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+			}
+		}
+
+	return FALSE;
+}
+
 gboolean rt_queue_draw_idle_cb(gpointer data)
 {
 	auto rt = static_cast<RendererTiles *>(data);
 	PixbufRenderer *pr = rt->pr;
-	QueueData *qd;
+	gboolean first_pass;
 	gboolean fast;
 
 
@@ -1602,7 +1961,7 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 
 	if (rt->draw_queue)
 		{
-		qd = static_cast<QueueData *>(rt->draw_queue->data);
+		first_pass = TRUE;
 		fast = (pr->zoom_2pass && ((pr->zoom_quality != GDK_INTERP_NEAREST && pr->scale != 1.0) || pr->post_process_slow));
 		}
 	else
@@ -1614,54 +1973,46 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 			return rt_queue_schedule_next_draw(rt, FALSE);
 			}
 
-		qd = static_cast<QueueData *>(rt->draw_queue_2pass->data);
+		first_pass = FALSE;
 		fast = FALSE;
 		}
 
-	if (gtk_widget_get_realized(GTK_WIDGET(pr)))
-		{
-		if (rt_tile_is_visible(rt, qd->it))
-			{
-			rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
-			}
-		else if (qd->new_data)
-			{
-			/* if new pixel data, and we already have a pixmap, update the tile */
-			qd->it->blank = FALSE;
-			if (qd->it->surface && qd->it->render_done == TILE_RENDER_ALL)
-				{
-				rt_tile_render(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
-				}
-			}
-		}
+	/* Tiles drawn directly from pr->pixbuf are rendered in batches on the
+	 * render thread pool. Source tiles are rendered one at a time, as the
+	 * source tile cache is only accessed from the main thread.
+	 */
+	const gint batch_max = (pr->pixbuf && !pr->source_tiles_enabled) ? rt_render_threads() : 1;
+	GList **queue = first_pass ? &rt->draw_queue : &rt->draw_queue_2pass;
+	std::vector<TileRenderJob> jobs;
+	std::vector<GdkRectangle> exposed;
+	std::vector<QueueData *> deferred;
 
-	if (rt->draw_queue)
+	for (gint n = 0; n < batch_max && *queue; n++)
 		{
-		qd->it->qd = nullptr;
-		rt->draw_queue = g_list_remove(rt->draw_queue, qd);
-		if (fast)
+		auto qd = static_cast<QueueData *>((*queue)->data);
+
+		/* tiles of deferred items are visible and keep their it->qd or it->qd2,
+		 * so rt_tile_free_space() will not free them before they are done
+		 */
+		*queue = g_list_delete_link(*queue, *queue);
+
+		if (rt_queue_item_render(rt, qd, fast, batch_max > 1, jobs, exposed))
 			{
-			if (qd->it->qd2)
-				{
-				rt_queue_merge(qd->it->qd2, qd);
-				g_free(qd);
-				}
-			else
-				{
-				qd->it->qd2 = qd;
-				rt->draw_queue_2pass = g_list_append(rt->draw_queue_2pass, qd);
-				}
+			deferred.push_back(qd);
 			}
 		else
 			{
-			g_free(qd);
+			rt_queue_item_done(rt, qd, first_pass, fast);
 			}
 		}
-	else
+
+	rt_render_jobs(rt, jobs.data(), static_cast<gint>(jobs.size()));
+
+	for (size_t i = 0; i < jobs.size(); i++)
 		{
-		qd->it->qd2 = nullptr;
-		rt->draw_queue_2pass = g_list_remove(rt->draw_queue_2pass, qd);
-		g_free(qd);
+		rt_tile_render_end(&jobs[i]);
+		rt_tile_expose_draw(rt, jobs[i].it, exposed[i].x, exposed[i].y, exposed[i].width, exposed[i].height);
+		rt_queue_item_done(rt, deferred[i], first_pass, fast);
 		}
 
 	if (!rt->draw_queue && !rt->draw_queue_2pass)
@@ -2083,7 +2434,14 @@ void renderer_free(void *renderer)
 	auto rt = static_cast<RendererTiles *>(renderer);
 	rt_queue_clear(rt);
 	rt_tile_free_all(rt);
+	g_hash_table_destroy(rt->tiles);
 	if (rt->spare_tile) g_object_unref(rt->spare_tile);
+	for (guint i = 0; i < rt->render_spare_tiles->len; i++)
+		{
+		auto spare_tile = static_cast<GdkPixbuf *>(g_ptr_array_index(rt->render_spare_tiles, i));
+		if (spare_tile) g_object_unref(spare_tile);
+		}
+	g_ptr_array_free(rt->render_spare_tiles, TRUE);
 	if (rt->overlay_buffer) g_object_unref(rt->overlay_buffer);
 	rt_overlay_list_clear(rt);
 	/* disconnect "hierarchy-changed" */
@@ -2208,13 +2566,17 @@ RendererFuncs *renderer_tiles_new(PixbufRenderer *pr)
 	rt->tile_width = options->image.tile_size;
 	rt->tile_height = options->image.tile_size;
 
-	rt->tiles = nullptr;
+	rt->tiles = g_hash_table_new(g_int64_hash, g_int64_equal);
+	rt->tiles_mru = nullptr;
+	rt->tiles_lru = nullptr;
 	rt->tile_cache_size = 0;
 
 	rt->tile_cache_max = PR_CACHE_SIZE_DEFAULT;
 
 	rt->draw_idle_id = 0;
 
+	rt->render_spare_tiles = g_ptr_array_new();
+
 	rt->stereo_mode = 0;
 	rt->stereo_off_x = 0;
 	rt->stereo_off_y = 0;
@@ -1866,6 +1866,7 @@ static gboolean search_file_do_extra(SearchData *sd, FileData *fd, gint *match,
 		if ((sd->match_dimensions_enable && !sd->img_cd->dimensions) || (sd->match_similarity_enable && !sd->img_cd->similarity) || sd->match_broken_enable)
 			{
 			sd->img_loader = image_loader_new(fd);
+			image_loader_set_job_class(sd->img_loader, IMAGE_LOADER_JOB_BACKGROUND);
 			g_signal_connect(G_OBJECT(sd->img_loader), "error", (GCallback)search_file_load_done_cb, sd);
 			g_signal_connect(G_OBJECT(sd->img_loader), "done", (GCallback)search_file_load_done_cb, sd);
 			if (image_loader_start(sd->img_loader))
@@ -2710,6 +2711,7 @@ static void search_start(SearchData *sd)
 				}
 
 			sd->img_loader = image_loader_new(file_data_new_group(sd->search_similarity_path));
+			image_loader_set_job_class(sd->img_loader, IMAGE_LOADER_JOB_BACKGROUND);
 			g_signal_connect(G_OBJECT(sd->img_loader), "error", (GCallback)search_similarity_load_done_cb, sd);
 			g_signal_connect(G_OBJECT(sd->img_loader), "done", (GCallback)search_similarity_load_done_cb, sd);
 			if (image_loader_start(sd->img_loader))
@@ -83,7 +83,11 @@
  * @FIXME Low risk race conditions about ssi->file_name.
  */
 
-SecureSaveErrno secsave_errno = SS_ERR_NONE;
+/* files are saved from worker threads too, e.g. the similarity cache */
+thread_local SecureSaveErrno secsave_errno = SS_ERR_NONE;
+
+/* the umask is per process, threads must not restore each other's */
+static GMutex secsave_umask_mutex;
 
 
 /** Open a file for writing in a secure way. @returns a pointer to a
@@ -209,9 +213,11 @@ secure_open(const gchar *file_name)
 	const mode_t mask = S_IXUSR | S_IRWXG | S_IRWXO;
 #endif
 
+	g_mutex_lock(&secsave_umask_mutex);
 	saved_mask = umask(mask);
 	ssi = secure_open_umask(file_name);
 	umask(saved_mask);
+	g_mutex_unlock(&secsave_umask_mutex);
 
 	return ssi;
 }
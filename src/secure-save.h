@@ -43,7 +43,7 @@ enum SecureSaveErrno {
 	SS_ERR_OTHER,
 };
 
-extern SecureSaveErrno secsave_errno; /**< internal secsave error number */
+extern thread_local SecureSaveErrno secsave_errno; /**< internal secsave error number, per thread */
 
 struct SecureSaveInfo {
 	FILE *fp; /**< file stream pointer */
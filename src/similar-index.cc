@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "similar-index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+
+#include "options.h"
+#include "similar.h"
+
+/**
+ * @file
+ *
+ * Candidate search for image_sim_compare_fast().
+ *
+ * Each image is reduced to a signature: the sums of the 4 x 4 blocks of
+ * 8 x 8 cells of each color plane. For any partition of the cells, the
+ * L1 distance of the block sums is at most the sum of absolute cell
+ * differences, so the signature distance is a lower bound of the value
+ * image_sim_compare_fast() computes (and of the alternate algorithm,
+ * whose sum is never smaller). The block grid maps onto itself under the
+ * 8 rotations/mirrors, so the bound also holds for rotation invariant
+ * matching by transforming the signature.
+ *
+ * Signatures are kept in a BK-tree over the L1 metric. A search returns
+ * every image whose bound does not already rule out a match, so running
+ * the full compare on the candidates gives the same results as comparing
+ * every pair.
+ */
+
+namespace
+{
+
+constexpr gint SIG_GRID = 4;
+constexpr gint SIG_BLOCKS = SIG_GRID * SIG_GRID;
+constexpr gint SIG_LEN = 3 * SIG_BLOCKS;
+
+/** Width of the distance range covered by one BK-tree child */
+constexpr guint BK_BUCKET = 1024;
+
+struct Signature
+{
+	guint32 v[SIG_LEN];
+};
+
+struct Node
+{
+	Signature sig;
+	gint id;
+	std::map<guint, gsize> children; /**< distance / #BK_BUCKET -> index in ImageSimIndex::nodes */
+};
+
+void signature_from_data(const ImageSimilarityData *sd, Signature &sig)
+{
+	const guint8 *planes[3] = {sd->avg_r, sd->avg_g, sd->avg_b};
+
+	sig = {};
+
+	for (gint c = 0; c < 3; c++)
+		{
+		for (gint n = 0; n < 1024; n++)
+			{
+			gint block = ((n / 32) / 8) * SIG_GRID + ((n % 32) / 8);
+
+			sig.v[(c * SIG_BLOCKS) + block] += planes[c][n];
+			}
+		}
+}
+
+/* same mapping as image_sim_data_compare_transfo(), on the block grid */
+void signature_transform(const Signature &in, gint transfo, Signature &out)
+{
+	for (gint i1 = 0; i1 < SIG_GRID; i1++)
+		{
+		for (gint j1 = 0; j1 < SIG_GRID; j1++)
+			{
+			gint i = (transfo & 4) ? SIG_GRID - 1 - i1 : i1;
+			gint j = (transfo & 2) ? SIG_GRID - 1 - j1 : j1;
+			gint i2 = (transfo & 1) ? j : i;
+			gint j2 = (transfo & 1) ? i : j;
+
+			for (gint c = 0; c < 3; c++)
+				{
+				out.v[(c * SIG_BLOCKS) + (i1 * SIG_GRID) + j1] = in.v[(c * SIG_BLOCKS) + (i2 * SIG_GRID) + j2];
+				}
+			}
+		}
+}
+
+guint signature_distance(const Signature &a, const Signature &b)
+{
+	guint d = 0;
+
+	for (gint n = 0; n < SIG_LEN; n++)
+		{
+		d += abs(static_cast<gint>(a.v[n]) - static_cast<gint>(b.v[n]));
+		}
+
+	return d;
+}
+
+} // namespace
+
+struct ImageSimIndex
+{
+	std::vector<Node> nodes;
+};
+
+ImageSimIndex *image_sim_index_new()
+{
+	return new ImageSimIndex();
+}
+
+void image_sim_index_free(ImageSimIndex *si)
+{
+	delete si;
+}
+
+/**
+ * @brief Adds an image to the index
+ * @param id Returned by image_sim_index_find() for this image
+ *
+ * Images without similarity data can never match and are not added.
+ */
+void image_sim_index_add(ImageSimIndex *si, const ImageSimilarityData *sd, gint id)
+{
+	if (!si || !sd || !sd->filled) return;
+
+	Node node;
+	signature_from_data(sd, node.sig);
+	node.id = id;
+
+	gsize new_index = si->nodes.size();
+	gsize n = 0;
+
+	while (new_index > 0)
+		{
+		guint key = signature_distance(si->nodes[n].sig, node.sig) / BK_BUCKET;
+		auto child = si->nodes[n].children.find(key);
+
+		if (child == si->nodes[n].children.end())
+			{
+			si->nodes[n].children.emplace(key, new_index);
+			break;
+			}
+
+		n = child->second;
+		}
+
+	si->nodes.push_back(std::move(node));
+}
+
+/**
+ * @brief Finds the images that may be similar to \a needle
+ * @param min Similarity threshold, as passed to image_sim_compare_fast()
+ * @param ids Set to the ids of the candidates, in ascending order
+ *
+ * Every image for which image_sim_compare_fast(image, needle, min) >= min
+ * is returned. The caller must compare every image itself if min <= 0,
+ * as images without similarity data then match too.
+ */
+void image_sim_index_find(const ImageSimIndex *si, const ImageSimilarityData *needle, gdouble min, std::vector<gint> &ids)
+{
+	ids.clear();
+
+	if (!si || si->nodes.empty() || !needle || !needle->filled) return;
+
+	const gboolean alternate = options->alternate_similarity_algorithm.enabled;
+	const gdouble scale = alternate ? 255.0 * 1024.0 * 4.0 : 255.0 * 1024.0 * 3.0;
+	const gint transforms = (!alternate && options->rot_invariant_sim) ? 8 : 1;
+	const gdouble limit = 1.0 - min;
+
+	if (limit < 0.0) return;
+
+	/* largest distance that does not exceed the limit image_sim_compare_fast() aborts at */
+	auto radius = static_cast<guint>(std::min(std::floor(limit * scale), scale));
+	while (static_cast<gdouble>(radius + 1) / scale <= limit) radius++;
+	while (radius > 0 && static_cast<gdouble>(radius) / scale > limit) radius--;
+
+	Signature sig;
+	signature_from_data(needle, sig);
+
+	std::vector<gsize> stack;
+
+	for (gint t = 0; t < transforms; t++)
+		{
+		Signature query;
+		signature_transform(sig, t, query);
+
+		stack.push_back(0);
+		while (!stack.empty())
+			{
+			const Node &node = si->nodes[stack.back()];
+			stack.pop_back();
+
+			guint d = signature_distance(node.sig, query);
+			if (d <= radius) ids.push_back(node.id);
+
+			guint lo = (d > radius) ? (d - radius) / BK_BUCKET : 0;
+			guint hi = (d + radius) / BK_BUCKET;
+
+			for (auto child = node.children.lower_bound(lo); child != node.children.end() && child->first <= hi; ++child)
+				{
+				stack.push_back(child->second);
+				}
+			}
+		}
+
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
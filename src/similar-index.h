@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SIMILAR_INDEX_H
+#define SIMILAR_INDEX_H
+
+#include <vector>
+
+#include <glib.h>
+
+struct ImageSimIndex;
+struct ImageSimilarityData;
+
+ImageSimIndex *image_sim_index_new();
+void image_sim_index_free(ImageSimIndex *si);
+
+void image_sim_index_add(ImageSimIndex *si, const ImageSimilarityData *sd, gint id);
+void image_sim_index_find(const ImageSimIndex *si, const ImageSimilarityData *needle, gdouble min, std::vector<gint> &ids);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
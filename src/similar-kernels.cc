@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "similar-kernels.h"
+
+#include <cstdlib>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define IMAGE_SIM_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @file
+ *
+ * The portable kernels are the reference implementation. On x86-64 SSE2 is
+ * always available; AVX2 is selected at run time when the CPU supports it.
+ * All kernels must return exactly the same results.
+ */
+
+namespace
+{
+
+guint sad_scalar(const guint8 *const a[3], const guint8 *const b[3], gsize offset, gsize len)
+{
+	guint sim = 0;
+
+	for (gint c = 0; c < 3; c++)
+		{
+		const guint8 *pa = a[c] + offset;
+		const guint8 *pb = b[c] + offset;
+
+		for (gsize i = 0; i < len; i++)
+			{
+			sim += abs(pa[i] - pb[i]);
+			}
+		}
+
+	return sim;
+}
+
+guint alternate_scalar(const guint8 *const a[3], const guint8 *const b[3], gsize offset, gsize len, gint &prev_cd)
+{
+	guint sim = 0;
+
+	for (gsize i = offset; i < offset + len; i++)
+		{
+		gint cd;
+
+		cd = abs(a[0][i] - b[0][i]) + abs(a[1][i] - b[1][i]) + abs(a[2][i] - b[2][i]);
+		sim += cd + abs(cd - prev_cd / 3);
+		prev_cd = cd;
+		}
+
+	return sim;
+}
+
+void sum_bytes_scalar(const guchar *p, gint rowstride, gint rows, gsize bytes, guint32 sums[IMAGE_SIM_SUM_PERIOD])
+{
+	for (gint y = 0; y < rows; y++)
+		{
+		const guchar *row = p + (y * rowstride);
+
+		for (gsize base = 0; base < bytes; base += IMAGE_SIM_SUM_PERIOD)
+			{
+			gsize n = MIN(IMAGE_SIM_SUM_PERIOD, bytes - base);
+
+			for (gsize t = 0; t < n; t++)
+				{
+				sums[t] += row[base + t];
+				}
+			}
+		}
+}
+
+#ifdef IMAGE_SIM_X86
+
+guint sad_sse2(const guint8 *const a[3], const guint8 *const b[3], gsize offset, gsize len)
+{
+	__m128i acc = _mm_setzero_si128();
+
+	for (gint c = 0; c < 3; c++)
+		{
+		for (gsize i = offset; i < offset + len; i += 16)
+			{
+			__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a[c] + i));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b[c] + i));
+
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+			}
+		}
+
+	return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+__attribute__((target("avx2")))
+guint sad_avx2(const guint8 *const a[3], const guint8 *const b[3], gsize offset, gsize len)
+{
+	__m256i acc = _mm256_setzero_si256();
+
+	for (gint c = 0; c < 3; c++)
+		{
+		for (gsize i = offset; i < offset + len; i += 32)
+			{
+			__m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a[c] + i));
+			__m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b[c] + i));
+
+			acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+			}
+		}
+
+	__m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+
+	return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+
+/*
+ * 16 cells per step, as two vectors of 8 16-bit cd values. The previous cd
+ * of each cell is the vector shifted by one lane, with the last cd of the
+ * previous step shifted in. x / 3 is computed as (x * 0xAAAB) >> 17, which
+ * is exact for all x < 65536.
+ */
+guint alternate_sse2(const guint8 *const a[3], const guint8 *const b[3], gsize offset, gsize len, gint &prev_cd)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	const __m128i third = _mm_set1_epi16(static_cast<gshort>(0xAAAB));
+	__m128i carry = _mm_insert_epi16(zero, prev_cd, 7);
+	__m128i acc = zero;
+
+	for (gsize i = offset; i < offset + len; i += 16)
+		{
+		__m128i cd_lo = zero;
+		__m128i cd_hi = zero;
+
+		for (gint c = 0; c < 3; c++)
+			{
+			__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a[c] + i));
+			__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b[c] + i));
+			__m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+
+			cd_lo = _mm_add_epi16(cd_lo, _mm_unpacklo_epi8(d, zero));
+			cd_hi = _mm_add_epi16(cd_hi, _mm_unpackhi_epi8(d, zero));
+			}
+
+		__m128i prev_lo = _mm_or_si128(_mm_slli_si128(cd_lo, 2), _mm_srli_si128(carry, 14));
+		__m128i prev_hi = _mm_or_si128(_mm_slli_si128(cd_hi, 2), _mm_srli_si128(cd_lo, 14));
+		carry = cd_hi;
+
+		__m128i ld_lo = _mm_srli_epi16(_mm_mulhi_epu16(prev_lo, third), 1);
+		__m128i ld_hi = _mm_srli_epi16(_mm_mulhi_epu16(prev_hi, third), 1);
+
+		__m128i diff_lo = _mm_sub_epi16(cd_lo, ld_lo);
+		__m128i diff_hi = _mm_sub_epi16(cd_hi, ld_hi);
+		diff_lo = _mm_max_epi16(diff_lo, _mm_sub_epi16(zero, diff_lo));
+		diff_hi = _mm_max_epi16(diff_hi, _mm_sub_epi16(zero, diff_hi));
+
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_add_epi16(cd_lo, diff_lo), ones));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_add_epi16(cd_hi, diff_hi), ones));
+		}
+
+	prev_cd = _mm_extract_epi16(carry, 7);
+
+	acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 8));
+	acc = _mm_add_epi32(acc, _mm_srli_si128(acc, 4));
+
+	return _mm_cvtsi128_si32(acc);
+}
+
+/*
+ * Sums 48 byte periods into 16-bit lanes, flushing to the 32-bit sums
+ * before a lane can overflow (256 * 255 < 65536).
+ */
+void sum_bytes_sse2(const guchar *p, gint rowstride, gint rows, gsize bytes, guint32 sums[IMAGE_SIM_SUM_PERIOD])
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc[IMAGE_SIM_SUM_PERIOD / 8];
+	gsize chunks = bytes / IMAGE_SIM_SUM_PERIOD;
+	gsize tail = chunks * IMAGE_SIM_SUM_PERIOD;
+	gint pending = 0;
+
+	for (auto &v : acc) v = zero;
+
+	auto flush = [&]()
+		{
+		alignas(16) guint16 lanes[IMAGE_SIM_SUM_PERIOD];
+
+		for (gint k = 0; k < IMAGE_SIM_SUM_PERIOD / 8; k++)
+			{
+			_mm_store_si128(reinterpret_cast<__m128i *>(lanes + (8 * k)), acc[k]);
+			acc[k] = zero;
+			}
+		for (gint t = 0; t < IMAGE_SIM_SUM_PERIOD; t++)
+			{
+			sums[t] += lanes[t];
+			}
+		pending = 0;
+		};
+
+	for (gint y = 0; y < rows; y++)
+		{
+		const guchar *row = p + (y * rowstride);
+
+		for (gsize c = 0; c < chunks; c++)
+			{
+			const guchar *q = row + (c * IMAGE_SIM_SUM_PERIOD);
+
+			for (gint k = 0; k < IMAGE_SIM_SUM_PERIOD / 16; k++)
+				{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q + (16 * k)));
+
+				acc[2 * k] = _mm_add_epi16(acc[2 * k], _mm_unpacklo_epi8(v, zero));
+				acc[(2 * k) + 1] = _mm_add_epi16(acc[(2 * k) + 1], _mm_unpackhi_epi8(v, zero));
+				}
+
+			if (++pending == 256) flush();
+			}
+
+		for (gsize t = tail; t < bytes; t++)
+			{
+			sums[t - tail] += row[t];
+			}
+		}
+
+	if (pending) flush();
+}
+
+bool cpu_has_avx2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+const ImageSimKernels kernels_scalar{"scalar", sad_scalar, alternate_scalar, sum_bytes_scalar};
+#ifdef IMAGE_SIM_X86
+const ImageSimKernels kernels_sse2{"sse2", sad_sse2, alternate_sse2, sum_bytes_sse2};
+const ImageSimKernels kernels_avx2{"avx2", sad_avx2, alternate_sse2, sum_bytes_sse2};
+#endif
+
+} // namespace
+
+const ImageSimKernels *image_sim_kernels_scalar()
+{
+	return &kernels_scalar;
+}
+
+/**
+ * @brief The fastest kernels supported by this CPU
+ */
+const ImageSimKernels *image_sim_kernels_best()
+{
+	static const ImageSimKernels *best = []()
+		{
+#ifdef IMAGE_SIM_X86
+		if (cpu_has_avx2()) return &kernels_avx2;
+		return &kernels_sse2;
+#else
+		return &kernels_scalar;
+#endif
+		}();
+
+	return best;
+}
+
+/**
+ * @brief All kernels usable on this CPU, scalar first
+ */
+std::vector<const ImageSimKernels *> image_sim_kernels_available()
+{
+	std::vector<const ImageSimKernels *> list{&kernels_scalar};
+
+#ifdef IMAGE_SIM_X86
+	list.push_back(&kernels_sse2);
+	if (cpu_has_avx2()) list.push_back(&kernels_avx2);
+#endif
+
+	return list;
+}
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SIMILAR_KERNELS_H
+#define SIMILAR_KERNELS_H
+
+#include <vector>
+
+#include <glib.h>
+
+/**
+ * Byte positions tracked by ImageSimKernels::sum_bytes(). A multiple of
+ * both 3 and 4, so position % pixel step gives the channel.
+ */
+#define IMAGE_SIM_SUM_PERIOD 48
+
+/**
+ * @brief Inner loops of the similarity code, one set per instruction set
+ *
+ * Planes are the red, green and blue grids of #ImageSimilarityData.
+ * Offsets and lengths must be multiples of 32.
+ */
+struct ImageSimKernels
+{
+	const gchar *name;
+
+	/** Sum of absolute differences over cells [offset, offset + len) of all three planes */
+	guint (*sad)(const guint8 *const a[3], const guint8 *const b[3], gsize offset, gsize len);
+
+	/**
+	 * Sum used by the alternate algorithm: for each cell cd = sum of channel
+	 * differences, adds cd + |cd - previous cd / 3|. \a prev_cd carries the last
+	 * cd between calls and starts at 0.
+	 */
+	guint (*alternate)(const guint8 *const a[3], const guint8 *const b[3], gsize offset, gsize len, gint &prev_cd);
+
+	/**
+	 * Adds the bytes of \a rows rows of \a bytes bytes each to \a sums,
+	 * indexed by position within the row modulo #IMAGE_SIM_SUM_PERIOD.
+	 */
+	void (*sum_bytes)(const guchar *p, gint rowstride, gint rows, gsize bytes, guint32 sums[IMAGE_SIM_SUM_PERIOD]);
+};
+
+const ImageSimKernels *image_sim_kernels_scalar();
+const ImageSimKernels *image_sim_kernels_best();
+std::vector<const ImageSimKernels *> image_sim_kernels_available();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
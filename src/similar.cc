@@ -22,12 +22,14 @@
 #include "similar.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdlib>
 #include <functional>
 #include <vector>
 
 #include "options.h"
+#include "similar-kernels.h"
 
 /**
  * @file
@@ -91,32 +93,72 @@ void image_sim_channel_equal(guint8 *pix, gsize len)
  * generate all possible isometric transformations
  * = 8 tests
  * = change dir of x, change dir of y, exchange x and y = 2^3 = 8
+ *
+ * transform_tables[t][a] is the cell of b compared with cell a of a
  */
+using TransformTables = std::array<std::array<guint16, 1024>, 8>;
+
+const TransformTables &image_sim_transform_tables()
+{
+	static const TransformTables tables = []()
+		{
+		TransformTables t;
+
+		for (gint transfo = 0; transfo < 8; transfo++)
+			{
+			for (gint i1 = 0; i1 < 32; i1++)
+				{
+				for (gint j1 = 0; j1 < 32; j1++)
+					{
+					gint i = (transfo & 4) ? 31 - i1 : i1;
+					gint j = (transfo & 2) ? 31 - j1 : j1;
+					gint i2 = (transfo & 1) ? j : i;
+					gint j2 = (transfo & 1) ? i : j;
+
+					t[transfo][i1 * 32 + j1] = i2 * 32 + j2;
+					}
+				}
+			}
+
+		return t;
+		}();
+
+	return tables;
+}
+
 gdouble image_sim_data_compare_transfo(const ImageSimilarityData *a, const ImageSimilarityData *b, gchar transfo, const ImageSimilarityCheckAbort &check_abort)
 {
 	if (!a || !b || !a->filled || !b->filled) return 0.0;
 
-	gint sim = 0.0;
-	gint i2;
-	gint *i;
-	gint j2;
-	gint *j;
+	const ImageSimKernels *kernels = image_sim_kernels_best();
+	const guint8 *const planes_a[3] = {a->avg_r, a->avg_g, a->avg_b};
+	const guint8 *planes_b[3] = {b->avg_r, b->avg_g, b->avg_b};
+	alignas(32) guint8 transformed[3][1024];
 
-	if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
-	for (gint j1 = 0; j1 < 32; j1++)
+	if (transfo != 0)
 		{
-		if (transfo & 2) *j = 31-j1; else *j = j1;
-		for (gint i1 = 0; i1 < 32; i1++)
+		const auto &table = image_sim_transform_tables()[transfo];
+
+		for (gint c = 0; c < 3; c++)
 			{
-			if (transfo & 4) *i = 31-i1; else *i = i1;
-			sim += abs(a->avg_r[i1*32+j1] - b->avg_r[i2*32+j2]);
-			sim += abs(a->avg_g[i1*32+j1] - b->avg_g[i2*32+j2]);
-			sim += abs(a->avg_b[i1*32+j1] - b->avg_b[i2*32+j2]);
-			/* check for abort, if so return 0.0 */
-			if (check_abort(sim)) return 0.0;
+			for (gint n = 0; n < 1024; n++)
+				{
+				transformed[c][n] = planes_b[c][table[n]];
+				}
+			planes_b[c] = transformed[c];
 			}
 		}
 
+	gint sim = 0;
+
+	/* the sum only grows, so checking every 8 rows aborts exactly when checking every cell would */
+	for (gsize offset = 0; offset < 1024; offset += 256)
+		{
+		sim += kernels->sad(planes_a, planes_b, offset, 256);
+		/* check for abort, if so return 0.0 */
+		if (check_abort(sim)) return 0.0;
+		}
+
 	return 1.0 - (static_cast<gdouble>(sim) / (255.0 * 1024.0 * 3.0));
 }
 
@@ -214,7 +256,6 @@ void image_sim_fill_data(ImageSimilarityData *sd, GdkPixbuf *pixbuf)
 	gboolean has_alpha;
 	gint p_step;
 
-	guchar *p;
 	gint i;
 	gint j;
 	gint x_inc;
@@ -252,6 +293,8 @@ void image_sim_fill_data(ImageSimilarityData *sd, GdkPixbuf *pixbuf)
 		y_small = TRUE;
 		}
 
+	const ImageSimKernels *kernels = image_sim_kernels_best();
+
 	j = 0;
 
 	for (ys = 0; ys < 32; ys++)
@@ -263,30 +306,24 @@ void image_sim_fill_data(ImageSimilarityData *sd, GdkPixbuf *pixbuf)
 		w_left = w;
 		for (xs = 0; xs < 32; xs++)
 			{
-			gint x;
-			gint y;
+			guint32 sums[IMAGE_SIM_SUM_PERIOD] = {0};
 			gint r;
 			gint g;
 			gint b;
 			gint t;
-			guchar *xpos;
 
 			if (x_small) i = static_cast<gdouble>(w) / 32 * xs;
 			else x_inc = std::lround(static_cast<gdouble>(w_left)/(32-xs));
 			xy_inc = x_inc * y_inc;
-			r = g = b = 0;
-			xpos = pix + (i * p_step);
 
-			for (y = j; y < j + y_inc; y++)
+			kernels->sum_bytes(pix + (j * rs) + (i * p_step), rs, y_inc, x_inc * p_step, sums);
+
+			r = g = b = 0;
+			for (t = 0; t < IMAGE_SIM_SUM_PERIOD; t += p_step)
 				{
-				p = xpos + (y * rs);
-				for (x = i; x < i + x_inc; x++)
-					{
-					r += p[0];
-					g += p[1];
-					b += p[2];
-					p += p_step;
-					}
+				r += sums[t];
+				g += sums[t + 1];
+				b += sums[t + 2];
 				}
 
 			r /= xy_inc;
@@ -321,33 +358,17 @@ ImageSimilarityData *image_sim_new_from_pixbuf(GdkPixbuf *pixbuf)
 
 static gdouble alternate_image_sim_compare_fast(const ImageSimilarityData *a, const ImageSimilarityData *b, gdouble min)
 {
-	gint sim;
-	gint i;
-	gint j;
-	gint ld;
-
 	if (!a || !b || !a->filled || !b->filled) return 0.0;
 
-	sim = 0.0;
-	ld = 0;
+	const ImageSimKernels *kernels = image_sim_kernels_best();
+	const guint8 *const planes_a[3] = {a->avg_r, a->avg_g, a->avg_b};
+	const guint8 *const planes_b[3] = {b->avg_r, b->avg_g, b->avg_b};
+	gint sim = 0;
+	gint prev_cd = 0;
 
-	for (j = 0; j < 1024; j += 32)
+	for (gsize offset = 0; offset < 1024; offset += 256)
 		{
-		for (i = j; i < j + 32; i++)
-			{
-			gint cr;
-			gint cg;
-			gint cb;
-			gint cd;
-
-			cr = abs(a->avg_r[i] - b->avg_r[i]);
-			cg = abs(a->avg_g[i] - b->avg_g[i]);
-			cb = abs(a->avg_b[i] - b->avg_b[i]);
-
-			cd = cr + cg + cb;
-			sim += cd + abs(cd - ld);
-			ld = cd / 3;
-			}
+		sim += kernels->alternate(planes_a, planes_b, offset, 256, prev_cd);
 		/* check for abort, if so return 0.0 */
 		if ((gdouble)sim / (255.0 * 1024.0 * 4.0) > min) return 0.0;
 		}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for cache-exif-index.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "cache-exif-index.h"
+#include "exif.h"
+#include "options.h"
+#include "test-util.h"
+
+namespace {
+
+// A little endian TIFF with only Exif.Image.Make = "Test"
+const guchar tiff_make[] = {
+	'I', 'I', 0x2a, 0x00, 0x08, 0x00, 0x00, 0x00,
+	0x01, 0x00,
+	0x0f, 0x01, 0x02, 0x00, 0x05, 0x00, 0x00, 0x00, 0x1a, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+	'T', 'e', 's', 't', '\0',
+};
+
+class ExifIndexTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+
+		if (!options) options = init_options(nullptr);
+		enable_caching = options->thumbnails.enable_caching;
+		options->thumbnails.enable_caching = TRUE;
+	}
+
+	void TearDown() override
+	{
+		exif_index_close();
+
+		options->thumbnails.enable_caching = enable_caching;
+
+		TempDirTest::TearDown();
+	}
+
+	/* writes the file and records it in the index */
+	void Add(const gchar *name, ExifIndexFile &file)
+	{
+		const gchar *path = WriteFile(name, tiff_make, sizeof(tiff_make));
+
+		file = {};
+		file.path = const_cast<gchar *>(path);
+		file.size = sizeof(tiff_make);
+		file.date = 1000000;
+
+		ExifData *exif = exif_read(path, nullptr, nullptr);
+		ASSERT_NE(nullptr, exif);
+		exif_index_update_file(file, exif);
+		exif_free(exif);
+	}
+
+	static gboolean LookupMake(const ExifIndexFile &file, std::string &make)
+	{
+		GList *values = nullptr;
+
+		if (!exif_index_lookup_file(file, "Exif.Image.Make", METADATA_PLAIN, &values)) return FALSE;
+
+		make = values ? static_cast<const gchar *>(values->data) : "";
+		g_list_free_full(values, g_free);
+
+		return TRUE;
+	}
+
+	gboolean enable_caching = FALSE;
+};
+
+TEST_F(ExifIndexTest, SaveAndLoad)
+{
+	ExifIndexFile file;
+	Add("a.tif", file);
+
+	std::string make;
+	ASSERT_TRUE(LookupMake(file, make));
+	EXPECT_EQ("Test", make);
+
+	// Written to disk, and read back on the next lookup
+	exif_index_close();
+
+	ASSERT_TRUE(LookupMake(file, make));
+	EXPECT_EQ("Test", make);
+
+	// Keys that are not indexed are not found
+	GList *values = nullptr;
+	EXPECT_FALSE(exif_index_lookup_file(file, "Exif.Image.Artist", METADATA_PLAIN, &values));
+}
+
+TEST_F(ExifIndexTest, ChangedFileIsNotFound)
+{
+	ExifIndexFile file;
+	Add("a.tif", file);
+	exif_index_close();
+
+	std::string make;
+
+	ExifIndexFile changed = file;
+	changed.size++;
+	EXPECT_FALSE(LookupMake(changed, make));
+
+	changed = file;
+	changed.date++;
+	EXPECT_FALSE(LookupMake(changed, make));
+
+	changed = file;
+	changed.sidecar_date = 1;
+	EXPECT_FALSE(LookupMake(changed, make));
+
+	changed = file;
+	changed.modified_xmp = TRUE;
+	EXPECT_FALSE(LookupMake(changed, make));
+
+	EXPECT_TRUE(LookupMake(file, make));
+}
+
+TEST_F(ExifIndexTest, DeletedFileIsDropped)
+{
+	ExifIndexFile kept;
+	ExifIndexFile deleted;
+	Add("kept.tif", kept);
+	Add("deleted.tif", deleted);
+
+	ASSERT_EQ(0, g_unlink(deleted.path));
+	exif_index_close();
+
+	std::string make;
+	EXPECT_TRUE(LookupMake(kept, make));
+	EXPECT_FALSE(LookupMake(deleted, make));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for cache-sim-index.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "cache-sim-index.h"
+#include "cache.h"
+#include "filedata.h"
+#include "options.h"
+#include "similar.h"
+#include "test-util.h"
+
+namespace {
+
+class SimIndexTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+
+		if (!options) options = init_options(nullptr);
+
+		sim = test_sim_new();
+	}
+
+	void TearDown() override
+	{
+		for (FileData *fd : fds) fd->file_data_unref();
+
+		g_autofree gchar *index = cache_sim_index_location(dir, FALSE);
+		if (index) g_unlink(index);
+
+		image_sim_free(sim);
+
+		TempDirTest::TearDown();
+	}
+
+	/* writes a source file of \a size bytes */
+	FileData *Add(const gchar *name, gsize size)
+	{
+		std::vector<gchar> data(size, 'x');
+		const gchar *path = WriteFile(name, data.data(), data.size());
+
+		FileData *fd = FileData::file_data_new_simple(path, &context);
+		fds.push_back(fd);
+
+		return fd;
+	}
+
+	std::vector<FileData *> fds;
+	FileDataContext context;
+	ImageSimilarityData *sim = nullptr;
+};
+
+TEST_F(SimIndexTest, SaveAndLoad)
+{
+	FileData *fd = Add("a.jpg", 100);
+
+	SimIndex *si = sim_index_open(dir);
+	ASSERT_NE(nullptr, si);
+	EXPECT_EQ(nullptr, sim_index_lookup(si, fd));
+
+	CacheData *cd = test_cache_data_new(sim);
+	sim_index_update(si, fd, cd);
+	cache_sim_data_free(cd);
+
+	cd = sim_index_lookup(si, fd);
+	test_expect_cache_data(cd, sim);
+	cache_sim_data_free(cd);
+
+	ASSERT_TRUE(sim_index_save(si));
+	sim_index_free(si);
+
+	si = sim_index_open(dir);
+	cd = sim_index_lookup(si, fd);
+	test_expect_cache_data(cd, sim);
+	cache_sim_data_free(cd);
+	sim_index_free(si);
+}
+
+TEST_F(SimIndexTest, UpdateKeepsOtherFields)
+{
+	FileData *fd = Add("a.jpg", 100);
+
+	SimIndex *si = sim_index_open(dir);
+
+	CacheData *cd = test_cache_data_new(sim);
+	sim_index_update(si, fd, cd);
+	cache_sim_data_free(cd);
+	sim_index_free(si);
+
+	si = sim_index_open(dir);
+
+	cd = cache_sim_data_new();
+	cache_sim_data_set_dimensions(cd, 320, 240);
+	sim_index_update(si, fd, cd);
+	cache_sim_data_free(cd);
+
+	cd = sim_index_lookup(si, fd);
+	ASSERT_NE(nullptr, cd);
+	EXPECT_EQ(320, cd->width);
+	EXPECT_EQ(240, cd->height);
+	EXPECT_TRUE(cd->have_md5sum);
+	EXPECT_EQ(0, memcmp(test_md5sum, cd->md5sum, sizeof(test_md5sum)));
+	EXPECT_TRUE(cd->similarity);
+	cache_sim_data_free(cd);
+	sim_index_free(si);
+}
+
+TEST_F(SimIndexTest, ChangedFileIsNotFound)
+{
+	FileData *fd = Add("a.jpg", 100);
+
+	SimIndex *si = sim_index_open(dir);
+	CacheData *cd = test_cache_data_new(sim);
+	sim_index_update(si, fd, cd);
+	cache_sim_data_free(cd);
+	sim_index_free(si);
+
+	si = sim_index_open(dir);
+
+	fd->size++;
+	EXPECT_EQ(nullptr, sim_index_lookup(si, fd));
+	fd->size--;
+
+	fd->date++;
+	EXPECT_EQ(nullptr, sim_index_lookup(si, fd));
+	fd->date--;
+
+	cd = sim_index_lookup(si, fd);
+	EXPECT_NE(nullptr, cd);
+	cache_sim_data_free(cd);
+	sim_index_free(si);
+}
+
+TEST_F(SimIndexTest, DeletedFileIsDropped)
+{
+	FileData *kept = Add("kept.jpg", 100);
+	FileData *deleted = Add("deleted.jpg", 200);
+
+	SimIndex *si = sim_index_open(dir);
+	CacheData *cd = test_cache_data_new(sim);
+	sim_index_update(si, kept, cd);
+	sim_index_update(si, deleted, cd);
+	cache_sim_data_free(cd);
+	sim_index_free(si);
+
+	ASSERT_EQ(0, g_unlink(deleted->path));
+
+	/* records are only dropped when the index is rewritten */
+	si = sim_index_open(dir);
+	cd = cache_sim_data_new();
+	cache_sim_data_set_dimensions(cd, 1, 1);
+	sim_index_update(si, kept, cd);
+	cache_sim_data_free(cd);
+	sim_index_free(si);
+
+	si = sim_index_open(dir);
+	cd = sim_index_lookup(si, kept);
+	EXPECT_NE(nullptr, cd);
+	cache_sim_data_free(cd);
+	EXPECT_EQ(nullptr, sim_index_lookup(si, deleted));
+	sim_index_free(si);
+}
+
+TEST_F(SimIndexTest, InvalidIndexIsIgnored)
+{
+	FileData *fd = Add("a.jpg", 100);
+
+	g_autofree gchar *index = cache_sim_index_location(dir, TRUE);
+	ASSERT_NE(nullptr, index);
+	ASSERT_TRUE(g_file_set_contents(index, "GQSIMIDX garbage", -1, nullptr));
+
+	SimIndex *si = sim_index_open(dir);
+	ASSERT_NE(nullptr, si);
+	EXPECT_EQ(nullptr, sim_index_lookup(si, fd));
+	sim_index_free(si);
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
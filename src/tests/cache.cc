@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for cache.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <string>
+
+#include <glib.h>
+
+#include "cache.h"
+#include "similar.h"
+#include "test-util.h"
+#include "ui-fileops.h"
+
+namespace {
+
+class CacheSimDataTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+
+		path = Path("a.jpg.sim");
+		sim = test_sim_new();
+	}
+
+	void TearDown() override
+	{
+		image_sim_free(sim);
+
+		TempDirTest::TearDown();
+	}
+
+	void ExpectFullData(const CacheData *cd)
+	{
+		test_expect_cache_data(cd, sim);
+
+		EXPECT_TRUE(cd->have_date);
+		EXPECT_EQ(1234567890, cd->date);
+	}
+
+	gboolean IsBinary()
+	{
+		g_autofree gchar *contents = nullptr;
+		gsize len = 0;
+
+		if (!g_file_get_contents(path, &contents, &len, nullptr)) return FALSE;
+
+		return len >= 8 && strncmp(contents, "GQSIMBIN", 8) == 0;
+	}
+
+	const gchar *path = nullptr;
+	ImageSimilarityData *sim = nullptr;
+};
+
+TEST_F(CacheSimDataTest, SaveAndLoad)
+{
+	CacheData *cd = test_cache_data_new(sim);
+	cd->path = g_strdup(path);
+	cd->date = 1234567890;
+	cd->have_date = TRUE;
+	ASSERT_TRUE(cache_sim_data_save(cd));
+	cache_sim_data_free(cd);
+
+	EXPECT_TRUE(IsBinary());
+
+	cd = cache_sim_data_load(path);
+	ExpectFullData(cd);
+	cache_sim_data_free(cd);
+}
+
+TEST_F(CacheSimDataTest, MissingFieldsAreNotSet)
+{
+	CacheData *cd = cache_sim_data_new();
+	cd->path = g_strdup(path);
+	cache_sim_data_set_dimensions(cd, 640, 480);
+	ASSERT_TRUE(cache_sim_data_save(cd));
+	cache_sim_data_free(cd);
+
+	cd = cache_sim_data_load(path);
+	ASSERT_NE(nullptr, cd);
+	EXPECT_TRUE(cd->dimensions);
+	EXPECT_FALSE(cd->have_date);
+	EXPECT_EQ(-1, cd->date);
+	EXPECT_FALSE(cd->have_md5sum);
+	EXPECT_FALSE(cd->similarity);
+	cache_sim_data_free(cd);
+}
+
+TEST_F(CacheSimDataTest, TextFileIsUpgraded)
+{
+	std::string text = "SIMcache\n#comment\nDimensions=[640 x 480]\nDate=[1234567890]\n"
+	                   "MD5sum=[00112233445566778899aabbccddeeff]\nSimilarityGrid[32 x 32]=";
+	for (gint n = 0; n < 1024; n++)
+	{
+		text += static_cast<gchar>(sim->avg_r[n]);
+		text += static_cast<gchar>(sim->avg_g[n]);
+		text += static_cast<gchar>(sim->avg_b[n]);
+	}
+	text += "\n";
+
+	ASSERT_TRUE(g_file_set_contents(path, text.data(), text.size(), nullptr));
+	ASSERT_TRUE(filetime_set(path, 1000000000));
+
+	CacheData *cd = cache_sim_data_load(path);
+	ExpectFullData(cd);
+	cache_sim_data_free(cd);
+
+	/* rewritten in place, keeping the time that ties it to its source */
+	EXPECT_TRUE(IsBinary());
+	EXPECT_EQ(1000000000, filetime(path));
+
+	cd = cache_sim_data_load(path);
+	ExpectFullData(cd);
+	cache_sim_data_free(cd);
+}
+
+TEST_F(CacheSimDataTest, InvalidFileIsNotLoaded)
+{
+	ASSERT_TRUE(g_file_set_contents(path, "GQSIMBIN truncated", -1, nullptr));
+	EXPECT_EQ(nullptr, cache_sim_data_load(path));
+
+	ASSERT_TRUE(g_file_set_contents(path, "not a cache file\n", -1, nullptr));
+	EXPECT_EQ(nullptr, cache_sim_data_load(path));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
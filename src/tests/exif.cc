@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for exif.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <glib.h>
+
+#include "exif-int.h"
+#include "exif.h"
+#include "test-util.h"
+
+namespace {
+
+// A big endian TIFF with ImageWidth = 1000, Make = "Test" and a second
+// Make = "Dupe", Orientation = 6 and XResolution = 72/1
+const guchar tiff_be[] = {
+	'M', 'M', 0x00, 0x2a, 0x00, 0x00, 0x00, 0x08,
+	0x00, 0x05,
+	0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x03, 0xe8,
+	0x01, 0x0f, 0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x4a,
+	0x01, 0x0f, 0x00, 0x02, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x4f,
+	0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+	0x01, 0x1a, 0x00, 0x05, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x54,
+	0x00, 0x00, 0x00, 0x00,
+	'T', 'e', 's', 't', '\0',
+	'D', 'u', 'p', 'e', '\0',
+	0x00, 0x00, 0x00, 0x48, 0x00, 0x00, 0x00, 0x01,
+};
+
+class ExifTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+
+		const gchar *path = WriteFile("a.tif", tiff_be, sizeof(tiff_be));
+
+		exif = exif_read(path, nullptr, nullptr);
+		ASSERT_NE(nullptr, exif);
+	}
+
+	void TearDown() override
+	{
+		exif_free(exif);
+
+		TempDirTest::TearDown();
+	}
+
+	ExifData *exif = nullptr;
+};
+
+TEST_F(ExifTest, GetItemByKey)
+{
+	ExifItem *item = exif_get_item(exif, "Exif.Image.Orientation");
+	ASSERT_NE(nullptr, item);
+	EXPECT_EQ(0x0112u, exif_item_get_tag_id(item));
+
+	EXPECT_EQ(nullptr, exif_get_item(exif, "Exif.Image.Artist"));
+	EXPECT_EQ(nullptr, exif_get_item(exif, nullptr));
+}
+
+TEST_F(ExifTest, FirstItemWins)
+{
+	g_autofree gchar *make = exif_get_data_as_text(exif, "Exif.Image.Make");
+	EXPECT_STREQ("Test", make);
+
+	/* items added later, as by the makernote parsers, do not replace it */
+	ExifItem *first = exif_get_item(exif, "Exif.Image.Make");
+	ExifItem *item = exif_item_new(EXIF_FORMAT_STRING, 0x010f, 5, first->marker);
+	exif_add_item(exif, item);
+
+	EXPECT_EQ(first, exif_get_item(exif, "Exif.Image.Make"));
+}
+
+TEST_F(ExifTest, ItemsAreDecodedOnFirstUse)
+{
+	ExifItem *item = exif_get_item(exif, "Exif.Image.ImageWidth");
+	ASSERT_NE(nullptr, item);
+	EXPECT_EQ(nullptr, item->data);
+	EXPECT_NE(nullptr, item->raw);
+
+	gpointer data = exif_item_data(item);
+	ASSERT_NE(nullptr, data);
+	EXPECT_EQ(1000u, *static_cast<guint32 *>(data));
+
+	/* decoded once */
+	EXPECT_EQ(data, exif_item_data(item));
+	EXPECT_EQ(data, item->data);
+}
+
+TEST_F(ExifTest, DecodedValuesAreInHostOrder)
+{
+	gint value = 0;
+
+	ASSERT_TRUE(exif_get_integer(exif, "Exif.Image.ImageWidth", &value));
+	EXPECT_EQ(1000, value);
+
+	ASSERT_TRUE(exif_get_integer(exif, "Exif.Image.Orientation", &value));
+	EXPECT_EQ(6, value);
+
+	gint sign = 0;
+	ExifRational *r = exif_get_rational(exif, "Exif.Image.XResolution", &sign);
+	ASSERT_NE(nullptr, r);
+	EXPECT_EQ(72u, r->num);
+	EXPECT_EQ(1u, r->den);
+	EXPECT_FALSE(sign);
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
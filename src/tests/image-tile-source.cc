@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for image-tile-source.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+
+#include <config.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#if HAVE_TIFF
+#  include <tiffio.h>
+#endif
+
+#include "image-tile-source.h"
+#if HAVE_TIFF
+#  include "image-load-tiff.h"
+#endif
+#include "test-util.h"
+
+namespace {
+
+struct BackendRead
+{
+	gint x;
+	gint y;
+	gint width;
+	gint height;
+	gint reduce;
+	gint dest_width;
+	gint dest_height;
+};
+
+/* fills the region red, and records what was asked for */
+struct FakeBackend : public ImageTileSourceBackend
+{
+	FakeBackend(gint width, gint height, gboolean rows) : width(width), height(height), rows(rows) {}
+
+	gboolean open(const gchar *, gint) override { return TRUE; }
+
+	void get_size(gint &w, gint &h) override
+	{
+		w = width;
+		h = height;
+	}
+
+	gboolean read(gint x, gint y, gint w, gint h, gint reduce, GdkPixbuf *dest) override
+	{
+		reads.push_back({x, y, w, h, reduce, gdk_pixbuf_get_width(dest), gdk_pixbuf_get_height(dest)});
+		gdk_pixbuf_fill(dest, 0xff0000ff);
+		return TRUE;
+	}
+
+	gboolean whole_rows() override { return rows; }
+
+	gint width;
+	gint height;
+	gboolean rows;
+	std::vector<BackendRead> reads;
+};
+
+guint32 pixel_at(GdkPixbuf *pixbuf, gint x, gint y)
+{
+	const guchar *p = gdk_pixbuf_get_pixels(pixbuf) + (y * gdk_pixbuf_get_rowstride(pixbuf)) + (x * gdk_pixbuf_get_n_channels(pixbuf));
+
+	return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+
+class ImageTileSourceTest : public ::testing::Test
+{
+    protected:
+	void Open(gint width, gint height, gboolean rows = FALSE)
+	{
+		auto fake = std::make_unique<FakeBackend>(width, height, rows);
+		backend = fake.get();
+		ts = image_tile_source_new(std::move(fake));
+	}
+
+	void TearDown() override
+	{
+		image_tile_source_unref(ts);
+		if (dest) g_object_unref(dest);
+	}
+
+	GdkPixbuf *NewDest(gint size)
+	{
+		if (dest) g_object_unref(dest);
+		dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, size, size);
+
+		return dest;
+	}
+
+	FakeBackend *backend = nullptr;
+	ImageTileSource *ts = nullptr;
+	GdkPixbuf *dest = nullptr;
+};
+
+TEST_F(ImageTileSourceTest, Levels)
+{
+	Open(4000, 3000);
+
+	gint width;
+	gint height;
+	image_tile_source_get_size(ts, width, height);
+	EXPECT_EQ(4000, width);
+	EXPECT_EQ(3000, height);
+
+	/* 4000 >> 2 fits in 1024 */
+	EXPECT_EQ(2, image_tile_source_get_max_level(ts));
+}
+
+TEST_F(ImageTileSourceTest, ReadFullResolution)
+{
+	Open(4000, 3000);
+
+	ASSERT_TRUE(image_tile_source_read(ts, 512, 1024, 512, 512, NewDest(512)));
+
+	ASSERT_EQ(1u, backend->reads.size());
+	const BackendRead &r = backend->reads[0];
+	EXPECT_EQ(512, r.x);
+	EXPECT_EQ(1024, r.y);
+	EXPECT_EQ(512, r.width);
+	EXPECT_EQ(512, r.height);
+	EXPECT_EQ(1, r.reduce);
+	EXPECT_EQ(512, r.dest_width);
+	EXPECT_EQ(512, r.dest_height);
+}
+
+TEST_F(ImageTileSourceTest, ReadReduced)
+{
+	Open(4000, 3000);
+
+	/* a level 2 tile covers 2048 x 2048 image pixels */
+	ASSERT_TRUE(image_tile_source_read(ts, 0, 0, 2048, 2048, NewDest(512)));
+
+	ASSERT_EQ(1u, backend->reads.size());
+	EXPECT_EQ(4, backend->reads[0].reduce);
+	EXPECT_EQ(512, backend->reads[0].dest_width);
+	EXPECT_EQ(512, backend->reads[0].dest_height);
+}
+
+TEST_F(ImageTileSourceTest, ReadEdge)
+{
+	Open(4000, 3000);
+
+	/* only 416 x 440 of the 1024 x 1024 are in the image, rounded up at the reduced size */
+	ASSERT_TRUE(image_tile_source_read(ts, 3584, 2560, 1024, 1024, NewDest(512)));
+
+	ASSERT_EQ(1u, backend->reads.size());
+	const BackendRead &r = backend->reads[0];
+	EXPECT_EQ(3584, r.x);
+	EXPECT_EQ(2560, r.y);
+	EXPECT_EQ(416, r.width);
+	EXPECT_EQ(440, r.height);
+	EXPECT_EQ(2, r.reduce);
+	EXPECT_EQ(208, r.dest_width);
+	EXPECT_EQ(220, r.dest_height);
+
+	/* the rest is black */
+	EXPECT_EQ(0xff0000u, pixel_at(dest, 0, 0));
+	EXPECT_EQ(0xff0000u, pixel_at(dest, 207, 219));
+	EXPECT_EQ(0x000000u, pixel_at(dest, 208, 0));
+	EXPECT_EQ(0x000000u, pixel_at(dest, 0, 220));
+}
+
+TEST_F(ImageTileSourceTest, ReadOutside)
+{
+	Open(4000, 3000);
+
+	ASSERT_TRUE(image_tile_source_read(ts, 4096, 0, 512, 512, NewDest(512)));
+
+	EXPECT_TRUE(backend->reads.empty());
+	EXPECT_EQ(0x000000u, pixel_at(dest, 0, 0));
+}
+
+TEST_F(ImageTileSourceTest, WholeRowsAreReadOnce)
+{
+	Open(4000, 3000, TRUE);
+
+	ASSERT_TRUE(image_tile_source_read(ts, 0, 512, 512, 512, NewDest(512)));
+	ASSERT_TRUE(image_tile_source_read(ts, 512, 512, 512, 512, NewDest(512)));
+	EXPECT_EQ(0xff0000u, pixel_at(dest, 0, 0));
+
+	ASSERT_EQ(1u, backend->reads.size());
+	const BackendRead &r = backend->reads[0];
+	EXPECT_EQ(0, r.x);
+	EXPECT_EQ(512, r.y);
+	EXPECT_EQ(4000, r.width);
+	EXPECT_EQ(512, r.height);
+	EXPECT_EQ(4000, r.dest_width);
+
+	/* another reduction is another band */
+	ASSERT_TRUE(image_tile_source_read(ts, 0, 512, 1024, 512, NewDest(512)));
+	EXPECT_EQ(2u, backend->reads.size());
+}
+
+struct AsyncResult
+{
+	gint count = 0;
+	GdkRectangle region{};
+	guint32 pixel = 0;
+};
+
+void async_read_cb(ImageTileSource *, gint x, gint y, gint width, gint height, GdkPixbuf *pixbuf, gpointer data)
+{
+	auto result = static_cast<AsyncResult *>(data);
+
+	result->count++;
+	result->region = {x, y, width, height};
+	result->pixel = pixel_at(pixbuf, 0, 0);
+}
+
+void wait_for(const AsyncResult &result)
+{
+	while (result.count == 0) g_main_context_iteration(nullptr, TRUE);
+}
+
+TEST_F(ImageTileSourceTest, ReadAsync)
+{
+	Open(4000, 3000);
+
+	AsyncResult result;
+	image_tile_source_read_async(ts, 512, 0, 512, 512, 512, 512, async_read_cb, &result);
+	/* the same request again is not queued twice */
+	image_tile_source_read_async(ts, 512, 0, 512, 512, 512, 512, async_read_cb, &result);
+
+	/* the source is kept by the pending read */
+	image_tile_source_unref(image_tile_source_ref(ts));
+
+	wait_for(result);
+	while (g_main_context_iteration(nullptr, FALSE)) {}
+
+	EXPECT_EQ(1, result.count);
+	EXPECT_EQ(512, result.region.x);
+	EXPECT_EQ(512, result.region.width);
+	EXPECT_EQ(0xff0000u, result.pixel);
+	EXPECT_EQ(1u, backend->reads.size());
+}
+
+TEST_F(ImageTileSourceTest, ReadAsyncCancel)
+{
+	Open(4000, 3000);
+
+	AsyncResult cancelled;
+	AsyncResult moved;
+	AsyncResult kept;
+	const GdkRectangle region{0, 0, 512, 512};
+
+	/* one worker, done in order */
+	image_tile_source_read_async(ts, 0, 0, 512, 512, 512, 512, async_read_cb, &cancelled);
+	image_tile_source_read_async(ts, 0, 512, 512, 512, 512, 512, async_read_cb, &cancelled);
+	image_tile_source_read_async(ts, 512, 0, 512, 512, 512, 512, async_read_cb, &moved);
+	image_tile_source_read_cancel(ts, &cancelled, &region);
+	image_tile_source_read_move(ts, &moved, &kept);
+
+	wait_for(kept);
+
+	EXPECT_EQ(1, cancelled.count);
+	EXPECT_EQ(512, cancelled.region.y);
+	EXPECT_EQ(0, moved.count);
+	EXPECT_EQ(1, kept.count);
+}
+
+#if HAVE_TIFF
+/* a page and two reduced images, each of one color */
+void write_tiff(const gchar *path)
+{
+	struct Level
+	{
+		guint32 width;
+		guint32 height;
+		guint8 rgb[3];
+	};
+	const Level levels[] = {
+		{2048, 1024, {255, 0, 0}},
+		{512, 256, {0, 255, 0}},
+		{256, 128, {0, 0, 255}},
+	};
+
+	TIFF *tiff = TIFFOpen(path, "w");
+	ASSERT_NE(nullptr, tiff);
+
+	for (gsize i = 0; i < G_N_ELEMENTS(levels); i++)
+		{
+		const Level &l = levels[i];
+
+		if (i > 0) TIFFSetField(tiff, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+		TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, l.width);
+		TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, l.height);
+		TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 3);
+		TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
+		TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+		TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+		TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, 16);
+
+		std::vector<guint8> row(l.width * 3);
+		for (guint32 x = 0; x < l.width; x++)
+			{
+			row[(x * 3) + 0] = l.rgb[0];
+			row[(x * 3) + 1] = l.rgb[1];
+			row[(x * 3) + 2] = l.rgb[2];
+			}
+		for (guint32 y = 0; y < l.height; y++) TIFFWriteScanline(tiff, row.data(), y, 0);
+
+		TIFFWriteDirectory(tiff);
+		}
+
+	TIFFClose(tiff);
+}
+
+using ImageTileSourceTiffTest = TempDirTest;
+
+TEST_F(ImageTileSourceTiffTest, LevelSelection)
+{
+	const gchar *path = Path("levels.tif");
+
+	write_tiff(path);
+
+	std::unique_ptr<ImageTileSourceBackend> backend = get_image_tile_source_backend_tiff();
+	ASSERT_TRUE(backend->open(path, 0));
+
+	gint width;
+	gint height;
+	backend->get_size(width, height);
+	EXPECT_EQ(2048, width);
+	EXPECT_EQ(1024, height);
+
+	/* the smallest image with at least a pixel for each one of dest */
+	const struct
+	{
+		gint reduce;
+		guint32 rgb;
+	} cases[] = {
+		{1, 0xff0000},
+		{2, 0xff0000},
+		{4, 0x00ff00},
+		{8, 0x0000ff},
+		{16, 0x0000ff},
+	};
+
+	for (const auto &c : cases)
+		{
+		SCOPED_TRACE(c.reduce);
+
+		GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, 2048 / c.reduce, 1024 / c.reduce);
+		gdk_pixbuf_fill(dest, 0);
+
+		EXPECT_TRUE(backend->read(0, 0, 2048, 1024, c.reduce, dest));
+		EXPECT_EQ(c.rgb, pixel_at(dest, 0, 0));
+		EXPECT_EQ(c.rgb, pixel_at(dest, (2048 / c.reduce) - 1, (1024 / c.reduce) - 1));
+
+		g_object_unref(dest);
+		}
+}
+#endif
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for md5-util.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include <glib.h>
+
+#include "md5-util.h"
+#include "test-util.h"
+
+namespace {
+
+class Md5UtilTest : public TempDirTest
+{
+    protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+
+		path = Path("a");
+	}
+
+	void Write(const std::vector<guchar> &data, time_t mtime)
+	{
+		ASSERT_TRUE(g_file_set_contents(path, reinterpret_cast<const gchar *>(data.data()), data.size(), nullptr));
+
+		struct timespec times[2] = {{mtime, 0}, {mtime, 0}};
+		ASSERT_EQ(0, utimensat(AT_FDCWD, path, times, 0));
+	}
+
+	static std::vector<guchar> Data(gsize size, guint seed)
+	{
+		std::vector<guchar> data(size);
+
+		for (gsize i = 0; i < size; i++) data[i] = (i * 131 + seed) % 251;
+
+		return data;
+	}
+
+	static std::string Expected(const std::vector<guchar> &data)
+	{
+		g_autofree gchar *text = g_compute_checksum_for_data(G_CHECKSUM_MD5, data.data(), data.size());
+
+		return text;
+	}
+
+	const gchar *path = nullptr;
+};
+
+TEST_F(Md5UtilTest, MatchesGChecksum)
+{
+	// Empty, read in one chunk, read in several chunks and mapped
+	for (gsize size : {0, 1000, 1024 * 1024 - 1, 3 * 1024 * 1024 + 17})
+		{
+		auto data = Data(size, size);
+		Write(data, 1000000 + size);
+
+		g_autofree gchar *text = md5_get_string_from_file(path);
+		ASSERT_NE(nullptr, text) << "size " << size;
+		EXPECT_EQ(Expected(data), text) << "size " << size;
+
+		guchar digest[16];
+		ASSERT_TRUE(md5_get_digest_from_file(path, digest));
+		g_autofree gchar *digest_text = md5_digest_to_text(digest);
+		EXPECT_EQ(Expected(data), digest_text) << "size " << size;
+		}
+}
+
+TEST_F(Md5UtilTest, ChangedFileIsRehashed)
+{
+	auto first = Data(4096, 1);
+	auto second = Data(4096, 2);
+
+	Write(first, 2000000);
+	g_autofree gchar *text1 = md5_get_string_from_file(path);
+	EXPECT_EQ(Expected(first), text1);
+
+	// Same size, new modification time
+	Write(second, 2000001);
+	g_autofree gchar *text2 = md5_get_string_from_file(path);
+	EXPECT_EQ(Expected(second), text2);
+}
+
+TEST_F(Md5UtilTest, MissingFileFails)
+{
+	g_autofree gchar *missing = g_strconcat(path, ".missing", nullptr);
+	guchar digest[16];
+
+	EXPECT_EQ(nullptr, md5_get_string_from_file(missing));
+	EXPECT_FALSE(md5_get_digest_from_file(missing, digest));
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for similar-index.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <glib.h>
+
+#include "options.h"
+#include "similar-index.h"
+#include "similar.h"
+
+namespace {
+
+class SimilarIndexTest : public ::testing::Test
+{
+    protected:
+	void SetUp() override
+	{
+		if (!options) options = init_options(nullptr);
+		rot_invariant_sim = options->rot_invariant_sim;
+		alternate = options->alternate_similarity_algorithm.enabled;
+
+		/* a few base images, each with copies at growing amounts of noise */
+		GRand *rand = g_rand_new_with_seed(7);
+
+		for (gint base = 0; base < 8; base++)
+		{
+			ImageSimilarityData *sd = image_sim_new();
+			for (gint n = 0; n < 1024; n++)
+			{
+				sd->avg_r[n] = g_rand_int_range(rand, 0, 256);
+				sd->avg_g[n] = g_rand_int_range(rand, 0, 256);
+				sd->avg_b[n] = g_rand_int_range(rand, 0, 256);
+			}
+			sd->filled = TRUE;
+			images.push_back(sd);
+
+			for (gint noise = 1; noise < 64; noise *= 2)
+			{
+				ImageSimilarityData *copy = image_sim_new();
+				*copy = *sd;
+				for (gint n = 0; n < 1024; n++)
+				{
+					copy->avg_r[n] = CLAMP(sd->avg_r[n] + g_rand_int_range(rand, -noise, noise + 1), 0, 255);
+					copy->avg_g[n] = CLAMP(sd->avg_g[n] + g_rand_int_range(rand, -noise, noise + 1), 0, 255);
+					copy->avg_b[n] = CLAMP(sd->avg_b[n] + g_rand_int_range(rand, -noise, noise + 1), 0, 255);
+				}
+				images.push_back(copy);
+			}
+		}
+
+		/* images without data are never returned */
+		images.push_back(image_sim_new());
+
+		g_rand_free(rand);
+	}
+
+	void TearDown() override
+	{
+		for (ImageSimilarityData *sd : images) image_sim_free(sd);
+
+		options->rot_invariant_sim = rot_invariant_sim;
+		options->alternate_similarity_algorithm.enabled = alternate;
+	}
+
+	/* every image the full compare matches must be a candidate */
+	void ExpectFindMatchesCompare()
+	{
+		ImageSimIndex *si = image_sim_index_new();
+		for (gsize i = 0; i < images.size(); i++) image_sim_index_add(si, images[i], i);
+
+		for (gdouble min : {0.5, 0.8, 0.9, 0.95, 0.99})
+		{
+			for (gsize i = 0; i < images.size() - 1; i++)
+			{
+				std::vector<gint> ids;
+				image_sim_index_find(si, images[i], min, ids);
+
+				for (gsize j = 0; j < images.size(); j++)
+				{
+					gboolean match = image_sim_compare_fast(images[j], images[i], min) >= min;
+					gboolean found = std::find(ids.begin(), ids.end(), static_cast<gint>(j)) != ids.end();
+
+					if (match) EXPECT_TRUE(found) << "min " << min << " needle " << i << " image " << j;
+					if (!images[j]->filled) EXPECT_FALSE(found);
+				}
+			}
+		}
+
+		image_sim_index_free(si);
+	}
+
+	std::vector<ImageSimilarityData *> images;
+	gboolean rot_invariant_sim = FALSE;
+	gboolean alternate = FALSE;
+};
+
+TEST_F(SimilarIndexTest, FindMatchesCompare)
+{
+	options->rot_invariant_sim = FALSE;
+	options->alternate_similarity_algorithm.enabled = FALSE;
+	ExpectFindMatchesCompare();
+}
+
+TEST_F(SimilarIndexTest, FindMatchesRotationInvariantCompare)
+{
+	options->rot_invariant_sim = TRUE;
+	options->alternate_similarity_algorithm.enabled = FALSE;
+	ExpectFindMatchesCompare();
+}
+
+TEST_F(SimilarIndexTest, FindMatchesAlternateCompare)
+{
+	options->rot_invariant_sim = FALSE;
+	options->alternate_similarity_algorithm.enabled = TRUE;
+	ExpectFindMatchesCompare();
+}
+
+TEST_F(SimilarIndexTest, FindPrunes)
+{
+	options->rot_invariant_sim = FALSE;
+	options->alternate_similarity_algorithm.enabled = FALSE;
+
+	ImageSimIndex *si = image_sim_index_new();
+	for (gsize i = 0; i < images.size(); i++) image_sim_index_add(si, images[i], i);
+
+	/* at a tight threshold only the copies of the same base remain */
+	std::vector<gint> ids;
+	image_sim_index_find(si, images[0], 0.95, ids);
+	ASSERT_FALSE(ids.empty());
+	EXPECT_EQ(0, ids.front());
+	EXPECT_LT(ids.back(), 7);
+
+	image_sim_index_free(si);
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests and micro-benchmark for similar-kernels.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include <glib.h>
+
+#include "similar-kernels.h"
+
+namespace {
+
+class SimilarKernelsTest : public ::testing::Test
+{
+    protected:
+	void SetUp() override
+	{
+		GRand *rand = g_rand_new_with_seed(42);
+
+		for (gint c = 0; c < 3; c++)
+		{
+			for (gint i = 0; i < 1024; i++)
+			{
+				a[c][i] = g_rand_int_range(rand, 0, 256);
+				b[c][i] = g_rand_int_range(rand, 0, 256);
+			}
+			planes_a[c] = a[c].data();
+			planes_b[c] = b[c].data();
+		}
+
+		/* odd row stride and 4 byte pixels, so rows end mid period */
+		image.resize(rowstride * rows);
+		for (auto &p : image) p = g_rand_int_range(rand, 0, 256);
+
+		g_rand_free(rand);
+	}
+
+	std::array<std::array<guint8, 1024>, 3> a;
+	std::array<std::array<guint8, 1024>, 3> b;
+	const guint8 *planes_a[3];
+	const guint8 *planes_b[3];
+
+	static constexpr gint rowstride = 4 * 333 + 3;
+	static constexpr gint rows = 300;
+	std::vector<guchar> image;
+};
+
+TEST_F(SimilarKernelsTest, KernelsMatchScalar)
+{
+	const ImageSimKernels *scalar = image_sim_kernels_scalar();
+
+	for (const ImageSimKernels *kernels : image_sim_kernels_available())
+	{
+		SCOPED_TRACE(kernels->name);
+
+		for (gsize offset = 0; offset < 1024; offset += 256)
+		{
+			EXPECT_EQ(kernels->sad(planes_a, planes_b, offset, 256), scalar->sad(planes_a, planes_b, offset, 256));
+		}
+
+		gint prev_cd = 0;
+		gint prev_cd_scalar = 0;
+		for (gsize offset = 0; offset < 1024; offset += 256)
+		{
+			EXPECT_EQ(kernels->alternate(planes_a, planes_b, offset, 256, prev_cd),
+			          scalar->alternate(planes_a, planes_b, offset, 256, prev_cd_scalar));
+			EXPECT_EQ(prev_cd, prev_cd_scalar);
+		}
+
+		guint32 sums[IMAGE_SIM_SUM_PERIOD] = {0};
+		guint32 sums_scalar[IMAGE_SIM_SUM_PERIOD] = {0};
+		kernels->sum_bytes(image.data() + 4, rowstride, rows, 4 * 311, sums);
+		scalar->sum_bytes(image.data() + 4, rowstride, rows, 4 * 311, sums_scalar);
+		for (gint t = 0; t < IMAGE_SIM_SUM_PERIOD; t++)
+		{
+			EXPECT_EQ(sums[t], sums_scalar[t]);
+		}
+	}
+}
+
+TEST_F(SimilarKernelsTest, SumBytesDoesNotOverflow)
+{
+	std::vector<guchar> white(IMAGE_SIM_SUM_PERIOD * 1000, 255);
+
+	for (const ImageSimKernels *kernels : image_sim_kernels_available())
+	{
+		SCOPED_TRACE(kernels->name);
+
+		guint32 sums[IMAGE_SIM_SUM_PERIOD] = {0};
+		kernels->sum_bytes(white.data(), 0, 1000, white.size(), sums);
+		EXPECT_EQ(sums[0], 255u * 1000 * 1000);
+	}
+}
+
+/* Not a pass/fail test: prints the time per call of each kernel set.
+ * Disabled, run it with --gtest_also_run_disabled_tests.
+ */
+TEST_F(SimilarKernelsTest, DISABLED_Benchmark)
+{
+	constexpr gint iterations = 20000;
+
+	for (const ImageSimKernels *kernels : image_sim_kernels_available())
+	{
+		guint sink = 0;
+		gint prev_cd = 0;
+
+		gint64 start = g_get_monotonic_time();
+		for (gint n = 0; n < iterations; n++)
+		{
+			sink += kernels->sad(planes_a, planes_b, 0, 1024);
+		}
+		gint64 sad_time = g_get_monotonic_time() - start;
+
+		start = g_get_monotonic_time();
+		for (gint n = 0; n < iterations; n++)
+		{
+			sink += kernels->alternate(planes_a, planes_b, 0, 1024, prev_cd);
+		}
+		gint64 alternate_time = g_get_monotonic_time() - start;
+
+		start = g_get_monotonic_time();
+		for (gint n = 0; n < iterations / 100; n++)
+		{
+			guint32 sums[IMAGE_SIM_SUM_PERIOD] = {0};
+			kernels->sum_bytes(image.data(), rowstride, rows, 4 * 333, sums);
+			sink += sums[0];
+		}
+		gint64 sum_time = g_get_monotonic_time() - start;
+
+		printf("%-8s sad %6.1f ns  alternate %6.1f ns  sum_bytes %8.1f ns  (%u)\n", kernels->name,
+		       1000.0 * sad_time / iterations, 1000.0 * alternate_time / iterations,
+		       1000.0 * sum_time / (iterations / 100), sink & 1);
+	}
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Helpers shared by the unit tests
+ *
+ */
+
+#include "test-util.h"
+
+#include <cstring>
+
+#include <glib/gstdio.h>
+
+#include "cache.h"
+#include "similar.h"
+
+void TempDirTest::SetUp()
+{
+	dir = g_dir_make_tmp("geeqie-test-XXXXXX", nullptr);
+	ASSERT_NE(nullptr, dir);
+
+	paths = g_ptr_array_new_with_free_func(g_free);
+}
+
+void TempDirTest::TearDown()
+{
+	if (!dir) return;
+
+	GDir *d = g_dir_open(dir, 0, nullptr);
+	if (d)
+		{
+		const gchar *name;
+
+		while ((name = g_dir_read_name(d)))
+			{
+			g_autofree gchar *path = g_build_filename(dir, name, NULL);
+			g_unlink(path);
+			}
+		g_dir_close(d);
+		}
+
+	EXPECT_EQ(0, g_rmdir(dir));
+	g_free(dir);
+	dir = nullptr;
+
+	g_ptr_array_free(paths, TRUE);
+	paths = nullptr;
+}
+
+const gchar *TempDirTest::Path(const gchar *name)
+{
+	gchar *path = g_build_filename(dir, name, NULL);
+	g_ptr_array_add(paths, path);
+
+	return path;
+}
+
+const gchar *TempDirTest::WriteFile(const gchar *name, const void *data, gsize size)
+{
+	const gchar *path = Path(name);
+
+	EXPECT_TRUE(g_file_set_contents(path, static_cast<const gchar *>(data), size, nullptr));
+
+	return path;
+}
+
+const guchar test_md5sum[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+/**
+ * @brief Similarity data with different values in each plane
+ */
+ImageSimilarityData *test_sim_new()
+{
+	ImageSimilarityData *sim = image_sim_new();
+
+	for (gint n = 0; n < 1024; n++)
+	{
+		sim->avg_r[n] = n;
+		sim->avg_g[n] = n * 3;
+		sim->avg_b[n] = n * 7;
+	}
+	sim->filled = TRUE;
+
+	return sim;
+}
+
+/**
+ * @brief Cache data of a 640 x 480 image with test_md5sum and \a sim
+ */
+CacheData *test_cache_data_new(ImageSimilarityData *sim)
+{
+	CacheData *cd = cache_sim_data_new();
+	cache_sim_data_set_dimensions(cd, 640, 480);
+	cache_sim_data_set_md5sum(cd, test_md5sum);
+	cache_sim_data_set_similarity(cd, sim);
+
+	return cd;
+}
+
+/**
+ * @brief Checks the fields set by test_cache_data_new()
+ */
+void test_expect_cache_data(const CacheData *cd, const ImageSimilarityData *sim)
+{
+	ASSERT_NE(nullptr, cd);
+
+	EXPECT_TRUE(cd->dimensions);
+	EXPECT_EQ(640, cd->width);
+	EXPECT_EQ(480, cd->height);
+
+	EXPECT_TRUE(cd->have_md5sum);
+	EXPECT_EQ(0, memcmp(test_md5sum, cd->md5sum, sizeof(test_md5sum)));
+
+	ASSERT_TRUE(cd->similarity);
+	ASSERT_NE(nullptr, cd->sim);
+	EXPECT_TRUE(cd->sim->filled);
+	EXPECT_EQ(0, memcmp(sim->avg_r, cd->sim->avg_r, 1024));
+	EXPECT_EQ(0, memcmp(sim->avg_g, cd->sim->avg_g, 1024));
+	EXPECT_EQ(0, memcmp(sim->avg_b, cd->sim->avg_b, 1024));
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Helpers shared by the unit tests
+ *
+ */
+
+#ifndef TESTS_TEST_UTIL_H
+#define TESTS_TEST_UTIL_H
+
+#include "gtest/gtest.h"
+
+#include <glib.h>
+
+struct CacheData;
+struct ImageSimilarityData;
+
+/**
+ * @brief A fixture with a temporary folder, removed with the files in it
+ *
+ * Fixtures that override SetUp() or TearDown() call these first and last.
+ */
+class TempDirTest : public ::testing::Test
+{
+    protected:
+	void SetUp() override;
+	void TearDown() override;
+
+	/* the path of \a name in the folder, freed with the fixture */
+	const gchar *Path(const gchar *name);
+	/* writes \a size bytes of \a data to \a name in the folder */
+	const gchar *WriteFile(const gchar *name, const void *data, gsize size);
+
+	gchar *dir = nullptr;
+
+    private:
+	GPtrArray *paths = nullptr;
+};
+
+/* the digest of test_cache_data_new() */
+extern const guchar test_md5sum[16];
+
+ImageSimilarityData *test_sim_new();
+CacheData *test_cache_data_new(ImageSimilarityData *sim);
+void test_expect_cache_data(const CacheData *cd, const ImageSimilarityData *sim);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
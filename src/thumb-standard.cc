@@ -42,6 +42,7 @@
 #include "metadata.h"
 #include "options.h"
 #include "pixbuf-util.h"
+#include "thumb.h"
 #include "typedefs.h"
 #include "ui-fileops.h"
 
@@ -294,7 +295,9 @@ static gboolean thumb_loader_std_validate(ThumbLoaderStd *tl, GdkPixbuf *pixbuf)
 static void thumb_loader_std_save(ThumbLoaderStd *tl, GdkPixbuf *pixbuf)
 {
 	gchar *base_path;
-	gchar *tmp_path;
+	const gchar *mark_uri;
+	gchar *mark_app;
+	gchar *pathl;
 	gboolean fail;
 
 	if (!tl->cache_enable || tl->cache_hit) return;
@@ -348,41 +351,19 @@ static void thumb_loader_std_save(ThumbLoaderStd *tl, GdkPixbuf *pixbuf)
 	DEBUG_1("thumb saving: %s", tl->fd->path);
 	DEBUG_1("       saved: %s", tl->thumb_path);
 
-	/* save thumb, using a temp file then renaming into place */
-	tmp_path = unique_filename(tl->thumb_path, ".tmp", "_", 2);
-	if (tmp_path)
-		{
-		const gchar *mark_uri;
-		gchar *mark_app;
-		gchar *pathl;
-		gboolean success;
-
-		mark_uri = (tl->cache_local) ? tl->local_uri :tl->thumb_uri;
-
-		mark_app = g_strdup_printf("%s %s", GQ_APPNAME, VERSION);
-		const std::string mark_mtime = std::to_string(static_cast<unsigned long long>(tl->source_mtime));
-		pathl = path_from_utf8(tmp_path);
-		success = gdk_pixbuf_save(pixbuf, pathl, "png", nullptr,
-		                          THUMB_MARKER_URI, mark_uri,
-		                          THUMB_MARKER_MTIME, mark_mtime.c_str(),
-		                          THUMB_MARKER_APP, mark_app,
-		                          NULL);
-		if (success)
-			{
-			chmod(pathl, (tl->cache_local) ? tl->source_mode : S_IRUSR | S_IWUSR);
-			success = rename_file(tmp_path, tl->thumb_path);
-			}
+	/* save thumb in the background */
+	mark_uri = (tl->cache_local) ? tl->local_uri :tl->thumb_uri;
 
-		g_free(pathl);
-		g_free(mark_app);
-		g_free(tmp_path);
+	mark_app = g_strdup_printf("%s %s", GQ_APPNAME, VERSION);
+	const std::string mark_mtime = std::to_string(static_cast<unsigned long long>(tl->source_mtime));
+	const gchar *keys[] = {THUMB_MARKER_URI, THUMB_MARKER_MTIME, THUMB_MARKER_APP, nullptr};
+	const gchar *values[] = {mark_uri, mark_mtime.c_str(), mark_app, nullptr};
 
-		if (!success)
-			{
-			DEBUG_1("thumb save failed: %s", tl->fd->path);
-			DEBUG_1("            thumb: %s", tl->thumb_path);
-			}
-		}
+	pathl = path_from_utf8(tl->thumb_path);
+	thumb_save_png(pixbuf, pathl, keys, values, (tl->cache_local) ? tl->source_mode : S_IRUSR | S_IWUSR, 0);
+
+	g_free(pathl);
+	g_free(mark_app);
 
 	g_object_unref(G_OBJECT(pixbuf));
 }
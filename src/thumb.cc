@@ -21,6 +21,8 @@
 
 #include "thumb.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
 #include <utime.h>
 
 #include <cstdio>
@@ -28,13 +30,17 @@
 
 #include <glib-object.h>
 
+#include <config.h>
+
 #include "cache.h"
 #include "debug.h"
 #include "exif.h"
 #include "filedata.h"
 #include "image-load.h"
 #include "intl.h"
+#include "main-defines.h"
 #include "metadata.h"
+#include "misc.h"
 #include "options.h"
 #include "pixbuf-util.h"
 #include "thumb-standard.h"
@@ -47,6 +53,103 @@ static void thumb_loader_setup(ThumbLoader *tl, FileData *fd);
 static GdkPixbuf *get_xv_thumbnail(gchar *thumb_filename, gint max_w, gint max_h);
 
 
+/*
+ *-----------------------------------------------------------------------------
+ * saving thumbnails in the background
+ *-----------------------------------------------------------------------------
+ */
+
+struct ThumbSave
+{
+	GdkPixbuf *pixbuf;
+	gchar *pathl;
+	gchar **keys;
+	gchar **values;
+	mode_t mode;
+	time_t mtime;
+};
+
+static void thumb_save_free(ThumbSave *ts)
+{
+	g_object_unref(ts->pixbuf);
+	g_free(ts->pathl);
+	g_strfreev(ts->keys);
+	g_strfreev(ts->values);
+	g_free(ts);
+}
+
+static void thumb_save_func(gpointer data, gpointer)
+{
+	auto ts = static_cast<ThumbSave *>(data);
+	g_autoptr(GError) error = nullptr;
+	gboolean success = FALSE;
+
+	/* write a temp file then rename it into place, so a thumbnail is never seen half written */
+	g_autofree gchar *tmp_pathl = g_strconcat(ts->pathl, ".XXXXXX", NULL);
+	gint fd = g_mkstemp(tmp_pathl);
+	if (fd < 0)
+		{
+		DEBUG_1("thumb save failed: %s", ts->pathl);
+		thumb_save_free(ts);
+		return;
+		}
+	close(fd);
+
+	if (gdk_pixbuf_savev(ts->pixbuf, tmp_pathl, "png", ts->keys, ts->values, &error))
+		{
+		chmod(tmp_pathl, ts->mode);
+
+		if (ts->mtime > 0)
+			{
+			struct utimbuf ut;
+
+			ut.actime = ut.modtime = ts->mtime;
+			utime(tmp_pathl, &ut);
+			}
+
+		success = (rename(tmp_pathl, ts->pathl) == 0);
+		}
+	else
+		{
+		log_printf("Error saving png file: %s\n", error->message);
+		}
+
+	if (!success)
+		{
+		DEBUG_1("thumb save failed: %s", ts->pathl);
+		unlink(tmp_pathl);
+		}
+
+	thumb_save_free(ts);
+}
+
+/**
+ * @brief Saves a thumbnail as png on a worker thread
+ * @param pathl Destination, in locale encoding
+ * @param keys PNG text chunk keys, NULL terminated, may be NULL
+ * @param values Values of \a keys
+ * @param mode Permissions of the file
+ * @param mtime Modification time to set, 0 to leave it
+ *
+ * Encoding and writing are slow compared to the rest of creating a
+ * thumbnail, and must not hold up the main loop.
+ */
+void thumb_save_png(GdkPixbuf *pixbuf, const gchar *pathl, const gchar *const *keys, const gchar *const *values, mode_t mode, time_t mtime)
+{
+	static GThreadPool *pool = g_thread_pool_new(thumb_save_func, nullptr, MAX(get_cpu_cores() / 2, 1), FALSE, nullptr);
+
+	auto ts = g_new0(ThumbSave, 1);
+
+	ts->pixbuf = static_cast<GdkPixbuf *>(g_object_ref(pixbuf));
+	ts->pathl = g_strdup(pathl);
+	ts->keys = g_strdupv(const_cast<gchar **>(keys));
+	ts->values = g_strdupv(const_cast<gchar **>(values));
+	ts->mode = mode;
+	ts->mtime = mtime;
+
+	g_thread_pool_push(pool, ts, nullptr);
+}
+
 /*
  *-----------------------------------------------------------------------------
  * thumbnail routines: creation, caching, and maintenance (public)
@@ -87,11 +190,17 @@ static gboolean thumb_loader_save_thumbnail(ThumbLoader *tl, gboolean mark_failu
 			}
 		else
 			{
+			static const gchar *keys[] = {"tEXt::Software", nullptr};
+			static const gchar *values[] = {GQ_APPNAME " " VERSION, nullptr};
+
 			DEBUG_1("Saving thumb: %s", cache_path);
-			success = pixbuf_to_file_as_png(tl->fd->thumb_pixbuf, pathl);
+			/* thumb time is set to that of source file */
+			thumb_save_png(tl->fd->thumb_pixbuf, pathl, keys, values,
+				       S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, filetime(tl->fd->path));
+			success = TRUE;
 			}
 
-		if (success)
+		if (success && mark_failure)
 			{
 			struct utimbuf ut;
 			/* set thumb time to that of source file */
@@ -102,7 +211,7 @@ static gboolean thumb_loader_save_thumbnail(ThumbLoader *tl, gboolean mark_failu
 				utime(pathl, &ut);
 				}
 			}
-		else
+		else if (!success)
 			{
 			DEBUG_1("Saving failed: %s", pathl);
 			}
@@ -260,6 +369,17 @@ static void thumb_loader_error_cb(ImageLoader *il, gpointer data)
 		return;
 		}
 
+	/* try from original if cache attempt, the source is only opened once the loader runs */
+	if (tl->cache_hit)
+		{
+		tl->cache_hit = FALSE;
+		log_printf("%s", _("Thumbnail image in cache failed to load, trying to recreate.\n"));
+
+		thumb_loader_setup(tl, tl->fd);
+		g_signal_connect(G_OBJECT(tl->il), "done", (GCallback)thumb_loader_done_cb, tl);
+		if (image_loader_start(tl->il)) return;
+		}
+
 	DEBUG_1("thumb error: %s", tl->fd->path);
 
 	image_loader_free(tl->il);
@@ -22,6 +22,10 @@
 #ifndef THUMB_H
 #define THUMB_H
 
+#include <sys/types.h>
+
+#include <ctime>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib.h>
 
@@ -70,5 +74,7 @@ GdkPixbuf *thumb_loader_get_pixbuf(ThumbLoader *tl);
 
 void thumb_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
+void thumb_save_png(GdkPixbuf *pixbuf, const gchar *pathl, const gchar *const *keys, const gchar *const *values, mode_t mode, time_t mtime);
+
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
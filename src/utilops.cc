@@ -395,6 +395,9 @@ struct UtilityData {
 	guint update_idle_id; /* event source id */
 	guint perform_idle_id; /* event source id */
 
+	guint writes_pending; /* metadata writes in progress */
+	GList *writes_failed; /* files whose metadata could not be written */
+
 	gboolean with_sidecars; /* operate on grouped or single files; TRUE = use file_data_sc_, FALSE = use file_data_ functions */
 
 	/* alternative dialog parts */
@@ -753,6 +756,53 @@ static gint file_util_perform_ci_cb(gpointer resume_data, EditorFlags flags, GLi
 }
 
 
+/*
+ * Metadata are written in parallel, in the background. Each written file
+ * is finished as for a single entry of file_util_perform_ci_internal(),
+ * the failures are reported together when all are done.
+ */
+
+static void file_util_write_metadata_done_cb(FileData *fd, gboolean success, gpointer data)
+{
+	auto ud = static_cast<UtilityData *>(data);
+
+	ud->writes_pending--;
+
+	if (success)
+		{
+		GList *single_entry = g_list_append(nullptr, fd);
+
+		file_util_perform_ci_cb(GINT_TO_POINTER(TRUE), static_cast<EditorFlags>(0), single_entry, ud);
+		g_list_free(single_entry);
+		}
+	else
+		{
+		ud->writes_failed = g_list_append(ud->writes_failed, fd);
+		}
+
+	if (ud->writes_pending > 0) return;
+
+	GList *failed = ud->writes_failed;
+	ud->writes_failed = nullptr;
+
+	file_util_perform_ci_cb(nullptr, failed ? EDITOR_ERROR_STATUS : static_cast<EditorFlags>(0), failed, ud);
+	g_list_free(failed);
+}
+
+static void file_util_write_metadata_perform(UtilityData *ud)
+{
+	GList *list = g_list_copy(ud->flist);
+
+	ud->writes_pending = g_list_length(list);
+
+	for (GList *work = list; work; work = work->next)
+		{
+		metadata_write_perform_async(static_cast<FileData *>(work->data), file_util_write_metadata_done_cb, ud);
+		}
+
+	g_list_free(list);
+}
+
 /*
  * Perform the operation described by FileDataChangeInfo on all files in the list
  * it is an alternative to start_editor_from_filelist_full, it should use similar interface
@@ -776,6 +826,13 @@ static gboolean file_util_perform_ci_internal(gpointer data)
 
 	g_assert(ud->flist);
 
+	if (ud->type == UTILITY_TYPE_WRITE_METADATA && !ud->with_sidecars)
+		{
+		ud->perform_idle_id = 0;
+		file_util_write_metadata_perform(ud);
+		return G_SOURCE_REMOVE;
+		}
+
 	if (ud->flist)
 		{
 		gint ret;
@@ -31,7 +31,8 @@
 
 class FileData;
 struct LayoutWindow;
-struct ThumbLoader;
+struct ViewFileMetadata;
+struct ViewFileStream;
 
 struct ViewFile
 {
@@ -75,8 +76,10 @@ struct ViewFile
 
 	/* thumbs updates*/
 	gboolean thumbs_running;
-	ThumbLoader *thumbs_loader;
-	FileData *thumbs_filedata;
+	GList *thumbs_loaders; /**< #ViewFileThumb in progress */
+	GList *thumbs_done; /**< #ViewFileThumb finished, not shown yet */
+	guint thumbs_done_id; /**< event source id */
+	guint thumbs_scroll_id; /**< event source id */
 
 	/* marks */
 	gboolean marks_enabled;
@@ -93,7 +96,9 @@ struct ViewFile
 
 	GList *editmenu_fd_list; /**< file list for edit menu */
 
-	guint read_metadata_in_idle_id;
+	ViewFileMetadata *read_metadata; /**< set while metadata are read in the background */
+
+	ViewFileStream *stream; /**< set while the folder is read in parts */
 
 	using SelectionCallback = std::function<void(FileData *)>;
 };
@@ -149,7 +154,14 @@ void vf_notify_cb(FileData *fd, NotifyType type, gpointer data);
 void vf_thumb_update(ViewFile *vf);
 void vf_thumb_cleanup(ViewFile *vf);
 void vf_thumb_stop(ViewFile *vf);
+gboolean vf_thumb_loading(ViewFile *vf, FileData *fd);
 void vf_read_metadata_in_idle(ViewFile *vf);
+
+gboolean vf_stream_start(ViewFile *vf);
+void vf_stream_cancel(ViewFile *vf);
+gboolean vf_stream_defer_refresh(ViewFile *vf);
+GList *vf_list_insert_sorted(ViewFile *vf, GList *list, GList *files);
+
 void vf_file_filter_set(ViewFile *vf, gboolean enable);
 GRegex *vf_file_filter_get_filter(ViewFile *vf);
 
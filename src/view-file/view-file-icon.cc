@@ -1566,17 +1566,6 @@ void vficon_thumb_progress_count(const GList *list, gint &count, gint &done)
 		}
 }
 
-void vficon_read_metadata_progress_count(const GList *list, gint &count, gint &done)
-{
-	for (const GList *work = list; work; work = work->next)
-		{
-		auto fd = static_cast<FileData *>(work->data);
-
-		if (fd->metadata_in_idle_loaded) done++;
-		count++;
-		}
-}
-
 void vficon_set_thumb_fd(ViewFile *vf, FileData *fd)
 {
 	GtkTreeModel *store;
@@ -1618,7 +1607,7 @@ FileData *vficon_thumb_next_fd(ViewFile *vf)
 			for (; list; list = list->next)
 				{
 				auto fd = static_cast<FileData *>(list->data);
-				if (fd && !fd->thumb_pixbuf) return fd;
+				if (fd && !fd->thumb_pixbuf && !vf_thumb_loading(vf, fd)) return fd;
 				}
 
 			valid = gtk_tree_model_iter_next(store, &iter);
@@ -1633,12 +1622,21 @@ FileData *vficon_thumb_next_fd(ViewFile *vf)
 
 		// Note: This implementation differs from view-file-list.cc because sidecar files are not
 		// distinct list elements here, as they are in the list view.
-		if (!fd->thumb_pixbuf) return fd;
+		if (!fd->thumb_pixbuf && !vf_thumb_loading(vf, fd)) return fd;
 		}
 
 	return nullptr;
 }
 
+gboolean vficon_thumb_fd_visible(ViewFile *vf, FileData *fd)
+{
+	GtkTreeIter iter;
+
+	if (!vficon_find_iter(vf, fd, &iter, nullptr)) return FALSE;
+
+	return tree_view_row_get_visibility(GTK_TREE_VIEW(vf->listview), &iter, FALSE) == 0;
+}
+
 void vficon_set_star_fd(ViewFile *vf, FileData *fd)
 {
 	GtkTreeModel *store;
@@ -1738,13 +1736,11 @@ gint vficon_index_by_fd(const ViewFile *vf, const FileData *fd)
  *-----------------------------------------------------------------------------
  */
 
-static gboolean vficon_refresh_real(ViewFile *vf, gboolean keep_position)
+static void vficon_refresh_list_real(ViewFile *vf, GList *new_filelist, gboolean keep_position)
 {
-	gboolean ret = TRUE;
 	GList *work;
 	GList *new_work;
 	FileData *first_selected = nullptr;
-	GList *new_filelist = nullptr;
 	GList *new_fd_list = nullptr;
 	GList *old_selected = nullptr;
 	GtkTreePath *end_path = nullptr;
@@ -1756,7 +1752,6 @@ static gboolean vficon_refresh_real(ViewFile *vf, gboolean keep_position)
 
 	if (vf->dir_fd)
 		{
-		ret = filelist_read(vf->dir_fd, &new_filelist, nullptr);
 		new_filelist = file_data_filter_marks_list(new_filelist, vf_marks_get_filter(vf));
 		new_filelist = g_list_first(new_filelist);
 		new_filelist = file_data_filter_file_filter_list(new_filelist, vf_file_filter_get_filter(vf));
@@ -1894,15 +1889,57 @@ static gboolean vficon_refresh_real(ViewFile *vf, gboolean keep_position)
 
 	gtk_tree_path_free(start_path);
 	gtk_tree_path_free(end_path);
+}
+
+static gboolean vficon_refresh_real(ViewFile *vf, gboolean keep_position)
+{
+	GList *new_filelist = nullptr;
+	gboolean ret = TRUE;
+
+	if (vf->dir_fd)
+		{
+		ret = filelist_read(vf->dir_fd, &new_filelist, nullptr);
+		}
+
+	vficon_refresh_list_real(vf, new_filelist, keep_position);
 
 	return ret;
 }
 
 gboolean vficon_refresh(ViewFile *vf)
 {
+	/* the complete list is shown when the folder is read */
+	if (vf_stream_defer_refresh(vf)) return TRUE;
+
 	return vficon_refresh_real(vf, TRUE);
 }
 
+/**
+ * @brief Updates the list to \a files, read from vf->dir_fd
+ * @param files Freed by the view
+ */
+void vficon_refresh_list(ViewFile *vf, GList *files)
+{
+	vficon_refresh_list_real(vf, files, vf->list != nullptr);
+}
+
+/**
+ * @brief Adds sorted \a files, read so far from vf->dir_fd
+ */
+void vficon_stream_add(ViewFile *vf, GList *files)
+{
+	gboolean keep_position = (vf->list != nullptr);
+
+	for (GList *work = files; work; work = work->next)
+		{
+		static_cast<FileData *>(work->data)->selected = SELECTION_NONE;
+		}
+
+	vf->list = vf_list_insert_sorted(vf, vf->list, files);
+
+	vficon_populate(vf, TRUE, keep_position);
+}
+
 /*
  *-----------------------------------------------------------------------------
  * draw, etc.
@@ -2051,7 +2088,7 @@ gboolean vficon_set_fd(ViewFile *vf, FileData *dir_fd)
 	vf->list = nullptr;
 
 	/* NOTE: populate will clear the store for us */
-	ret = vficon_refresh_real(vf, FALSE);
+	ret = vf_stream_start(vf);
 
 	VFICON(vf)->focus_fd = nullptr;
 	vficon_move_focus(vf, 0, 0, FALSE);
@@ -67,6 +67,8 @@ ViewFile *vficon_new(ViewFile *vf);
 
 gboolean vficon_set_fd(ViewFile *vf, FileData *dir_fd);
 gboolean vficon_refresh(ViewFile *vf);
+void vficon_refresh_list(ViewFile *vf, GList *files);
+void vficon_stream_add(ViewFile *vf, GList *files);
 
 
 void vficon_marks_set(ViewFile *vf, gboolean enable);
@@ -98,9 +100,9 @@ void vficon_selection_to_mark(ViewFile *vf, gint mark, SelectionToMarkMode mode)
 
 
 void vficon_thumb_progress_count(const GList *list, gint &count, gint &done);
-void vficon_read_metadata_progress_count(const GList *list, gint &count, gint &done);
 void vficon_set_thumb_fd(ViewFile *vf, FileData *fd);
 FileData *vficon_thumb_next_fd(ViewFile *vf);
+gboolean vficon_thumb_fd_visible(ViewFile *vf, FileData *fd);
 
 FileData *vficon_star_next_fd(ViewFile *vf);
 void vficon_set_star_fd(ViewFile *vf, FileData *fd);
@@ -1038,22 +1038,6 @@ void vflist_thumb_progress_count(const GList *list, gint &count, gint &done)
 		}
 }
 
-void vflist_read_metadata_progress_count(const GList *list, gint &count, gint &done)
-{
-	for (const GList *work = list; work; work = work->next)
-		{
-		auto fd = static_cast<FileData *>(work->data);
-
-		if (fd->metadata_in_idle_loaded) done++;
-
-		if (fd->sidecar_files)
-			{
-			vflist_read_metadata_progress_count(fd->sidecar_files, count, done);
-			}
-		count++;
-		}
-}
-
 void vflist_set_thumb_fd(ViewFile *vf, FileData *fd)
 {
 	GtkTreeStore *store;
@@ -1089,7 +1073,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 
 			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &nfd, -1);
 
-			if (!nfd->thumb_pixbuf) fd = nfd;
+			if (!nfd->thumb_pixbuf && !vf_thumb_loading(vf, nfd)) fd = nfd;
 
 			valid = gtk_tree_model_iter_next(store, &iter);
 			}
@@ -1103,7 +1087,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 		while (work && !fd)
 			{
 			auto fd_p = static_cast<FileData *>(work->data);
-			if (!fd_p->thumb_pixbuf)
+			if (!fd_p->thumb_pixbuf && !vf_thumb_loading(vf, fd_p))
 				fd = fd_p;
 			else
 				{
@@ -1112,7 +1096,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 				while (work2 && !fd)
 					{
 					fd_p = static_cast<FileData *>(work2->data);
-					if (!fd_p->thumb_pixbuf) fd = fd_p;
+					if (!fd_p->thumb_pixbuf && !vf_thumb_loading(vf, fd_p)) fd = fd_p;
 					work2 = work2->next;
 					}
 				}
@@ -1123,6 +1107,15 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 	return fd;
 }
 
+gboolean vflist_thumb_fd_visible(ViewFile *vf, FileData *fd)
+{
+	GtkTreeIter iter;
+
+	if (vflist_find_row(vf, fd, &iter) < 0) return FALSE;
+
+	return tree_view_row_get_visibility(GTK_TREE_VIEW(vf->listview), &iter, FALSE) == 0;
+}
+
 void vflist_set_star_fd(ViewFile *vf, FileData *fd)
 {
 	GtkTreeStore *store;
@@ -1746,46 +1739,39 @@ static void vflist_populate_view(ViewFile *vf, gboolean force)
 	vf_star_update(vf);
 }
 
-gboolean vflist_refresh(ViewFile *vf)
+/**
+ * @brief Replaces the list with \a files, read from vf->dir_fd
+ * @param files Taken over by the view
+ */
+void vflist_refresh_list(ViewFile *vf, GList *files)
 {
 	GList *old_list;
-	gboolean ret = TRUE;
 
 	old_list = vf->list;
-	vf->list = nullptr;
+	vf->list = files;
 
-	DEBUG_1("%s vflist_refresh: read dir", get_exec_time());
-	if (vf->dir_fd)
+	if (vf->marks_enabled)
 		{
-		file_data_unregister_notify_func(vf_notify_cb, vf); /* we don't need the notification of changes detected by filelist_read */
-
-		ret = filelist_read(vf->dir_fd, &vf->list, nullptr);
-
-		if (vf->marks_enabled)
-			{
-			// When marks are enabled, lock FileDatas so that we don't end up re-parsing XML
-			// each time a mark is changed.
-			file_data_lock_list(vf->list);
-			}
-		else
-			{
-			/** @FIXME only do this when needed (aka when we just switched from */
-			/** @FIXME marks-enabled to marks-disabled) */
-			file_data_unlock_list(vf->list);
-			}
-
-		vf->list = file_data_filter_marks_list(vf->list, vf_marks_get_filter(vf));
-		vf->list = g_list_first(vf->list);
-		vf->list = file_data_filter_file_filter_list(vf->list, vf_file_filter_get_filter(vf));
+		// When marks are enabled, lock FileDatas so that we don't end up re-parsing XML
+		// each time a mark is changed.
+		file_data_lock_list(vf->list);
+		}
+	else
+		{
+		/** @FIXME only do this when needed (aka when we just switched from */
+		/** @FIXME marks-enabled to marks-disabled) */
+		file_data_unlock_list(vf->list);
+		}
 
-		vf->list = g_list_first(vf->list);
-		vf->list = file_data_filter_class_list(vf->list, vf_class_get_filter(vf));
+	vf->list = file_data_filter_marks_list(vf->list, vf_marks_get_filter(vf));
+	vf->list = g_list_first(vf->list);
+	vf->list = file_data_filter_file_filter_list(vf->list, vf_file_filter_get_filter(vf));
 
-		file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+	vf->list = g_list_first(vf->list);
+	vf->list = file_data_filter_class_list(vf->list, vf_class_get_filter(vf));
 
-		DEBUG_1("%s vflist_refresh: sort", get_exec_time());
-		vf->list = filelist_sort(vf->list, vf->sort_method, vf->sort_ascend, vf->sort_case);
-		}
+	DEBUG_1("%s vflist_refresh: sort", get_exec_time());
+	vf->list = filelist_sort(vf->list, vf->sort_method, vf->sort_ascend, vf->sort_case);
 
 	DEBUG_1("%s vflist_refresh: populate view", get_exec_time());
 
@@ -1795,10 +1781,50 @@ gboolean vflist_refresh(ViewFile *vf)
 
 	filelist_free(old_list);
 	DEBUG_1("%s vflist_refresh: done", get_exec_time());
+}
+
+gboolean vflist_refresh(ViewFile *vf)
+{
+	GList *files = nullptr;
+	gboolean ret = TRUE;
+
+	/* the complete list is shown when the folder is read */
+	if (vf_stream_defer_refresh(vf)) return TRUE;
+
+	DEBUG_1("%s vflist_refresh: read dir", get_exec_time());
+	if (vf->dir_fd)
+		{
+		file_data_unregister_notify_func(vf_notify_cb, vf); /* we don't need the notification of changes detected by filelist_read */
+
+		ret = filelist_read(vf->dir_fd, &files, nullptr);
+
+		file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+
+		vflist_refresh_list(vf, files);
+		}
+	else
+		{
+		GList *old_list = vf->list;
+
+		vf->list = nullptr;
+		vflist_populate_view(vf, FALSE);
+		filelist_free(old_list);
+		}
 
 	return ret;
 }
 
+/**
+ * @brief Adds sorted \a files, read so far from vf->dir_fd
+ */
+void vflist_stream_add(ViewFile *vf, GList *files)
+{
+	if (vf->marks_enabled) file_data_lock_list(files);
+
+	vf->list = vf_list_insert_sorted(vf, vf->list, files);
+
+	vflist_populate_view(vf, FALSE);
+}
 
 static GdkRGBA *vflist_listview_color_shifted(GtkWidget *widget)
 {
@@ -1951,7 +1977,7 @@ gboolean vflist_set_fd(ViewFile *vf, FileData *dir_fd)
 	filelist_free(vf->list);
 	vf->list = nullptr;
 
-	ret = vflist_refresh(vf);
+	ret = vf_stream_start(vf);
 	gtk_tree_view_columns_autosize(GTK_TREE_VIEW(vf->listview));
 	return ret;
 }
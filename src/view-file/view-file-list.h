@@ -56,6 +56,8 @@ ViewFile *vflist_new(ViewFile *vf);
 
 gboolean vflist_set_fd(ViewFile *vf, FileData *dir_fd);
 gboolean vflist_refresh(ViewFile *vf);
+void vflist_refresh_list(ViewFile *vf, GList *files);
+void vflist_stream_add(ViewFile *vf, GList *files);
 
 void vflist_thumb_set(ViewFile *vf, gboolean enable);
 void vflist_marks_set(ViewFile *vf, gboolean enable);
@@ -88,9 +90,9 @@ void vflist_selection_to_mark(ViewFile *vf, gint mark, SelectionToMarkMode mode)
 void vflist_color_set(ViewFile *vf, FileData *fd, gboolean color_set);
 
 void vflist_thumb_progress_count(const GList *list, gint &count, gint &done);
-void vflist_read_metadata_progress_count(const GList *list, gint &count, gint &done);
 void vflist_set_thumb_fd(ViewFile *vf, FileData *fd);
 FileData *vflist_thumb_next_fd(ViewFile *vf);
+gboolean vflist_thumb_fd_visible(ViewFile *vf, FileData *fd);
 
 FileData *vflist_star_next_fd(ViewFile *vf);
 void vflist_set_star_fd(ViewFile *vf, FileData *fd);
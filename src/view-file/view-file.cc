@@ -21,11 +21,13 @@
 #include "view-file.h"
 
 #include <array>
+#include <ctime>
 
 #include <gdk/gdk.h>
 #include <glib-object.h>
 
 #include "archives.h"
+#include "cache-exif-index.h"
 #include "compat.h"
 #include "debug.h"
 #include "dnd.h"
@@ -941,6 +943,8 @@ gboolean vf_set_fd(ViewFile *vf, FileData *dir_fd)
 	return ret;
 }
 
+static void vf_read_metadata_cancel(ViewFile *vf);
+
 static void vf_destroy_cb(GtkWidget *, gpointer data)
 {
 	auto vf = static_cast<ViewFile *>(data);
@@ -958,10 +962,10 @@ static void vf_destroy_cb(GtkWidget *, gpointer data)
 		gq_gtk_widget_destroy(vf->popup);
 		}
 
-	if (vf->read_metadata_in_idle_id)
-		{
-		g_idle_remove_by_data(vf);
-		}
+	g_signal_handlers_disconnect_by_data(G_OBJECT(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(vf->scrolled))), vf);
+
+	vf_read_metadata_cancel(vf);
+	vf_stream_cancel(vf);
 	file_data_unref(vf->dir_fd);
 	g_free(vf->info);
 	g_free(vf);
@@ -1365,6 +1369,8 @@ void vf_mark_filter_toggle(ViewFile *vf, gint mark)
 				     !gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(vf->filter_check[n])));
 }
 
+static void vf_thumb_scroll_cb(GtkAdjustment *adjustment, gpointer data);
+
 ViewFile *vf_new(FileViewType type, FileData *dir_fd)
 {
 	ViewFile *vf;
@@ -1374,7 +1380,6 @@ ViewFile *vf_new(FileViewType type, FileData *dir_fd)
 	vf->type = type;
 	vf->sort_method = SORT_NAME;
 	vf->sort_ascend = TRUE;
-	vf->read_metadata_in_idle_id = 0;
 
 	vf->scrolled = gq_gtk_scrolled_window_new(nullptr, nullptr);
 	gq_gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(vf->scrolled), GTK_SHADOW_IN);
@@ -1411,6 +1416,9 @@ ViewFile *vf_new(FileViewType type, FileData *dir_fd)
 	gq_gtk_container_add(GTK_WIDGET(vf->scrolled), vf->listview);
 	gtk_widget_show(vf->listview);
 
+	g_signal_connect(G_OBJECT(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(vf->scrolled))), "value-changed",
+			 G_CALLBACK(vf_thumb_scroll_cb), vf);
+
 	if (dir_fd) vf_set_fd(vf, dir_fd);
 
 	return vf;
@@ -1455,20 +1463,6 @@ static gdouble vf_thumb_progress(ViewFile *vf)
 	return static_cast<gdouble>(done) / count;
 }
 
-static gdouble vf_read_metadata_in_idle_progress(ViewFile *vf)
-{
-	gint count = 0;
-	gint done = 0;
-
-	switch (vf->type)
-	{
-	case FILEVIEW_LIST: vflist_read_metadata_progress_count(vf->list, count, done); break;
-	case FILEVIEW_ICON: vficon_read_metadata_progress_count(vf->list, count, done); break;
-	}
-
-	return static_cast<gdouble>(done) / count;
-}
-
 static void vf_set_thumb_fd(ViewFile *vf, FileData *fd)
 {
 	switch (vf->type)
@@ -1494,16 +1488,61 @@ static void vf_thumb_do(ViewFile *vf, FileData *fd)
 	vf_thumb_status(vf, vf_thumb_progress(vf), _("Loading thumbs..."));
 }
 
+/*
+ * Thumbnails are loaded by up to vf_thumb_max_loaders() loaders at a time,
+ * visible rows first. Finished loaders are collected in vf->thumbs_done and
+ * the view is updated for all of them at once.
+ */
+struct ViewFileThumb
+{
+	ViewFile *vf;
+	FileData *fd;
+	ThumbLoader *tl;
+};
+
+namespace
+{
+
+constexpr gint VF_THUMB_MAX_LOADERS = 8;
+constexpr guint VF_THUMB_SCROLL_DELAY = 100; /**< ms after scrolling before loaders are moved to the visible rows */
+
+guint vf_thumb_max_loaders()
+{
+	return CLAMP(get_cpu_cores(), 1, VF_THUMB_MAX_LOADERS);
+}
+
+} // namespace
+
+static void vf_thumb_free(ViewFileThumb *vt)
+{
+	thumb_loader_free(vt->tl);
+	file_data_unref(vt->fd);
+	g_free(vt);
+}
+
 void vf_thumb_cleanup(ViewFile *vf)
 {
 	vf_thumb_status(vf, 0.0, nullptr);
 
 	vf->thumbs_running = FALSE;
 
-	thumb_loader_free(vf->thumbs_loader);
-	vf->thumbs_loader = nullptr;
+	g_list_free_full(vf->thumbs_loaders, reinterpret_cast<GDestroyNotify>(vf_thumb_free));
+	vf->thumbs_loaders = nullptr;
+
+	g_list_free_full(vf->thumbs_done, reinterpret_cast<GDestroyNotify>(vf_thumb_free));
+	vf->thumbs_done = nullptr;
+
+	if (vf->thumbs_done_id)
+		{
+		g_source_remove(vf->thumbs_done_id);
+		vf->thumbs_done_id = 0;
+		}
 
-	vf->thumbs_filedata = nullptr;
+	if (vf->thumbs_scroll_id)
+		{
+		g_source_remove(vf->thumbs_scroll_id);
+		vf->thumbs_scroll_id = 0;
+		}
 }
 
 void vf_thumb_stop(ViewFile *vf)
@@ -1511,16 +1550,95 @@ void vf_thumb_stop(ViewFile *vf)
 	if (vf->thumbs_running) vf_thumb_cleanup(vf);
 }
 
-static void vf_thumb_common_cb(ThumbLoader *tl, gpointer data)
+/**
+ * @brief Checks if a thumbnail of \a fd is being loaded
+ *
+ * Used by the views to skip files that are in progress when looking for
+ * the next thumbnail to load.
+ */
+gboolean vf_thumb_loading(ViewFile *vf, FileData *fd)
+{
+	for (GList *work = vf->thumbs_loaders; work; work = work->next)
+		{
+		if (static_cast<ViewFileThumb *>(work->data)->fd == fd) return TRUE;
+		}
+
+	return FALSE;
+}
+
+static FileData *vf_thumb_next_fd(ViewFile *vf)
+{
+	FileData *fd = nullptr;
+
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: fd = vflist_thumb_next_fd(vf); break;
+	case FILEVIEW_ICON: fd = vficon_thumb_next_fd(vf); break;
+	}
+
+	return fd;
+}
+
+static gboolean vf_thumb_fd_visible(ViewFile *vf, FileData *fd)
+{
+	gboolean visible = FALSE;
+
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: visible = vflist_thumb_fd_visible(vf, fd); break;
+	case FILEVIEW_ICON: visible = vficon_thumb_fd_visible(vf, fd); break;
+	}
+
+	return visible;
+}
+
+static void vf_thumb_fill(ViewFile *vf)
+{
+	while (g_list_length(vf->thumbs_loaders) < vf_thumb_max_loaders() && vf_thumb_next(vf));
+
+	if (vf->thumbs_running && !vf->thumbs_loaders && !vf->thumbs_done)
+		{
+		/* done */
+		vf_thumb_cleanup(vf);
+		}
+}
+
+static gboolean vf_thumb_done_idle_cb(gpointer data)
 {
 	auto vf = static_cast<ViewFile *>(data);
+	GList *done = g_list_reverse(vf->thumbs_done);
 
-	if (vf->thumbs_filedata && vf->thumbs_loader == tl)
+	vf->thumbs_done = nullptr;
+	vf->thumbs_done_id = 0;
+
+	for (GList *work = done; work; work = work->next)
 		{
-		vf_thumb_do(vf, vf->thumbs_filedata);
+		auto vt = static_cast<ViewFileThumb *>(work->data);
+
+		vf_set_thumb_fd(vf, vt->fd);
+		vf_thumb_free(vt);
 		}
+	g_list_free(done);
+
+	vf_thumb_status(vf, vf_thumb_progress(vf), _("Loading thumbs..."));
+
+	vf_thumb_fill(vf);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void vf_thumb_common_cb(ThumbLoader *, gpointer data)
+{
+	auto vt = static_cast<ViewFileThumb *>(data);
+	ViewFile *vf = vt->vf;
 
-	while (vf_thumb_next(vf));
+	vf->thumbs_loaders = g_list_remove(vf->thumbs_loaders, vt);
+	vf->thumbs_done = g_list_prepend(vf->thumbs_done, vt);
+
+	if (!vf->thumbs_done_id)
+		{
+		vf->thumbs_done_id = g_idle_add(vf_thumb_done_idle_cb, vf);
+		}
 }
 
 static void vf_thumb_error_cb(ThumbLoader *tl, gpointer data)
@@ -1533,9 +1651,12 @@ static void vf_thumb_done_cb(ThumbLoader *tl, gpointer data)
 	vf_thumb_common_cb(tl, data);
 }
 
+/**
+ * @returns TRUE if there may be more thumbnails to start
+ */
 static gboolean vf_thumb_next(ViewFile *vf)
 {
-	FileData *fd = nullptr;
+	FileData *fd;
 
 	if (!gtk_widget_get_realized(vf->listview))
 		{
@@ -1543,40 +1664,72 @@ static gboolean vf_thumb_next(ViewFile *vf)
 		return FALSE;
 		}
 
-	switch (vf->type)
-	{
-	case FILEVIEW_LIST: fd = vflist_thumb_next_fd(vf); break;
-	case FILEVIEW_ICON: fd = vficon_thumb_next_fd(vf); break;
-	}
-
-	if (!fd)
-		{
-		/* done */
-		vf_thumb_cleanup(vf);
-		return FALSE;
-		}
-
-	vf->thumbs_filedata = fd;
-
-	thumb_loader_free(vf->thumbs_loader);
+	fd = vf_thumb_next_fd(vf);
+	if (!fd) return FALSE;
 
-	vf->thumbs_loader = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
-	thumb_loader_set_callbacks(vf->thumbs_loader,
+	auto vt = g_new0(ViewFileThumb, 1);
+	vt->vf = vf;
+	vt->fd = file_data_ref(fd);
+	vt->tl = thumb_loader_new(options->thumbnails.max_width, options->thumbnails.max_height);
+	thumb_loader_set_callbacks(vt->tl,
 				   vf_thumb_done_cb,
 				   vf_thumb_error_cb,
 				   nullptr,
-				   vf);
+				   vt);
 
-	if (!thumb_loader_start(vf->thumbs_loader, fd))
+	if (!thumb_loader_start(vt->tl, fd))
 		{
 		/* set icon to unknown, continue */
 		DEBUG_1("thumb loader start failed %s", fd->path);
+		vf_thumb_free(vt);
 		vf_thumb_do(vf, fd);
 
 		return TRUE;
 		}
 
-	return FALSE;
+	vf->thumbs_loaders = g_list_prepend(vf->thumbs_loaders, vt);
+
+	return TRUE;
+}
+
+static gboolean vf_thumb_scroll_delay_cb(gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
+
+	vf->thumbs_scroll_id = 0;
+
+	/* nothing visible is waiting */
+	FileData *fd = vf_thumb_next_fd(vf);
+	if (!fd || !vf_thumb_fd_visible(vf, fd)) return G_SOURCE_REMOVE;
+
+	/* cancel the rows scrolled out of view, they are started again later */
+	GList *work = vf->thumbs_loaders;
+	while (work)
+		{
+		auto vt = static_cast<ViewFileThumb *>(work->data);
+		GList *next = work->next;
+
+		if (!vf_thumb_fd_visible(vf, vt->fd))
+			{
+			DEBUG_1("thumb loader cancelled %s", vt->fd->path);
+			vf->thumbs_loaders = g_list_delete_link(vf->thumbs_loaders, work);
+			vf_thumb_free(vt);
+			}
+		work = next;
+		}
+
+	vf_thumb_fill(vf);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void vf_thumb_scroll_cb(GtkAdjustment *, gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
+
+	if (!vf->thumbs_running || vf->thumbs_scroll_id) return;
+
+	vf->thumbs_scroll_id = g_timeout_add(VF_THUMB_SCROLL_DELAY, vf_thumb_scroll_delay_cb, vf);
 }
 
 static void vf_thumb_reset_all(ViewFile *vf)
@@ -1609,7 +1762,7 @@ void vf_thumb_update(ViewFile *vf)
 		thumb_format_changed = FALSE;
 		}
 
-	while (vf_thumb_next(vf));
+	vf_thumb_fill(vf);
 }
 
 void vf_star_cleanup(ViewFile *vf)
@@ -1883,68 +2036,439 @@ void vf_notify_cb(FileData *fd, NotifyType type, gpointer data)
 		}
 }
 
-static gboolean vf_read_metadata_in_idle_cb(gpointer data)
+/*
+ *-----------------------------------------------------------------------------
+ * streaming folder load
+ *-----------------------------------------------------------------------------
+ */
+
+/**
+ * A large folder is shown while it is read: the files found so far are
+ * added to the view at intervals, merged into the sorted list, and the
+ * complete list with grouped sidecars replaces them at the end.
+ */
+struct ViewFileStream
 {
-	FileData *fd;
-	auto vf = static_cast<ViewFile *>(data);
-	GList *work;
+	ViewFile *vf;
+	FileListReader *reader;
+	guint idle_id; /**< event source id */
+	gint64 update_time; /**< monotonic time of the last view update */
+	GList *pending; /**< files read but not yet shown */
+	gboolean refresh; /**< a refresh was requested while reading */
+	gboolean read_metadata; /**< reading metadata in idle waits for the complete list */
+};
 
-	vf_thumb_status(vf, vf_read_metadata_in_idle_progress(vf), _("Loading meta..."));
+namespace
+{
 
-	work = vf->list;
+constexpr gint64 VF_STREAM_FIRST_SLICE = 50000; /**< µs of reading before the view is first shown */
+constexpr gint64 VF_STREAM_SLICE = 20000; /**< µs of reading per idle call */
+constexpr gint64 VF_STREAM_UPDATE_INTERVAL = 250000; /**< µs between view updates */
 
-	while (work)
+} // namespace
+
+/*
+ *-----------------------------------------------------------------------------
+ * reading metadata in the background
+ *-----------------------------------------------------------------------------
+ */
+
+/*
+ * The sort dates and ratings of the files are read by a pool of worker
+ * threads, through the metadata index so unchanged files are not parsed
+ * again. The results are applied on the main thread and the view is sorted
+ * once when all are read. A cancelled batch stays alive until the workers
+ * returned all its jobs, the FileData references are only dropped on the
+ * main thread.
+ */
+struct ViewFileMetadata
+{
+	ViewFile *vf; /**< nullptr when cancelled */
+	gint cancelled; /**< atomic, tells the workers to skip the remaining jobs */
+	GAsyncQueue *done; /**< finished #ViewFileMetadataJob */
+	guint jobs;
+	guint jobs_done;
+};
+
+struct ViewFileMetadataJob
+{
+	ViewFileMetadata *vm;
+	FileData *fd; /**< only used on the main thread */
+	ExifIndexFile file; /**< what the workers read of fd */
+	gchar *sidecar_path;
+
+	gboolean read; /**< the values below are set */
+	time_t exifdate;
+	time_t exifdate_digitized;
+	gint rating;
+};
+
+namespace
+{
+
+constexpr gint VF_METADATA_MAX_THREADS = 8;
+constexpr guint VF_METADATA_POLL_INTERVAL = 100; /**< ms between applying the results */
+
+const gchar *const vf_metadata_keys[] = {"Exif.Photo.DateTimeOriginal", "Exif.Photo.DateTimeDigitized", RATING_KEY, nullptr};
+
+} // namespace
+
+static time_t vf_metadata_parse_date(const gchar *text)
+{
+	std::tm time_str{};
+
+	if (!text) return 0;
+
+	strptime(text, "%Y:%m:%d %H:%M:%S", &time_str);
+
+	return mktime(&time_str);
+}
+
+static void vf_metadata_thread_func(gpointer data, gpointer)
+{
+	auto job = static_cast<ViewFileMetadataJob *>(data);
+
+	/* files with unsaved changes are read on the main thread */
+	if (!g_atomic_int_get(&job->vm->cancelled) && !job->file.modified_xmp)
 		{
-		fd = static_cast<FileData *>(work->data);
+		gchar *values[G_N_ELEMENTS(vf_metadata_keys)];
 
-		if (fd && !fd->metadata_in_idle_loaded)
+		if (metadata_read_strings_thread(job->file, job->sidecar_path, vf_metadata_keys, values))
 			{
-			if (!fd->exifdate)
-				{
-				read_exif_time_data(fd);
-				}
-			if (!fd->exifdate_digitized)
-				{
-				read_exif_time_digitized_data(fd);
-				}
-			if (fd->rating == STAR_RATING_NOT_READ)
-				{
-				read_rating_data(fd);
-				}
-			fd->metadata_in_idle_loaded = TRUE;
-			return G_SOURCE_CONTINUE;
+			job->exifdate = vf_metadata_parse_date(values[0]);
+			job->exifdate_digitized = vf_metadata_parse_date(values[1]);
+			job->rating = values[2] ? atoi(values[2]) : 0;
 			}
-		work = work->next;
+		job->read = TRUE;
+
+		for (gchar *value : values) g_free(value);
+		}
+
+	g_async_queue_push(job->vm->done, job);
+}
+
+static GThreadPool *vf_metadata_thread_pool()
+{
+	static GThreadPool *pool = g_thread_pool_new(vf_metadata_thread_func, nullptr,
+						     CLAMP(get_cpu_cores(), 1, VF_METADATA_MAX_THREADS), FALSE, nullptr);
+
+	return pool;
+}
+
+static void vf_metadata_job_apply(ViewFileMetadataJob *job)
+{
+	FileData *fd = job->fd;
+
+	if (fd->metadata_in_idle_loaded) return;
+
+	if (job->read && !fd->modified_xmp)
+		{
+		if (!fd->exifdate) fd->exifdate = job->exifdate;
+		if (!fd->exifdate_digitized) fd->exifdate_digitized = job->exifdate_digitized;
+		if (fd->rating == STAR_RATING_NOT_READ) fd->rating = job->rating;
+		}
+	else
+		{
+		/* the unsaved changes are only seen on the main thread */
+		if (!fd->exifdate) read_exif_time_data(fd);
+		if (!fd->exifdate_digitized) read_exif_time_digitized_data(fd);
+		if (fd->rating == STAR_RATING_NOT_READ) read_rating_data(fd);
+		}
+
+	fd->metadata_in_idle_loaded = TRUE;
+}
+
+static gboolean vf_metadata_poll_cb(gpointer data)
+{
+	auto vm = static_cast<ViewFileMetadata *>(data);
+	gpointer item;
+
+	while ((item = g_async_queue_try_pop(vm->done)))
+		{
+		auto job = static_cast<ViewFileMetadataJob *>(item);
+
+		if (vm->vf) vf_metadata_job_apply(job);
+
+		file_data_unref(job->fd);
+		exif_index_file_clear(job->file);
+		g_free(job->sidecar_path);
+		g_free(job);
+		vm->jobs_done++;
+		}
+
+	if (vm->jobs_done < vm->jobs)
+		{
+		if (vm->vf) vf_thumb_status(vm->vf, static_cast<gdouble>(vm->jobs_done) / vm->jobs, _("Loading meta..."));
+		return G_SOURCE_CONTINUE;
+		}
+
+	ViewFile *vf = vm->vf;
+
+	g_async_queue_unref(vm->done);
+	g_free(vm);
+
+	if (vf)
+		{
+		DEBUG_1("metadata cache of %s: %" G_GSIZE_FORMAT " bytes", vf->dir_fd ? vf->dir_fd->path : "", metadata_cache_size(vf->list));
+
+		vf->read_metadata = nullptr;
+		vf_thumb_status(vf, 0.0, nullptr);
+		vf_refresh(vf);
 		}
 
-	vf_thumb_status(vf, 0.0, nullptr);
-	vf->read_metadata_in_idle_id = 0;
-	vf_refresh(vf);
 	return G_SOURCE_REMOVE;
 }
 
-static void vf_read_metadata_in_idle_finished_cb(gpointer data)
+static void vf_read_metadata_cancel(ViewFile *vf)
 {
-	auto vf = static_cast<ViewFile *>(data);
+	ViewFileMetadata *vm = vf->read_metadata;
 
-	vf_thumb_status(vf, 0.0, _("Loading meta..."));
-	vf->read_metadata_in_idle_id = 0;
+	if (!vm) return;
+
+	vf->read_metadata = nullptr;
+	vm->vf = nullptr;
+	g_atomic_int_set(&vm->cancelled, TRUE);
 }
 
 void vf_read_metadata_in_idle(ViewFile *vf)
 {
 	if (!vf) return;
 
-	if (vf->read_metadata_in_idle_id)
+	vf_read_metadata_cancel(vf);
+
+	if (vf->stream)
+		{
+		/* started again when the whole folder is read */
+		vf->stream->read_metadata = TRUE;
+		return;
+		}
+
+	auto vm = g_new0(ViewFileMetadata, 1);
+	vm->vf = vf;
+	vm->done = g_async_queue_new();
+
+	for (GList *work = vf->list; work; work = work->next)
 		{
-		g_idle_remove_by_data(vf);
+		auto fd = static_cast<FileData *>(work->data);
+
+		if (!fd || fd->metadata_in_idle_loaded) continue;
+
+		auto job = g_new0(ViewFileMetadataJob, 1);
+		job->vm = vm;
+		job->fd = file_data_ref(fd);
+		exif_index_file_init(job->file, fd);
+		job->sidecar_path = file_data_get_sidecar_path(fd, TRUE);
+
+		vm->jobs++;
+		g_thread_pool_push(vf_metadata_thread_pool(), job, nullptr);
 		}
-	vf->read_metadata_in_idle_id = 0;
 
-	if (vf->list)
+	if (vm->jobs == 0)
 		{
-		vf->read_metadata_in_idle_id = g_idle_add_full(G_PRIORITY_LOW, vf_read_metadata_in_idle_cb, vf, vf_read_metadata_in_idle_finished_cb);
+		g_async_queue_unref(vm->done);
+		g_free(vm);
+		vf_refresh(vf);
+		return;
 		}
+
+	vf->read_metadata = vm;
+	vf_thumb_status(vf, 0.0, _("Loading meta..."));
+	g_timeout_add(VF_METADATA_POLL_INTERVAL, vf_metadata_poll_cb, vm);
+}
+
+/**
+ * @brief Merges sorted \a files into the sorted \a list
+ * @returns The new list. The links of \a files are freed, the references kept.
+ */
+GList *vf_list_insert_sorted(ViewFile *vf, GList *list, GList *files)
+{
+	FileData::FileList::SortSettings settings;
+	GList *work = list;
+	GList *tail = nullptr;
+
+	settings.method = vf->sort_method;
+	settings.ascending = vf->sort_ascend;
+	settings.case_sensitive = vf->sort_case;
+
+	for (GList *file = files; file; file = file->next)
+		{
+		auto fd = static_cast<FileData *>(file->data);
+
+		while (work && filelist_sort_compare_filedata(static_cast<FileData *>(work->data), fd, &settings) <= 0)
+			{
+			work = work->next;
+			}
+
+		if (work)
+			{
+			list = g_list_insert_before(list, work, fd);
+			}
+		else
+			{
+			/* appending is O(n), add all of these at once */
+			tail = g_list_prepend(tail, fd);
+			}
+		}
+
+	g_list_free(files);
+
+	return g_list_concat(list, g_list_reverse(tail));
+}
+
+static void vf_stream_update(ViewFileStream *stream)
+{
+	ViewFile *vf = stream->vf;
+	GList *files = stream->pending;
+
+	stream->pending = nullptr;
+	stream->update_time = g_get_monotonic_time();
+
+	files = file_data_filter_marks_list(files, vf_marks_get_filter(vf));
+	files = file_data_filter_file_filter_list(files, vf_file_filter_get_filter(vf));
+	files = file_data_filter_class_list(files, vf_class_get_filter(vf));
+	files = filelist_sort(files, vf->sort_method, vf->sort_ascend, vf->sort_case);
+
+	if (files)
+		{
+		switch (vf->type)
+		{
+		case FILEVIEW_LIST: vflist_stream_add(vf, files); break;
+		case FILEVIEW_ICON: vficon_stream_add(vf, files); break;
+		}
+		}
+
+	vf_thumb_status(vf, filelist_read_progress(stream->reader), _("Reading folder..."));
+}
+
+static void vf_stream_free(ViewFileStream *stream)
+{
+	if (stream->idle_id) g_source_remove(stream->idle_id);
+	filelist_free(stream->pending);
+	g_free(stream);
+}
+
+static void vf_stream_finish(ViewFile *vf)
+{
+	ViewFileStream *stream = vf->stream;
+	GList *files;
+
+	vf->stream = nullptr;
+
+	gboolean notify = file_data_unregister_notify_func(vf_notify_cb, vf);
+	files = filelist_read_finish(stream->reader);
+	if (notify) file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+
+	vf_thumb_status(vf, 0.0, nullptr);
+
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: vflist_refresh_list(vf, files); break;
+	case FILEVIEW_ICON: vficon_refresh_list(vf, files); break;
+	}
+
+	if (stream->read_metadata) vf_read_metadata_in_idle(vf);
+	if (stream->refresh) vf_refresh_idle(vf);
+
+	stream->idle_id = 0;
+	vf_stream_free(stream);
+}
+
+/**
+ * @returns TRUE if there is more to read
+ */
+static gboolean vf_stream_step(ViewFileStream *stream, gint64 slice)
+{
+	ViewFile *vf = stream->vf;
+	gint64 now = g_get_monotonic_time();
+
+	/* we don't need the notification of changes detected while reading */
+	gboolean notify = file_data_unregister_notify_func(vf_notify_cb, vf);
+	gboolean more = filelist_read_step(stream->reader, &stream->pending, now + slice);
+	if (notify) file_data_register_notify_func(vf_notify_cb, vf, NOTIFY_PRIORITY_MEDIUM);
+
+	if (!more) return FALSE;
+
+	if (stream->pending && g_get_monotonic_time() - stream->update_time >= VF_STREAM_UPDATE_INTERVAL)
+		{
+		vf_stream_update(stream);
+		}
+
+	return TRUE;
+}
+
+static gboolean vf_stream_idle_cb(gpointer data)
+{
+	auto stream = static_cast<ViewFileStream *>(data);
+
+	if (vf_stream_step(stream, VF_STREAM_SLICE)) return G_SOURCE_CONTINUE;
+
+	stream->idle_id = 0;
+	vf_stream_finish(stream->vf);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Reads vf->dir_fd into the empty view
+ * @returns FALSE if the folder can not be read
+ *
+ * A folder that can not be read at once is shown in parts, see #ViewFileStream.
+ */
+gboolean vf_stream_start(ViewFile *vf)
+{
+	vf_stream_cancel(vf);
+
+	FileListReader *reader = vf->dir_fd ? filelist_read_begin(vf->dir_fd) : nullptr;
+	if (!reader)
+		{
+		vf_refresh(vf);
+		return FALSE;
+		}
+
+	auto stream = g_new0(ViewFileStream, 1);
+	stream->vf = vf;
+	stream->reader = reader;
+	stream->update_time = g_get_monotonic_time();
+	vf->stream = stream;
+
+	if (!vf_stream_step(stream, VF_STREAM_FIRST_SLICE))
+		{
+		vf_stream_finish(vf);
+		return TRUE;
+		}
+
+	DEBUG_1("%s vf_stream_start: reading %s in parts", get_exec_time(), vf->dir_fd->path);
+
+	/* show the first part now */
+	vf_stream_update(stream);
+
+	stream->idle_id = g_idle_add(vf_stream_idle_cb, stream);
+
+	return TRUE;
+}
+
+void vf_stream_cancel(ViewFile *vf)
+{
+	ViewFileStream *stream = vf->stream;
+
+	if (!stream) return;
+
+	vf->stream = nullptr;
+	filelist_read_cancel(stream->reader);
+	vf_stream_free(stream);
+}
+
+/**
+ * @brief Postpones a refresh until the folder is read
+ * @returns TRUE if the refresh was postponed
+ */
+gboolean vf_stream_defer_refresh(ViewFile *vf)
+{
+	if (!vf->stream) return FALSE;
+
+	vf->stream->refresh = TRUE;
+
+	return TRUE;
 }
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */